@@ -8,6 +8,10 @@
 #include <math.h>
 #include <time.h>
 #include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/random.h>
 #include <immintrin.h>
 
 #include <xxhash.h>
@@ -34,8 +38,9 @@ static inline uint64_t
 _pow2_next_u64(uint64_t n);
 
 static inline MapV_Hash_st
-_hash(const void*  key,
-      const size_t keyLen);
+_hash(const MapV_st* map,
+      const void*    key,
+      const size_t   keyLen);
 
 static inline uint64_t
 _hashhi_from_slot(const MapV_st*      map,
@@ -44,15 +49,53 @@ _hashhi_from_slot(const MapV_st*      map,
 static inline bool
 _hashes_are_equal(const MapV_Hash_st hash1, const MapV_Hash_st hash2);
 
+static void
+_hash_batch(const MapV_st*      map,
+            const void* const*  keys,
+            const size_t*       keyLens,
+            const uint64_t      keysCnt,
+                  MapV_Hash_st* hashes);
+
 static inline bool
 _hv_is_empty(const MapV_HV_st* hv);
 
 static inline MapV_BktId_t
 _bkt_from_slot(const MapV_SlotId_t slotId);
 
+static inline MapV_Bkt_st*
+_tbl_bkt(const MapV_st*     map,
+         const MapV_BktId_t bktId);
+
+static inline MapV_Bkt_st*
+_tbl_bkt_for_write(const MapV_st*     map,
+                   const MapV_BktId_t bktId);
+
+static inline MapV_HashLo_t
+_bkt_lo_get(const MapV_st*     map,
+            const MapV_Bkt_st* bkt,
+            const MapV_BktId_t bktSlotId);
+
+static inline void
+_bkt_lo_set(const MapV_st*      map,
+                  MapV_Bkt_st*  bkt,
+            const MapV_BktId_t  bktSlotId,
+            const MapV_HashLo_t lo);
+
+static inline MapV_Val_ut*
+_bkt_vals(const MapV_st*     map,
+          const MapV_Bkt_st* bkt);
+
 static inline MapV_BktId_t
 _bktslot_from_slot(const MapV_SlotId_t slotId);
 
+static inline void
+_bkt_prefetch(const MapV_st*     map,
+              const MapV_Hash_st hash);
+
+static inline MapV_SlotId_t
+_slot_from_norm(const MapV_st* map,
+                const uint64_t norm);
+
 static inline MapV_SlotId_t
 _slot_from_hash_hi(const MapV_st*      map,
                    const MapV_HashHi_t hashHi);
@@ -62,11 +105,31 @@ _slot_hash_hi_dist(const MapV_st*      map,
                    const MapV_HashHi_t hashHi,
                    const MapV_SlotId_t cmpSlotId);
 
+static inline MapV_SlotId_t
+_slot_from_hash(const MapV_st*     map,
+                const MapV_Hash_st hash);
+
+static inline int
+_bkt_match(const MapV_st*     map,
+           const MapV_Bkt_st* bkt,
+           const MapV_Hash_st hash);
+
+static inline int
+_bkt_match_lo(const MapV_st*     map,
+              const MapV_Bkt_st* bkt,
+              const MapV_Hash_st hash,
+                    int          found);
+
 static inline MapV_SlotId_t
 _slot_from_key(const MapV_st* map,
                const void*    key,
                const size_t   keyLen);
 
+static inline bool
+_find_hash(const MapV_st*     map,
+           const MapV_Hash_st hash,
+                 MapV_Val_ut* val);
+
 static inline void
 _tbl_cap_update(MapV_st* map);
 
@@ -89,21 +152,324 @@ _tbl_dist_update(MapV_st*      map,
                  MapV_HashHi_t hashHi,
                  MapV_SlotId_t slotId);
 
+static inline void
+_tbl_dist_raise(      MapV_st*    map,
+                const MapV_Dist_t slotDist,
+                const MapV_Dist_t bktDist);
+
 static inline bool
 _tbl_should_realloc(MapV_st* map);
 
+static inline bool
+_tbl_slot_in_reach(const MapV_st*      map,
+                   const MapV_HashHi_t hashHi,
+                   const MapV_SlotId_t slotId);
+
+static inline MapV_SlotId_t
+_tbl_reach_end(const MapV_st*      map,
+               const MapV_SlotId_t homeSlotId);
+
+static inline void
+_tbl_move_slots(const MapV_st*      map,
+                      MapV_SlotId_t dstSlotId,
+                      MapV_SlotId_t srcSlotId,
+                      uint64_t      cnt);
+
+static inline MapV_Err_et
+_tbl_upsert_hv(      MapV_st*       map,
+               const MapV_HV_st     newHv,
+                     MapV_SlotId_t* slotIdOut,
+                     bool*          inserted);
+
+static inline MapV_Err_et
+_tbl_upsert_probe(      MapV_st*       map,
+                  const MapV_HV_st     newHv,
+                        MapV_SlotId_t* slotIdOut,
+                        bool*          inserted);
+
+static inline MapV_Err_et
+_tbl_upsert_probe_scalar(      MapV_st*       map,
+                         const MapV_HV_st     newHv,
+                               MapV_SlotId_t* slotIdOut,
+                               bool*          inserted);
+
 static inline MapV_Err_et
 _tbl_insert_hv(      MapV_st*   map,
-                     MapV_HV_st newHv,
+               const MapV_HV_st newHv,
                const bool       overwriteIfExists);
 
+typedef struct _Scan_st _Scan_st;
+
+static uint64_t
+_scan_text(const MapV_st*        map,
+           const char*           buf,
+           const uint64_t        len,
+           const MapV_ScanHit_ft onHit,
+                 void*           ctx);
+
+typedef struct _Stream_st _Stream_st;
+
+static void
+_stream_init(      _Stream_st*   st,
+             const MapV_st*      map,
+             const MapV_SlotId_t slotId);
+
+static bool
+_stream_next(_Stream_st* st,
+             MapV_HV_st* hv);
+
+static void
+_stream_free(_Stream_st* st);
+
+static inline int
+_hash_cmp(const MapV_Hash_st hash1, const MapV_Hash_st hash2);
+
+static MapV_Err_et
+_split(const MapV_st*  map,
+       const uint32_t  bits,
+             MapV_st** out);
+
+static MapV_st*
+_export_range(const MapV_st* map,
+              const uint64_t hashLo,
+              const uint64_t hashHi);
+
+static MapV_st*
+_map_create_like(const MapV_st* like,
+                 const uint64_t entsCnt,
+                 const uint64_t hashLo,
+                 const uint64_t hashHi);
+
+static inline bool
+_tbl_fill_grow(      MapV_st*       map,
+               const MapV_HV_st*    hv,
+                     MapV_SlotId_t* fillSlotId);
+
+static uint64_t
+_ser_write(const MapV_st* map,
+                 FILE*    out);
+
+static MapV_st*
+_ser_read(      FILE*        in,
+          const MapV_Cfg_st* cfg);
+
+static MapV_st*
+_setop(const MapV_st*         a,
+       const MapV_st*         b,
+       const int              op,
+       const MapV_Conflict_ft onConflict,
+             void*            ctx);
+
+static MapV_st*
+_setop_many(const MapV_st* const*  maps,
+            const uint64_t         mapsCnt,
+            const MapV_Conflict_ft onConflict,
+                  void*            ctx);
+
+static inline MapV_Err_et
+_upsert_hash(      MapV_st*      map,
+                   MapV_Hash_st  hash,
+             const void*         key,
+             const size_t        keyLen,
+                   MapV_Val_ut** valPtr,
+                   bool*         inserted);
+
+static inline MapV_Err_et
+_insert_hash(      MapV_st*     map,
+                   MapV_Hash_st hash,
+             const void*        key,
+             const size_t       keyLen,
+             const MapV_Val_ut  val,
+             const bool         overwriteIfExists);
+
+static inline MapV_Val_ut*
+_tbl_val_ptr_from_slot(const MapV_st*      map,
+                       const MapV_SlotId_t slotId);
+
+static inline MapV_Val_ut*
+_tbl_val_ptr_for_write(const MapV_st*      map,
+                       const MapV_SlotId_t slotId);
+
+static inline MapV_Err_et
+_tbl_fill_hv(      MapV_st*       map,
+             const MapV_HV_st*    hv,
+                   MapV_SlotId_t* fillSlotId);
+
 static inline bool
 _tbl_redistribute_hashes(MapV_st* map,
                          MapV_st* oldMap);
 
+static inline MapV_Err_et
+_tbl_realloc(      MapV_st* cur,
+                   uint64_t slotsCap,
+             const uint64_t seed);
+
+static inline uint64_t
+_tbl_grow_cap(const MapV_st* map,
+              const uint64_t slotsCap);
+
 static inline bool
 _tbl_realloc_grow(MapV_st* cur);
 
+static inline uint64_t
+_tbl_bkts_extra(const MapV_Cfg_st* cfg);
+
+static inline void
+_tbl_delete_slot(      MapV_st*      map,
+                       MapV_SlotId_t slotId);
+
+static inline MapV_SlotId_t
+_tbl_delete_shift(const MapV_st*      map,
+                  const MapV_SlotId_t slotId);
+
+static inline MapV_SlotId_t
+_tbl_delete_shift_scalar(const MapV_st*      map,
+                               MapV_SlotId_t slotId);
+
+static inline bool
+_tbl_make_room(      MapV_st*      map,
+               const MapV_HashHi_t hashHi,
+               const bool          canReseed);
+
+static inline bool
+_tbl_reseed(MapV_st* map);
+
+static inline uint64_t
+_seed_random(const uint64_t prev);
+
+static inline void
+_tbl_mem_free(MapV_st* map);
+
+static inline void*
+_file_map(const MapV_st* map);
+
+static inline void
+_file_advise(const MapV_st* map,
+             const int      advice);
+
+static inline void
+_file_willneed(const MapV_st*      map,
+               const MapV_Hash_st* hashes,
+               const uint64_t      hashesCnt);
+
+static inline void*
+_shm_map(const MapV_st* map,
+         const uint64_t gen,
+         const uint64_t bytes,
+         const bool     create);
+
+static inline void
+_shm_unlink(const MapV_st* map,
+            const uint64_t gen);
+
+static inline void
+_shm_write_begin(const MapV_st* map);
+
+static inline void
+_shm_write_end(const MapV_st* map);
+
+static inline bool
+_shm_sync(MapV_st* map);
+
+static inline bool
+_shm_find_key(      MapV_st*     map,
+              const void*        key,
+              const size_t       keyLen,
+                    MapV_Val_ut* val);
+
+static inline bool
+_snap_frozen(const MapV_st* map);
+
+static bool
+_snap_pages(MapV_st* map);
+
+static inline uint64_t*
+_snap_refs(const MapV_Snap_st* snap,
+           const uint64_t      pageId);
+
+static inline void
+_snap_cow(const MapV_st*     map,
+          const MapV_BktId_t bktId);
+
+static inline void
+_snap_write_begin(MapV_st* map);
+
+static void
+_snap_fold(MapV_st* map);
+
+static void
+_snap_release(MapV_Snap_st* snap);
+
+static inline uint64_t
+_cache_bytes(const MapV_st* map,
+             const uint64_t slotsCap);
+
+static inline bool
+_cache_alloc(MapV_st* map);
+
+static inline bool
+_cache_ref_get(const MapV_st*      map,
+               const MapV_SlotId_t slotId);
+
+static inline void
+_cache_ref_put(const MapV_st*      map,
+               const MapV_SlotId_t slotId,
+               const bool          on);
+
+static inline void
+_cache_ref_move(const MapV_st*      map,
+                const MapV_SlotId_t dstSlotId,
+                const MapV_SlotId_t srcSlotId);
+
+static inline void
+_cache_touch(      MapV_st*      map,
+             const MapV_SlotId_t slotId);
+
+static inline bool
+_cache_evict(      MapV_st*      map,
+             const MapV_HashHi_t hashHi);
+
+static inline bool
+_hot_alloc(MapV_st* map);
+
+static inline void
+_hot_touch(      MapV_st*      map,
+           const MapV_SlotId_t slotId);
+
+static uint64_t
+_hot_optimize(MapV_st* map);
+
+static inline MapV_BktId_t
+_cuckoo_bkt_alt(const MapV_st*     map,
+                const MapV_Hash_st hash);
+
+static inline MapV_SlotId_t
+_cuckoo_slot_from_hash(const MapV_st*     map,
+                       const MapV_Hash_st hash);
+
+static inline bool
+_cuckoo_bfs(      MapV_st*       map,
+            const MapV_Hash_st   hash,
+                  MapV_SlotId_t* slotIdOut);
+
+static inline MapV_Err_et
+_cuckoo_upsert_hv(      MapV_st*       map,
+                  const MapV_HV_st     newHv,
+                        MapV_SlotId_t* slotIdOut,
+                        bool*          inserted);
+
+static inline uint64_t
+_arena_alloc(MapV_st* map,
+             uint64_t cap);
+
+static bool
+_arena_compact_grow(MapV_st* map,
+                    uint64_t need);
+
+static inline void
+_multi_release(MapV_st*      map,
+               MapV_SlotId_t slotId);
+
 
 
 
@@ -122,6 +488,47 @@ MapV_Create(const MapV_Cfg_st* cfg)
     printf("attempted to configure with %d bytes\n", cfg->memAlign);
     return NULL;
   }
+  if (cfg->set && cfg->multi) {
+    printf("a map can't be both a set and a multimap\n");
+    return NULL;
+  }
+  if (cfg->cacheBytes && cfg->multi) {
+    printf("a cache can't be a multimap\n");
+    return NULL;
+  }
+  if (cfg->cacheBytes && cfg->cuckoo) {
+    printf("a cache can't use the cuckoo engine\n");
+    return NULL;
+  }
+  if (cfg->hotCounters && cfg->cuckoo) {
+    printf("the cuckoo engine has no access counters\n");
+    return NULL;
+  }
+  if (cfg->filePath && (cfg->cuckoo || cfg->cacheBytes)) {
+    printf("a file backed table can't be a cache or use the cuckoo engine\n");
+    return NULL;
+  }
+  if (cfg->shmName && (cfg->multi || cfg->cacheBytes || cfg->filePath)) {
+    printf("a shared memory map can't be a multimap, a cache or file backed\n");
+    return NULL;
+  }
+  const bool     allHashes = (0 == cfg->hashLo && 0 == cfg->hashHi);
+  const uint64_t hashHi    = allHashes ? UINT64_MAX : cfg->hashHi;
+  if (cfg->hashLo > hashHi) {
+    printf("hash range is empty: %"PRIx64" > %"PRIx64"\n", cfg->hashLo, hashHi);
+    return NULL;
+  }
+  if (cfg->growPct && (cfg->growPct < 110 || cfg->growPct > 200)) {
+    printf("growth must be 110 to 200 percent\n");
+    printf("attempted to configure with %"PRIu32"%%\n", cfg->growPct);
+    return NULL;
+  }
+  const uint32_t fpBits = cfg->fpBits ? cfg->fpBits : 128;
+  if (64 != fpBits && 96 != fpBits && 128 != fpBits) {
+    printf("fingerprint width must be 64, 96 or 128 bits\n");
+    printf("attempted to configure with %"PRIu32" bits\n", cfg->fpBits);
+    return NULL;
+  }
 
   MapV_st* map = calloc(1, sizeof(*map));
 
@@ -129,11 +536,82 @@ MapV_Create(const MapV_Cfg_st* cfg)
   map->cfg.distBktMax    = cfg->distBktMax;
   map->cfg.capPctMax     = cfg->capPctMax;
   map->cfg.memAlign      = cfg->memAlign;
+  map->cfg.multi         = cfg->multi;
+  map->cfg.set           = cfg->set;
+  map->cfg.fpBits        = fpBits;
+  map->cfg.hashLo        = cfg->hashLo;
+  map->cfg.hashHi        = hashHi;
+  map->cfg.cacheBytes    = cfg->cacheBytes;
+  map->cfg.cuckoo        = cfg->cuckoo;
+  map->cfg.growPct       = cfg->growPct ? cfg->growPct : 200;
+  map->cfg.hotCounters   = cfg->hotCounters;
+  map->cfg.seed          = cfg->seed;
+  map->cfg.keyOf         = cfg->keyOf;
+  map->cfg.keyOfCtx      = cfg->keyOfCtx;
+  map->meta.seed         = cfg->seed;
+
+  // stretch the range over the whole slot space; see _slot_from_hash_hi()
+  map->meta.hashLo       = cfg->hashLo;
+  map->meta.hashSpan     = hashHi - cfg->hashLo;
+  map->meta.hashSkip     = map->meta.hashSpan
+                         ? __builtin_clzll(map->meta.hashSpan) : 0;
+
+  // [ hi lane: 4x u64 ][ lo lane: 4x u64 | 4x u32 | - ][ vals: 4x u64 | - ]
+  const uint64_t loBytes = (fpBits - 64) / 8 * MAPV_BKT_SLOTS;
+  map->meta.bktValOff    = sizeof(MapV_HashHi_t) * MAPV_BKT_SLOTS + loBytes;
+  map->meta.bktBytes     = map->meta.bktValOff
+                         + (cfg->set ? 0 : sizeof(MapV_Val_ut) * MAPV_BKT_SLOTS);
+  map->meta.hashLoMask   = (128 == fpBits) ? UINT64_MAX
+                         : ( 96 == fpBits) ? UINT32_MAX
+                         :                   0;
   map->meta.slotsCap     = cfg->initialSlotCount;
   map->meta.distSlotIter = 1;
   map->meta.distBktIter  = 1;
 
+  if (cfg->filePath) {
+    map->tbl.path       = strdup(cfg->filePath);
+    map->cfg.filePath   = map->tbl.path;
+    map->meta.pageBytes = sysconf(_SC_PAGESIZE);
+    map->meta.pageBkts  = map->meta.pageBytes / map->meta.bktBytes;
+    const uint64_t spare = (map->meta.pageBkts > MAPV_FILE_PAGE_SPARE)
+                         ? map->meta.pageBkts / MAPV_FILE_PAGE_SPARE : 1;
+    map->meta.pageHomeSlots = (map->meta.pageBkts - spare) * MAPV_BKT_SLOTS;
+  }
+
+  if (cfg->shmName) {
+    map->shm.name     = strdup(cfg->shmName);
+    map->cfg.shmName  = map->shm.name;
+    map->shm.hdr      = _shm_map(map, 0, sizeof(*map->shm.hdr), true);
+    if (NULL == map->shm.hdr) {
+      free(map->shm.name);
+      free(map->tbl.path);
+      free(map);
+      return NULL;
+    }
+    map->shm.hdr->cfg = map->cfg;
+    __atomic_store_n(&map->shm.hdr->magic, MAPV_SHM_MAGIC, __ATOMIC_RELEASE);
+  }
+
+  if (cfg->hotCounters && !_hot_alloc(map)) {
+    MapV_Destroy(map);
+    return NULL;
+  }
+
+  if (cfg->cacheBytes) {
+    if (!_cache_alloc(map)) {
+      free(map->hot.cnt);
+      free(map);
+      return NULL;
+    }
+    return map;
+  }
+
   if (!_tbl_realloc_grow(map)) {
+    // a file or shared memory can fail to be made; memory, we assume, won't
+    if (map->tbl.path || map->shm.hdr) {
+      MapV_Destroy(map);
+      return NULL;
+    }
     free(map);
     printf("_tbl_realloc_grow() failed\n");
     exit(1);
@@ -151,26 +629,109 @@ MapV_Insert(      MapV_st*    map,
             const MapV_Val_ut val,
             const bool        overwriteIfExists)
 {
-  MapV_HV_st newHv = { .hash = _hash(key, keyLen), .val = val, };
+  if (map->cfg.set) {
+    return MAPV_ERR__SET_HAS_NO_VALS;
+  }
+
+  return _insert_hash(map, _hash(map, key, keyLen), key, keyLen, val,
+                      overwriteIfExists);
+}
+
+//------------------------------------------------------------------------------
+MapV_Hash_st
+MapV_Hash(const MapV_st* map,
+          const void*    key,
+          const size_t   keyLen)
+{
+  return _hash(map, key, keyLen);
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_InsertHash(      MapV_st*     map,
+                const MapV_Hash_st hash,
+                const MapV_Val_ut  val,
+                const bool         overwriteIfExists)
+{
+  return _insert_hash(map, hash, NULL, 0, val, overwriteIfExists);
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_Prefetch(const MapV_st*     map,
+              const MapV_Hash_st hash)
+{
+  _bkt_prefetch(map, hash);
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_UpsertHash(      MapV_st*      map,
+                const MapV_Hash_st  hash,
+                      MapV_Val_ut** valPtr,
+                      bool*         inserted)
+{
+  if (map->cfg.set) {
+    return MAPV_ERR__SET_HAS_NO_VALS;
+  }
+
+  return _upsert_hash(map, hash, NULL, 0, valPtr, inserted);
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: one hash, one probe. the returned pointer is into the table, so it's
+//        only valid until the next insert/delete/grow.
+MapV_Err_et
+MapV_Upsert(      MapV_st*      map,
+            const void*         key,
+            const size_t        keyLen,
+                  MapV_Val_ut** valPtr,
+                  bool*         inserted)
+{
+  if (map->cfg.set) {
+    return MAPV_ERR__SET_HAS_NO_VALS;
+  }
+
+  return _upsert_hash(map, _hash(map, key, keyLen), key, keyLen, valPtr,
+                      inserted);
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: not safe to call from more than one thread, even for keys that
+//        already exist: the upsert checks whether the table must grow before
+//        it probes, a cache's ref bit and the onInsert hook are plain writes,
+//        and after a MapV_Snapshot() it may copy a page (see _snap_cow()).
+//        threads that need to add into one table should each keep their own
+//        (see MapV_Agg.h).
+MapV_Err_et
+MapV_UpsertAdd(      MapV_st*  map,
+               const void*     key,
+               const size_t    keyLen,
+               const uint64_t  delta,
+                     uint64_t* newVal)
+{
+  if (map->cfg.set) {
+    return MAPV_ERR__SET_HAS_NO_VALS;
+  }
+
+  const MapV_Hash_st hash = _hash(map, key, keyLen);
+        MapV_Val_ut* valPtr;
+        bool         inserted;
 
   MapV_Err_et err;
-  if (MAPV_ERR__OK != (err = _tbl_insert_hv(map, newHv, overwriteIfExists))) {
-    if (MAPV_ERR__TABLE_MUST_GROW == err) {
-      if (!_tbl_realloc_grow(map)) {
-        printf("MapV_Insert(): _tbl_realloc_grow() failed\n");
-        return MAPV_ERR__TABLE_GROW_FAILED;
-      }
-    }
-    // it's possible to get here? can't insert, but shouldn't realloc?
-  } else {
-    map->meta.slotsUsed++;
-    _tbl_cap_update(map);
-    return MAPV_ERR__OK;
+  if (MAPV_ERR__OK != (err = _upsert_hash(map, hash, key, keyLen, &valPtr,
+                                          &inserted))) {
+    return err;
   }
 
-  // should always return MAPV_ERR__OK at this point...?
-  // @TODO: vertify
-  return _tbl_insert_hv(map, newHv, overwriteIfExists);
+  const uint64_t val = (valPtr->u64 += delta);
+  if (NULL != newVal) {
+    *newVal = val;
+  }
+  if (NULL != map->hook.onInsert) {
+    map->hook.onInsert(map->hook.ctx, hash, (MapV_Val_ut){ .u64 = val });
+  }
+  return MAPV_ERR__OK;
 }
 
 //------------------------------------------------------------------------------
@@ -187,7 +748,26 @@ MapV_Find(      MapV_st*     map,
           const size_t       keyLen,
                 MapV_Val_ut* val)
 {
-  const MapV_Hash_st  hash     = _hash(key, keyLen);
+  if (map->shm.reader) {
+    return _shm_find_key(map, key, keyLen, val);
+  }
+
+  // this loop is for the default bucket layout only; sets and narrower
+  // fingerprints go through _slot_from_hash(), which handles every layout,
+  // as do cuckoo, file backed and snapshotted tables
+  if (   sizeof(MapV_Bkt_st) != map->meta.bktBytes
+      || map->cfg.cuckoo || map->meta.pageBkts || NULL != map->snap) {
+    const MapV_SlotId_t slotId = _slot_from_key(map, key, keyLen);
+    _cache_touch(map, slotId);
+    _hot_touch(map, slotId);
+    if (UINT64_MAX == slotId) {
+      return false;
+    }
+    val->u64 = map->cfg.set ? 0 : _tbl_val_ptr_from_slot(map, slotId)->u64;
+    return true;
+  }
+
+  const MapV_Hash_st  hash     = _hash(map, key, keyLen);
         MapV_SlotId_t slotId   = _slot_from_hash_hi(map, hash.high64);
   const __m256i       needleHi = _mm256_set1_epi64x(hash.high64);
   const __m256i       needleLo = _mm256_set1_epi64x(hash.low64);
@@ -198,21 +778,18 @@ MapV_Find(      MapV_st*     map,
   const int maxIters = map->meta.distBktIter;
   for (int iter = 0; iter < maxIters; iter++)
   {
-    // @NOTE: `| 0x100` in _mm256_movemask_pd is to set a highest bit as
-    //        an indicator that nothing was found.
-    //        when no matches were found, idxHi/Lo will == 8.
-    //        could also set to 0x10 and check idx is 4.
-    //        but that's less clear, given we're working with 4 array indices.
+    // @NOTE: two entries can share a high64, so a slot is a match only
+    //        when both of its lanes are; see _bkt_match().
 
     const MapV_BktId_t bktId = slotId / MAPV_BKT_SLOTS;
 
   	map->stats.mm256Loads++;
     haystack = _mm256_load_si256((__m256i*)map->tbl.bkt[bktId].slotsHi);
     found    = _mm256_cmpeq_epi64(haystack, needleHi);
-    const int idxHi = __builtin_ctz(_mm256_movemask_pd((__m256d)found) | 0x100);
+    const int hiMask = _mm256_movemask_pd((__m256d)found);
 
     // somehow runs about the same speed with vs without this branch
-    if (idxHi == 8) { // not found
+    if (0 == hiMask) { // not found
       slotId += MAPV_BKT_SLOTS;
       continue;
     }
@@ -220,620 +797,4792 @@ MapV_Find(      MapV_st*     map,
   	map->stats.mm256Loads++;
     haystack = _mm256_load_si256((__m256i*)map->tbl.bkt[bktId].slotsLo);
     found    = _mm256_cmpeq_epi64(haystack, needleLo);
-    const int idxLo = __builtin_ctz(_mm256_movemask_pd((__m256d)found) | 0x100);
-    if (idxHi == idxLo) { // found
-      val->u64 = map->tbl.bkt[bktId].vals[idxLo].u64;
+    const int match = hiMask & _mm256_movemask_pd((__m256d)found);
+    if (0 != match) { // found
+      const int idx = __builtin_ctz(match);
+      _cache_touch(map, bktId * MAPV_BKT_SLOTS + idx);
+      _hot_touch(map, bktId * MAPV_BKT_SLOTS + idx);
+      val->u64 = map->tbl.bkt[bktId].vals[idx].u64;
       return true;
     }
 
     // not found
     slotId += MAPV_BKT_SLOTS;
   }
+  _cache_touch(map, UINT64_MAX);
   return false;
 }
 
 //------------------------------------------------------------------------------
-// @TODO: there may be a better way to implement this...?
-MapV_Err_et
-MapV_Delete(      MapV_st* map,
-            const void*    key,
-            const size_t   keyLen)
+// @NOTE: keys are hashed MAPV_FIND_BATCH at a time, and every home bucket in
+//        the group is prefetched before the first one is probed. for tables
+//        that don't fit in cache, the bucket misses then overlap instead of
+//        being paid one after another like in a MapV_Find() loop.
+//
+//        doesn't update map->stats, so any number of threads may call this
+//        on the same map, as long as nothing is writing to it. except a
+//        MapV_ShmAttach() map, which syncs with its writer: one thread each.
+uint64_t
+MapV_FindBatch(const MapV_st*     map,
+               const void* const* keys,
+               const size_t*      keyLens,
+               const uint64_t     keysCnt,
+                     MapV_Val_ut* vals,
+                     bool*        found)
 {
-	MapV_SlotId_t curSlotId;
-	if (UINT64_MAX == (curSlotId = _slot_from_key(map, key, keyLen))) {
-		return MAPV_ERR__DELETE_KEY_NOT_FOUND;
-	}
+  MapV_Hash_st hashes[MAPV_FIND_BATCH];
+  uint64_t     hits = 0;
 
-	MapV_HashHi_t hashHi = _hashhi_from_slot(map, curSlotId);
-	MapV_Dist_t   dist   = _slot_hash_hi_dist(map, hashHi, curSlotId);
-	_tbl_clear_slot(map, curSlotId);
+  for (uint64_t beg = 0; beg < keysCnt; beg += MAPV_FIND_BATCH)
+  {
+    const uint64_t cnt = (keysCnt - beg < MAPV_FIND_BATCH)
+                       ? (keysCnt - beg)
+                       : MAPV_FIND_BATCH;
+
+    _hash_batch(map, &keys[beg], &keyLens[beg], cnt, hashes);
+    _file_willneed(map, hashes, cnt);
+    for (uint64_t i = 0; i < cnt; i++) {
+      _bkt_prefetch(map, hashes[i]);
+    }
 
-	do
-	{
-		const MapV_SlotId_t nextSlotId = curSlotId + 1;
+    for (uint64_t i = 0; i < cnt; i++) {
+      found[beg + i] = map->shm.reader
+                     ? _shm_find_key((MapV_st*)map, keys[beg + i],
+                                     keyLens[beg + i], &vals[beg + i])
+                     : _find_hash(map, hashes[i], &vals[beg + i]);
+      hits          += found[beg + i];
+    }
+  }
 
-		MapV_HV_st nextSlotHv;
-		_tbl_get_hv_from_slot(map, nextSlotId, &nextSlotHv);
-		if (_hv_is_empty(&nextSlotHv)) {
-			break;
-		}
+  return hits;
+}
 
-		_tbl_clear_slot(map, nextSlotId);
+//------------------------------------------------------------------------------
+// @NOTE: MapV_FindBatch() without the hashing; the same groups and prefetches
+uint64_t
+MapV_FindHashBatch(const MapV_st*      map,
+                   const MapV_Hash_st* hashes,
+                   const uint64_t      hashesCnt,
+                         MapV_Val_ut*  vals,
+                         bool*         found)
+{
+  if (map->shm.reader) {
+    memset(found, 0, hashesCnt * sizeof(*found));
+    memset(vals,  0, hashesCnt * sizeof(*vals));
+    return 0;
+  }
 
-		dist = _slot_hash_hi_dist(map, nextSlotHv.hash.high64, nextSlotId);
-		if (dist == 0) {
-			break;
-		}
-		_tbl_set_hv_into_slot(map, curSlotId, &nextSlotHv);
+  uint64_t hits = 0;
+  for (uint64_t beg = 0; beg < hashesCnt; beg += MAPV_FIND_BATCH)
+  {
+    const uint64_t cnt = (hashesCnt - beg < MAPV_FIND_BATCH)
+                       ? (hashesCnt - beg)
+                       : MAPV_FIND_BATCH;
+
+    _file_willneed(map, &hashes[beg], cnt);
+    for (uint64_t i = 0; i < cnt; i++) {
+      _bkt_prefetch(map, hashes[beg + i]);
+    }
+    for (uint64_t i = 0; i < cnt; i++) {
+      found[beg + i] = _find_hash(map, hashes[beg + i], &vals[beg + i]);
+      hits          += found[beg + i];
+    }
+  }
 
-		curSlotId++;
+  return hits;
+}
 
-	} while (dist > 0);
+//------------------------------------------------------------------------------
+// @NOTE: _slot_from_hash() reads through _tbl_bkt(), so after a
+//        MapV_Snapshot() nothing is copied and nothing grows.
+const MapV_Val_ut*
+MapV_FindHashPtr(const MapV_st*     map,
+                 const MapV_Hash_st hash)
+{
+  if (map->cfg.set || map->cfg.multi || map->shm.reader) {
+    return NULL;
+  }
 
-  return MAPV_ERR__OK;
+  const MapV_SlotId_t slotId = _slot_from_hash(map, hash);
+  return (UINT64_MAX == slotId) ? NULL : _tbl_val_ptr_from_slot(map, slotId);
 }
 
 //------------------------------------------------------------------------------
-MapV_Err_et
-MapV_Destroy(MapV_st* map)
+// @NOTE: only the found value's page is copied, if a snapshot shares it
+MapV_Val_ut*
+MapV_FindHashPtrForWrite(      MapV_st*     map,
+                         const MapV_Hash_st hash)
 {
-  // @TODO: test
-	if (NULL != map) {
-		if (NULL != map->tbl.bktPtrReal) {
-			free(map->tbl.bktPtrReal);
-		} else {
-			// still allow the map to free...
+  if (   map->cfg.set || map->cfg.multi || map->shm.reader
+      || _snap_frozen(map)) {
+    return NULL;
+  }
+
+  const MapV_SlotId_t slotId = _slot_from_hash(map, hash);
+  return (UINT64_MAX == slotId) ? NULL : _tbl_val_ptr_for_write(map, slotId);
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_HashBatch(const MapV_st*      map,
+               const void* const*  keys,
+               const size_t*       keyLens,
+               const uint64_t      keysCnt,
+                     MapV_Hash_st* hashes)
+{
+  _hash_batch(map, keys, keyLens, keysCnt, hashes);
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: like MapV_FindBatch(), a group's home buckets are prefetched before
+//        the first insert; inserts that shift entries or grow the table
+//        touch more than that, so the win is mostly in the hashing.
+MapV_Err_et
+MapV_InsertBatch(      MapV_st*     map,
+                 const void* const* keys,
+                 const size_t*      keyLens,
+                 const uint64_t     keysCnt,
+                 const MapV_Val_ut* vals,
+                 const bool         overwriteIfExists)
+{
+  if (map->cfg.set) {
+    return MAPV_ERR__SET_HAS_NO_VALS;
+  }
+
+  MapV_Hash_st hashes[MAPV_FIND_BATCH];
+
+  for (uint64_t beg = 0; beg < keysCnt; beg += MAPV_FIND_BATCH)
+  {
+    const uint64_t cnt = (keysCnt - beg < MAPV_FIND_BATCH)
+                       ? (keysCnt - beg)
+                       : MAPV_FIND_BATCH;
+
+    _hash_batch(map, &keys[beg], &keyLens[beg], cnt, hashes);
+    _file_willneed(map, hashes, cnt);
+    for (uint64_t i = 0; i < cnt; i++) {
+      _bkt_prefetch(map, hashes[i]);
+    }
+
+    const uint64_t seed = map->meta.seed;
+    for (uint64_t i = 0; i < cnt; i++) {
+      // a reseed (cfg.keyOf) changed every hash; the group's rest are stale
+      if (seed != map->meta.seed) {
+        hashes[i] = _hash(map, keys[beg + i], keyLens[beg + i]);
+      }
+      const MapV_Err_et err = _insert_hash(map, hashes[i], keys[beg + i],
+                                           keyLens[beg + i], vals[beg + i],
+                                           overwriteIfExists);
+      if (MAPV_ERR__OK != err && MAPV_ERR__INSERT_KEY_EXISTS != err) {
+        return err;
+      }
+    }
+  }
+
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: the hashes are counting sorted by home slot in the table as sized
+//        for them, then each home slot's few by hash, so they're in hash
+//        order: two passes over the input, where a sort would take log n.
+//        filling is then _setop()'s, and a grow part way (distSlotMax etc.)
+//        carries on in the bigger table, since hash order is home slot
+//        order at any size.
+MapV_Err_et
+MapV_BulkLoad(      MapV_st*      map,
+              const MapV_Hash_st* hashes,
+              const MapV_Val_ut*  vals,
+              const uint64_t      hashesCnt)
+{
+  if (map->shm.reader) {
+    return MAPV_ERR__SHM_READ_ONLY;
+  }
+  if (_snap_frozen(map)) {
+    return MAPV_ERR__SNAPSHOT_READ_ONLY;
+  }
+  if (0 != map->meta.slotsUsed) {
+    return MAPV_ERR__BULK_LOAD_NOT_EMPTY;
+  }
+  if (map->cfg.multi || map->cfg.cuckoo || map->cfg.cacheBytes) {
+    printf("MapV_BulkLoad(): not for multimaps, cuckoo maps or caches\n");
+    return MAPV_ERR__BULK_LOAD_UNSUPPORTED;
+  }
+  for (uint64_t i = 0; i < hashesCnt; i++) {
+    if (hashes[i].high64 - map->meta.hashLo > map->meta.hashSpan) {
+      return MAPV_ERR__HASH_OUT_OF_RANGE;
+    }
+  }
+
+  //---------------------------
+  // size for every hash up front, as MapV_Deserialize() does
+  const uint64_t slotsNeed = (map->cfg.capPctMax > 0)
+                           ? (uint64_t)(hashesCnt * 100 / map->cfg.capPctMax) + 1
+                           : hashesCnt;
+  if (slotsNeed > map->meta.slotsCap)
+  {
+    uint64_t slotsCap = map->meta.slotsCap;
+    while (slotsCap < slotsNeed) {
+      slotsCap = _tbl_grow_cap(map, slotsCap);
+    }
+    if (MAPV_ERR__OK != _tbl_realloc(map, slotsCap, map->meta.seed)) {
+      return MAPV_ERR__TABLE_GROW_FAILED;
+    }
+  }
+
+  //---------------------------
+  // counting sort by home slot, then hash order within each home slot.
+  // equal hashes stay in input order, so the last of them is the one kept.
+  const uint64_t homesCnt = map->meta.slotsCapReal + 1;
+  uint64_t*      offs     = calloc(homesCnt, sizeof(*offs));
+  uint64_t*      order    = malloc((hashesCnt ? hashesCnt : 1) * sizeof(*order));
+  if (NULL == offs || NULL == order) {
+    free(offs);
+    free(order);
+    return MAPV_ERR__TABLE_GROW_FAILED;
+  }
+  for (uint64_t i = 0; i < hashesCnt; i++) {
+    offs[_slot_from_hash_hi(map, hashes[i].high64) + 1]++;
+  }
+  for (uint64_t h = 1; h < homesCnt; h++) {
+    offs[h] += offs[h - 1];
+  }
+  for (uint64_t i = 0; i < hashesCnt; i++) {
+    order[offs[_slot_from_hash_hi(map, hashes[i].high64)]++] = i;
+  }
+  free(offs);
+
+  MapV_SlotId_t fillSlotId = 0;
+  MapV_Err_et   err        = MAPV_ERR__OK;
+  for (uint64_t beg = 0; beg < hashesCnt && MAPV_ERR__OK == err; )
+  {
+    // one home slot's hashes, by hash; insertion sort, there are a few
+    const MapV_SlotId_t home = _slot_from_hash_hi(map, hashes[order[beg]].high64);
+    uint64_t            end  = beg + 1;
+    for (; end < hashesCnt
+           && home == _slot_from_hash_hi(map, hashes[order[end]].high64); end++) {
+      const uint64_t idx = order[end];
+      uint64_t       j   = end;
+      while (j > beg && _hash_cmp(hashes[order[j - 1]], hashes[idx]) > 0) {
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = idx;
+    }
+
+    for (uint64_t k = beg; k < end && MAPV_ERR__OK == err; k++)
+    {
+      // the next is the same hash, given later: it wins
+      if (k + 1 < end && 0 == _hash_cmp(hashes[order[k]], hashes[order[k + 1]])) {
+        continue;
+      }
+      const MapV_HV_st hv = {
+        .hash = hashes[order[k]],
+        .val  = (NULL != vals && !map->cfg.set) ? vals[order[k]] : (MapV_Val_ut){0},
+      };
+      if (!_tbl_fill_grow(map, &hv, &fillSlotId)) {
+        err = MAPV_ERR__TABLE_GROW_FAILED;
+      } else if (NULL != map->hook.onInsert) {
+        map->hook.onInsert(map->hook.ctx, hv.hash, hv.val);
+      }
+    }
+    beg = end;
+  }
+  free(order);
+
+  _tbl_cap_update(map);
+  return err;
+}
+
+//------------------------------------------------------------------------------
+// doesn't update map->stats; safe for concurrent readers. see _scan...()
+uint64_t
+MapV_ScanText(const MapV_st*        map,
+              const char*           buf,
+              const uint64_t        len,
+              const MapV_ScanHit_ft onHit,
+                    void*           ctx)
+{
+  return _scan_text(map, buf, len, onHit, ctx);
+}
+
+//------------------------------------------------------------------------------
+// @TODO: there may be a better way to implement this...?
+MapV_Err_et
+MapV_Delete(      MapV_st* map,
+            const void*    key,
+            const size_t   keyLen)
+{
+  return MapV_DeleteHash(map, _hash(map, key, keyLen));
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_DeleteHash(      MapV_st*     map,
+                const MapV_Hash_st hash)
+{
+	if (map->shm.reader) {
+		return MAPV_ERR__SHM_READ_ONLY;
+	}
+	if (_snap_frozen(map)) {
+		return MAPV_ERR__SNAPSHOT_READ_ONLY;
+	}
+
+	MapV_SlotId_t curSlotId;
+	if (UINT64_MAX == (curSlotId = _slot_from_hash(map, hash))) {
+		return MAPV_ERR__DELETE_KEY_NOT_FOUND;
+	}
+
+	if (map->cfg.multi) {
+		_multi_release(map, curSlotId);
+	}
+	_tbl_delete_slot(map, curSlotId);
+
+	if (NULL != map->hook.onDelete) {
+		map->hook.onDelete(map->hook.ctx, hash);
+	}
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_Destroy(MapV_st* map)
+{
+  // @TODO: test
+	if (NULL != map) {
+		if (NULL != map->tbl.bktPtrReal) {
+			_tbl_mem_free(map);
+		} else {
+			// still allow the map to free...
 			// return MAPV_ERR__DESTROY_MAP_BKTPTRREAL_IS_NULL;
 		}
+		free(map->arena.vals);
+		free(map->tbl.ref);
+		free(map->hot.cnt);
+		free(map->tbl.path);
+		if (NULL != map->shm.hdr) {
+			munmap(map->shm.hdr, sizeof(*map->shm.hdr));
+			if (!map->shm.reader) {
+				shm_unlink(map->shm.name);
+			}
+		}
+		free(map->shm.name);
 		free(map);
 	} else {
 		return MAPV_ERR__DESTROY_MAP_IS_NULL;
 	}
 
-  return MAPV_ERR__OK;
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: slot order is home slot order, which is hash order (except with
+//        cfg.cuckoo, where it's no particular order). so a walk hands
+//        out entries in the order _tbl_redistribute_hashes() would re-insert
+//        them, and re-inserting them in that order never shifts anything.
+bool
+MapV_Next(const MapV_st*       map,
+                MapV_SlotId_t* slotId,
+                MapV_Hash_st*  hash,
+                MapV_Val_ut*   val)
+{
+  for (; *slotId < map->meta.slotsCapReal; (*slotId)++)
+  {
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, *slotId, &hv);
+    if (_hv_is_empty(&hv)) {
+      continue;
+    }
+    *hash = hv.hash;
+    *val  = hv.val;
+    (*slotId)++;
+    return true;
+  }
+  return false;
+}
+
+
+
+
+
+//==============================================================================
+//
+// MapV_Multi*() : multimap
+//
+// @NOTE: a key with one value keeps it inline in its slot, so the common
+//        case (most tokens appear in a single doc) costs nothing extra.
+//        lists live in map->arena; a full block is copied to one twice its
+//        size and the old one becomes dead space. when the arena fills up,
+//        every live block is copied into a new arena in one pass over the
+//        table, which is where dead space is reclaimed.
+//
+//------------------------------------------------------------------------------
+#define MAPV_MULTI_TAG     ((uint64_t)1 << 63)
+#define MAPV_MULTI_CAP_MIN 4
+#define MAPV_ARENA_CAP_MIN 1024
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_MultiAppend(      MapV_st*    map,
+                 const void*       key,
+                 const size_t      keyLen,
+                 const MapV_Val_ut val)
+{
+  if (map->cfg.set) {
+    return MAPV_ERR__SET_HAS_NO_VALS;
+  }
+  if (!map->cfg.multi) {
+    return MAPV_ERR__MULTI_NOT_ENABLED;
+  }
+  if (val.u64 & MAPV_MULTI_TAG) {
+    return MAPV_ERR__MULTI_VAL_TOO_BIG;
+  }
+
+  MapV_Val_ut* slotVal;
+  bool         inserted;
+
+  MapV_Err_et err;
+  if (MAPV_ERR__OK != (err = MapV_Upsert(map, key, keyLen, &slotVal, &inserted))) {
+    return err;
+  }
+  if (inserted) {
+    *slotVal = val;
+    return MAPV_ERR__OK;
+  }
+
+  // the slot doesn't move while we're in here; only arena offsets can,
+  // so re-read the slot value after any _arena_alloc().
+
+  if (!(slotVal->u64 & MAPV_MULTI_TAG)) {
+    const uint64_t off = _arena_alloc(map, MAPV_MULTI_CAP_MIN);
+    if (UINT64_MAX == off) {
+      return MAPV_ERR__MULTI_ALLOC_FAILED;
+    }
+    MapV_Val_ut* blk = &map->arena.vals[off];
+    blk[0].u64    = ((uint64_t)MAPV_MULTI_CAP_MIN << 32) | 2;
+    blk[1]        = *slotVal;
+    blk[2]        = val;
+    slotVal->u64  = MAPV_MULTI_TAG | off;
+    return MAPV_ERR__OK;
+  }
+
+  uint64_t off = slotVal->u64 & ~MAPV_MULTI_TAG;
+  uint64_t cnt = map->arena.vals[off].u64 & UINT32_MAX;
+  uint64_t cap = map->arena.vals[off].u64 >> 32;
+
+  if (cnt < cap) {
+    map->arena.vals[off + 1 + cnt] = val;
+    map->arena.vals[off].u64++;
+    return MAPV_ERR__OK;
+  }
+
+  const uint64_t newOff = _arena_alloc(map, cap * 2);
+  if (UINT64_MAX == newOff) {
+    return MAPV_ERR__MULTI_ALLOC_FAILED;
+  }
+  off = slotVal->u64 & ~MAPV_MULTI_TAG;
+
+  MapV_Val_ut* blk = &map->arena.vals[newOff];
+  memcpy(&blk[1], &map->arena.vals[off + 1], cnt * sizeof(*blk));
+  blk[1 + cnt]  = val;
+  blk[0].u64    = ((cap * 2) << 32) | (cnt + 1);
+  slotVal->u64  = MAPV_MULTI_TAG | newOff;
+  map->arena.dead += cap + 1;
+
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+const MapV_Val_ut*
+MapV_MultiFind(      MapV_st*  map,
+               const void*     key,
+               const size_t    keyLen,
+                     uint64_t* cnt)
+{
+  // a set has no values to hand out
+  const MapV_SlotId_t slotId = map->cfg.set ? UINT64_MAX
+                                            : _slot_from_key(map, key, keyLen);
+  if (UINT64_MAX == slotId) {
+    *cnt = 0;
+    return NULL;
+  }
+
+  const MapV_Val_ut* slotVal = _tbl_val_ptr_from_slot(map, slotId);
+  if (!(slotVal->u64 & MAPV_MULTI_TAG)) {
+    *cnt = 1;
+    return slotVal;
+  }
+
+  const uint64_t off = slotVal->u64 & ~MAPV_MULTI_TAG;
+  *cnt = map->arena.vals[off].u64 & UINT32_MAX;
+  return &map->arena.vals[off + 1];
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_MultiRemove(      MapV_st*    map,
+                 const void*       key,
+                 const size_t      keyLen,
+                 const MapV_Val_ut val)
+{
+  if (map->cfg.set) {
+    return MAPV_ERR__SET_HAS_NO_VALS;
+  }
+  if (!map->cfg.multi) {
+    return MAPV_ERR__MULTI_NOT_ENABLED;
+  }
+
+  const MapV_SlotId_t slotId = _slot_from_key(map, key, keyLen);
+  if (UINT64_MAX == slotId) {
+    return MAPV_ERR__DELETE_KEY_NOT_FOUND;
+  }
+
+  MapV_Val_ut* slotVal = _tbl_val_ptr_from_slot(map, slotId);
+  if (!(slotVal->u64 & MAPV_MULTI_TAG)) {
+    if (slotVal->u64 != val.u64) {
+      return MAPV_ERR__MULTI_VAL_NOT_FOUND;
+    }
+    return MapV_Delete(map, key, keyLen);
+  }
+
+  const uint64_t off = slotVal->u64 & ~MAPV_MULTI_TAG;
+  const uint64_t cnt = map->arena.vals[off].u64 & UINT32_MAX;
+  const uint64_t cap = map->arena.vals[off].u64 >> 32;
+  MapV_Val_ut*   blk = &map->arena.vals[off];
+
+  uint64_t idx = 1;
+  while (idx <= cnt && blk[idx].u64 != val.u64) {
+    idx++;
+  }
+  if (idx > cnt) {
+    return MAPV_ERR__MULTI_VAL_NOT_FOUND;
+  }
+
+  blk[idx] = blk[cnt];
+  if (cnt - 1 == 1) {
+    // back to a single inline value; the block is dead
+    *slotVal = blk[1];
+    map->arena.dead += cap + 1;
+  } else {
+    blk[0].u64--;
+  }
+
+  return MAPV_ERR__OK;
+}
+
+
+
+//==============================================================================
+//
+// MapV_Contains() / MapV_Add() / MapV_Remove() : set mode
+//
+// @NOTE: these only look at hashes, so they work on maps as well as sets.
+//        in a set, a bucket is the two hash lanes with no vals[], which fits
+//        it in one cache line (64 vs 96 bytes), and lookups touch one line.
+//
+//------------------------------------------------------------------------------
+bool
+MapV_Contains(      MapV_st* map,
+              const void*    key,
+              const size_t   keyLen)
+{
+  if (map->shm.reader) {
+    MapV_Val_ut val;
+    return _shm_find_key(map, key, keyLen, &val);
+  }
+
+  const MapV_SlotId_t slotId = _slot_from_key(map, key, keyLen);
+  _cache_touch(map, slotId);
+  _hot_touch(map, slotId);
+  return UINT64_MAX != slotId;
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_Add(      MapV_st* map,
+         const void*    key,
+         const size_t   keyLen)
+{
+  return _insert_hash(map, _hash(map, key, keyLen), key, keyLen,
+                      (MapV_Val_ut){0}, false);
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_Remove(      MapV_st* map,
+            const void*    key,
+            const size_t   keyLen)
+{
+  return MapV_Delete(map, key, keyLen);
+}
+
+
+
+//==============================================================================
+//
+// MapV_Merge() / MapV_Intersect() / MapV_Diff()
+//
+// @NOTE: a walk of a table in slot order is sorted by home slot, which is
+//        the top bits of high64. only entries sharing a home slot can be out
+//        of order, and those sit next to each other, so sorting each home
+//        slot's run (a handful of entries at most) makes the walk sorted by
+//        the full hash. two of those walks are then merged like a merge join;
+//        tables of different sizes don't matter.
+//        results come out sorted too, so filling the new table never shifts
+//        anything, and every table is read and written front to back.
+//
+//------------------------------------------------------------------------------
+#define MAPV_SETOP_MERGE     0
+#define MAPV_SETOP_INTERSECT 1
+#define MAPV_SETOP_DIFF      2
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_Merge(const MapV_st*         a,
+           const MapV_st*         b,
+           const MapV_Conflict_ft onConflict,
+                 void*            ctx)
+{
+  return _setop(a, b, MAPV_SETOP_MERGE, onConflict, ctx);
+}
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_Intersect(const MapV_st*         a,
+               const MapV_st*         b,
+               const MapV_Conflict_ft onConflict,
+                     void*            ctx)
+{
+  return _setop(a, b, MAPV_SETOP_INTERSECT, onConflict, ctx);
+}
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_Diff(const MapV_st* a,
+          const MapV_st* b)
+{
+  return _setop(a, b, MAPV_SETOP_DIFF, NULL, NULL);
+}
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_MergeMany(const MapV_st* const*  maps,
+               const uint64_t         mapsCnt,
+               const MapV_Conflict_ft onConflict,
+                     void*            ctx)
+{
+  return _setop_many(maps, mapsCnt, onConflict, ctx);
+}
+
+
+
+//==============================================================================
+//
+// MapV_Split() / MapV_ExportRange()
+//
+// @NOTE: a table walk is in hash order (see MapV_Merge()), so a hash range
+//        is a contiguous stretch of the table, and each partition is filled
+//        front to back. partitions are created over just their own range;
+//        without that, all of a partition's entries would have the same top
+//        bits, land in the same small part of its table, and the table
+//        would have to grow by about 2^bits to fit them.
+//
+//------------------------------------------------------------------------------
+#define MAPV_SPLIT_BITS_MAX 16
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_Split(const MapV_st*  map,
+           const uint32_t  bits,
+                 MapV_st** out)
+{
+  return _split(map, bits, out);
+}
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_ExportRange(const MapV_st* map,
+                 const uint64_t hashLo,
+                 const uint64_t hashHi)
+{
+  return _export_range(map, hashLo, hashHi);
+}
+
+
+
+//==============================================================================
+//
+// MapV_Serialize() / MapV_Deserialize()
+//
+// @NOTE: written from a sorted walk (see MapV_Merge()), so high64s go up
+//        and their differences are about 2^64 / entries: rice coding them
+//        takes ~log2 of that plus 2 bits, where the table takes 64 and the
+//        empty slots around them. low64s are random and are stored as is.
+//        loading hands the entries to _tbl_fill_grow() in the same order.
+//
+//------------------------------------------------------------------------------
+uint64_t
+MapV_Serialize(const MapV_st* map,
+                     FILE*    out)
+{
+  return _ser_write(map, out);
+}
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_Deserialize(      FILE*        in,
+                 const MapV_Cfg_st* cfg)
+{
+  return _ser_read(in, cfg);
+}
+
+
+//==============================================================================
+//
+// MapV_ShmAttach() : shared memory. see _shm...()
+//
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_ShmAttach(const char* name)
+{
+  MapV_st* map  = calloc(1, sizeof(*map));
+  map->shm.name = strdup(name);
+
+  map->shm.hdr = _shm_map(map, 0, sizeof(*map->shm.hdr), false);
+  if (NULL == map->shm.hdr) {
+    printf("can't attach to shared memory %s: %s\n", name, strerror(errno));
+    MapV_Destroy(map);
+    return NULL;
+  }
+  map->shm.reader = true;
+  if (MAPV_SHM_MAGIC != __atomic_load_n(&map->shm.hdr->magic, __ATOMIC_ACQUIRE)) {
+    printf("%s isn't a MapV shared memory map\n", name);
+    MapV_Destroy(map);
+    return NULL;
+  }
+
+  // the writer's pointers mean nothing here
+  map->cfg             = map->shm.hdr->cfg;
+  map->cfg.filePath    = NULL;
+  map->cfg.hotCounters = 0;
+  map->cfg.keyOf       = NULL;
+  map->cfg.keyOfCtx    = NULL;
+  map->cfg.shmName     = map->shm.name;
+
+  if (0 == __atomic_load_n(&map->shm.hdr->gen, __ATOMIC_ACQUIRE)
+      || !_shm_sync(map)) {
+    printf("shared memory %s has no table\n", name);
+    MapV_Destroy(map);
+    return NULL;
+  }
+  return map;
+}
+
+
+//==============================================================================
+//
+// MapV_Snapshot() : copy-on-write snapshots. see _snap...()
+//
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_Snapshot(MapV_st* map)
+{
+  if (map->cfg.multi || map->tbl.path || map->shm.hdr) {
+    printf("MapV_Snapshot(): multimaps, file backed and shared memory maps "
+           "can't be snapshotted\n");
+    return NULL;
+  }
+  if (_snap_frozen(map)) {
+    // its pages' refs are the writer's to take
+    printf("MapV_Snapshot(): a snapshot can't be snapshotted; it doesn't "
+           "change, so use it as it is\n");
+    return NULL;
+  }
+  if (NULL == map->snap && !_snap_pages(map)) {
+    return NULL;
+  }
+
+  const size_t  pagesBytes = map->snap->pagesCnt * sizeof(*map->snap->page);
+  MapV_st*      snap       = malloc(sizeof(*snap));
+  MapV_Snap_st* pages      = malloc(sizeof(*pages) + pagesBytes);
+  if (NULL == snap || NULL == pages) {
+    printf("MapV_Snapshot(): out of memory\n");
+    free(snap);
+    free(pages);
+    return NULL;
+  }
+  memcpy(pages, map->snap, sizeof(*pages) + pagesBytes);
+  pages->copies = 0;
+  pages->frozen = true;
+  map->snap->foldAt = 0; // copies made from here on may be anywhere
+
+  // every page the map holds is now held by the snapshot too
+  __atomic_add_fetch(&pages->base->refs, 1, __ATOMIC_RELAXED);
+  for (uint64_t p = 0; p < pages->pagesCnt; p++) {
+    if (&pages->base->refs != _snap_refs(pages, p)) {
+      __atomic_add_fetch(_snap_refs(pages, p), 1, __ATOMIC_RELAXED);
+    }
+  }
+
+  // only the table and what describes it; nothing the writer goes on using
+  *snap                 = *map;
+  snap->snap            = pages;
+  snap->cfg.cacheBytes  = 0;
+  snap->cfg.hotCounters = 0;
+  snap->tbl.ref         = NULL;
+  snap->tbl.path        = NULL;
+  memset(&snap->stats, 0, sizeof(snap->stats));
+  memset(&snap->arena, 0, sizeof(snap->arena));
+  memset(&snap->hook,  0, sizeof(snap->hook));
+  memset(&snap->hot,   0, sizeof(snap->hot));
+  memset(&snap->shm,   0, sizeof(snap->shm));
+  return snap;
+}
+
+
+//==============================================================================
+//
+// MapV_CacheHitRate() : cache mode. see _cache...()
+//
+//------------------------------------------------------------------------------
+double
+MapV_CacheHitRate(const MapV_st* map)
+{
+  const uint64_t lookups = map->stats.cacheHits + map->stats.cacheMisses;
+  return lookups ? (double)map->stats.cacheHits / lookups : 0.0;
+}
+
+//------------------------------------------------------------------------------
+// see _hot...()
+MapV_Err_et
+MapV_Optimize(MapV_st* map)
+{
+  if (NULL == map->hot.cnt) {
+    return MAPV_ERR__OPTIMIZE_NO_COUNTERS;
+  }
+  map->stats.hotSwaps += _hot_optimize(map);
+  return MAPV_ERR__OK;
+}
+
+
+
+//==============================================================================
+//
+// MapV_FalsePosProb() / MapV_CollisionProb() : fingerprint width
+//
+// @NOTE: the home slot comes from the top bits of hash.high64, the same bits
+//        that are stored; growing the table recomputes every home slot from
+//        what's stored, since there are no keys. so the entries a lookup
+//        compares against already share its top log2(slots) bits, and those
+//        bits rule nothing out: a miss matches with odds of about
+//        n / 2^fpBits, not the k / 2^fpBits (k: entries compared) that
+//        independent bits, or a quotient taken out of the stored ones,
+//        would give. wider fpBits is the fix when that matters.
+//
+//------------------------------------------------------------------------------
+double
+MapV_FalsePosProb(const MapV_st* map)
+{
+  return ldexp((double)map->meta.slotsUsed, -(int)map->cfg.fpBits);
+}
+
+//------------------------------------------------------------------------------
+// birthday bound: 1 - e^(-n(n-1) / 2^(bits+1))
+double
+MapV_CollisionProb(const MapV_st* map)
+{
+  const double n = (double)map->meta.slotsUsed;
+  return -expm1(-ldexp(n * (n - 1), -(int)map->cfg.fpBits - 1));
+}
+
+
+
+//==============================================================================
+//
+// MapV_Print*()
+//
+//==============================================================================
+
+//------------------------------------------------------------------------------
+void
+MapV_PrintTableCfg(const MapV_st* map)
+{
+  printf("\n\n");
+  printf("--------------------------------\n");
+  printf("\n");
+  printf("cfg.distSlotMax    : %"PRIu64"\n", map->cfg.distSlotMax);
+  printf("cfg.distBktMax     : %"PRIu64"\n", map->cfg.distBktMax);
+  printf("cfg.capPctMax      : %f\n",        map->cfg.capPctMax);
+  printf("cfg.memAlign       : %d\n",        map->cfg.memAlign);
+  printf("cfg.set            : %d\n",        map->cfg.set);
+  printf("cfg.fpBits         : %"PRIu32"\n", map->cfg.fpBits);
+  printf("cfg.hashLo         : %016"PRIx64"\n", map->cfg.hashLo);
+  printf("cfg.hashHi         : %016"PRIx64"\n", map->cfg.hashHi);
+  printf("cfg.cacheBytes     : %"PRIu64"\n", map->cfg.cacheBytes);
+  printf("cfg.cuckoo         : %d\n",        map->cfg.cuckoo);
+  printf("cfg.growPct        : %"PRIu32"\n", map->cfg.growPct);
+  printf("cfg.hotCounters    : %"PRIu64"\n", map->cfg.hotCounters);
+  printf("cfg.filePath       : %s\n", map->cfg.filePath ? map->cfg.filePath : "-");
+  printf("cfg.shmName        : %s\n", map->cfg.shmName ? map->cfg.shmName : "-");
+  printf("cfg.seed           : %016"PRIx64"\n", map->cfg.seed);
+  printf("cfg.keyOf          : %s\n", map->cfg.keyOf ? "set" : "-");
+  printf("\n");
+  printf("meta.tblBytes      : %"PRIu64"\n", map->meta.tblBytes);
+  printf("meta.tblBytesReal  : %"PRIu64"\n", map->meta.tblBytesReal);
+  printf("\n");
+  printf("meta.bktBytes      : %"PRIu64"\n", map->meta.bktBytes);
+  printf("meta.bktValOff     : %"PRIu64"\n", map->meta.bktValOff);
+  printf("meta.bktsCnt       : %"PRIu64"\n", map->meta.bktsCnt);
+  printf("meta.bktsCntReal   : %"PRIu64"\n", map->meta.bktsCntReal);
+  printf("\n");
+  printf("meta.slotHashShift : %"PRIu64"\n", map->meta.slotHashShift);
+  printf("meta.hashSkip      : %"PRIu64"\n", map->meta.hashSkip);
+  printf("meta.slotsCap      : %"PRIu64"\n", map->meta.slotsCap);
+  printf("meta.slotsCapReal  : %"PRIu64"\n", map->meta.slotsCapReal);
+  printf("meta.slotsUsed     : %"PRIu64"\n", map->meta.slotsUsed);
+  printf("meta.slotsAvail    : %"PRIu64"\n", map->meta.slotsAvail);
+  printf("meta.slotsCapPct   : %f\n",        map->meta.slotsCapPct);
+  printf("\n");
+  printf("meta.distSlotMax   : %"PRIu64"\n", map->meta.distSlotMax);
+  printf("meta.distSlotIter  : %"PRIu64"\n", map->meta.distSlotIter);
+  printf("meta.distBktMax    : %"PRIu64"\n", map->meta.distBktMax);
+  printf("meta.distBktIter   : %"PRIu64"\n", map->meta.distBktIter);
+  if (map->cfg.cuckoo) {
+    printf("meta.stashUsed     : %"PRIu64"\n", map->meta.stashUsed);
+  }
+  printf("meta.seed          : %016"PRIx64"\n", map->meta.seed);
+  printf("meta.reseeds       : %"PRIu64"\n", map->meta.reseeds);
+  if (map->meta.pageBkts) {
+    printf("meta.pageBytes     : %"PRIu64"\n", map->meta.pageBytes);
+    printf("meta.pageBkts      : %"PRIu64"\n", map->meta.pageBkts);
+    printf("meta.pageHomeSlots : %"PRIu64"\n", map->meta.pageHomeSlots);
+  }
+  printf("\n");
+  printf("tbl.bktPtrReal     : %p\n", map->tbl.bktPtrReal);
+  printf("tbl.bkt            : %p\n", map->tbl.bkt);
+  if (NULL != map->shm.hdr) {
+    printf("shm.gen            : %"PRIu64"%s\n", map->shm.gen,
+           map->shm.reader ? " (reader)" : "");
+  }
+  if (NULL != map->snap) {
+    printf("snap.pagesCnt      : %"PRIu64"%s\n", map->snap->pagesCnt,
+           map->snap->frozen ? " (snapshot)" : "");
+    printf("snap.copies        : %"PRIu64"\n", map->snap->copies);
+  }
+  printf("\n");
+  printf("stats.mm256Loads   : %"PRIu64"\n", map->stats.mm256Loads);
+  printf("stats.reseeds      : %"PRIu64"\n", map->stats.reseeds);
+  if (NULL != map->tbl.ref) {
+    printf("stats.cacheHits    : %"PRIu64"\n", map->stats.cacheHits);
+    printf("stats.cacheMisses  : %"PRIu64"\n", map->stats.cacheMisses);
+    printf("stats.cacheEvicts  : %"PRIu64"\n", map->stats.cacheEvictions);
+    printf("meta.cacheHand     : %"PRIu64"\n", map->meta.cacheHand);
+  }
+  if (map->cfg.multi) {
+    printf("\n");
+    printf("arena.cap          : %"PRIu64"\n", map->arena.cap);
+    printf("arena.used         : %"PRIu64"\n", map->arena.used);
+    printf("arena.dead         : %"PRIu64"\n", map->arena.dead);
+    printf("arena.compactions  : %"PRIu64"\n", map->arena.compactions);
+  }
+  printf("\n\n");
+  printf("--------------------------------\n");
+  printf("\n\n");
+  fflush(stdout);
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_PrintTableData(const MapV_st* map)
+{
+  printf("\n\n");
+
+  int distSlotMax = 0;
+  int numFound    = 0;
+  for (int slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  {
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, slotId, &hv);
+    if (_hv_is_empty(&hv)) {
+      continue;
+    }
+
+    numFound++;
+    const int slotDist = _slot_hash_hi_dist(map, hv.hash.high64, slotId);
+    printf("\t[%d] %"PRIu64" %"PRIu64" : %"PRIu64" : %d\n",
+           slotId, hv.hash.high64, hv.hash.low64, hv.val.u64, slotDist);
+    fflush(stdout);
+
+    if (slotDist > distSlotMax) {
+      distSlotMax = slotDist;
+    }
+  }
+
+  printf("\n\n");
+  printf("distSlotMax: %d\n", distSlotMax);
+  printf("numFound: %d\n", numFound);
+}
+
+//------------------------------------------------------------------------------
+// summary of how entries are spread out; a histogram instead of every slot.
+void
+MapV_PrintTableStats(const MapV_st* map)
+{
+  uint64_t distSlotHist[256] = {0};
+  uint64_t distBktHist [256] = {0};
+  uint64_t distSlotSum       = 0;
+  uint64_t distBktSum        = 0;
+  uint64_t numFound          = 0;
+  uint64_t cuckooIn[3]       = {0}; // cuckoo: first bucket, second, stash
+
+  for (MapV_SlotId_t slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  {
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, slotId, &hv);
+    if (_hv_is_empty(&hv)) {
+      continue;
+    }
+
+    // cuckoo entries aren't a distance from anything
+    if (map->cfg.cuckoo) {
+      const MapV_BktId_t bktId = _bkt_from_slot(slotId);
+      const MapV_BktId_t home  = _bkt_from_slot(
+                                   _slot_from_hash_hi(map, hv.hash.high64));
+      cuckooIn[(bktId >= map->meta.bktsCnt) ? 2 : (bktId == home) ? 0 : 1]++;
+      numFound++;
+      continue;
+    }
+
+    const MapV_Dist_t  slotDist = _slot_hash_hi_dist(map, hv.hash.high64,
+                                                     slotId);
+    const MapV_BktId_t homeBkt  = _bkt_from_slot(
+                                    _slot_from_hash_hi(map, hv.hash.high64));
+    const MapV_Dist_t  bktDist  = _bkt_from_slot(slotId) - homeBkt;
+
+    distSlotHist[slotDist < 255 ? slotDist : 255]++;
+    distBktHist [bktDist  < 255 ? bktDist  : 255]++;
+    distSlotSum += slotDist;
+    distBktSum  += bktDist;
+    numFound++;
+  }
+
+  printf("\n");
+  printf("entries            : %"PRIu64"\n", numFound);
+  printf("table bytes        : %"PRIu64"\n", map->meta.tblBytes);
+  printf("bytes per entry    : %.2f\n",
+         numFound ? (double)map->meta.tblBytes / numFound : 0.0);
+  printf("capacity used      : %.2f%%\n", map->meta.slotsCapPct);
+  printf("fingerprint bits   : %"PRIu32"\n", map->cfg.fpBits);
+  printf("false positive prob: %.3g\n", MapV_FalsePosProb(map));
+  printf("collision prob     : %.3g\n", MapV_CollisionProb(map));
+  if (map->cfg.cuckoo) {
+    printf("in first bucket    : %"PRIu64"\n", cuckooIn[0]);
+    printf("in second bucket   : %"PRIu64"\n", cuckooIn[1]);
+    printf("in stash           : %"PRIu64"\n", cuckooIn[2]);
+    printf("\n");
+    fflush(stdout);
+    return;
+  }
+  printf("avg slot distance  : %.3f\n",
+         numFound ? (double)distSlotSum / numFound : 0.0);
+  printf("avg bkt distance   : %.3f\n",
+         numFound ? (double)distBktSum / numFound : 0.0);
+
+  printf("\nslot distance histogram:\n");
+  for (int i = 0; i < 256; i++) {
+    if (distSlotHist[i]) {
+      printf("\t%3d%s : %12"PRIu64"  %6.2f%%\n", i, (i == 255) ? "+" : " ",
+             distSlotHist[i], 100.0 * distSlotHist[i] / numFound);
+    }
+  }
+  printf("\nbucket distance histogram:\n");
+  for (int i = 0; i < 256; i++) {
+    if (distBktHist[i]) {
+      printf("\t%3d%s : %12"PRIu64"  %6.2f%%\n", i, (i == 255) ? "+" : " ",
+             distBktHist[i], 100.0 * distBktHist[i] / numFound);
+    }
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+//------------------------------------------------------------------------------
+const char*
+MapV_PrintErr(MapV_Err_et err)
+{
+	if (err > MAPV_ERR___LAST || err < MAPV_ERR___FIRST) {
+		return "INVALID MapV_Err_et VALUE";
+	}
+	static const char* strArr[] = {
+		[MAPV_ERR__OK] =
+		"MAPV_ERR__OK",
+		[MAPV_ERR__TABLE_MUST_GROW] =
+		"MAPV_ERR__TABLE_MUST_GROW",
+		[MAPV_ERR__TABLE_GROW_FAILED] =
+		"MAPV_ERR__TABLE_GROW_FAILED",
+		[MAPV_ERR__INSERT_KEY_EXISTS] =
+		"MAPV_ERR__INSERT_KEY_EXISTS",
+		[MAPV_ERR__DELETE_KEY_NOT_FOUND] =
+		"MAPV_ERR__DELETE_KEY_NOT_FOUND",
+		[MAPV_ERR__DESTROY_MAP_IS_NULL] =
+		"MAPV_ERR__DESTROY_MAP_IS_NULL",
+		[MAPV_ERR__DESTROY_MAP_BKTPTRREAL_IS_NULL] =
+		"MAPV_ERR__DESTROY_MAP_BKTPTRREAL_IS_NULL",
+		[MAPV_ERR__MULTI_NOT_ENABLED] =
+		"MAPV_ERR__MULTI_NOT_ENABLED",
+		[MAPV_ERR__MULTI_VAL_TOO_BIG] =
+		"MAPV_ERR__MULTI_VAL_TOO_BIG",
+		[MAPV_ERR__MULTI_VAL_NOT_FOUND] =
+		"MAPV_ERR__MULTI_VAL_NOT_FOUND",
+		[MAPV_ERR__MULTI_ALLOC_FAILED] =
+		"MAPV_ERR__MULTI_ALLOC_FAILED",
+		[MAPV_ERR__SET_HAS_NO_VALS] =
+		"MAPV_ERR__SET_HAS_NO_VALS",
+		[MAPV_ERR__HASH_OUT_OF_RANGE] =
+		"MAPV_ERR__HASH_OUT_OF_RANGE",
+		[MAPV_ERR__SPLIT_TOO_MANY_PARTS] =
+		"MAPV_ERR__SPLIT_TOO_MANY_PARTS",
+		[MAPV_ERR__OPTIMIZE_NO_COUNTERS] =
+		"MAPV_ERR__OPTIMIZE_NO_COUNTERS",
+		[MAPV_ERR__SHM_READ_ONLY] =
+		"MAPV_ERR__SHM_READ_ONLY",
+		[MAPV_ERR__BULK_LOAD_NOT_EMPTY] =
+		"MAPV_ERR__BULK_LOAD_NOT_EMPTY",
+		[MAPV_ERR__BULK_LOAD_UNSUPPORTED] =
+		"MAPV_ERR__BULK_LOAD_UNSUPPORTED",
+		[MAPV_ERR__SNAPSHOT_READ_ONLY] =
+		"MAPV_ERR__SNAPSHOT_READ_ONLY",
+	};
+	return strArr[err];
+}
+
+//------------------------------------------------------------------------------
+// only used for debugging
+// static void
+// _print_hv(MapV_HV_st hv) {
+//   printf("\n\n---------------\n");
+//   printf("HV:\n");
+//   printf("\thi64 : %"PRIu64"\n", hv.hash.high64);
+//   printf("\tlo64 : %"PRIu64"\n", hv.hash.low64);
+//   printf("\tval  : %"PRIu64"\n", hv.val);
+//   printf("\n");
+//   fflush(stdout);
+// }
+
+
+
+
+//==============================================================================
+//
+// Static Functions
+//
+//==============================================================================
+
+
+
+
+//==============================================================================
+//
+// _pow2...()
+//
+//------------------------------------------------------------------------------
+static inline uint64_t
+_pow2_next_u64(uint64_t n) {
+  --n;
+  n |= n >> 1;
+  n |= n >> 2;
+  n |= n >> 4;
+  n |= n >> 8;
+  n |= n >> 16;
+  n |= n >> 32;
+  ++n;
+  return n;
+}
+
+
+//==============================================================================
+//
+// _hash...()
+//
+//------------------------------------------------------------------------------
+// @NOTE: low64 is cut down to what the table stores (cfg.fpBits), so hashes
+//        from here compare equal to hashes read back out of the table.
+static inline MapV_Hash_st
+_hash(const MapV_st* map,
+      const void*    key,
+      const size_t   keyLen)
+{
+  // a high64 of 0 marks an empty slot; move the one hash in 2^64 that has it
+  MapV_Hash_st hash = XXH3_128bits_withSeed(key, keyLen, map->meta.seed);
+  hash.high64 += (0 == hash.high64);
+  hash.low64  &= map->meta.hashLoMask;
+  return hash;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: no error checking.
+//        this must only be called when you know the slot is in range
+static inline MapV_HashHi_t
+_hashhi_from_slot(const MapV_st*      map,
+                  const MapV_SlotId_t slotId)
+{
+  const MapV_BktId_t  bktId     = slotId / MAPV_BKT_SLOTS;
+	const MapV_SlotId_t bktSlotId = slotId % MAPV_BKT_SLOTS;
+	return _tbl_bkt(map, bktId)->slotsHi[bktSlotId];
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: pass by value since the data is small enough
+static inline bool
+_hashes_are_equal(const MapV_Hash_st hash1, const MapV_Hash_st hash2)
+{
+  return (0 == ((hash1.high64 ^ hash2.high64) | (hash1.low64 ^ hash2.low64)));
+}
+
+
+//==============================================================================
+//
+// _hash_batch...() : XXH3_128bits() for short keys, a SIMD lane per key
+//
+// @NOTE: XXH3 hashes keys of up to 16 bytes with one of three short
+//        functions, picked by length (1-3, 4-8, 9-16), each a few multiplies
+//        and shifts over at most two 8 byte reads. keys are sorted into
+//        those three groups as they come, with their reads done up front,
+//        and each group is hashed MAPV_HASH_LANES keys at a time. the math is
+//        xxhash's own (v0.8, default secret), so the hashes are bit for bit
+//        XXH3_128bits_withSeed()'s; tables don't change. the seed only moves
+//        each function's bitflips, so it's added to them per flush.
+//        64x64 -> 128 bit multiplies are put together from 32x32 -> 64 bit
+//        ones, which costs ~4x a scalar mulx per lane; what's saved is the
+//        per-key call and the length branches, which mispredict on keys of
+//        mixed lengths. other lengths go through XXH3_128bits().
+//
+//------------------------------------------------------------------------------
+#if defined(__AVX512F__) && defined(__AVX512DQ__) && defined(__AVX512BW__)
+
+#define MAPV_HASH_LANES 8
+typedef __m512i _Lanes_t;
+#define _lanes_load(p)     _mm512_loadu_si512((const void*)(p))
+#define _lanes_store(p, v) _mm512_storeu_si512((void*)(p), v)
+#define _lanes_set1(x)     _mm512_set1_epi64((long long)(x))
+#define _lanes_add(a, b)   _mm512_add_epi64(a, b)
+#define _lanes_xor(a, b)   _mm512_xor_si512(a, b)
+#define _lanes_or(a, b)    _mm512_or_si512(a, b)
+#define _lanes_and(a, b)   _mm512_and_si512(a, b)
+#define _lanes_srli(a, n)  _mm512_srli_epi64(a, n)
+#define _lanes_slli(a, n)  _mm512_slli_epi64(a, n)
+#define _lanes_mul32(a, b) _mm512_mul_epu32(a, b)
+#define _lanes_mullo(a, b) _mm512_mullo_epi64(a, b)
+#define _lanes_bswap(a)    _mm512_shuffle_epi8(a, _mm512_broadcast_i32x4(   \
+                             _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,     \
+                                          0, 1,  2,  3,  4,  5,  6,  7)))
+
+#else
+
+#define MAPV_HASH_LANES 4
+typedef __m256i _Lanes_t;
+#define _lanes_load(p)     _mm256_loadu_si256((const __m256i*)(p))
+#define _lanes_store(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+#define _lanes_set1(x)     _mm256_set1_epi64x((long long)(x))
+#define _lanes_add(a, b)   _mm256_add_epi64(a, b)
+#define _lanes_xor(a, b)   _mm256_xor_si256(a, b)
+#define _lanes_or(a, b)    _mm256_or_si256(a, b)
+#define _lanes_and(a, b)   _mm256_and_si256(a, b)
+#define _lanes_srli(a, n)  _mm256_srli_epi64(a, n)
+#define _lanes_slli(a, n)  _mm256_slli_epi64(a, n)
+#define _lanes_mul32(a, b) _mm256_mul_epu32(a, b)
+#define _lanes_mullo(a, b) _lanes_mullo_avx2(a, b)
+#define _lanes_bswap(a)    _mm256_shuffle_epi8(a, _mm256_broadcastsi128_si256( \
+                             _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,        \
+                                          0, 1,  2,  3,  4,  5,  6,  7)))
+
+// the low 64 bits of a 64x64 bit multiply; AVX2 has no vpmullq
+static inline __m256i
+_lanes_mullo_avx2(const __m256i a, const __m256i b)
+{
+  const __m256i ll = _mm256_mul_epu32(a, b);
+  const __m256i lh = _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32));
+  const __m256i hl = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+  return _mm256_add_epi64(ll, _mm256_slli_epi64(_mm256_add_epi64(lh, hl), 32));
+}
+
+#endif
+
+// xxhash's constants. the bitflips are XORs of the default secret's words,
+// before the seed is applied.
+#define XXH_P32_2       0x85EBCA77ull
+#define XXH_P64_1       0x9E3779B185EBCA87ull
+#define XXH_P64_2       0xC2B2AE3D27D4EB4Full
+#define XXH_P64_3       0x165667B19E3779F9ull
+#define XXH_MX1         0x165667919E3779F9ull
+#define XXH_MX2         0x9FB21C651E98DF25ull
+#define XXH_FLIP_1TO3_L 0x87275a9bull
+#define XXH_FLIP_1TO3_H 0x302c208bull
+#define XXH_FLIP_4TO8   0xc4f023344dc994acull
+#define XXH_FLIP_9TO_L  0x59973f0033362349ull
+#define XXH_FLIP_9TO_H  0xc202797692d63d58ull
+
+// keys waiting for a full group of lanes. a and b are the key's reads, as
+// each length group's function wants them.
+typedef struct _HashLanes_st {
+  uint64_t a   [MAPV_HASH_LANES];
+  uint64_t b   [MAPV_HASH_LANES];
+  uint64_t len [MAPV_HASH_LANES];
+  uint64_t idx [MAPV_HASH_LANES];
+  uint64_t cnt;
+} _HashLanes_st;
+
+//------------------------------------------------------------------------------
+// 64x64 -> 128 bit multiply; returns the low half (XXH_mult64to128()'s
+// portable version, per lane)
+static inline _Lanes_t
+_lanes_mul128(const _Lanes_t a,
+              const _Lanes_t b,
+                    _Lanes_t* hi)
+{
+  const _Lanes_t mask  = _lanes_set1(0xFFFFFFFFull);
+  const _Lanes_t aHi   = _lanes_srli(a, 32);
+  const _Lanes_t bHi   = _lanes_srli(b, 32);
+  const _Lanes_t ll    = _lanes_mul32(a,   b);
+  const _Lanes_t lh    = _lanes_mul32(a,   bHi);
+  const _Lanes_t hl    = _lanes_mul32(aHi, b);
+  const _Lanes_t hh    = _lanes_mul32(aHi, bHi);
+  const _Lanes_t cross = _lanes_add(_lanes_add(_lanes_srli(ll, 32),
+                                               _lanes_and(lh, mask)), hl);
+  *hi = _lanes_add(_lanes_add(hh, _lanes_srli(lh, 32)), _lanes_srli(cross, 32));
+  return _lanes_or(_lanes_slli(cross, 32), _lanes_and(ll, mask));
+}
+
+//------------------------------------------------------------------------------
+static inline _Lanes_t
+_lanes_xxh3_avalanche(_Lanes_t h)
+{
+  h = _lanes_xor(h, _lanes_srli(h, 37));
+  h = _lanes_mullo(h, _lanes_set1(XXH_MX1));
+  return _lanes_xor(h, _lanes_srli(h, 32));
+}
+
+//------------------------------------------------------------------------------
+static inline _Lanes_t
+_lanes_xxh64_avalanche(_Lanes_t h)
+{
+  h = _lanes_xor(h, _lanes_srli(h, 33));
+  h = _lanes_mullo(h, _lanes_set1(XXH_P64_2));
+  h = _lanes_xor(h, _lanes_srli(h, 29));
+  h = _lanes_mullo(h, _lanes_set1(XXH_P64_3));
+  return _lanes_xor(h, _lanes_srli(h, 32));
+}
+
+//------------------------------------------------------------------------------
+// XXH3_len_1to3_128b(). a/b: combinedl/combinedh
+static inline void
+_hash_lanes_1to3(const _HashLanes_st* hl,
+                 const uint64_t       seed,
+                       uint64_t*      lo,
+                       uint64_t*      hi)
+{
+  _lanes_store(lo, _lanes_xxh64_avalanche(
+                     _lanes_xor(_lanes_load(hl->a),
+                                _lanes_set1(XXH_FLIP_1TO3_L + seed))));
+  _lanes_store(hi, _lanes_xxh64_avalanche(
+                     _lanes_xor(_lanes_load(hl->b),
+                                _lanes_set1(XXH_FLIP_1TO3_H - seed))));
+}
+
+//------------------------------------------------------------------------------
+// XXH3_len_4to8_128b(). a: input_64
+static inline void
+_hash_lanes_4to8(const _HashLanes_st* hl,
+                 const uint64_t       seed,
+                       uint64_t*      lo,
+                       uint64_t*      hi)
+{
+  const uint64_t flip  = XXH_FLIP_4TO8
+                       + (seed ^ ((uint64_t)__builtin_bswap32((uint32_t)seed) << 32));
+  const _Lanes_t keyed = _lanes_xor(_lanes_load(hl->a), _lanes_set1(flip));
+  const _Lanes_t mul   = _lanes_add(_lanes_set1(XXH_P64_1),
+                                    _lanes_slli(_lanes_load(hl->len), 2));
+        _Lanes_t mHi;
+        _Lanes_t mLo   = _lanes_mul128(keyed, mul, &mHi);
+
+  mHi = _lanes_add(mHi, _lanes_slli(mLo, 1));
+  mLo = _lanes_xor(mLo, _lanes_srli(mHi, 3));
+  mLo = _lanes_xor(mLo, _lanes_srli(mLo, 35));
+  mLo = _lanes_mullo(mLo, _lanes_set1(XXH_MX2));
+  mLo = _lanes_xor(mLo, _lanes_srli(mLo, 28));
+  _lanes_store(lo, mLo);
+  _lanes_store(hi, _lanes_xxh3_avalanche(mHi));
+}
+
+//------------------------------------------------------------------------------
+// XXH3_len_9to16_128b(). a/b: input_lo/input_hi
+static inline void
+_hash_lanes_9to16(const _HashLanes_st* hl,
+                  const uint64_t       seed,
+                        uint64_t*      lo,
+                        uint64_t*      hi)
+{
+  const _Lanes_t inLo = _lanes_load(hl->a);
+        _Lanes_t inHi = _lanes_load(hl->b);
+        _Lanes_t mHi;
+        _Lanes_t mLo  = _lanes_mul128(_lanes_xor(_lanes_xor(inLo, inHi),
+                                                 _lanes_set1(XXH_FLIP_9TO_L - seed)),
+                                      _lanes_set1(XXH_P64_1), &mHi);
+
+  mLo  = _lanes_add(mLo, _lanes_slli(_lanes_add(_lanes_load(hl->len),
+                                                _lanes_set1(-1)), 54));
+  inHi = _lanes_xor(inHi, _lanes_set1(XXH_FLIP_9TO_H + seed));
+  mHi  = _lanes_add(mHi, _lanes_add(inHi, _lanes_mul32(inHi,
+                                            _lanes_set1(XXH_P32_2 - 1))));
+  mLo  = _lanes_xor(mLo, _lanes_bswap(mHi));
+
+  _Lanes_t hHi;
+  _Lanes_t hLo = _lanes_mul128(mLo, _lanes_set1(XXH_P64_2), &hHi);
+  hHi = _lanes_add(hHi, _lanes_mullo(mHi, _lanes_set1(XXH_P64_2)));
+  _lanes_store(lo, _lanes_xxh3_avalanche(hLo));
+  _lanes_store(hi, _lanes_xxh3_avalanche(hHi));
+}
+
+//------------------------------------------------------------------------------
+// hash a length group's waiting keys into hashes[], as _hash() would.
+// unused lanes hash whatever was left in them.
+static inline void
+_hash_lanes_flush(const MapV_st*       map,
+                  const int            group,
+                        _HashLanes_st* hl,
+                        MapV_Hash_st*  hashes)
+{
+  uint64_t lo[MAPV_HASH_LANES];
+  uint64_t hi[MAPV_HASH_LANES];
+  switch (group) {
+    case 0 : _hash_lanes_1to3 (hl, map->meta.seed, lo, hi); break;
+    case 1 : _hash_lanes_4to8 (hl, map->meta.seed, lo, hi); break;
+    default: _hash_lanes_9to16(hl, map->meta.seed, lo, hi); break;
+  }
+  for (uint64_t i = 0; i < hl->cnt; i++)
+  {
+    MapV_Hash_st* hash = &hashes[hl->idx[i]];
+    hash->high64  = hi[i] + (0 == hi[i]);
+    hash->low64   = lo[i] & map->meta.hashLoMask;
+  }
+  hl->cnt = 0;
+}
+
+//------------------------------------------------------------------------------
+// _hash() for keysCnt keys
+static void
+_hash_batch(const MapV_st*     map,
+            const void* const* keys,
+            const size_t*      keyLens,
+            const uint64_t     keysCnt,
+                  MapV_Hash_st* hashes)
+{
+  _HashLanes_st groups[3] = {{{0}}};
+
+  for (uint64_t i = 0; i < keysCnt; i++)
+  {
+    const uint8_t* p   = keys[i];
+    const size_t   len = keyLens[i];
+    if (0 == len || len > 16) {
+      hashes[i] = _hash(map, p, len);
+      continue;
+    }
+
+    const int      group = (len > 8) ? 2 : (len >= 4) ? 1 : 0;
+    _HashLanes_st* hl    = &groups[group];
+    const uint64_t lane  = hl->cnt++;
+    if (len > 8) {
+      memcpy(&hl->a[lane], p,           8);
+      memcpy(&hl->b[lane], p + len - 8, 8);
+    } else if (len >= 4) {
+      uint32_t in[2];
+      memcpy(&in[0], p,           4);
+      memcpy(&in[1], p + len - 4, 4);
+      hl->a[lane] = in[0] + ((uint64_t)in[1] << 32);
+    } else {
+      const uint32_t combinedl = ((uint32_t)p[0] << 16) | ((uint32_t)p[len >> 1] << 24)
+                               | ((uint32_t)p[len - 1])  | ((uint32_t)len << 8);
+      const uint32_t swapped   = __builtin_bswap32(combinedl);
+      hl->a[lane] = combinedl;
+      hl->b[lane] = (swapped << 13) | (swapped >> 19);
+    }
+    hl->len[lane] = len;
+    hl->idx[lane] = i;
+
+    if (MAPV_HASH_LANES == hl->cnt) {
+      _hash_lanes_flush(map, group, hl, hashes);
+    }
+  }
+
+  for (int group = 0; group < 3; group++) {
+    if (0 != groups[group].cnt) {
+      _hash_lanes_flush(map, group, &groups[group], hashes);
+    }
+  }
+}
+
+
+//==============================================================================
+//
+// _hv...()
+//
+//------------------------------------------------------------------------------
+// @NOTE: only the hash is checked, since sets have no value to look at.
+//        _hash() never returns a high64 of 0.
+static inline bool
+_hv_is_empty(const MapV_HV_st* hv)
+{
+  return (0 == hv->hash.high64);
+}
+
+
+//==============================================================================
+//
+// _bkt...()
+//
+//------------------------------------------------------------------------------
+static inline MapV_BktId_t
+_bkt_from_slot(const MapV_SlotId_t slotId)
+{
+  return slotId / MAPV_BKT_SLOTS;
+}
+
+//------------------------------------------------------------------------------
+static inline MapV_BktId_t
+_bktslot_from_slot(const MapV_SlotId_t slotId)
+{
+  return slotId % MAPV_BKT_SLOTS;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: buckets are meta.bktBytes apart, so always index through this
+//        rather than tbl.bkt[] (MapV_Find() is the one exception, and only
+//        runs on the default layout). only .slotsHi is always where the
+//        struct says; go through _bkt_lo_get/set() and _bkt_vals() for the rest.
+static inline MapV_Bkt_st*
+_tbl_bkt(const MapV_st*     map,
+         const MapV_BktId_t bktId)
+{
+  // file backed: no bucket straddles a page
+  if (map->meta.pageBkts) {
+    return (MapV_Bkt_st*)((char*)map->tbl.bkt
+                          + bktId / map->meta.pageBkts * map->meta.pageBytes
+                          + bktId % map->meta.pageBkts * map->meta.bktBytes);
+  }
+  // snapshotted: through the page table
+  if (NULL != map->snap) {
+    return (MapV_Bkt_st*)(map->snap->page[bktId / MAPV_SNAP_PAGE_BKTS]
+                          + bktId % MAPV_SNAP_PAGE_BKTS * map->meta.bktBytes);
+  }
+  return (MapV_Bkt_st*)((char*)map->tbl.bkt + bktId * map->meta.bktBytes);
+}
+
+//------------------------------------------------------------------------------
+// _tbl_bkt(), for a bucket that's about to be written. every change to the
+// table goes through here, or _tbl_val_ptr_for_write(), so a page a
+// snapshot shares is copied first; see _snap_cow().
+static inline MapV_Bkt_st*
+_tbl_bkt_for_write(const MapV_st*     map,
+                   const MapV_BktId_t bktId)
+{
+  if (NULL != map->snap) {
+    _snap_cow(map, bktId);
+  }
+  return _tbl_bkt(map, bktId);
+}
+
+//------------------------------------------------------------------------------
+static inline MapV_HashLo_t
+_bkt_lo_get(const MapV_st*     map,
+            const MapV_Bkt_st* bkt,
+            const MapV_BktId_t bktSlotId)
+{
+  switch (map->cfg.fpBits) {
+    case 128: return bkt->slotsLo[bktSlotId];
+    case  96: return ((const uint32_t*)bkt->slotsLo)[bktSlotId];
+    default : return 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_bkt_lo_set(const MapV_st*      map,
+                  MapV_Bkt_st*  bkt,
+            const MapV_BktId_t  bktSlotId,
+            const MapV_HashLo_t lo)
+{
+  switch (map->cfg.fpBits) {
+    case 128: bkt->slotsLo[bktSlotId]                = lo; break;
+    case  96: ((uint32_t*)bkt->slotsLo)[bktSlotId]   = lo; break;
+    default : break;
+  }
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: maps only; a set bucket has no vals[]
+static inline MapV_Val_ut*
+_bkt_vals(const MapV_st*     map,
+          const MapV_Bkt_st* bkt)
+{
+  return (MapV_Val_ut*)((char*)bkt + map->meta.bktValOff);
+}
+
+_Static_assert(offsetof(MapV_Bkt_st, slotsHi) == offsetof(MapV_SetBkt_st, slotsHi)
+            && offsetof(MapV_Bkt_st, slotsLo) == offsetof(MapV_SetBkt_st, slotsLo),
+               "set buckets must share the map bucket's hash lanes");
+
+//------------------------------------------------------------------------------
+// start loading a hash's home bucket, ahead of probing it
+static inline void
+_bkt_prefetch(const MapV_st*     map,
+              const MapV_Hash_st hash)
+{
+  const MapV_SlotId_t slotId = _slot_from_hash_hi(map, hash.high64);
+  const MapV_Bkt_st*  bkt    = _tbl_bkt(map, _bkt_from_slot(slotId));
+  // a default map bucket is 96 bytes, so it can span two cache lines
+  __builtin_prefetch((const char*)bkt, 0, 0);
+  if (map->meta.bktBytes > 64) {
+    __builtin_prefetch((const char*)bkt + 64, 0, 0);
+  }
+  // both of a cuckoo key's buckets; the loads overlap
+  if (map->cfg.cuckoo) {
+    const MapV_Bkt_st* alt = _tbl_bkt(map, _cuckoo_bkt_alt(map, hash));
+    __builtin_prefetch((const char*)alt, 0, 0);
+    if (map->meta.bktBytes > 64) {
+      __builtin_prefetch((const char*)alt + 64, 0, 0);
+    }
+  }
+}
+
+
+//==============================================================================
+//
+// _slot...()
+//
+//------------------------------------------------------------------------------
+// @NOTE: a 64 bit value, spread evenly over [0, meta.slotsCap): the top
+//        bits of (norm * slotsCap), which for a power of two table are just
+//        norm's top bits. it's monotonic either way, so tables stay in hash
+//        order and growing stays a single pass; see cfg.growPct.
+static inline MapV_SlotId_t
+_slot_from_norm(const MapV_st* map,
+                const uint64_t norm)
+{
+  const MapV_SlotId_t slotId
+    = (MapV_SlotId_t)(((unsigned __int128)norm * map->meta.slotsCap) >> 64);
+  // file backed: home slots skip each page's spare buckets. still monotonic
+  if (map->meta.pageHomeSlots) {
+    return slotId / map->meta.pageHomeSlots * map->meta.pageBkts * MAPV_BKT_SLOTS
+         + slotId % map->meta.pageHomeSlots;
+  }
+  return slotId;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: for a map over every hash (the default) this is just the top bits.
+//        a map over part of the hash space (cfg.hashLo/hashHi) first moves
+//        its range to start at 0, then shifts it up to fill 64 bits, so its
+//        entries still spread over the whole table. both keep hash order.
+static inline MapV_SlotId_t
+_slot_from_hash_hi(const MapV_st*      map,
+                   const MapV_HashHi_t hashHi)
+{
+  return _slot_from_norm(map, (hashHi - map->meta.hashLo) << map->meta.hashSkip);
+}
+
+//------------------------------------------------------------------------------
+static inline MapV_Dist_t
+_slot_hash_hi_dist(const MapV_st*      map,
+                   const MapV_HashHi_t hashHi,
+                   const MapV_SlotId_t cmpSlotId)
+{
+  const MapV_SlotId_t slotId = _slot_from_hash_hi(map, hashHi);
+  return cmpSlotId - slotId;
+}
+
+//------------------------------------------------------------------------------
+// @IMPORTNT: changes must likely be made in _Find(), and vice versa
+//
+// @NOTE: this isn't used by find(). see notes on that function.
+//        this _is_ used by delete and find batch.
+static inline MapV_SlotId_t
+_slot_from_key(const MapV_st* map,
+               const void*    key,
+               const size_t   keyLen)
+{
+  return _slot_from_hash(map, _hash(map, key, keyLen));
+}
+
+//------------------------------------------------------------------------------
+// the slot a hash is stored in, or UINT64_MAX if it isn't in the table.
+// does not touch map->stats, so it's safe for concurrent readers.
+//
+// @NOTE: handles every bucket layout (cfg.fpBits, cfg.set). with 64-bit
+//        fingerprints, that's a single compare per bucket. buckets aren't
+//        always 32 byte aligned (96-bit layouts are 80/48 bytes), hence loadu.
+static inline MapV_SlotId_t
+_slot_from_hash(const MapV_st*     map,
+                const MapV_Hash_st hash)
+{
+  if (map->cfg.cuckoo) {
+    return _cuckoo_slot_from_hash(map, hash);
+  }
+
+  MapV_BktId_t bktId = _bkt_from_slot(_slot_from_hash_hi(map, hash.high64));
+
+  // file backed: nothing is stored past its home page; don't read the next
+  int maxIters = map->meta.distBktIter;
+  if (map->meta.pageBkts) {
+    const uint64_t pageLeft = map->meta.pageBkts - bktId % map->meta.pageBkts;
+    maxIters = (pageLeft < (uint64_t)maxIters) ? (int)pageLeft : maxIters;
+  }
+  for (int iter = 0; iter < maxIters; iter++, bktId++)
+  {
+    const int found = _bkt_match(map, _tbl_bkt(map, bktId), hash);
+    if (0 != found) {
+      return bktId * MAPV_BKT_SLOTS + __builtin_ctz(found);
+    }
+  }
+
+  // ie: not found
+  return UINT64_MAX;
+}
+
+//------------------------------------------------------------------------------
+// one bit per slot of bkt whose hash matches. both lanes must match in the
+// same slot; two entries may share a high64.
+static inline int
+_bkt_match(const MapV_st*     map,
+           const MapV_Bkt_st* bkt,
+           const MapV_Hash_st hash)
+{
+// #ifdef __AVX2__ ... __AVX__
+
+  const int found = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+                      _mm256_loadu_si256((const __m256i*)bkt->slotsHi),
+                      _mm256_set1_epi64x(hash.high64)));
+  if (0 == found) {
+    return 0;
+  }
+  return _bkt_match_lo(map, bkt, hash, found);
+}
+
+//------------------------------------------------------------------------------
+// the slots of found, whose high64s match, whose low lanes match too
+static inline int
+_bkt_match_lo(const MapV_st*     map,
+              const MapV_Bkt_st* bkt,
+              const MapV_Hash_st hash,
+                    int          found)
+{
+  switch (map->cfg.fpBits) {
+    case 128:
+      found &= _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+                 _mm256_loadu_si256((const __m256i*)bkt->slotsLo),
+                 _mm256_set1_epi64x(hash.low64)));
+      break;
+    case 96:
+      found &= _mm_movemask_ps((__m128)_mm_cmpeq_epi32(
+                 _mm_loadu_si128((const __m128i*)bkt->slotsLo),
+                 _mm_set1_epi32((uint32_t)hash.low64)));
+      break;
+    default:
+      break;
+  }
+  return found;
+}
+
+
+
+//------------------------------------------------------------------------------
+// MapV_Find() for a hash. read only, like _slot_from_hash().
+static inline bool
+_find_hash(const MapV_st*     map,
+           const MapV_Hash_st hash,
+                 MapV_Val_ut* val)
+{
+  const MapV_SlotId_t slotId = _slot_from_hash(map, hash);
+  if (UINT64_MAX == slotId) {
+    val->u64 = 0;
+    return false;
+  }
+  val->u64 = map->cfg.set ? 0 : _tbl_val_ptr_from_slot(map, slotId)->u64;
+  return true;
+}
+
+
+
+//==============================================================================
+//
+// _tbl...()
+//
+//------------------------------------------------------------------------------
+static inline void
+_tbl_cap_update(MapV_st* map)
+{
+  map->meta.slotsAvail  = map->meta.slotsCapReal - map->meta.slotsUsed;
+  map->meta.slotsCapPct = (double)map->meta.slotsUsed
+                        / (double)map->meta.slotsCapReal
+                        * 100;
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_tbl_clear_slot(const MapV_st*      map,
+                const MapV_SlotId_t slotId)
+{
+  const MapV_BktId_t bktId     = _bkt_from_slot(slotId);
+  const MapV_BktId_t bktSlotId = _bktslot_from_slot(slotId);
+  MapV_Bkt_st*       bkt       = _tbl_bkt_for_write(map, bktId);
+  bkt->slotsHi[bktSlotId] = 0;
+  _bkt_lo_set(map, bkt, bktSlotId, 0);
+  if (!map->cfg.set) {
+    _bkt_vals(map, bkt)[bktSlotId].u64 = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_tbl_get_hv_from_slot(const MapV_st*      map,
+                      const MapV_SlotId_t slotId,
+                            MapV_HV_st*   hv)
+{
+  const MapV_BktId_t bktId     = _bkt_from_slot(slotId);
+  const MapV_BktId_t bktSlotId = _bktslot_from_slot(slotId);
+  const MapV_Bkt_st* bkt       = _tbl_bkt(map, bktId);
+  hv->hash.high64 = bkt->slotsHi[bktSlotId];
+  hv->hash.low64  = _bkt_lo_get(map, bkt, bktSlotId);
+  hv->val.u64     = map->cfg.set ? 0 : _bkt_vals(map, bkt)[bktSlotId].u64;
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_tbl_set_hv_into_slot(const MapV_st*      map,
+                      const MapV_SlotId_t slotId,
+                      const MapV_HV_st*   hv)
+{
+  const MapV_BktId_t bktId     = _bkt_from_slot(slotId);
+  const MapV_BktId_t bktSlotId = _bktslot_from_slot(slotId);
+  MapV_Bkt_st*       bkt       = _tbl_bkt_for_write(map, bktId);
+  bkt->slotsHi[bktSlotId] = hv->hash.high64;
+  _bkt_lo_set(map, bkt, bktSlotId, hv->hash.low64);
+  if (!map->cfg.set) {
+    _bkt_vals(map, bkt)[bktSlotId] = hv->val;
+  }
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: maps only; a set bucket has no vals[]
+static inline MapV_Val_ut*
+_tbl_val_ptr_from_slot(const MapV_st*      map,
+                       const MapV_SlotId_t slotId)
+{
+  return &_bkt_vals(map, _tbl_bkt(map, _bkt_from_slot(slotId)))
+            [_bktslot_from_slot(slotId)];
+}
+
+//------------------------------------------------------------------------------
+// _tbl_val_ptr_from_slot(), for a value that's about to be written
+static inline MapV_Val_ut*
+_tbl_val_ptr_for_write(const MapV_st*      map,
+                       const MapV_SlotId_t slotId)
+{
+  return &_bkt_vals(map, _tbl_bkt_for_write(map, _bkt_from_slot(slotId)))
+            [_bktslot_from_slot(slotId)];
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_tbl_dist_update(MapV_st*      map,
+                 MapV_HashHi_t hashHi,
+                 MapV_SlotId_t slotId)
+{
+  const MapV_Dist_t slotDist = _slot_hash_hi_dist(map, hashHi, slotId);
+
+  const MapV_SlotId_t targetSlot = _slot_from_hash_hi(map, hashHi);
+  const MapV_BktId_t  targetBkt  = _bkt_from_slot(targetSlot);
+  const MapV_BktId_t  actualBkt  = _bkt_from_slot(slotId);
+  const MapV_Dist_t   bktDist    = (actualBkt > targetBkt)
+                                 ? (actualBkt - targetBkt)
+                                 : (targetBkt - actualBkt);
+  _tbl_dist_raise(map, slotDist, bktDist);
+}
+
+//------------------------------------------------------------------------------
+// an entry now sits this many slots/buckets from home
+static inline void
+_tbl_dist_raise(      MapV_st*    map,
+                const MapV_Dist_t slotDist,
+                const MapV_Dist_t bktDist)
+{
+  if (slotDist > map->meta.distSlotMax) {
+    map->meta.distSlotMax  = slotDist;
+    map->meta.distSlotIter = slotDist + 1;
+  }
+  if (bktDist > map->meta.distBktMax) {
+    map->meta.distBktMax  = bktDist;
+    map->meta.distBktIter = bktDist + 1;
+  }
+}
+
+//------------------------------------------------------------------------------
+static inline bool
+_tbl_should_realloc(MapV_st* map)
+{
+  if (   map->meta.distSlotIter > map->cfg.distSlotMax
+      || map->meta.distBktIter  > map->cfg.distBktMax
+      || map->meta.slotsCapPct  > map->cfg.capPctMax) {
+    return true;
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// can an entry with this hash sit in this slot without exceeding either
+// configured probe distance, or running off the end of the table?
+static inline bool
+_tbl_slot_in_reach(const MapV_st*      map,
+                   const MapV_HashHi_t hashHi,
+                   const MapV_SlotId_t slotId)
+{
+  if (slotId >= map->meta.slotsCapReal) {
+    return false;
+  }
+  const MapV_SlotId_t homeSlotId = _slot_from_hash_hi(map, hashHi);
+  return (slotId - homeSlotId < map->cfg.distSlotMax)
+      && (  _bkt_from_slot(slotId)
+          - _bkt_from_slot(homeSlotId) < map->cfg.distBktMax)
+      && (   0 == map->meta.pageBkts
+          ||    _bkt_from_slot(slotId)     / map->meta.pageBkts
+             == _bkt_from_slot(homeSlotId) / map->meta.pageBkts);
+}
+
+//------------------------------------------------------------------------------
+// the first slot an entry with this home slot can't sit in: the
+// _tbl_slot_in_reach() limits, for every slot from homeSlotId on at once.
+static inline MapV_SlotId_t
+_tbl_reach_end(const MapV_st*      map,
+               const MapV_SlotId_t homeSlotId)
+{
+  const MapV_BktId_t  homeBktId = _bkt_from_slot(homeSlotId);
+        MapV_SlotId_t end       = homeSlotId + map->cfg.distSlotMax;
+  if (end > (homeBktId + map->cfg.distBktMax) * MAPV_BKT_SLOTS) {
+    end = (homeBktId + map->cfg.distBktMax) * MAPV_BKT_SLOTS;
+  }
+  if (map->meta.pageBkts) {
+    const MapV_SlotId_t pageEnd = (homeBktId / map->meta.pageBkts + 1)
+                                * map->meta.pageBkts * MAPV_BKT_SLOTS;
+    end = (end < pageEnd) ? end : pageEnd;
+  }
+  return (end < map->meta.slotsCapReal) ? end : map->meta.slotsCapReal;
+}
+
+//------------------------------------------------------------------------------
+// memmove() for cnt slots' entries, srcSlotId to dstSlotId, in pieces that
+// each stay inside one bucket at both ends, back to front when moving up.
+// cache refs don't move; see _cache_ref_move().
+static inline void
+_tbl_move_slots(const MapV_st*      map,
+                      MapV_SlotId_t dstSlotId,
+                      MapV_SlotId_t srcSlotId,
+                      uint64_t      cnt)
+{
+  const bool up = (dstSlotId > srcSlotId);
+  if (up) {
+    dstSlotId += cnt;
+    srcSlotId += cnt;
+  }
+  while (cnt > 0)
+  {
+    // the longest piece that stays inside one source and one dest bucket
+    uint64_t n = cnt;
+    if (up) {
+      n = (n < (dstSlotId - 1) % MAPV_BKT_SLOTS + 1)
+        ? n : (dstSlotId - 1) % MAPV_BKT_SLOTS + 1;
+      n = (n < (srcSlotId - 1) % MAPV_BKT_SLOTS + 1)
+        ? n : (srcSlotId - 1) % MAPV_BKT_SLOTS + 1;
+      dstSlotId -= n;
+      srcSlotId -= n;
+    } else {
+      n = (n < MAPV_BKT_SLOTS - dstSlotId % MAPV_BKT_SLOTS)
+        ? n : MAPV_BKT_SLOTS - dstSlotId % MAPV_BKT_SLOTS;
+      n = (n < MAPV_BKT_SLOTS - srcSlotId % MAPV_BKT_SLOTS)
+        ? n : MAPV_BKT_SLOTS - srcSlotId % MAPV_BKT_SLOTS;
+    }
+
+    // dst first: if it's src's page that's copied, src is then read there
+    MapV_Bkt_st*       dst = _tbl_bkt_for_write(map, _bkt_from_slot(dstSlotId));
+    const MapV_Bkt_st* src = _tbl_bkt(map, _bkt_from_slot(srcSlotId));
+    const uint64_t     d   = _bktslot_from_slot(dstSlotId);
+    const uint64_t     s   = _bktslot_from_slot(srcSlotId);
+    // at most 4 of each; a loop beats a memmove() call. back to front when
+    // moving up, as the piece may overlap itself
+    for (uint64_t k = 0; k < n; k++) {
+      const uint64_t i = up ? n - 1 - k : k;
+      dst->slotsHi[d + i] = src->slotsHi[s + i];
+      switch (map->cfg.fpBits) {
+        case 128:
+          dst->slotsLo[d + i] = src->slotsLo[s + i];
+          break;
+        case 96:
+          ((uint32_t*)dst->slotsLo)[d + i] = ((const uint32_t*)src->slotsLo)[s + i];
+          break;
+        default:
+          break;
+      }
+      if (!map->cfg.set) {
+        _bkt_vals(map, dst)[d + i] = _bkt_vals(map, src)[s + i];
+      }
+    }
+
+    if (!up) {
+      dstSlotId += n;
+      srcSlotId += n;
+    }
+    cnt -= n;
+  }
+}
+
+//------------------------------------------------------------------------------
+// find newHv's hash, or insert newHv, in a single probe.
+// *slotIdOut is where the entry is; *inserted tells which one happened.
+//
+// @NOTE: robin hood insertion done as "find the spot, then shift":
+//        1. probe from the home slot until we find the hash (done), an empty
+//           slot, or an entry closer to its home than we'd be (the swap point)
+//        2. every entry from the swap point up to the next empty slot moves
+//           one slot right. check that they all still fit first.
+//        3. shift them, back to front, and write newHv at the swap point.
+//        nothing is written until we know the insert fits, so a
+//        MAPV_ERR__TABLE_MUST_GROW leaves the table untouched.
+//        entries with the same home slot keep their insertion order, so
+//        early-inserted keys stay the ones found first.
+//        see _tbl_upsert_probe() and MAPV_PROBE_SCALAR for the two ways
+//        it's done; the tables they leave are the same.
+static inline MapV_Err_et
+_tbl_upsert_hv(      MapV_st*       map,
+               const MapV_HV_st     newHv,
+                     MapV_SlotId_t* slotIdOut,
+                     bool*          inserted)
+{
+  if (map->shm.reader) {
+    return MAPV_ERR__SHM_READ_ONLY;
+  }
+  if (_snap_frozen(map)) {
+    return MAPV_ERR__SNAPSHOT_READ_ONLY;
+  }
+  if (newHv.hash.high64 - map->meta.hashLo > map->meta.hashSpan) {
+    return MAPV_ERR__HASH_OUT_OF_RANGE;
+  }
+  _snap_write_begin(map);
+  if (map->cfg.cuckoo) {
+    return _cuckoo_upsert_hv(map, newHv, slotIdOut, inserted);
+  }
+  if (_tbl_should_realloc(map)) {
+    return MAPV_ERR__TABLE_MUST_GROW;
+  }
+
+#if MAPV_PROBE_SCALAR
+  return _tbl_upsert_probe_scalar(map, newHv, slotIdOut, inserted);
+#else
+  return _tbl_upsert_probe(map, newHv, slotIdOut, inserted);
+#endif
+}
+
+//------------------------------------------------------------------------------
+// _tbl_upsert_hv(), a bucket at a time. each bucket's high64s are loaded
+// once and compared all together: with newHv's, with 0 (empty), and, as
+// unsigned numbers, to see which sort after it, ie: may live further along
+// than newHv would. the first of those, in slot order, decides, as it would
+// slot by slot. only the last kind is checked any further, for a home slot
+// past newHv's; one with the same home slot is older, and is passed.
+// every reach check is against one end slot, and the shift moves the run a
+// bucket at a time.
+//
+// @NOTE: the home slot settles most probes, and is always in reach, so
+//        it's checked first, on its own, before any of the rest is set up.
+static inline MapV_Err_et
+_tbl_upsert_probe(      MapV_st*       map,
+                  const MapV_HV_st     newHv,
+                        MapV_SlotId_t* slotIdOut,
+                        bool*          inserted)
+{
+  const MapV_SlotId_t homeSlotId = _slot_from_hash_hi(map, newHv.hash.high64);
+        MapV_BktId_t  bktId      = _bkt_from_slot(homeSlotId);
+  const MapV_Bkt_st*  bkt        = _tbl_bkt(map, bktId);
+  const MapV_BktId_t  homeBktSlot    = _bktslot_from_slot(homeSlotId);
+
+  MapV_SlotId_t slotId = homeSlotId;
+  int           isEmpty;
+  if (   bkt->slotsHi[homeBktSlot] == newHv.hash.high64
+      && _bkt_lo_get(map, bkt, homeBktSlot) == newHv.hash.low64) {
+    _cache_ref_put(map, slotId, true);
+    *slotIdOut = slotId;
+    *inserted  = false;
+    return MAPV_ERR__OK;
+  }
+  if (0 == bkt->slotsHi[homeBktSlot]) {
+    isEmpty = 1;
+    goto insert;
+  }
+
+  __m256i hi    = _mm256_loadu_si256((const __m256i*)bkt->slotsHi);
+  int     found = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+                    hi, _mm256_set1_epi64x(newHv.hash.high64)));
+  int     empty = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+                    hi, _mm256_setzero_si256()));
+  found = (0 == found) ? 0 : _bkt_match_lo(map, bkt, newHv.hash, found);
+
+  // unsigned compares, as signed ones, with the sign bit flipped
+  const MapV_SlotId_t reachEnd = _tbl_reach_end(map, homeSlotId);
+  const __m128i       skip     = _mm_cvtsi64_si128((long long)map->meta.hashSkip);
+  const __m256i       lo       = _mm256_set1_epi64x((long long)map->meta.hashLo);
+  const __m256i       sign     = _mm256_set1_epi64x(INT64_MIN);
+  const __m256i       norm     = _mm256_set1_epi64x((long long)
+                                   (((newHv.hash.high64 - map->meta.hashLo)
+                                     << map->meta.hashSkip) ^ (uint64_t)INT64_MIN));
+  for (;;)
+  {
+    const int after = _mm256_movemask_pd((__m256d)_mm256_cmpgt_epi64(
+                        _mm256_xor_si256(_mm256_sll_epi64(
+                          _mm256_sub_epi64(hi, lo), skip), sign),
+                        norm)) & ~empty;
+
+    int stop = (found | empty | after) & (0xf << _bktslot_from_slot(slotId));
+    for (; 0 != stop; stop &= stop - 1)
+    {
+      const int bit = __builtin_ctz(stop);
+      slotId = bktId * MAPV_BKT_SLOTS + bit;
+      if (slotId >= reachEnd) {
+        return MAPV_ERR__TABLE_MUST_GROW;
+      }
+      if (found & (1 << bit)) {
+        _cache_ref_put(map, slotId, true);
+        *slotIdOut = slotId;
+        *inserted  = false;
+        return MAPV_ERR__OK;
+      }
+      isEmpty = empty & (1 << bit);
+      if (isEmpty || _slot_from_hash_hi(map, bkt->slotsHi[bit]) > homeSlotId) {
+        goto insert;
+      }
+    }
+
+    slotId = (++bktId) * MAPV_BKT_SLOTS;
+    if (slotId >= reachEnd) {
+      return MAPV_ERR__TABLE_MUST_GROW;
+    }
+    bkt   = _tbl_bkt(map, bktId);
+    hi    = _mm256_loadu_si256((const __m256i*)bkt->slotsHi);
+    found = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+              hi, _mm256_set1_epi64x(newHv.hash.high64)));
+    found = (0 == found) ? 0 : _bkt_match_lo(map, bkt, newHv.hash, found);
+    empty = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+              hi, _mm256_setzero_si256()));
+  }
+
+insert:;
+  // the run to shift: up to the next empty slot. every entry in it must
+  // still be in reach one slot on; note how far that takes them
+  const MapV_SlotId_t insSlotId = slotId;
+        MapV_SlotId_t endSlotId = slotId;
+        MapV_Dist_t   slotDist  = 0;
+        MapV_Dist_t   bktDist   = 0;
+  while (!isEmpty)
+  {
+    const MapV_BktId_t bktId = _bkt_from_slot(endSlotId);
+    const MapV_Bkt_st* bkt   = _tbl_bkt(map, bktId);
+    const int          empty = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+                                 _mm256_loadu_si256((const __m256i*)bkt->slotsHi),
+                                 _mm256_setzero_si256()))
+                             & (0xf << _bktslot_from_slot(endSlotId));
+    const MapV_SlotId_t runEnd = (0 == empty)
+                               ? (bktId + 1) * MAPV_BKT_SLOTS
+                               : bktId * MAPV_BKT_SLOTS + __builtin_ctz(empty);
+    for (; endSlotId < runEnd; endSlotId++)
+    {
+      const MapV_SlotId_t curHome = _slot_from_hash_hi(map,
+                                      bkt->slotsHi[_bktslot_from_slot(endSlotId)]);
+      if (endSlotId + 1 >= _tbl_reach_end(map, curHome)) {
+        return MAPV_ERR__TABLE_MUST_GROW;
+      }
+      const MapV_Dist_t curBktDist = _bkt_from_slot(endSlotId + 1)
+                                   - _bkt_from_slot(curHome);
+      slotDist = (endSlotId + 1 - curHome > slotDist)
+               ? endSlotId + 1 - curHome : slotDist;
+      bktDist  = (curBktDist > bktDist) ? curBktDist : bktDist;
+    }
+    isEmpty = (0 != empty);
+  }
+
+  _shm_write_begin(map);
+  _tbl_move_slots(map, insSlotId + 1, insSlotId, endSlotId - insSlotId);
+  for (MapV_SlotId_t dstSlotId = endSlotId; dstSlotId > insSlotId; dstSlotId--) {
+    _cache_ref_move(map, dstSlotId, dstSlotId - 1);
+  }
+  _tbl_dist_raise(map, slotDist, bktDist);
+  _tbl_set_hv_into_slot(map, insSlotId, &newHv);
+  _cache_ref_put(map, insSlotId, true);
+  _tbl_dist_update(map, newHv.hash.high64, insSlotId);
+  map->meta.slotsUsed++;
+  _shm_write_end(map);
+
+  *slotIdOut = insSlotId;
+  *inserted  = true;
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+// _tbl_upsert_hv(), a slot at a time (MAPV_PROBE_SCALAR)
+static inline MapV_Err_et
+_tbl_upsert_probe_scalar(      MapV_st*       map,
+                         const MapV_HV_st     newHv,
+                               MapV_SlotId_t* slotIdOut,
+                               bool*          inserted)
+{
+  const MapV_SlotId_t homeSlotId = _slot_from_hash_hi(map, newHv.hash.high64);
+        MapV_SlotId_t slotId     = homeSlotId;
+        MapV_HV_st    curHv;
+
+  for (;; slotId++)
+  {
+    if (!_tbl_slot_in_reach(map, newHv.hash.high64, slotId)) {
+      return MAPV_ERR__TABLE_MUST_GROW;
+    }
+
+    // compare the hash before anything else; for counting/dedup the key
+    // is usually there already
+    const MapV_Bkt_st* bkt       = _tbl_bkt(map, _bkt_from_slot(slotId));
+    const MapV_BktId_t bktSlotId = _bktslot_from_slot(slotId);
+    if (bkt->slotsHi[bktSlotId] == newHv.hash.high64
+        && _bkt_lo_get(map, bkt, bktSlotId) == newHv.hash.low64) {
+      _cache_ref_put(map, slotId, true);
+      *slotIdOut = slotId;
+      *inserted  = false;
+      return MAPV_ERR__OK;
+    }
+
+    _tbl_get_hv_from_slot(map, slotId, &curHv);
+    if (_hv_is_empty(&curHv)) {
+      break;
+    }
+    if (  slotId - homeSlotId
+        > _slot_hash_hi_dist(map, curHv.hash.high64, slotId)) {
+      break;
+    }
+  }
+
+  const MapV_SlotId_t insSlotId = slotId;
+        MapV_SlotId_t endSlotId = slotId;
+  while (!_hv_is_empty(&curHv)) {
+    if (!_tbl_slot_in_reach(map, curHv.hash.high64, endSlotId + 1)) {
+      return MAPV_ERR__TABLE_MUST_GROW;
+    }
+    endSlotId++;
+    _tbl_get_hv_from_slot(map, endSlotId, &curHv);
+  }
+
+  _shm_write_begin(map);
+  for (MapV_SlotId_t dstSlotId = endSlotId; dstSlotId > insSlotId; dstSlotId--)
+  {
+    _tbl_get_hv_from_slot(map, dstSlotId - 1, &curHv);
+    _tbl_set_hv_into_slot(map, dstSlotId,     &curHv);
+    _tbl_dist_update(map, curHv.hash.high64, dstSlotId);
+    _cache_ref_move(map, dstSlotId, dstSlotId - 1);
+  }
+  _tbl_set_hv_into_slot(map, insSlotId, &newHv);
+  _cache_ref_put(map, insSlotId, true);
+  _tbl_dist_update(map, newHv.hash.high64, insSlotId);
+  map->meta.slotsUsed++;
+  _shm_write_end(map);
+
+  *slotIdOut = insSlotId;
+  *inserted  = true;
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+// MapV_Upsert() for a hash, growing the table as needed. with the key, the
+// table may be reseeded instead (cfg.keyOf), and the key is hashed again.
+// NULL: the hash is all there is, and the table only grows.
+static inline MapV_Err_et
+_upsert_hash(      MapV_st*      map,
+                   MapV_Hash_st  hash,
+             const void*         key,
+             const size_t        keyLen,
+                   MapV_Val_ut** valPtr,
+                   bool*         inserted)
+{
+  MapV_HV_st newHv = { .hash = hash, .val = {0}, };
+
+  MapV_SlotId_t slotId;
+  MapV_Err_et   err;
+  while (MAPV_ERR__TABLE_MUST_GROW
+         == (err = _tbl_upsert_hv(map, newHv, &slotId, inserted))) {
+    if (!_tbl_make_room(map, newHv.hash.high64, NULL != key)) {
+      printf("MapV_Upsert(): _tbl_make_room() failed\n");
+      return MAPV_ERR__TABLE_GROW_FAILED;
+    }
+    if (NULL != key) {
+      newHv.hash = _hash(map, key, keyLen);
+    }
+  }
+  if (MAPV_ERR__OK != err) {
+    *inserted = false;
+    *valPtr   = NULL;
+    return err;
+  }
+
+  if (*inserted) {
+    _tbl_cap_update(map);
+  }
+  *valPtr = _tbl_val_ptr_for_write(map, slotId);
+  return err;
+}
+
+//------------------------------------------------------------------------------
+// MapV_InsertHash(); key as in _upsert_hash()
+static inline MapV_Err_et
+_insert_hash(      MapV_st*     map,
+                   MapV_Hash_st hash,
+             const void*        key,
+             const size_t       keyLen,
+             const MapV_Val_ut  val,
+             const bool         overwriteIfExists)
+{
+  MapV_HV_st newHv = { .hash = hash, .val = val, };
+
+  MapV_Err_et err;
+  while (MAPV_ERR__TABLE_MUST_GROW
+         == (err = _tbl_insert_hv(map, newHv, overwriteIfExists))) {
+    if (!_tbl_make_room(map, newHv.hash.high64, NULL != key)) {
+      printf("MapV_InsertHash(): _tbl_make_room() failed\n");
+      return MAPV_ERR__TABLE_GROW_FAILED;
+    }
+    if (NULL != key) {
+      newHv.hash = _hash(map, key, keyLen);
+    }
+  }
+
+  _tbl_cap_update(map);
+  if (MAPV_ERR__OK == err && NULL != map->hook.onInsert) {
+    map->hook.onInsert(map->hook.ctx, newHv.hash,
+                       map->cfg.set ? (MapV_Val_ut){0} : val);
+  }
+  return err;
+}
+
+//------------------------------------------------------------------------------
+static inline MapV_Err_et
+_tbl_insert_hv(      MapV_st*   map,
+               const MapV_HV_st newHv,
+               const bool       overwriteIfExists)
+{
+  MapV_SlotId_t slotId;
+  bool          inserted;
+
+  MapV_Err_et err;
+  if (MAPV_ERR__OK != (err = _tbl_upsert_hv(map, newHv, &slotId, &inserted))) {
+    return err;
+  }
+  if (!inserted) {
+    if (!overwriteIfExists) {
+      return MAPV_ERR__INSERT_KEY_EXISTS;
+    }
+    *_tbl_val_ptr_for_write(map, slotId) = newHv.val;
+  }
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+// append an entry whose hash sorts after every entry already in the table:
+// it goes in its home slot, or right after the last entry if that's further.
+// no probing, no shifting, no duplicate check.
+// *fillSlotId is the slot after the last entry placed; 0 for an empty table.
+static inline MapV_Err_et
+_tbl_fill_hv(      MapV_st*       map,
+             const MapV_HV_st*    hv,
+                   MapV_SlotId_t* fillSlotId)
+{
+  if (hv->hash.high64 - map->meta.hashLo > map->meta.hashSpan) {
+    return MAPV_ERR__HASH_OUT_OF_RANGE;
+  }
+
+  const MapV_SlotId_t homeSlotId = _slot_from_hash_hi(map, hv->hash.high64);
+  const MapV_SlotId_t slotId     = (homeSlotId > *fillSlotId)
+                                 ? homeSlotId : *fillSlotId;
+  if (!_tbl_slot_in_reach(map, hv->hash.high64, slotId)) {
+    return MAPV_ERR__TABLE_MUST_GROW;
+  }
+
+  _shm_write_begin(map);
+  _tbl_set_hv_into_slot(map, slotId, hv);
+  _tbl_dist_update(map, hv->hash.high64, slotId);
+  map->meta.slotsUsed++;
+  _shm_write_end(map);
+  *fillSlotId = slotId + 1;
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+static inline bool
+_tbl_redistribute_hashes(MapV_st* map,
+                         MapV_st* oldMap)
+{
+  // a distance of 0 still needs one iteration; same as MapV_Create()
+  map->meta.distSlotMax  = 0;
+  map->meta.distSlotIter = 1;
+  map->meta.distBktMax   = 0;
+  map->meta.distBktIter  = 1;
+  map->meta.slotsUsed    = 0; // recounted by _tbl_insert_hv()
+  map->meta.stashUsed    = 0; // "
+
+  // a reseed: every entry's key, from cfg.keyOf(), hashed again. they're
+  // no longer in order, so inserts shift, as any others do
+  const bool rehash = (map->meta.seed != oldMap->meta.seed);
+
+  const uint64_t slotCnt = oldMap->meta.slotsCapReal;
+  for (MapV_SlotId_t oldSlot = 0; oldSlot < slotCnt; oldSlot++)
+  {
+    MapV_HV_st newHv;
+    _tbl_get_hv_from_slot(oldMap, oldSlot, &newHv);
+    if (_hv_is_empty(&newHv)) {
+      continue;
+    }
+    if (rehash) {
+      const void* key;
+      size_t      keyLen;
+      if (!map->cfg.keyOf(map->cfg.keyOfCtx, newHv.hash, newHv.val,
+                          &key, &keyLen)) {
+        return false;
+      }
+      newHv.hash = _hash(map, key, keyLen);
+    }
+
+    // @NOTE: old slots are visited in home slot order, so every entry lands
+    //        after the previous one and nothing is ever shifted.
+    //        the old table is left intact; if an entry doesn't fit, the
+    //        caller throws this table away and tries a bigger one.
+	  if (MAPV_ERR__OK != _tbl_insert_hv(map, newHv, true)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// free a table's memory, or unmap its file or shared memory. snapshotted,
+// let go of its pages instead; a snapshot may still have them
+static inline void
+_tbl_mem_free(MapV_st* map)
+{
+  if (NULL != map->snap) {
+    _snap_release(map->snap);
+    map->snap = NULL;
+  } else if (map->tbl.path || map->shm.hdr) {
+    munmap(map->tbl.bktPtrReal, map->meta.tblBytesReal);
+    if (map->shm.hdr && !map->shm.reader) {
+      _shm_unlink(map, map->shm.gen);
+    }
+  } else {
+    free(map->tbl.bktPtrReal);
+  }
+  map->tbl.bktPtrReal = NULL;
+  map->tbl.bkt        = NULL;
+}
+
+//------------------------------------------------------------------------------
+// rebuild cur into a table with slotsCap home slots, hashed with seed (a
+// seed other than cur's rehashes every key; see _tbl_reseed()).
+// returns MAPV_ERR__TABLE_MUST_GROW if the entries don't fit at that size,
+// or a key wasn't there to rehash, MAPV_ERR__TABLE_GROW_FAILED if memory
+// couldn't be allocated. either way, cur is unchanged on failure.
+static inline MapV_Err_et
+_tbl_realloc(      MapV_st* cur,
+                   uint64_t slotsCap,
+             const uint64_t seed)
+{
+  MapV_st new = *cur; // copy our current table config for modifications
+                      // until we're certain memory has allocated, etc.
+  new.meta.seed = seed;
+
+  if (slotsCap < MAPV_BKT_SLOTS) {
+    slotsCap = MAPV_BKT_SLOTS;
+  }
+  new.meta.slotsCap = slotsCap;
+
+  // lookups use _slot_from_norm(); this is for code that only ever sees
+  // power of two tables (MapV.hpp)
+  new.meta.slotHashShift = (0 == (slotsCap & (slotsCap - 1)) && !new.tbl.path)
+                         ? 64 - log2(new.meta.slotsCap) : 0;
+
+  new.meta.bktsCnt = new.meta.slotsCap / MAPV_BKT_SLOTS;
+
+  // add extra buckets for the last bucket's overflow
+  // but do not increase .meta.slotsCap
+  // when inserting, we'll only check against .cfg.distSlotMax
+  new.meta.bktsCntReal = new.meta.bktsCnt + _tbl_bkts_extra(&new.cfg);
+
+  new.meta.slotsCapReal = new.meta.bktsCntReal * MAPV_BKT_SLOTS;
+
+  new.meta.tblBytes = new.meta.slotsCapReal
+                    / MAPV_BKT_SLOTS
+                    * new.meta.bktBytes;
+
+  // allocate extra, then trim for alignment
+  new.meta.tblBytesReal = new.meta.tblBytes + (2 * new.cfg.memAlign);
+
+  // file backed: whole pages, each with its home slots and then its spare
+  // buckets; a page's entries overflow into its own spares, so the extra
+  // buckets at the end aren't needed. mmap() aligns them
+  if (new.tbl.path) {
+    const uint64_t pagesCnt = (slotsCap + new.meta.pageHomeSlots - 1)
+                            / new.meta.pageHomeSlots;
+    new.meta.bktsCntReal  = pagesCnt * new.meta.pageBkts;
+    new.meta.slotsCapReal = new.meta.bktsCntReal * MAPV_BKT_SLOTS;
+    new.meta.tblBytes     = pagesCnt * new.meta.pageBytes;
+    new.meta.tblBytesReal = new.meta.tblBytes;
+  }
+
+  // the new table is in one piece, with no snapshot sharing it
+  new.snap = NULL;
+
+  // shared memory: the next gen's object, page aligned by mmap() too
+  if (new.shm.hdr) {
+    new.shm.gen           = cur->shm.gen + 1;
+    new.meta.tblBytesReal = new.meta.tblBytes;
+  }
+
+  //--------------------------------------------------------------------
+  // setup is done. now alloc and align.
+
+  if (new.tbl.path) {
+    new.tbl.bktPtrReal    = _file_map(&new);
+    new.tbl.bkt           = new.tbl.bktPtrReal;
+  } else if (new.shm.hdr) {
+    new.tbl.bktPtrReal    = _shm_map(&new, new.shm.gen, new.meta.tblBytes, true);
+    new.tbl.bkt           = new.tbl.bktPtrReal;
+  } else {
+    new.tbl.bktPtrReal = calloc(1, new.meta.tblBytesReal);
+    // set our bucket to an aligned address
+    new.tbl.bkt = (void*)(((uint64_t)new.tbl.bktPtrReal / new.cfg.memAlign)
+                           * new.cfg.memAlign
+                           + new.cfg.memAlign);
+  }
+  if (NULL == new.tbl.bktPtrReal) {
+    // @TODO: get error
+    return MAPV_ERR__TABLE_GROW_FAILED;
+  }
+
+  _tbl_cap_update(&new);
+
+  if (0 != cur->meta.slotsUsed) {
+    // the old table is read front to back
+    _file_advise(cur, MADV_SEQUENTIAL);
+    // shared memory readers keep using the old table meanwhile; the new one
+    // isn't theirs until it's published below
+    MapV_ShmHdr_st* hdr = new.shm.hdr;
+    new.shm.hdr = NULL;
+    const bool fits = _tbl_redistribute_hashes(&new, cur);
+    new.shm.hdr = hdr;
+    if (!fits) {
+      _tbl_mem_free(&new);
+      _file_advise(cur, MADV_RANDOM);
+      return MAPV_ERR__TABLE_MUST_GROW;
+    }
+    _tbl_cap_update(&new);
+  }
+
+  MapV_st old = *cur;
+  *cur = new;
+  _shm_write_begin(cur); // publish: readers move to the new gen
+  _shm_write_end(cur);
+  if (NULL != old.tbl.bktPtrReal) {
+    _tbl_mem_free(&old);
+  }
+
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+// the next size up from slotsCap: a power of two, or cfg.growPct of it in
+// whole buckets. a map with no table yet gets the smallest that's bigger
+// than cfg.initialSlotCount, as a power of two table would.
+static inline uint64_t
+_tbl_grow_cap(const MapV_st* map,
+              const uint64_t slotsCap)
+{
+  if (200 == map->cfg.growPct) {
+    return _pow2_next_u64(slotsCap + 1);
+  }
+
+  uint64_t next = (0 == map->meta.bktsCnt)
+                ? slotsCap + 1
+                : slotsCap * map->cfg.growPct / 100;
+  next = (next + MAPV_BKT_SLOTS - 1) / MAPV_BKT_SLOTS * MAPV_BKT_SLOTS;
+  return (next > slotsCap) ? next : slotsCap + MAPV_BKT_SLOTS;
+}
+
+//------------------------------------------------------------------------------
+// grow the table until everything fits
+static inline bool
+_tbl_realloc_grow(MapV_st* cur)
+{
+  uint64_t    slotsCap = cur->meta.slotsCap;
+  MapV_Err_et err;
+  do {
+    slotsCap = _tbl_grow_cap(cur, slotsCap);
+  } while (MAPV_ERR__TABLE_MUST_GROW
+           == (err = _tbl_realloc(cur, slotsCap, cur->meta.seed)));
+
+  return (MAPV_ERR__OK == err);
+}
+
+//------------------------------------------------------------------------------
+// buckets past the last home bucket, for the last entries' overflow.
+// .meta.slotsCap doesn't include them; inserts only check .cfg.distSlotMax.
+static inline uint64_t
+_tbl_bkts_extra(const MapV_Cfg_st* cfg)
+{
+  // cuckoo: nothing overflows into the next bucket; these are the stash
+  if (cfg->cuckoo) {
+    return MAPV_CUCKOO_STASH_BKTS;
+  }
+  // -1 because we already have an initial bucket
+  if (cfg->distSlotMax > (cfg->distBktMax * MAPV_BKT_SLOTS)) {
+    return (cfg->distSlotMax / MAPV_BKT_SLOTS) - 1;
+  }
+  return cfg->distBktMax - 1;
+}
+
+//------------------------------------------------------------------------------
+// empty a slot, then backward shift: pull each following entry back one slot
+// until we hit an empty slot or an entry that's already in its home slot.
+static inline void
+_tbl_delete_slot(MapV_st*      map,
+                 MapV_SlotId_t slotId)
+{
+	_snap_write_begin(map);
+	_shm_write_begin(map);
+
+	// cuckoo: entries don't depend on their neighbours; nothing moves
+	if (map->cfg.cuckoo) {
+		_tbl_clear_slot(map, slotId);
+		if (_bkt_from_slot(slotId) >= map->meta.bktsCnt) {
+			map->meta.stashUsed--;
+		}
+		map->meta.slotsUsed--;
+		_tbl_cap_update(map);
+		_shm_write_end(map);
+		return;
+	}
+
+#if MAPV_PROBE_SCALAR
+	slotId = _tbl_delete_shift_scalar(map, slotId);
+#else
+	slotId = _tbl_delete_shift(map, slotId);
+#endif
+	_cache_ref_put(map, slotId, false);
+
+	map->meta.slotsUsed--;
+	_tbl_cap_update(map);
+	_shm_write_end(map);
+}
+
+//------------------------------------------------------------------------------
+// _tbl_delete_slot()'s shift, a bucket run at a time: each bucket's empty
+// slots are found together, the entries before the first are checked for
+// one in its home slot, and the whole run moves back at once. returns the
+// slot left empty.
+static inline MapV_SlotId_t
+_tbl_delete_shift(const MapV_st*      map,
+                  const MapV_SlotId_t slotId)
+{
+	// most deletes move nothing: the next slot is empty, or its entry is home
+	MapV_SlotId_t endSlotId = slotId + 1;
+	bool          done      = (endSlotId >= map->meta.slotsCapReal);
+	if (!done) {
+		const MapV_HashHi_t hi = _tbl_bkt(map, _bkt_from_slot(endSlotId))
+		                           ->slotsHi[_bktslot_from_slot(endSlotId)];
+		done = (0 == hi || 0 == _slot_hash_hi_dist(map, hi, endSlotId));
+	}
+	while (!done && endSlotId < map->meta.slotsCapReal)
+	{
+		const MapV_BktId_t bktId = _bkt_from_slot(endSlotId);
+		const MapV_Bkt_st* bkt   = _tbl_bkt(map, bktId);
+		const int          empty = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+		                             _mm256_loadu_si256((const __m256i*)bkt->slotsHi),
+		                             _mm256_setzero_si256()))
+		                         & (0xf << _bktslot_from_slot(endSlotId));
+		const MapV_SlotId_t runEnd = (0 == empty)
+		                           ? (bktId + 1) * MAPV_BKT_SLOTS
+		                           : bktId * MAPV_BKT_SLOTS + __builtin_ctz(empty);
+		done = (0 != empty);
+		for (; endSlotId < runEnd; endSlotId++) {
+			const MapV_HashHi_t hi = bkt->slotsHi[_bktslot_from_slot(endSlotId)];
+			if (0 == _slot_hash_hi_dist(map, hi, endSlotId)) {
+				done = true;
+				break;
+			}
+		}
+	}
+
+	const uint64_t cnt = endSlotId - slotId - 1;
+	_tbl_move_slots(map, slotId, slotId + 1, cnt);
+	for (MapV_SlotId_t dstSlotId = slotId; dstSlotId < slotId + cnt; dstSlotId++) {
+		_cache_ref_move(map, dstSlotId, dstSlotId + 1);
+	}
+	_tbl_clear_slot(map, slotId + cnt);
+	return slotId + cnt;
+}
+
+//------------------------------------------------------------------------------
+// _tbl_delete_slot()'s shift, a slot at a time (MAPV_PROBE_SCALAR)
+static inline MapV_SlotId_t
+_tbl_delete_shift_scalar(const MapV_st*      map,
+                               MapV_SlotId_t slotId)
+{
+	_tbl_clear_slot(map, slotId);
+
+	while (slotId + 1 < map->meta.slotsCapReal)
+	{
+		const MapV_SlotId_t nextSlotId = slotId + 1;
+
+		MapV_HV_st nextSlotHv;
+		_tbl_get_hv_from_slot(map, nextSlotId, &nextSlotHv);
+		if (_hv_is_empty(&nextSlotHv)) {
+			break;
+		}
+		if (0 == _slot_hash_hi_dist(map, nextSlotHv.hash.high64, nextSlotId)) {
+			break;
+		}
+
+		_tbl_set_hv_into_slot(map, slotId, &nextSlotHv);
+		_tbl_clear_slot(map, nextSlotId);
+		_cache_ref_move(map, slotId, nextSlotId);
+
+		slotId++;
+	}
+	return slotId;
+}
+
+//------------------------------------------------------------------------------
+// an insert returned MAPV_ERR__TABLE_MUST_GROW: grow, or in a cache, evict.
+// canReseed: the caller has the key, and will hash it again; see
+// _tbl_reseed().
+static inline bool
+_tbl_make_room(      MapV_st*      map,
+               const MapV_HashHi_t hashHi,
+               const bool          canReseed)
+{
+  if (NULL != map->tbl.ref) {
+    return _cache_evict(map, hashHi);
+  }
+  if (canReseed && _tbl_reseed(map)) {
+    return true;
+  }
+  if (!_tbl_realloc_grow(map)) {
+    return false;
+  }
+  map->meta.reseeds = 0;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// a probe ran past the distance limits in a mostly empty table: the keys
+// cluster under this seed, by chance or by design. growing would take
+// memory and might not help (a crafted set collides at any size); a new
+// seed scatters them. rebuilt at the same size, with every key from
+// cfg.keyOf(). false if that's not possible, or didn't fit; then the
+// table grows as usual.
+static inline bool
+_tbl_reseed(MapV_st* map)
+{
+  if (   NULL == map->cfg.keyOf
+      || NULL != map->hook.onInsert || NULL != map->hook.onDelete
+      || map->meta.slotsCapPct >= MAPV_RESEED_PCT_MAX
+      || map->meta.reseeds     >= MAPV_RESEED_TRIES) {
+    return false;
+  }
+  map->meta.reseeds++;
+  if (MAPV_ERR__OK != _tbl_realloc(map, map->meta.slotsCap,
+                                   _seed_random(map->meta.seed))) {
+    return false;
+  }
+  map->stats.reseeds++;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// a seed an attacker can't know ahead of time; never prev (a rebuild would
+// be for nothing), or 0
+static inline uint64_t
+_seed_random(const uint64_t prev)
+{
+  uint64_t seed = 0;
+  if (sizeof(seed) != getrandom(&seed, sizeof(seed), 0)) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    seed = XXH3_64bits_withSeed(&ts, sizeof(ts), prev);
+  }
+  return (seed == prev || 0 == seed) ? ~prev + (0 == ~prev) : seed;
+}
+
+
+
+//==============================================================================
+//
+// _file...() : out of core tables (cfg.filePath)
+//
+// @NOTE: each table, including each one a grow makes, gets its own file:
+//        created, sized, mapped shared, then unlinked and closed, so it's
+//        gone once unmapped. the kernel writes its pages back and reads
+//        them in as memory allows. lookups are random, so readahead is off
+//        (MADV_RANDOM) except while a grow reads the old table in order.
+//        entries never leave their home slot's page (_tbl_slot_in_reach()),
+//        so a probe faults in one page at most.
+//
+//------------------------------------------------------------------------------
+// a zeroed, page aligned table of map->meta.tblBytes, or NULL
+static inline void*
+_file_map(const MapV_st* map)
+{
+  const int fd = open(map->tbl.path, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    printf("can't create %s: %s\n", map->tbl.path, strerror(errno));
+    return NULL;
+  }
+  unlink(map->tbl.path);
+
+  void* mem = MAP_FAILED;
+  if (0 == ftruncate(fd, map->meta.tblBytes)) {
+    mem = mmap(NULL, map->meta.tblBytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+               fd, 0);
+  }
+  if (MAP_FAILED == mem) {
+    printf("can't map %"PRIu64" bytes of %s: %s\n",
+           map->meta.tblBytes, map->tbl.path, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+  close(fd);
+
+  madvise(mem, map->meta.tblBytes, MADV_RANDOM);
+  return mem;
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_file_advise(const MapV_st* map,
+             const int      advice)
+{
+  if (map->tbl.path && map->tbl.bktPtrReal) {
+    madvise(map->tbl.bktPtrReal, map->meta.tblBytesReal, advice);
+  }
+}
+
+//------------------------------------------------------------------------------
+// ask for every page these hashes' probes will read, once each, so the
+// reads are in flight together rather than faulted in one at a time
+static inline void
+_file_willneed(const MapV_st*      map,
+               const MapV_Hash_st* hashes,
+               const uint64_t      hashesCnt)
+{
+  if (0 == map->meta.pageBkts) {
+    return;
+  }
+
+  uint64_t pages[MAPV_FIND_BATCH];
+  uint64_t pagesCnt = 0;
+  for (uint64_t i = 0; i < hashesCnt && pagesCnt < MAPV_FIND_BATCH; i++)
+  {
+    const MapV_BktId_t bktId = _bkt_from_slot(
+                                 _slot_from_hash_hi(map, hashes[i].high64));
+    const uint64_t     page  = bktId / map->meta.pageBkts;
+
+    uint64_t j = 0;
+    while (j < pagesCnt && pages[j] != page) {
+      j++;
+    }
+    if (j == pagesCnt) {
+      pages[pagesCnt++] = page;
+      madvise((char*)map->tbl.bkt + page * map->meta.pageBytes,
+              map->meta.pageBytes, MADV_WILLNEED);
+    }
+  }
+}
+
+
+//==============================================================================
+//
+// _shm...() : shared memory maps (cfg.shmName, MapV_ShmAttach())
+//
+// @NOTE: the header object holds a seqlock, the gen of the current table,
+//        and copies of the writer's cfg and meta. every change the writer
+//        makes to a table or its meta is between _shm_write_begin() and
+//        _shm_write_end(), which leave seq odd while it's under way and
+//        copy meta out at the end. readers look up with _find_hash() on
+//        their own copy of meta (its seed included), and retry if seq moved
+//        while they did.
+//
+//        a grow fills "<name>.<gen + 1>" while readers carry on with the
+//        old table, then publishes it by bumping gen, and unlinks the old
+//        one. a reader's mapping of the old table stays valid until it
+//        sees the new gen and swaps its own mapping over (_shm_sync()).
+//
+//------------------------------------------------------------------------------
+// "<name>", or "<name>.<gen>" for a table
+static inline void
+_shm_obj_name(const MapV_st* map,
+              const uint64_t gen,
+                    char*    buf,
+              const size_t   bufLen)
+{
+  if (0 == gen) {
+    snprintf(buf, bufLen, "%s", map->shm.name);
+  } else {
+    snprintf(buf, bufLen, "%s.%"PRIu64, map->shm.name, gen);
+  }
+}
+
+//------------------------------------------------------------------------------
+// map gen's object (0: the header) shared. create: a new, zeroed one of
+// bytes, read/write; the name must not be taken. otherwise an existing one,
+// read only. NULL on failure, with errno from the call that failed.
+static inline void*
+_shm_map(const MapV_st* map,
+         const uint64_t gen,
+         const uint64_t bytes,
+         const bool     create)
+{
+  char name[NAME_MAX + 1];
+  _shm_obj_name(map, gen, name, sizeof(name));
+
+  const int fd = create ? shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)
+                        : shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    if (create) {
+      printf("can't create shared memory %s: %s\n", name, strerror(errno));
+    }
+    return NULL;
+  }
+
+  void* mem = MAP_FAILED;
+  if (!create || 0 == ftruncate(fd, bytes)) {
+    mem = mmap(NULL, bytes, create ? PROT_READ | PROT_WRITE : PROT_READ,
+               MAP_SHARED, fd, 0);
+  }
+  const int err = errno;
+  close(fd);
+  if (MAP_FAILED == mem) {
+    printf("can't map %"PRIu64" bytes of shared memory %s: %s\n",
+           bytes, name, strerror(err));
+    if (create) {
+      shm_unlink(name);
+    }
+    errno = err;
+    return NULL;
+  }
+  return mem;
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_shm_unlink(const MapV_st* map,
+            const uint64_t gen)
+{
+  char name[NAME_MAX + 1];
+  _shm_obj_name(map, gen, name, sizeof(name));
+  shm_unlink(name);
+}
+
+//------------------------------------------------------------------------------
+// writer: seq goes odd before anything in the table or meta changes
+static inline void
+_shm_write_begin(const MapV_st* map)
+{
+  if (NULL == map->shm.hdr) {
+    return;
+  }
+  MapV_ShmHdr_st* hdr = map->shm.hdr;
+  __atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+// writer: meta and gen out, then seq even again
+static inline void
+_shm_write_end(const MapV_st* map)
+{
+  if (NULL == map->shm.hdr) {
+    return;
+  }
+  MapV_ShmHdr_st* hdr = map->shm.hdr;
+  hdr->meta = map->meta;
+  hdr->gen  = map->shm.gen;
+  __atomic_store_n(&hdr->seq, hdr->seq + 1, __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+// reader: copy meta at an even seq, and map the table it describes if the
+// writer has grown since. false if the table can't be mapped.
+static inline bool
+_shm_sync(MapV_st* map)
+{
+  MapV_ShmHdr_st* hdr = map->shm.hdr;
+  for (;;)
+  {
+    const uint64_t seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
+      _mm_pause();
+      continue;
+    }
+    const MapV_Meta_st meta = hdr->meta;
+    const uint64_t     gen  = hdr->gen;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (seq != __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED)) {
+      continue;
+    }
+
+    if (gen != map->shm.gen) {
+      void* bkt = _shm_map(map, gen, meta.tblBytes, false);
+      if (NULL == bkt) {
+        if (ENOENT == errno) {
+          continue; // grown again, and that gen unlinked, since we read it
+        }
+        return false;
+      }
+      if (NULL != map->tbl.bktPtrReal) {
+        munmap(map->tbl.bktPtrReal, map->meta.tblBytesReal);
+      }
+      map->tbl.bktPtrReal = bkt;
+      map->tbl.bkt        = bkt;
+      map->shm.gen        = gen;
+    }
+    map->meta              = meta;
+    map->meta.tblBytesReal = meta.tblBytes;
+    map->shm.seq           = seq;
+    return true;
+  }
+}
+
+//------------------------------------------------------------------------------
+// reader: _find_hash() between two reads of the same even seq. the key is
+// hashed in here, with the synced meta's seed: a reseed changes it.
+static inline bool
+_shm_find_key(      MapV_st*     map,
+              const void*        key,
+              const size_t       keyLen,
+                    MapV_Val_ut* val)
+{
+  const MapV_ShmHdr_st* hdr = map->shm.hdr;
+  for (;;)
+  {
+    if (__atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE) != map->shm.seq
+        && !_shm_sync(map)) {
+      val->u64 = 0;
+      return false;
+    }
+    const bool found = _find_hash(map, _hash(map, key, keyLen), val);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) == map->shm.seq) {
+      return found;
+    }
+  }
+}
+
+
+
+//==============================================================================
+//
+// _snap...() : copy-on-write snapshots (MapV_Snapshot())
+//
+// @NOTE: the first snapshot of a map gives it a page table: a pointer to
+//        every MAPV_SNAP_PAGE_BKTS buckets of its table, which from then on
+//        is read through it (_tbl_bkt()). a snapshot is a copy of the map
+//        with its own copy of the page table, and a reference to each page.
+//        the table's own memory (base) is counted once per page table that
+//        has any of it; a copied page has its count in the cache line
+//        before it.
+//
+//        every write to a bucket goes through _tbl_bkt_for_write(): with a
+//        count over 1, the page is shared, so the writer copies it into a
+//        page of its own, points its page table there, and drops its
+//        reference to the old one. a snapshot's pages are never written,
+//        so it's read with no locking, on another thread, at full speed.
+//        a write stalls for one page copy at most, and only the first time
+//        it touches a page after a snapshot.
+//
+//        only the writer makes snapshots, so a count it sees can only go
+//        down under it: a snapshot let go of on another thread. counts are
+//        atomic, and whoever takes a count to 0 frees the page.
+//        a grow or a reseed leaves every old page to the snapshots, and
+//        starts over with a table in one piece and no page table.
+//
+//        once no snapshot is left, each insert or delete moves a little of
+//        the table back into base (_snap_fold()), until it's in one piece
+//        and the page table is dropped.
+//
+//------------------------------------------------------------------------------
+#define MAPV_SNAP_PAGE_HDR  64 // a copied page's count, in a line of its own
+#define MAPV_SNAP_FOLD_SCAN 64 // pages _snap_fold() looks at per write
+
+//------------------------------------------------------------------------------
+static inline bool
+_snap_frozen(const MapV_st* map)
+{
+  return NULL != map->snap && map->snap->frozen;
+}
+
+//------------------------------------------------------------------------------
+// give map a page table over its table, which stays where it is
+static bool
+_snap_pages(MapV_st* map)
+{
+  const uint64_t    pagesCnt = (map->meta.bktsCntReal + MAPV_SNAP_PAGE_BKTS - 1)
+                             / MAPV_SNAP_PAGE_BKTS;
+  MapV_Snap_st*     snap     = calloc(1, sizeof(*snap)
+                                         + pagesCnt * sizeof(*snap->page));
+  MapV_SnapBase_st* base     = malloc(sizeof(*base));
+  if (NULL == snap || NULL == base) {
+    printf("MapV_Snapshot(): out of memory for %"PRIu64" pages\n", pagesCnt);
+    free(snap);
+    free(base);
+    return false;
+  }
+  base->refs       = 1;
+  base->bktPtrReal = map->tbl.bktPtrReal;
+  base->bkt        = map->tbl.bkt;
+  snap->base       = base;
+  snap->pageBytes  = MAPV_SNAP_PAGE_BKTS * map->meta.bktBytes;
+  snap->pagesCnt   = pagesCnt;
+  for (uint64_t p = 0; p < pagesCnt; p++) {
+    snap->page[p] = (char*)base->bkt + p * snap->pageBytes;
+  }
+  map->snap = snap;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// the count of page tables holding pageId's page
+static inline uint64_t*
+_snap_refs(const MapV_Snap_st* snap,
+           const uint64_t      pageId)
+{
+  char* page = snap->page[pageId];
+  if (page == (char*)snap->base->bkt + pageId * snap->pageBytes) {
+    return &snap->base->refs;
+  }
+  return (uint64_t*)(page - MAPV_SNAP_PAGE_HDR);
+}
+
+//------------------------------------------------------------------------------
+// writer: bktId's page is about to change. if a snapshot holds it too, swap
+// in a copy of its own first.
+//
+// @NOTE: a write can't fail part way, so neither can this; as in
+//        MapV_Create(), memory is assumed not to run out.
+static inline void
+_snap_cow(const MapV_st*     map,
+          const MapV_BktId_t bktId)
+{
+  MapV_Snap_st*  snap   = map->snap;
+  const uint64_t pageId = bktId / MAPV_SNAP_PAGE_BKTS;
+  uint64_t*      refs   = _snap_refs(snap, pageId);
+  if (1 == __atomic_load_n(refs, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+
+  // the last page can be short
+  const uint64_t bkts = map->meta.bktsCntReal - pageId * MAPV_SNAP_PAGE_BKTS;
+  void*          mem  = NULL;
+  if (0 != posix_memalign(&mem, MAPV_SNAP_PAGE_HDR,
+                          MAPV_SNAP_PAGE_HDR + snap->pageBytes)) {
+    printf("_snap_cow(): out of memory for a page copy\n");
+    exit(1);
+  }
+  char* page = (char*)mem + MAPV_SNAP_PAGE_HDR;
+  *(uint64_t*)mem = 1;
+  memcpy(page, snap->page[pageId],
+         ((bkts < MAPV_SNAP_PAGE_BKTS) ? bkts : MAPV_SNAP_PAGE_BKTS)
+         * map->meta.bktBytes);
+  snap->page[pageId] = page;
+  snap->copies++;
+
+  // the base is let go of with the whole page table
+  if (refs != &snap->base->refs
+      && 1 == __atomic_fetch_sub(refs, 1, __ATOMIC_ACQ_REL)) {
+    free(refs);
+  }
+}
+
+//------------------------------------------------------------------------------
+// writer: about to insert or delete
+static inline void
+_snap_write_begin(MapV_st* map)
+{
+  if (   NULL != map->snap
+      && 1 == __atomic_load_n(&map->snap->base->refs, __ATOMIC_ACQUIRE)) {
+    _snap_fold(map);
+  }
+}
+
+//------------------------------------------------------------------------------
+// writer, with no snapshot holding any of its table: every snapshot holds
+// base, so its copied pages are its alone. move the next one found in
+// MAPV_SNAP_FOLD_SCAN pages back into base, so a write stalls for no more
+// than a page copy. with every page home, drop the page table.
+static void
+_snap_fold(MapV_st* map)
+{
+  MapV_Snap_st*  snap = map->snap;
+  const uint64_t end  = (snap->foldAt + MAPV_SNAP_FOLD_SCAN < snap->pagesCnt)
+                      ? snap->foldAt + MAPV_SNAP_FOLD_SCAN : snap->pagesCnt;
+  for (; snap->foldAt < end; snap->foldAt++)
+  {
+    const uint64_t p    = snap->foldAt;
+    char*          home = (char*)snap->base->bkt + p * snap->pageBytes;
+    if (snap->page[p] != home) {
+      const uint64_t bkts = map->meta.bktsCntReal - p * MAPV_SNAP_PAGE_BKTS;
+      memcpy(home, snap->page[p],
+             ((bkts < MAPV_SNAP_PAGE_BKTS) ? bkts : MAPV_SNAP_PAGE_BKTS)
+             * map->meta.bktBytes);
+      free(snap->page[p] - MAPV_SNAP_PAGE_HDR);
+      snap->page[p] = home;
+      snap->foldAt++;
+      break;
+    }
+  }
+  if (snap->foldAt == snap->pagesCnt) {
+    free(snap->base);
+    free(snap);
+    map->snap = NULL;
+  }
+}
+
+//------------------------------------------------------------------------------
+// let go of a page table's pages, and then of the table itself
+static void
+_snap_release(MapV_Snap_st* snap)
+{
+  for (uint64_t p = 0; p < snap->pagesCnt; p++) {
+    uint64_t* refs = _snap_refs(snap, p);
+    if (refs != &snap->base->refs
+        && 1 == __atomic_fetch_sub(refs, 1, __ATOMIC_ACQ_REL)) {
+      free(refs);
+    }
+  }
+  if (1 == __atomic_fetch_sub(&snap->base->refs, 1, __ATOMIC_ACQ_REL)) {
+    free(snap->base->bktPtrReal);
+    free(snap->base);
+  }
+  free(snap);
+}
+
+
+
+//==============================================================================
+//
+// _cache...() : cache mode (cfg.cacheBytes)
+//
+// @NOTE: reference bits are kept in their own bitmap rather than in the
+//        buckets, so buckets keep their layout and find() its loads. they
+//        move along with their entries whenever entries are shifted.
+//
+//------------------------------------------------------------------------------
+// memory for a table with slotsCap home slots, plus its reference bits
+static inline uint64_t
+_cache_bytes(const MapV_st* map,
+             const uint64_t slotsCap)
+{
+  const uint64_t bktsCntReal = slotsCap / MAPV_BKT_SLOTS
+                             + _tbl_bkts_extra(&map->cfg);
+  const uint64_t slotsReal   = bktsCntReal * MAPV_BKT_SLOTS;
+  return bktsCntReal * map->meta.bktBytes
+       + 2 * map->cfg.memAlign
+       + (slotsReal + 63) / 64 * sizeof(uint64_t);
+}
+
+//------------------------------------------------------------------------------
+// the biggest table that fits in cfg.cacheBytes. it's never resized.
+static inline bool
+_cache_alloc(MapV_st* map)
+{
+  uint64_t slotsCap = 0;
+  for (uint64_t cap = MAPV_BKT_SLOTS;
+       cap <= ((uint64_t)1 << 62) && _cache_bytes(map, cap) <= map->cfg.cacheBytes;
+       cap *= 2) {
+    slotsCap = cap;
+  }
+  if (0 == slotsCap) {
+    printf("cfg.cacheBytes of %"PRIu64" is too small for a table\n",
+           map->cfg.cacheBytes);
+    return false;
+  }
+
+  if (MAPV_ERR__OK != _tbl_realloc(map, slotsCap, map->meta.seed)) {
+    return false;
+  }
+  map->tbl.ref = calloc((map->meta.slotsCapReal + 63) / 64, sizeof(uint64_t));
+  if (NULL == map->tbl.ref) {
+    free(map->tbl.bktPtrReal);
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static inline bool
+_cache_ref_get(const MapV_st*      map,
+               const MapV_SlotId_t slotId)
+{
+  return (map->tbl.ref[slotId / 64] >> (slotId % 64)) & 1;
+}
+
+//------------------------------------------------------------------------------
+// no-op for maps that aren't caches
+static inline void
+_cache_ref_put(const MapV_st*      map,
+               const MapV_SlotId_t slotId,
+               const bool          on)
+{
+  if (NULL == map->tbl.ref) {
+    return;
+  }
+  const uint64_t bit = (uint64_t)1 << (slotId % 64);
+  if (on) {
+    map->tbl.ref[slotId / 64] |=  bit;
+  } else {
+    map->tbl.ref[slotId / 64] &= ~bit;
+  }
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_cache_ref_move(const MapV_st*      map,
+                const MapV_SlotId_t dstSlotId,
+                const MapV_SlotId_t srcSlotId)
+{
+  if (NULL == map->tbl.ref) {
+    return;
+  }
+  _cache_ref_put(map, dstSlotId, _cache_ref_get(map, srcSlotId));
+}
+
+//------------------------------------------------------------------------------
+// a lookup found slotId, or UINT64_MAX for a miss
+static inline void
+_cache_touch(      MapV_st*      map,
+             const MapV_SlotId_t slotId)
+{
+  if (NULL == map->tbl.ref) {
+    return;
+  }
+  if (UINT64_MAX == slotId) {
+    map->stats.cacheMisses++;
+    return;
+  }
+  map->stats.cacheHits++;
+  _cache_ref_put(map, slotId, true);
+}
+
+//------------------------------------------------------------------------------
+// evict one entry, CLOCK / second chance: entries with their reference bit
+// set have it cleared and are passed over; the first one without is evicted.
+// when the table is full, the hand sweeps the whole table and remembers
+// where it stopped. otherwise the insert of hashHi was out of probe distance,
+// and only its reach is swept: evicting anywhere else wouldn't help it.
+// false if there was nothing to evict.
+static inline bool
+_cache_evict(      MapV_st*      map,
+             const MapV_HashHi_t hashHi)
+{
+  const bool    full = (map->meta.slotsCapPct > map->cfg.capPctMax);
+  MapV_SlotId_t beg  = 0;
+  MapV_SlotId_t end  = map->meta.slotsCapReal;
+  MapV_SlotId_t hand = map->meta.cacheHand;
+  if (!full) {
+    beg  = _slot_from_hash_hi(map, hashHi);
+    end  = beg + map->cfg.distSlotMax;
+    const MapV_SlotId_t bktEnd = (_bkt_from_slot(beg) + map->cfg.distBktMax)
+                               * MAPV_BKT_SLOTS;
+    end  = (bktEnd < end) ? bktEnd : end;
+    end  = (map->meta.slotsCapReal < end) ? map->meta.slotsCapReal : end;
+    hand = beg;
+  }
+  if (hand < beg || hand >= end) {
+    hand = beg;
+  }
+
+  // the first sweep may only clear bits; the second is sure to find one
+  for (uint64_t i = 0; i < 2 * (end - beg); i++)
+  {
+    const MapV_SlotId_t slotId = hand;
+    hand = (hand + 1 < end) ? (hand + 1) : beg;
+
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, slotId, &hv);
+    if (_hv_is_empty(&hv)) {
+      continue;
+    }
+    if (_cache_ref_get(map, slotId)) {
+      _cache_ref_put(map, slotId, false);
+      continue;
+    }
+
+    _tbl_delete_slot(map, slotId);
+    map->stats.cacheEvictions++;
+    if (full) {
+      map->meta.cacheHand = slotId; // the next entry was shifted into it
+    }
+    if (NULL != map->hook.onDelete) {
+      map->hook.onDelete(map->hook.ctx, hv.hash);
+    }
+    return true;
+  }
+  return false;
+}
+
+
+//==============================================================================
+//
+// _hot...() : access counters (cfg.hotCounters), and MapV_Optimize()
+//
+// @NOTE: robin hood keeps entries in home slot order, but entries with the
+//        same home slot are in insert order, which is no order at all as far
+//        as lookups go. reordering them moves nothing across a home slot, so
+//        the table is as valid as before, with the same probe distances.
+//        the counters are per hash, not per slot, so inserts, deletes and
+//        grows never have to carry them along.
+//
+//------------------------------------------------------------------------------
+static inline bool
+_hot_alloc(MapV_st* map)
+{
+  const uint64_t cnt = _pow2_next_u64(map->cfg.hotCounters < 2
+                                      ? 2 : map->cfg.hotCounters);
+  map->hot.shift = 64 - __builtin_ctzll(cnt);
+  map->hot.cnt   = calloc(2 * cnt, sizeof(*map->hot.cnt));
+  if (NULL == map->hot.cnt) {
+    printf("cfg.hotCounters: couldn't allocate %"PRIu64" counters\n", 2 * cnt);
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// a row's counter for hashHi. the multiply spreads the low bits too, as
+// keys that collide in the table share their top bits.
+static inline uint16_t*
+_hot_cnt(const MapV_st*      map,
+         const MapV_HashHi_t hashHi,
+         const uint64_t      row)
+{
+  static const uint64_t mul[2] = { 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full };
+  return &map->hot.cnt[(row << (64 - map->hot.shift))
+                       + ((hashHi * mul[row]) >> map->hot.shift)];
+}
+
+//------------------------------------------------------------------------------
+// count-min: a hash's count is its smaller counter
+static inline uint64_t
+_hot_get(const MapV_st*      map,
+         const MapV_HashHi_t hashHi)
+{
+  const uint16_t c0 = *_hot_cnt(map, hashHi, 0);
+  const uint16_t c1 = *_hot_cnt(map, hashHi, 1);
+  return (c0 < c1) ? c0 : c1;
+}
+
+//------------------------------------------------------------------------------
+// a lookup found slotId, or UINT64_MAX for a miss. only the smaller counter
+// is counted up (conservative update); the other is already too high.
+static inline void
+_hot_touch(      MapV_st*      map,
+           const MapV_SlotId_t slotId)
+{
+  if (NULL == map->hot.cnt || UINT64_MAX == slotId
+      || 0 != (++map->hot.tick % MAPV_HOT_SAMPLE)) {
+    return;
+  }
+  const MapV_HashHi_t hashHi = _hashhi_from_slot(map, slotId);
+  uint16_t*           c0     = _hot_cnt(map, hashHi, 0);
+  uint16_t*           c1     = _hot_cnt(map, hashHi, 1);
+  const uint16_t      min    = (*c0 < *c1) ? *c0 : *c1;
+  if (UINT16_MAX == min) {
+    return;
+  }
+  *c0 += (*c0 == min);
+  *c1 += (*c1 == min);
+}
+
+//------------------------------------------------------------------------------
+static inline void
+_hot_swap(      MapV_st*      map,
+          const MapV_SlotId_t slotIdA,
+          const MapV_SlotId_t slotIdB)
+{
+  MapV_HV_st hvA;
+  MapV_HV_st hvB;
+  _tbl_get_hv_from_slot(map, slotIdA, &hvA);
+  _tbl_get_hv_from_slot(map, slotIdB, &hvB);
+  _shm_write_begin(map);
+  _tbl_set_hv_into_slot(map, slotIdA, &hvB);
+  _tbl_set_hv_into_slot(map, slotIdB, &hvA);
+  _shm_write_end(map);
+
+  if (NULL != map->tbl.ref) {
+    const bool refA = _cache_ref_get(map, slotIdA);
+    _cache_ref_move(map, slotIdA, slotIdB);
+    _cache_ref_put(map, slotIdB, refA);
+  }
+}
+
+//------------------------------------------------------------------------------
+// sort every run of entries with the same home slot, most counted first.
+// runs are a few entries long, so it's an insertion sort. returns the
+// number of swaps.
+static uint64_t
+_hot_optimize(MapV_st* map)
+{
+  uint64_t            moved = 0;
+  const MapV_SlotId_t end   = map->meta.slotsCapReal;
+
+  for (MapV_SlotId_t beg = 0; beg < end; )
+  {
+    const MapV_HashHi_t begHi = _hashhi_from_slot(map, beg);
+    if (0 == begHi) {
+      beg++;
+      continue;
+    }
+    const MapV_SlotId_t home   = _slot_from_hash_hi(map, begHi);
+          MapV_SlotId_t runEnd = beg + 1;
+    while (runEnd < end) {
+      const MapV_HashHi_t hashHi = _hashhi_from_slot(map, runEnd);
+      if (0 == hashHi || home != _slot_from_hash_hi(map, hashHi)) {
+        break;
+      }
+      runEnd++;
+    }
+
+    for (MapV_SlotId_t i = beg + 1; i < runEnd; i++) {
+      for (MapV_SlotId_t j = i;
+           j > beg && _hot_get(map, _hashhi_from_slot(map, j - 1))
+                    < _hot_get(map, _hashhi_from_slot(map, j));
+           j--) {
+        _hot_swap(map, j - 1, j);
+        moved++;
+      }
+    }
+    beg = runEnd;
+  }
+
+  // halve every count, so old lookups weigh less than new ones next time
+  const uint64_t cnt = (uint64_t)2 << (64 - map->hot.shift);
+  for (uint64_t i = 0; i < cnt; i++) {
+    map->hot.cnt[i] >>= 1;
+  }
+  return moved;
+}
+
+
+//==============================================================================
+//
+// _cuckoo...() : bucketized cuckoo engine (cfg.cuckoo)
+//
+// @NOTE: same table, same buckets, different placement. a hash has two
+//        candidate buckets: its robin hood home bucket (from the high half)
+//        and a second one from the low half. an entry is always in one of
+//        them, or in the stash: MAPV_CUCKOO_STASH_BKTS buckets after the
+//        table, which only take what the table can't, and are only looked at
+//        while they hold something. so a lookup reads two buckets, and both
+//        can be loaded at once.
+//        an insert with both buckets full searches breadth first for the
+//        shortest chain of entries that can each move to their other bucket,
+//        ending at a free slot, and moves them back to front. only if there
+//        is none within MAPV_CUCKOO_BFS_MAX buckets does it go to the stash,
+//        and only if that's full does the table grow.
+//
+//------------------------------------------------------------------------------
+// the second bucket. with 64-bit fingerprints the low half isn't stored, and
+// has to be available again when the entry is moved, so the high half is
+// used instead. it's multiplied either way, as 96-bit maps keep 32 bits of it.
+static inline MapV_BktId_t
+_cuckoo_bkt_alt(const MapV_st*     map,
+                const MapV_Hash_st hash)
+{
+  const uint64_t src = map->meta.hashLoMask ? hash.low64 : hash.high64;
+  return _bkt_from_slot(_slot_from_norm(map, src * 0x9e3779b97f4a7c15ull));
+}
+
+//------------------------------------------------------------------------------
+// _slot_from_hash() for a cuckoo table
+static inline MapV_SlotId_t
+_cuckoo_slot_from_hash(const MapV_st*     map,
+                       const MapV_Hash_st hash)
+{
+  const MapV_BktId_t bktId1 = _bkt_from_slot(
+                                _slot_from_hash_hi(map, hash.high64));
+  const MapV_BktId_t bktId2 = _cuckoo_bkt_alt(map, hash);
+
+  int found;
+  if (0 != (found = _bkt_match(map, _tbl_bkt(map, bktId1), hash))) {
+    return bktId1 * MAPV_BKT_SLOTS + __builtin_ctz(found);
+  }
+  if (0 != (found = _bkt_match(map, _tbl_bkt(map, bktId2), hash))) {
+    return bktId2 * MAPV_BKT_SLOTS + __builtin_ctz(found);
+  }
+  if (0 == map->meta.stashUsed) {
+    return UINT64_MAX;
+  }
+  for (MapV_BktId_t bktId = map->meta.bktsCnt;
+       bktId < map->meta.bktsCntReal;
+       bktId++) {
+    if (0 != (found = _bkt_match(map, _tbl_bkt(map, bktId), hash))) {
+      return bktId * MAPV_BKT_SLOTS + __builtin_ctz(found);
+    }
+  }
+  return UINT64_MAX;
+}
+
+//------------------------------------------------------------------------------
+// free a slot in one of hash's two buckets, moving entries along the
+// shortest path found. false if there's none; nothing is moved then.
+//
+// @NOTE: a bucket is queued at most once, so the buckets on a path are all
+//        different, and every move is into a slot that was just emptied.
+static inline bool
+_cuckoo_bfs(      MapV_st*       map,
+            const MapV_Hash_st   hash,
+                  MapV_SlotId_t* slotIdOut)
+{
+  MapV_BktId_t qBktId [MAPV_CUCKOO_BFS_MAX];
+  int32_t      qParent[MAPV_CUCKOO_BFS_MAX]; // -1 for hash's own buckets
+  int32_t      qSlot  [MAPV_CUCKOO_BFS_MAX]; // the parent's slot that moves
+  uint32_t     qCnt = 0;
+
+  const MapV_BktId_t bktId1 = _bkt_from_slot(
+                                _slot_from_hash_hi(map, hash.high64));
+  const MapV_BktId_t bktId2 = _cuckoo_bkt_alt(map, hash);
+  qBktId[qCnt] = bktId1; qParent[qCnt] = -1; qSlot[qCnt++] = -1;
+  if (bktId2 != bktId1) {
+    qBktId[qCnt] = bktId2; qParent[qCnt] = -1; qSlot[qCnt++] = -1;
+  }
+
+  for (uint32_t head = 0; head < qCnt; head++)
+  {
+    const MapV_Bkt_st* bkt   = _tbl_bkt(map, qBktId[head]);
+    const int          empty = _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+                                 _mm256_loadu_si256((const __m256i*)bkt->slotsHi),
+                                 _mm256_setzero_si256()));
+    if (0 != empty)
+    {
+      // move each entry on the path into the slot emptied ahead of it
+      MapV_SlotId_t freeSlotId = qBktId[head] * MAPV_BKT_SLOTS
+                               + __builtin_ctz(empty);
+      for (int32_t node = head; qParent[node] >= 0; node = qParent[node])
+      {
+        const MapV_SlotId_t srcSlotId = qBktId[qParent[node]] * MAPV_BKT_SLOTS
+                                      + qSlot[node];
+        MapV_HV_st hv;
+        _tbl_get_hv_from_slot(map, srcSlotId,  &hv);
+        _tbl_set_hv_into_slot(map, freeSlotId, &hv);
+        freeSlotId = srcSlotId;
+      }
+      *slotIdOut = freeSlotId;
+      return true;
+    }
+
+    // full: queue each entry's other bucket
+    for (int bktSlot = 0;
+         bktSlot < MAPV_BKT_SLOTS && qCnt < MAPV_CUCKOO_BFS_MAX;
+         bktSlot++)
+    {
+      MapV_HV_st hv;
+      _tbl_get_hv_from_slot(map, qBktId[head] * MAPV_BKT_SLOTS + bktSlot, &hv);
+      const MapV_BktId_t home = _bkt_from_slot(
+                                  _slot_from_hash_hi(map, hv.hash.high64));
+      const MapV_BktId_t alt  = (home == qBktId[head])
+                              ? _cuckoo_bkt_alt(map, hv.hash)
+                              : home;
+      bool queued = false;
+      for (uint32_t i = 0; i < qCnt && !queued; i++) {
+        queued = (qBktId[i] == alt);
+      }
+      if (!queued) {
+        qBktId[qCnt] = alt; qParent[qCnt] = head; qSlot[qCnt++] = bktSlot;
+      }
+    }
+  }
+  return false;
 }
 
+//------------------------------------------------------------------------------
+// _tbl_upsert_hv() for a cuckoo table. the hash is in range.
+static inline MapV_Err_et
+_cuckoo_upsert_hv(      MapV_st*       map,
+                  const MapV_HV_st     newHv,
+                        MapV_SlotId_t* slotIdOut,
+                        bool*          inserted)
+{
+  const MapV_SlotId_t foundSlotId = _cuckoo_slot_from_hash(map, newHv.hash);
+  if (UINT64_MAX != foundSlotId) {
+    *slotIdOut = foundSlotId;
+    *inserted  = false;
+    return MAPV_ERR__OK;
+  }
+  if (map->meta.slotsCapPct > map->cfg.capPctMax) {
+    return MAPV_ERR__TABLE_MUST_GROW;
+  }
+
+  // the search moves entries along the path it finds
+  _shm_write_begin(map);
+  MapV_SlotId_t slotId;
+  if (!_cuckoo_bfs(map, newHv.hash, &slotId))
+  {
+    for (slotId = map->meta.bktsCnt * MAPV_BKT_SLOTS;
+         slotId < map->meta.slotsCapReal && 0 != _hashhi_from_slot(map, slotId);
+         slotId++) {
+    }
+    if (slotId == map->meta.slotsCapReal) {
+      _shm_write_end(map);
+      return MAPV_ERR__TABLE_MUST_GROW;
+    }
+    map->meta.stashUsed++;
+  }
+
+  _tbl_set_hv_into_slot(map, slotId, &newHv);
+  map->meta.slotsUsed++;
+  _shm_write_end(map);
+
+  *slotIdOut = slotId;
+  *inserted  = true;
+  return MAPV_ERR__OK;
+}
 
 
 
 //==============================================================================
 //
-// MapV_Print*()
+// _stream...() / _setop() : sorted walks, for MapV_Merge() and friends
 //
-//==============================================================================
+//------------------------------------------------------------------------------
+struct _Stream_st {
+  const MapV_st* map;
+  MapV_SlotId_t  slotId;   // next slot to read
+  MapV_HV_st*    run;      // entries sharing one home slot, sorted
+  uint64_t       runCnt;
+  uint64_t       runPos;
+  uint64_t       runCap;
+  MapV_HV_st     next;     // read ahead: first entry of the next run
+  bool           nextOk;
+};
 
 //------------------------------------------------------------------------------
-void
-MapV_PrintTableCfg(const MapV_st* map)
+// walk from slotId on. a run is only complete if slotId is a home slot
+// (or 0); entries are never in front of their home slot.
+static void
+_stream_init(      _Stream_st*   st,
+             const MapV_st*      map,
+             const MapV_SlotId_t slotId)
 {
-  printf("\n\n");
-  printf("--------------------------------\n");
-  printf("\n");
-  printf("cfg.distSlotMax    : %"PRIu64"\n", map->cfg.distSlotMax);
-  printf("cfg.distBktMax     : %"PRIu64"\n", map->cfg.distSlotMax);
-  printf("cfg.capPctMax      : %f\n",        map->cfg.capPctMax);
-  printf("cfg.memAlign       : %d\n",        map->cfg.memAlign);
-  printf("\n");
-  printf("meta.tblBytes      : %"PRIu64"\n", map->meta.tblBytes);
-  printf("meta.tblBytesReal  : %"PRIu64"\n", map->meta.tblBytesReal);
-  printf("\n");
-  printf("meta.bktsCnt       : %"PRIu64"\n", map->meta.bktsCnt);
-  printf("meta.bktsCntReal   : %"PRIu64"\n", map->meta.bktsCntReal);
-  printf("\n");
-  printf("meta.slotHashShift : %"PRIu64"\n", map->meta.slotHashShift);
-  printf("meta.slotsCap      : %"PRIu64"\n", map->meta.slotsCap);
-  printf("meta.slotsCapReal  : %"PRIu64"\n", map->meta.slotsCapReal);
-  printf("meta.slotsUsed     : %"PRIu64"\n", map->meta.slotsUsed);
-  printf("meta.slotsAvail    : %"PRIu64"\n", map->meta.slotsAvail);
-  printf("meta.slotsCapPct   : %f\n",        map->meta.slotsCapPct);
-  printf("\n");
-  printf("meta.distSlotMax   : %"PRIu64"\n", map->meta.distSlotMax);
-  printf("meta.distSlotIter  : %"PRIu64"\n", map->meta.distSlotIter);
-  printf("meta.distBktMax    : %"PRIu64"\n", map->meta.distBktMax);
-  printf("meta.distBktIter   : %"PRIu64"\n", map->meta.distBktIter);
-  printf("\n");
-  printf("tbl.bktPtrReal     : %p\n", map->tbl.bktPtrReal);
-  printf("tbl.bkt            : %p\n", map->tbl.bkt);
-  printf("\n");
-  printf("stats.mm256Loads   : %"PRIu64"\n", map->stats.mm256Loads);
-  printf("\n\n");
-  printf("--------------------------------\n");
-  printf("\n\n");
-  fflush(stdout);
+  memset(st, 0, sizeof(*st));
+  st->map    = map;
+  st->slotId = slotId;
+  st->runCap = 16;
+  st->run    = malloc(st->runCap * sizeof(*st->run));
+  st->nextOk = MapV_Next(map, &st->slotId, &st->next.hash, &st->next.val);
 }
 
 //------------------------------------------------------------------------------
-void
-MapV_PrintTableData(const MapV_st* map)
+static bool
+_stream_next(_Stream_st* st,
+             MapV_HV_st* hv)
 {
-  printf("\n\n");
-
-  int distSlotMax = 0;
-  int numFound    = 0;
-  for (int slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  if (st->runPos == st->runCnt)
   {
-    MapV_HV_st hv;
-    _tbl_get_hv_from_slot(map, slotId, &hv);
-    if (_hv_is_empty(&hv)) {
-      continue;
+    if (!st->nextOk) {
+      return false;
     }
 
-    numFound++;
-    const int slotDist = _slot_hash_hi_dist(map, hv.hash.high64, slotId);
-    printf("\t[%d] %"PRIu64" %"PRIu64" : %"PRIu64" : %d\n",
-           slotId, hv.hash.high64, hv.hash.low64, hv.val.u64, slotDist);
-    fflush(stdout);
+    // collect the run: every entry with the read ahead's home slot
+    const MapV_SlotId_t home = _slot_from_hash_hi(st->map, st->next.hash.high64);
+    st->runCnt = 0;
+    st->runPos = 0;
+    while (   st->nextOk
+           && home == _slot_from_hash_hi(st->map, st->next.hash.high64)) {
+      if (st->runCnt == st->runCap) {
+        st->runCap *= 2;
+        st->run     = realloc(st->run, st->runCap * sizeof(*st->run));
+      }
 
-    if (slotDist > distSlotMax) {
-      distSlotMax = slotDist;
+      // insertion sort; runs are a few entries long
+      uint64_t i = st->runCnt++;
+      while (i > 0 && _hash_cmp(st->run[i - 1].hash, st->next.hash) > 0) {
+        st->run[i] = st->run[i - 1];
+        i--;
+      }
+      st->run[i] = st->next;
+
+      st->nextOk = MapV_Next(st->map, &st->slotId,
+                             &st->next.hash, &st->next.val);
     }
   }
 
-  printf("\n\n");
-  printf("distSlotMax: %d\n", distSlotMax);
-  printf("numFound: %d\n", numFound);
+  *hv = st->run[st->runPos++];
+  return true;
 }
 
 //------------------------------------------------------------------------------
-const char*
-MapV_PrintErr(MapV_Err_et err)
+static void
+_stream_free(_Stream_st* st)
 {
-	if (err > MAPV_ERR___LAST || err < MAPV_ERR___FIRST) {
-		return "INVALID MapV_Err_et VALUE";
-	}
-	static const char* strArr[] = {
-		[MAPV_ERR__OK] =
-		"MAPV_ERR__OK",
-		[MAPV_ERR__TABLE_MUST_GROW] =
-		"MAPV_ERR__TABLE_MUST_GROW",
-		[MAPV_ERR__TABLE_GROW_FAILED] =
-		"MAPV_ERR__TABLE_GROW_FAILED",
-		[MAPV_ERR__INSERT_KEY_EXISTS] =
-		"MAPV_ERR__INSERT_KEY_EXISTS",
-		[MAPV_ERR__DELETE_KEY_NOT_FOUND] =
-		"MAPV_ERR__DELETE_KEY_NOT_FOUND",
-		[MAPV_ERR__DESTROY_MAP_IS_NULL] =
-		"MAPV_ERR__DESTROY_MAP_IS_NULL",
-		[MAPV_ERR__DESTROY_MAP_BKTPTRREAL_IS_NULL] =
-		"MAPV_ERR__DESTROY_MAP_BKTPTRREAL_IS_NULL",
-	};
-	return strArr[err];
+  free(st->run);
 }
 
 //------------------------------------------------------------------------------
-// only used for debugging
-// static void
-// _print_hv(MapV_HV_st hv) {
-//   printf("\n\n---------------\n");
-//   printf("HV:\n");
-//   printf("\thi64 : %"PRIu64"\n", hv.hash.high64);
-//   printf("\tlo64 : %"PRIu64"\n", hv.hash.low64);
-//   printf("\tval  : %"PRIu64"\n", hv.val);
-//   printf("\n");
-//   fflush(stdout);
-// }
+static inline int
+_hash_cmp(const MapV_Hash_st hash1, const MapV_Hash_st hash2)
+{
+  if (hash1.high64 != hash2.high64) {
+    return (hash1.high64 < hash2.high64) ? -1 : 1;
+  }
+  return (hash1.low64 > hash2.low64) - (hash1.low64 < hash2.low64);
+}
+
+//------------------------------------------------------------------------------
+// an empty map configured like `like`, over [hashLo, hashHi], with room for
+// entsCnt entries before it needs to grow.
+static MapV_st*
+_map_create_like(const MapV_st* like,
+                 const uint64_t entsCnt,
+                 const uint64_t hashLo,
+                 const uint64_t hashHi)
+{
+  MapV_Cfg_st cfg      = like->cfg;
+  cfg.hashLo           = hashLo;
+  cfg.hashHi           = hashHi;
+  cfg.cacheBytes       = 0; // sized for entsCnt instead
+  cfg.shmName          = NULL; // a result is the caller's, not shared
+  cfg.seed             = like->meta.seed; // its hashes are like's
+  cfg.initialSlotCount = (cfg.capPctMax > 0)
+                       ? (uint64_t)(entsCnt * 100 / cfg.capPctMax) + 1
+                       : entsCnt;
+  if (0 == hashLo && 0 == hashHi) {
+    cfg.hashHi = 1; // a range of just 0, not "every hash"; 0 isn't a hash
+  }
+  return MapV_Create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+// _tbl_fill_hv(), growing the table if needed. the rebuilt table is still in
+// hash order, so filling carries on after its last entry.
+static inline bool
+_tbl_fill_grow(      MapV_st*       map,
+               const MapV_HV_st*    hv,
+                     MapV_SlotId_t* fillSlotId)
+{
+  MapV_Err_et err;
+  while (MAPV_ERR__TABLE_MUST_GROW == (err = _tbl_fill_hv(map, hv, fillSlotId)))
+  {
+    if (!_tbl_realloc_grow(map)) {
+      return false;
+    }
+    *fillSlotId = map->meta.slotsCapReal;
+    while (*fillSlotId > 0 && 0 == _hashhi_from_slot(map, *fillSlotId - 1)) {
+      (*fillSlotId)--;
+    }
+  }
+  return (MAPV_ERR__OK == err);
+}
 
+//------------------------------------------------------------------------------
+static MapV_st*
+_setop(const MapV_st*         a,
+       const MapV_st*         b,
+       const int              op,
+       const MapV_Conflict_ft onConflict,
+             void*            ctx)
+{
+  if (a->cfg.fpBits != b->cfg.fpBits) {
+    printf("maps with different fingerprint widths can't be combined\n");
+    return NULL;
+  }
+  if (a->meta.seed != b->meta.seed) {
+    printf("maps with different seeds can't be combined\n");
+    return NULL;
+  }
+  if (a->cfg.multi || b->cfg.multi) {
+    printf("multimaps can't be combined\n");
+    return NULL;
+  }
+  if (a->cfg.cuckoo || b->cfg.cuckoo) {
+    printf("cuckoo maps aren't in hash order, and can't be combined\n");
+    return NULL;
+  }
 
+  // sized for the largest possible result, so it never grows
+  const uint64_t entsMax = (MAPV_SETOP_MERGE     == op)
+                         ? a->meta.slotsUsed + b->meta.slotsUsed
+                         : (MAPV_SETOP_INTERSECT == op)
+                         ? ((a->meta.slotsUsed < b->meta.slotsUsed)
+                            ? a->meta.slotsUsed : b->meta.slotsUsed)
+                         : a->meta.slotsUsed;
+
+  // the result covers both ranges for a merge; it's a subset of a otherwise
+  uint64_t hashLo = a->cfg.hashLo;
+  uint64_t hashHi = a->cfg.hashHi;
+  if (MAPV_SETOP_MERGE == op) {
+    hashLo = (b->cfg.hashLo < hashLo) ? b->cfg.hashLo : hashLo;
+    hashHi = (b->cfg.hashHi > hashHi) ? b->cfg.hashHi : hashHi;
+  }
 
+  MapV_st* out;
+  if (NULL == (out = _map_create_like(a, entsMax, hashLo, hashHi))) {
+    return NULL;
+  }
 
-//==============================================================================
-//
-// Static Functions
-//
-//==============================================================================
+  _Stream_st stA;
+  _Stream_st stB;
+  _stream_init(&stA, a, 0);
+  _stream_init(&stB, b, 0);
 
+  MapV_HV_st hvA;
+  MapV_HV_st hvB;
+  bool       okA = _stream_next(&stA, &hvA);
+  bool       okB = _stream_next(&stB, &hvB);
+  bool       ok  = true;
 
+  MapV_SlotId_t fillSlotId = 0;
 
+  while (ok && (okA || okB))
+  {
+    const int cmp = !okA ?  1
+                  : !okB ? -1
+                  : _hash_cmp(hvA.hash, hvB.hash);
 
-//==============================================================================
-//
-// _pow2...()
-//
-//------------------------------------------------------------------------------
-static inline uint64_t
-_pow2_next_u64(uint64_t n) {
-  --n;
-  n |= n >> 1;
-  n |= n >> 2;
-  n |= n >> 4;
-  n |= n >> 8;
-  n |= n >> 16;
-  n |= n >> 32;
-  ++n;
-  return n;
-}
+    MapV_HV_st hv;
+    bool       emit;
+    if (cmp < 0) {        // only in a
+      hv   = hvA;
+      emit = (MAPV_SETOP_INTERSECT != op);
+      okA  = _stream_next(&stA, &hvA);
+    } else if (cmp > 0) { // only in b
+      hv   = hvB;
+      emit = (MAPV_SETOP_MERGE == op);
+      okB  = _stream_next(&stB, &hvB);
+    } else {              // in both
+      hv   = hvA;
+      emit = (MAPV_SETOP_DIFF != op);
+      if (emit && NULL != onConflict) {
+        hv.val = onConflict(ctx, hvA.hash, hvA.val, hvB.val);
+      }
+      okA  = _stream_next(&stA, &hvA);
+      okB  = _stream_next(&stB, &hvB);
+    }
 
+    if (emit) {
+      ok = _tbl_fill_grow(out, &hv, &fillSlotId);
+    }
+  }
+
+  _stream_free(&stA);
+  _stream_free(&stB);
+
+  if (!ok) {
+    printf("_setop(): building the result failed\n");
+    MapV_Destroy(out);
+    return NULL;
+  }
+  _tbl_cap_update(out);
+  return out;
+}
 
-//==============================================================================
-//
-// _hash...()
-//
 //------------------------------------------------------------------------------
-static inline MapV_Hash_st
-_hash(const void*  key,
-      const size_t keyLen)
+// _setop()'s merge over any number of maps. the smallest hash at the head of
+// any stream is taken each step; there are only ever a few dozen streams, so
+// they're scanned rather than kept in a heap.
+static MapV_st*
+_setop_many(const MapV_st* const*  maps,
+            const uint64_t         mapsCnt,
+            const MapV_Conflict_ft onConflict,
+                  void*            ctx)
 {
-  return XXH3_128bits(key, keyLen);
+  if (0 == mapsCnt) {
+    printf("MapV_MergeMany(): no maps\n");
+    return NULL;
+  }
+
+  uint64_t entsMax = 0;
+  uint64_t hashLo  = maps[0]->cfg.hashLo;
+  uint64_t hashHi  = maps[0]->cfg.hashHi;
+  for (uint64_t i = 0; i < mapsCnt; i++)
+  {
+    const MapV_st* m = maps[i];
+    if (m->cfg.fpBits != maps[0]->cfg.fpBits) {
+      printf("maps with different fingerprint widths can't be combined\n");
+      return NULL;
+    }
+    if (m->meta.seed != maps[0]->meta.seed) {
+      printf("maps with different seeds can't be combined\n");
+      return NULL;
+    }
+    if (m->cfg.multi) {
+      printf("multimaps can't be combined\n");
+      return NULL;
+    }
+    if (m->cfg.cuckoo) {
+      printf("cuckoo maps aren't in hash order, and can't be combined\n");
+      return NULL;
+    }
+    entsMax  = (m->meta.slotsUsed > entsMax) ? m->meta.slotsUsed : entsMax;
+    hashLo   = (m->cfg.hashLo < hashLo) ? m->cfg.hashLo : hashLo;
+    hashHi   = (m->cfg.hashHi > hashHi) ? m->cfg.hashHi : hashHi;
+  }
+
+  // sized for the biggest map. many maps are often mostly the same keys, and
+  // sized for all of them it could be several times too big. a sorted fill
+  // that grows carries on where it was (see _tbl_fill_grow()).
+  MapV_st* out;
+  if (NULL == (out = _map_create_like(maps[0], entsMax, hashLo, hashHi))) {
+    return NULL;
+  }
+
+  _Stream_st* st  = malloc(mapsCnt * sizeof(*st));
+  MapV_HV_st* hvs = malloc(mapsCnt * sizeof(*hvs));
+  bool*       oks = malloc(mapsCnt * sizeof(*oks));
+  for (uint64_t i = 0; i < mapsCnt; i++) {
+    _stream_init(&st[i], maps[i], 0);
+    oks[i] = _stream_next(&st[i], &hvs[i]);
+  }
+
+  MapV_SlotId_t fillSlotId = 0;
+  bool          ok         = true;
+
+  while (ok)
+  {
+    int64_t first = -1;
+    for (uint64_t i = 0; i < mapsCnt; i++) {
+      if (oks[i] && (first < 0 || _hash_cmp(hvs[i].hash, hvs[first].hash) < 0)) {
+        first = i;
+      }
+    }
+    if (first < 0) {
+      break;
+    }
+
+    MapV_HV_st hv = hvs[first];
+    oks[first] = _stream_next(&st[first], &hvs[first]);
+    for (uint64_t i = first + 1; i < mapsCnt; i++) {
+      if (oks[i] && 0 == _hash_cmp(hvs[i].hash, hv.hash)) {
+        if (NULL != onConflict) {
+          hv.val = onConflict(ctx, hv.hash, hv.val, hvs[i].val);
+        }
+        oks[i] = _stream_next(&st[i], &hvs[i]);
+      }
+    }
+
+    ok = _tbl_fill_grow(out, &hv, &fillSlotId);
+  }
+
+  for (uint64_t i = 0; i < mapsCnt; i++) {
+    _stream_free(&st[i]);
+  }
+  free(st);
+  free(hvs);
+  free(oks);
+
+  if (!ok) {
+    printf("MapV_MergeMany(): building the result failed\n");
+    MapV_Destroy(out);
+    return NULL;
+  }
+  _tbl_cap_update(out);
+  return out;
 }
 
 //------------------------------------------------------------------------------
-// @NOTE: no error checking.
-//        this must only be called when you know the slot is in range
-static inline MapV_HashHi_t
-_hashhi_from_slot(const MapV_st*      map,
-                  const MapV_SlotId_t slotId)
+static MapV_Err_et
+_split(const MapV_st*  map,
+       const uint32_t  bits,
+             MapV_st** out)
 {
-  const MapV_BktId_t  bktId     = slotId / MAPV_BKT_SLOTS;
-	const MapV_SlotId_t bktSlotId = slotId % MAPV_BKT_SLOTS;
-	return map->tbl.bkt[bktId].slotsHi[bktSlotId];
+  if (bits > MAPV_SPLIT_BITS_MAX || map->cfg.multi || map->cfg.cuckoo) {
+    return MAPV_ERR__SPLIT_TOO_MANY_PARTS;
+  }
+  const uint64_t partsCnt = (uint64_t)1 << bits;
+
+  // partition i: normalized hashes (as in _slot_from_hash_hi()) whose
+  // top bits are i. mapped back to the map's own range for each new map.
+  for (uint64_t i = 0; i < partsCnt; i++)
+  {
+    const uint64_t normLo = bits ? (i << (64 - bits))               : 0;
+    const uint64_t normHi = bits ? (normLo | (UINT64_MAX >> bits))  : UINT64_MAX;
+    const uint64_t hashLo = map->meta.hashLo + (normLo >> map->meta.hashSkip);
+          uint64_t hashHi = map->meta.hashLo + (normHi >> map->meta.hashSkip);
+    if (hashHi > map->cfg.hashHi || hashHi < hashLo) {
+      hashHi = map->cfg.hashHi;
+    }
+    if (NULL == (out[i] = _map_create_like(map, map->meta.slotsUsed >> bits,
+                                           hashLo, hashHi))) {
+      for (uint64_t j = 0; j < i; j++) {
+        MapV_Destroy(out[j]);
+      }
+      return MAPV_ERR__TABLE_GROW_FAILED;
+    }
+  }
+
+  MapV_SlotId_t* fillSlotIds = calloc(partsCnt, sizeof(*fillSlotIds));
+  bool           ok          = (NULL != fillSlotIds);
+
+  _Stream_st st;
+  _stream_init(&st, map, 0);
+  MapV_HV_st hv;
+  while (ok && _stream_next(&st, &hv))
+  {
+    const uint64_t norm = (hv.hash.high64 - map->meta.hashLo) << map->meta.hashSkip;
+    const uint64_t i    = bits ? (norm >> (64 - bits)) : 0;
+    ok = _tbl_fill_grow(out[i], &hv, &fillSlotIds[i]);
+  }
+  _stream_free(&st);
+  free(fillSlotIds);
+
+  for (uint64_t i = 0; i < partsCnt; i++) {
+    if (ok) {
+      _tbl_cap_update(out[i]);
+    } else {
+      MapV_Destroy(out[i]);
+      out[i] = NULL;
+    }
+  }
+  return ok ? MAPV_ERR__OK : MAPV_ERR__TABLE_GROW_FAILED;
 }
 
 //------------------------------------------------------------------------------
-// @NOTE: pass by value since the data is small enough
-static inline bool
-_hashes_are_equal(const MapV_Hash_st hash1, const MapV_Hash_st hash2)
+static MapV_st*
+_export_range(const MapV_st* map,
+              const uint64_t hashLo,
+              const uint64_t hashHi)
 {
-  return (0 == ((hash1.high64 ^ hash2.high64) | (hash1.low64 ^ hash2.low64)));
+  if (hashLo > hashHi || map->cfg.multi || map->cfg.cuckoo) {
+    printf("MapV_ExportRange(): bad range, or a multimap/cuckoo map\n");
+    return NULL;
+  }
+
+  // clamped to the map's own range, for the sizing estimate and start slot
+  const uint64_t lo = (hashLo > map->cfg.hashLo) ? hashLo : map->cfg.hashLo;
+  const uint64_t hi = (hashHi < map->cfg.hashHi) ? hashHi : map->cfg.hashHi;
+
+  const double   frac    = (lo > hi) ? 0.0
+                         : ((double)(hi - lo) + 1.0)
+                           / ((double)map->meta.hashSpan + 1.0);
+  const uint64_t entsEst = (uint64_t)(map->meta.slotsUsed * frac * 1.1) + 1;
+
+  MapV_st* out;
+  if (NULL == (out = _map_create_like(map, entsEst, hashLo, hashHi))) {
+    return NULL;
+  }
+  if (lo > hi) {
+    return out;
+  }
+
+  // nothing in range can sit before lo's home slot
+  _Stream_st st;
+  _stream_init(&st, map, _slot_from_hash_hi(map, lo));
+
+  MapV_SlotId_t fillSlotId = 0;
+  MapV_HV_st    hv;
+  bool          ok = true;
+  while (ok && _stream_next(&st, &hv))
+  {
+    if (hv.hash.high64 < lo) {
+      continue; // pushed past lo's home from further back
+    }
+    if (hv.hash.high64 > hi) {
+      break;
+    }
+    ok = _tbl_fill_grow(out, &hv, &fillSlotId);
+  }
+  _stream_free(&st);
+
+  if (!ok) {
+    MapV_Destroy(out);
+    return NULL;
+  }
+  _tbl_cap_update(out);
+  return out;
 }
 
 
+
 //==============================================================================
 //
-// _hv...()
+// _scan...() : MapV_ScanText()
+//
+// @NOTE: one pass over buf, 64 bytes at a time: a bitmask of which bytes are
+//        token bytes comes from two AVX2 compares, and token starts/ends are
+//        the bits where that mask flips, so the loop is per token, not per
+//        byte. tokens are hashed straight out of buf and their home buckets
+//        prefetched right away; they're probed MAPV_FIND_BATCH tokens later,
+//        by which time the buckets have usually arrived.
 //
 //------------------------------------------------------------------------------
-static inline bool
-_hv_is_empty(const MapV_HV_st* hv)
-{
-  return (0 == (hv->hash.high64 | hv->hash.low64 | hv->val.u64));
-}
+struct _Scan_st {
+  const MapV_st*  map;
+  MapV_ScanHit_ft onHit;
+  void*           ctx;
+  uint64_t        hits;
+  uint64_t        cnt;
+  MapV_Hash_st    hashes[MAPV_FIND_BATCH];
+  uint64_t        offs  [MAPV_FIND_BATCH];
+  uint64_t        lens  [MAPV_FIND_BATCH];
+};
 
-
-//==============================================================================
-//
-// _bkt...()
-//
 //------------------------------------------------------------------------------
-static inline MapV_BktId_t
-_bkt_from_slot(const MapV_SlotId_t slotId)
+// 0xff in each byte of c that's in [lo, hi]
+static inline __m256i
+_scan_in_range(const __m256i c,
+               const char    lo,
+               const char    hi)
 {
-  return slotId / MAPV_BKT_SLOTS;
+  const __m256i off = _mm256_sub_epi8(c, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(off, _mm256_set1_epi8(hi - lo)), off);
 }
 
 //------------------------------------------------------------------------------
-static inline MapV_BktId_t
-_bktslot_from_slot(const MapV_SlotId_t slotId)
+// bit i set if p[i] is a token byte: an ASCII letter or digit, or >= 0x80
+static inline uint64_t
+_scan_token_mask(const char* p)
 {
-  return slotId % MAPV_BKT_SLOTS;
+  uint64_t mask = 0;
+  for (int half = 0; half < 2; half++)
+  {
+    const __m256i c     = _mm256_loadu_si256((const __m256i*)(p + 32 * half));
+    const __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+    const __m256i tok   = _mm256_or_si256(_scan_in_range(lower, 'a', 'z'),
+                                          _scan_in_range(c,     '0', '9'));
+    // movemask of c itself is the high bit of each byte: >= 0x80
+    const uint32_t bits = (uint32_t)_mm256_movemask_epi8(tok)
+                        | (uint32_t)_mm256_movemask_epi8(c);
+    mask |= (uint64_t)bits << (32 * half);
+  }
+  return mask;
 }
 
-
-//==============================================================================
-//
-// _slot...()
-//
 //------------------------------------------------------------------------------
-static inline MapV_SlotId_t
-_slot_from_hash_hi(const MapV_st*      map,
-                   const MapV_HashHi_t hashHi)
+// probe every queued token, and report the hits in text order
+static inline void
+_scan_flush(_Scan_st* sc)
 {
-  return hashHi >> map->meta.slotHashShift;
+  for (uint64_t i = 0; i < sc->cnt; i++)
+  {
+    MapV_Val_ut val;
+    if (_find_hash(sc->map, sc->hashes[i], &val)) {
+      sc->hits++;
+      sc->onHit(sc->ctx, sc->offs[i], sc->lens[i], val);
+    }
+  }
+  sc->cnt = 0;
 }
 
 //------------------------------------------------------------------------------
-static inline MapV_Dist_t
-_slot_hash_hi_dist(const MapV_st*      map,
-                   const MapV_HashHi_t hashHi,
-                   const MapV_SlotId_t cmpSlotId)
+static inline void
+_scan_push(      _Scan_st* sc,
+           const char*     buf,
+           const uint64_t  off,
+           const uint64_t  len)
 {
-  const MapV_SlotId_t slotId = _slot_from_hash_hi(map, hashHi);
-  return cmpSlotId - slotId;
+  if (MAPV_FIND_BATCH == sc->cnt) {
+    _scan_flush(sc);
+  }
+  const MapV_Hash_st hash = _hash(sc->map, buf + off, len);
+  _bkt_prefetch(sc->map, hash);
+  sc->hashes[sc->cnt] = hash;
+  sc->offs  [sc->cnt] = off;
+  sc->lens  [sc->cnt] = len;
+  sc->cnt++;
 }
 
 //------------------------------------------------------------------------------
-// @IMPORTNT: changes must likely be made in _Find(), and vice versa
-//
-// @NOTE: this isn't used by find(). see notes on that function.
-//        this _is_ used by delete, and maybe others in the future.
-static inline MapV_SlotId_t
-_slot_from_key(const MapV_st* map,
-               const void*    key,
-               const size_t   keyLen)
+static uint64_t
+_scan_text(const MapV_st*        map,
+           const char*           buf,
+           const uint64_t        len,
+           const MapV_ScanHit_ft onHit,
+                 void*           ctx)
 {
-  const MapV_Hash_st  hash     = _hash(key, keyLen);
-        MapV_SlotId_t slotId   = _slot_from_hash_hi(map, hash.high64);
-
-// #ifdef __AVX2__ ... __AVX__
+  _Scan_st sc = { .map = map, .onHit = onHit, .ctx = ctx, };
+  char     tail[64];
+  uint64_t tokBeg = 0;
+  uint64_t inTok  = 0; // 1 if a token runs into the next block
 
-  const uint64_t*     pHashHi  = (uint64_t*)&hash.high64;
-  const __m256i       needleHi = _mm256_set_epi64x(*pHashHi, *pHashHi,
-                                                   *pHashHi, *pHashHi);
-  const uint64_t*     pHashLo  = (uint64_t*)&hash.low64;
-  const __m256i       needleLo = _mm256_set_epi64x(*pHashLo, *pHashLo,
-                                                   *pHashLo, *pHashLo);
-
-  __m256i found;
-  __m256i haystack;
-
-  const int maxIters = map->meta.distBktIter;
-  for (int iter = 0; iter < maxIters; iter++)
+  for (uint64_t blkOff = 0; blkOff < len; blkOff += 64)
   {
-    // @NOTE: `| 0x100` in _mm256_movemask_pd is to set a highest bit as
-    //        an indicator that nothing was found.
-    //        when no matches were found, idxHi/Lo will == 8.
-    //        could also set to 0x10 and check idx is 4.
-    //        but that's less clear, given we're working with 4 array indices.
-
-    const MapV_BktId_t bktId = slotId / MAPV_BKT_SLOTS;
-
-    haystack = _mm256_load_si256((__m256i*)map->tbl.bkt[bktId].slotsHi);
-    found    = _mm256_cmpeq_epi64(haystack, needleHi);
-    const int idxHi = __builtin_ctz(_mm256_movemask_pd((__m256d)found) | 0x100);
-    if (idxHi == 8) { // not found
-      slotId += MAPV_BKT_SLOTS;
-      continue;
+    // the last partial block is copied out and padded with separators
+    uint64_t mask;
+    if (len - blkOff >= 64) {
+      mask = _scan_token_mask(buf + blkOff);
+    } else {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, buf + blkOff, len - blkOff);
+      mask = _scan_token_mask(tail);
     }
 
-    haystack = _mm256_load_si256((__m256i*)map->tbl.bkt[bktId].slotsLo);
-    found    = _mm256_cmpeq_epi64(haystack, needleLo);
-    const int idxLo = __builtin_ctz(_mm256_movemask_pd((__m256d)found) | 0x100);
-    if (idxHi == idxLo) { // found
-      // *val = map->tbl.bkt[bktId].vals[idxLo];
-      // return true;
-      return slotId;
+    // a set bit: a token starts here, or the one before ended here
+    uint64_t edges = mask ^ ((mask << 1) | inTok);
+    while (0 != edges)
+    {
+      const int i = __builtin_ctzll(edges);
+      edges &= edges - 1;
+      if ((mask >> i) & 1) {
+        tokBeg = blkOff + i;
+      } else {
+        _scan_push(&sc, buf, tokBeg, blkOff + i - tokBeg);
+      }
     }
-
-    // not found
-    slotId += MAPV_BKT_SLOTS;
+    inTok = mask >> 63;
   }
+  if (inTok) {
+    _scan_push(&sc, buf, tokBeg, len - tokBeg);
+  }
+  _scan_flush(&sc);
 
-  // ie: not found
-  return UINT64_MAX;
+  return sc.hits;
 }
 
 
 
 //==============================================================================
 //
-// _tbl...()
+// _ser...() : MapV_Serialize() / MapV_Deserialize()
 //
+// @NOTE: bits are packed into 64-bit words, low bits first; a payload is
+//        read 8 bytes at a time, so its buffer has MAPV_SER_PAD spare
+//        zeroed bytes at the end. a rice code is q one bits, a zero, then
+//        the low riceBits bits; q can't reach MAPV_SER_RICE_ESC, where the
+//        difference is written whole instead.
+//
+//------------------------------------------------------------------------------
+#define MAPV_SER_PAD      16
+#define MAPV_SER_RICE_ESC 32
+// bytes for a block's payload at most: an escaped difference and 64-bit
+// low64s and values, for every entry
+#define MAPV_SER_BLK_BYTES_MAX \
+  (MAPV_SER_BLOCK_ENTS * (MAPV_SER_RICE_ESC + 64 + 64 + 64) / 8 + MAPV_SER_PAD)
+
+typedef struct _SerBits_st {
+  uint8_t* buf;
+  uint64_t off;     // write: bytes stored. read: bits read
+  uint64_t acc;     // write: bits not stored yet
+  uint32_t accBits;
+} _SerBits_st;
+
 //------------------------------------------------------------------------------
 static inline void
-_tbl_cap_update(MapV_st* map)
+_ser_put(      _SerBits_st* b,
+               uint64_t     v,
+         const uint32_t     n)
 {
-  map->meta.slotsAvail  = map->meta.slotsCapReal - map->meta.slotsUsed;
-  map->meta.slotsCapPct = (double)map->meta.slotsUsed
-                        / (double)map->meta.slotsCapReal
-                        * 100;
+  if (0 == n) {
+    return;
+  }
+  if (n < 64) {
+    v &= ((uint64_t)1 << n) - 1;
+  }
+  b->acc |= v << b->accBits;
+  const uint32_t bits = b->accBits + n;
+  if (bits < 64) {
+    b->accBits = bits;
+    return;
+  }
+  memcpy(b->buf + b->off, &b->acc, sizeof(b->acc));
+  b->off    += sizeof(b->acc);
+  b->acc     = b->accBits ? (v >> (64 - b->accBits)) : 0;
+  b->accBits = bits - 64;
 }
 
 //------------------------------------------------------------------------------
-static inline void
-_tbl_clear_slot(const MapV_st*      map,
-                const MapV_SlotId_t slotId)
+// store what's left; returns the payload's bytes
+static inline uint64_t
+_ser_put_end(_SerBits_st* b)
 {
-  const MapV_BktId_t bktId     = _bkt_from_slot(slotId);
-  const MapV_BktId_t bktSlotId = _bktslot_from_slot(slotId);
-  map->tbl.bkt[bktId].slotsHi[bktSlotId]     = 0;
-  map->tbl.bkt[bktId].slotsLo[bktSlotId]     = 0;
-  map->tbl.bkt[bktId].vals   [bktSlotId].u64 = 0;
+  const uint32_t bytes = (b->accBits + 7) / 8;
+  memcpy(b->buf + b->off, &b->acc, bytes);
+  b->off    += bytes;
+  b->acc     = 0;
+  b->accBits = 0;
+  return b->off;
 }
 
 //------------------------------------------------------------------------------
-static inline void
-_tbl_get_hv_from_slot(const MapV_st*      map,
-                      const MapV_SlotId_t slotId,
-                            MapV_HV_st*   hv)
+// the next 64 bits, without reading past them
+static inline uint64_t
+_ser_peek(const _SerBits_st* b)
 {
-  const MapV_BktId_t bktId     = _bkt_from_slot(slotId);
-  const MapV_BktId_t bktSlotId = _bktslot_from_slot(slotId);
-  hv->hash.high64 = map->tbl.bkt[bktId].slotsHi[bktSlotId];
-  hv->hash.low64  = map->tbl.bkt[bktId].slotsLo[bktSlotId];
-  hv->val         = map->tbl.bkt[bktId].vals   [bktSlotId];
+  const uint64_t byte  = b->off / 8;
+  const uint32_t shift = b->off % 8;
+  uint64_t v;
+  memcpy(&v, b->buf + byte, sizeof(v));
+  v >>= shift;
+  if (shift) {
+    v |= (uint64_t)b->buf[byte + 8] << (64 - shift);
+  }
+  return v;
 }
 
 //------------------------------------------------------------------------------
-static inline void
-_tbl_set_hv_into_slot(const MapV_st*      map,
-                      const MapV_SlotId_t slotId,
-                      const MapV_HV_st*   hv)
+static inline uint64_t
+_ser_get(      _SerBits_st* b,
+         const uint32_t     n)
 {
-  const MapV_BktId_t bktId     = _bkt_from_slot(slotId);
-  const MapV_BktId_t bktSlotId = _bktslot_from_slot(slotId);
-  map->tbl.bkt[bktId].slotsHi[bktSlotId] = hv->hash.high64;
-  map->tbl.bkt[bktId].slotsLo[bktSlotId] = hv->hash.low64;
-  map->tbl.bkt[bktId].vals   [bktSlotId] = hv->val;
+  if (0 == n) {
+    return 0;
+  }
+  const uint64_t v = _ser_peek(b);
+  b->off += n;
+  return (n < 64) ? (v & (((uint64_t)1 << n) - 1)) : v;
 }
 
 //------------------------------------------------------------------------------
 static inline void
-_tbl_dist_update(MapV_st*      map,
-                 MapV_HashHi_t hashHi,
-                 MapV_SlotId_t slotId)
+_ser_put_rice(      _SerBits_st* b,
+              const uint64_t     d,
+              const uint32_t     riceBits)
 {
-  const MapV_Dist_t slotDist = _slot_hash_hi_dist(map, hashHi, slotId);
-
-  if (slotDist > map->meta.distSlotMax) {
-    map->meta.distSlotMax  = slotDist;
-    map->meta.distSlotIter = slotDist + 1;
+  const uint64_t q = d >> riceBits;
+  if (q >= MAPV_SER_RICE_ESC) {
+    _ser_put(b, UINT64_MAX, MAPV_SER_RICE_ESC);
+    _ser_put(b, d, 64);
+    return;
   }
+  _ser_put(b, ((uint64_t)1 << q) - 1, q + 1);
+  _ser_put(b, d, riceBits);
+}
 
-  const MapV_SlotId_t targetSlot = _slot_from_hash_hi(map, hashHi);
-  const MapV_BktId_t  targetBkt  = _bkt_from_slot(targetSlot);
-  const MapV_BktId_t  actualBkt  = _bkt_from_slot(slotId);
-  const MapV_Dist_t   bktDist    = (actualBkt > targetBkt)
-                                 ? (actualBkt - targetBkt)
-                                 : (targetBkt - actualBkt);
-  if (bktDist > map->meta.distBktMax) {
-    map->meta.distBktMax  = bktDist;
-    map->meta.distBktIter = bktDist + 1;
+//------------------------------------------------------------------------------
+static inline uint64_t
+_ser_get_rice(      _SerBits_st* b,
+              const uint32_t     riceBits)
+{
+  const uint64_t ones = ~_ser_peek(b);
+  const uint32_t q    = ones ? __builtin_ctzll(ones) : 64;
+  if (q >= MAPV_SER_RICE_ESC) {
+    b->off += MAPV_SER_RICE_ESC;
+    return _ser_get(b, 64);
   }
+  b->off += q + 1;
+  return ((uint64_t)q << riceBits) | _ser_get(b, riceBits);
 }
 
 //------------------------------------------------------------------------------
-static inline bool
-_tbl_should_realloc(MapV_st* map)
+// covers the block's header too, so a damaged hiFirst is caught
+static inline uint32_t
+_ser_blk_check(const MapV_SerBlk_st* blk,
+               const uint8_t*        payload)
 {
-  if (   map->meta.distSlotIter > map->cfg.distSlotMax
-      || map->meta.distBktIter  > map->cfg.distBktMax
-      || map->meta.slotsCapPct  > map->cfg.capPctMax) {
-    return true;
-  }
-  return false;
+  MapV_SerBlk_st h = *blk;
+  h.check = 0;
+  return XXH32(payload, blk->bytes, XXH32(&h, sizeof(h), 0));
 }
 
 //------------------------------------------------------------------------------
-static inline MapV_Err_et
-_tbl_insert_hv(      MapV_st*   map,
-                     MapV_HV_st newHv,
-               const bool       overwriteIfExists)
+// one block's payload from hvs[0, cnt) into b->buf
+static void
+_ser_blk_encode(const MapV_st*        map,
+                const MapV_HV_st*     hvs,
+                const uint64_t        cnt,
+                      MapV_SerBlk_st* blk,
+                      _SerBits_st*    b)
 {
-  if (_tbl_should_realloc(map)) {
-    return MAPV_ERR__TABLE_MUST_GROW;
+  // the mean difference's bits
+  const uint64_t mean = (cnt > 1)
+                      ? (hvs[cnt - 1].hash.high64 - hvs[0].hash.high64) / (cnt - 1)
+                      : 0;
+  uint64_t valMax = 0;
+  for (uint64_t i = 0; !map->cfg.set && i < cnt; i++) {
+    valMax |= hvs[i].val.u64;
   }
+  *blk = (MapV_SerBlk_st){
+    .hiFirst  = hvs[0].hash.high64,
+    .entsCnt  = cnt,
+    .riceBits = mean   ? 63 - __builtin_clzll(mean)   : 0,
+    .valBits  = valMax ? 64 - __builtin_clzll(valMax) : 0,
+  };
+
+  const uint32_t loBits = map->cfg.fpBits - 64;
+  for (uint64_t i = 1; i < cnt; i++) {
+    _ser_put_rice(b, hvs[i].hash.high64 - hvs[i - 1].hash.high64, blk->riceBits);
+  }
+  for (uint64_t i = 0; i < cnt; i++) {
+    _ser_put(b, hvs[i].hash.low64, loBits);
+  }
+  for (uint64_t i = 0; i < cnt; i++) {
+    _ser_put(b, hvs[i].val.u64, blk->valBits);
+  }
+  blk->bytes = _ser_put_end(b);
+  blk->check = _ser_blk_check(blk, b->buf);
+}
 
-  uint64_t slotId = _slot_from_hash_hi(map, newHv.hash.high64);
-
-  do {
-    const int newSlotDist = _slot_hash_hi_dist(map, newHv.hash.high64, slotId);
-
-    MapV_HV_st curHv;
-    _tbl_get_hv_from_slot(map, slotId, &curHv);
-    if (_hv_is_empty(&curHv)) {
-      _tbl_set_hv_into_slot(map, slotId, &newHv);
-      _tbl_dist_update(map, newHv.hash.high64, slotId);
-      return MAPV_ERR__OK;
-    }
-
-    if (_hashes_are_equal(curHv.hash, newHv.hash)) {
-    	if (overwriteIfExists) {
-	      _tbl_set_hv_into_slot(map, slotId, &newHv);
-	      // no need to call _tbl_dist_update()
-	      return MAPV_ERR__OK;
-    	} else {
-	    	return MAPV_ERR__INSERT_KEY_EXISTS;
-    	}
-    }
+//------------------------------------------------------------------------------
+static uint64_t
+_ser_write(const MapV_st* map,
+                 FILE*    out)
+{
+  if (map->cfg.multi || map->cfg.cuckoo) {
+    printf("MapV_Serialize(): multimaps and cuckoo maps can't be serialized\n");
+    return 0;
+  }
 
-    const int curSlotDist = _slot_hash_hi_dist(map, curHv.hash.high64, slotId);
-    if (newSlotDist > curSlotDist) {
-      _tbl_set_hv_into_slot(map, slotId, &newHv);
-      _tbl_dist_update(map, newHv.hash.high64, slotId);
-      newHv = curHv;
+  const MapV_SerHdr_st hdr = {
+    .magic   = MAPV_SER_MAGIC,
+    .version = MAPV_SER_VERSION,
+    .fpBits  = map->cfg.fpBits,
+    .set     = map->cfg.set,
+    .hashLo  = map->cfg.hashLo,
+    .hashHi  = map->cfg.hashHi,
+    .seed    = map->meta.seed,
+    .entsCnt = map->meta.slotsUsed,
+    .blksCnt = (map->meta.slotsUsed + MAPV_SER_BLOCK_ENTS - 1) / MAPV_SER_BLOCK_ENTS,
+  };
+  MapV_HV_st* hvs   = malloc(MAPV_SER_BLOCK_ENTS * sizeof(*hvs));
+  uint8_t*    buf   = malloc(MAPV_SER_BLK_BYTES_MAX);
+  bool        ok    = (NULL != hvs && NULL != buf)
+                   && (1 == fwrite(&hdr, sizeof(hdr), 1, out));
+  uint64_t    bytes = sizeof(hdr);
+
+  _Stream_st st;
+  _stream_init(&st, map, 0);
+  while (ok)
+  {
+    uint64_t cnt = 0;
+    while (cnt < MAPV_SER_BLOCK_ENTS && _stream_next(&st, &hvs[cnt])) {
+      cnt++;
     }
-
-    if (curSlotDist >= map->cfg.distSlotMax) {
-      return MAPV_ERR__TABLE_MUST_GROW;
+    if (0 == cnt) {
+      break;
     }
 
-    slotId++;
+    MapV_SerBlk_st blk;
+    _SerBits_st    b = { .buf = buf, };
+    _ser_blk_encode(map, hvs, cnt, &blk, &b);
+    ok = (1 == fwrite(&blk, sizeof(blk), 1, out))
+      && (1 == fwrite(buf, blk.bytes, 1, out));
+    bytes += sizeof(blk) + blk.bytes;
+  }
+  _stream_free(&st);
+  free(hvs);
+  free(buf);
 
-  } while (1);
+  if (!ok) {
+    printf("MapV_Serialize(): write failed\n");
+    return 0;
+  }
+  return bytes;
 }
 
 //------------------------------------------------------------------------------
-static inline bool
-_tbl_redistribute_hashes(MapV_st* map,
-                         MapV_st* oldMap)
+// decode a block, and append its entries to the table. *prevHi is the last
+// high64 so far; nothing may sort before it.
+static bool
+_ser_blk_fill(      MapV_st*        map,
+              const MapV_SerBlk_st* blk,
+                    _SerBits_st*    b,
+                    MapV_HV_st*     hvs,
+                    MapV_SlotId_t*  fillSlotId,
+                    uint64_t*       prevHi)
 {
-  map->meta.distSlotMax  = 0;
-  map->meta.distSlotIter = 0;
-  map->meta.distBktMax   = 0;
-  map->meta.distBktIter  = 0;
-
-  const uint64_t slotCnt = oldMap->meta.slotsCapReal;
-  for (MapV_SlotId_t oldSlot = 0; oldSlot < slotCnt; oldSlot++)
+  const uint32_t loBits  = map->cfg.fpBits - 64;
+  const uint64_t cnt     = blk->entsCnt;
+  const uint64_t bitsMax = (uint64_t)blk->bytes * 8;
+  // the low64s and values start where the differences end, so each part
+  // is decoded in turn. a damaged stream can point reads past the payload;
+  // stopping before each read that starts past it keeps them in the padding
+
+  uint64_t hi = blk->hiFirst;
+  for (uint64_t i = 0; i < cnt; i++)
   {
-    MapV_HV_st newHv;
-    _tbl_get_hv_from_slot(oldMap, oldSlot, &newHv);
-    if (_hv_is_empty(&newHv)) {
-      continue;
+    if (i > 0) {
+      if (b->off > bitsMax) {
+        return false;
+      }
+      const uint64_t d = _ser_get_rice(b, blk->riceBits);
+      if (hi + d < hi) {
+        return false;
+      }
+      hi += d;
     }
-
-    // should always return true after realloc...?
-    // @TODO: vertify
-    // @NOTE: we're setting overwriteIfExists to true.
-    //        technically, this shold be false...?
-	  MapV_Err_et err;
-	  if (MAPV_ERR__OK == (err = _tbl_insert_hv(map, newHv, true))) {
-      _tbl_clear_slot(oldMap, oldSlot);
-      continue;
-    } else {
-      MapV_PrintTableCfg(map);
-      MapV_PrintTableCfg(oldMap);
-      printf("could not re-insert on redistribute\n");
-      exit(1);
+    hvs[i].hash.high64 = hi;
+  }
+  for (uint64_t i = 0; i < cnt; i++) {
+    if (b->off > bitsMax) {
+      return false;
+    }
+    hvs[i].hash.low64 = _ser_get(b, loBits);
+  }
+  for (uint64_t i = 0; i < cnt; i++) {
+    if (b->off > bitsMax) {
+      return false;
     }
+    hvs[i].val.u64 = map->cfg.set ? 0 : _ser_get(b, blk->valBits);
+  }
+  if (b->off > bitsMax) {
+    return false;
   }
 
+  for (uint64_t i = 0; i < cnt; i++)
+  {
+    if (hvs[i].hash.high64 < *prevHi || 0 == hvs[i].hash.high64) {
+      return false;
+    }
+    *prevHi = hvs[i].hash.high64;
+    if (!_tbl_fill_grow(map, &hvs[i], fillSlotId)) {
+      return false;
+    }
+  }
   return true;
 }
 
 //------------------------------------------------------------------------------
-static inline bool
-_tbl_realloc_grow(MapV_st* cur)
+static MapV_st*
+_ser_read(      FILE*        in,
+          const MapV_Cfg_st* cfg)
 {
-  MapV_st new = *cur; // copy our current table config for modifications
-                      // until we're certain memory has allocated, etc.
-
-  new.meta.slotsCap = _pow2_next_u64(++new.meta.slotsCap);
-
-  // pre-compute this so we're not calculating it on every lookup
-  new.meta.slotHashShift = 64 - log2(new.meta.slotsCap);
-
-  new.meta.bktsCnt = new.meta.slotsCap / MAPV_BKT_SLOTS;
-
-  // add extra buckets for the last bucket's overflow
-  // but do not increase .meta.slotsCap
-  // when inserting, we'll only check against .cfg.distSlotMax
-  if (new.cfg.distSlotMax > (new.cfg.distBktMax * MAPV_BKT_SLOTS)) {
-    new.meta.bktsCntReal = new.meta.bktsCnt
-                         + (new.cfg.distSlotMax / MAPV_BKT_SLOTS)
-                         - 1; // -1 because we already have an initial bucket
-  } else {
-    new.meta.bktsCntReal = new.meta.bktsCnt
-                         + new.cfg.distBktMax
-                         - 1; // -1 because we already have an initial bucket
+  MapV_SerHdr_st hdr;
+  if (   1 != fread(&hdr, sizeof(hdr), 1, in)
+      || MAPV_SER_MAGIC   != hdr.magic
+      || MAPV_SER_VERSION != hdr.version) {
+    printf("MapV_Deserialize(): not a MapV_Serialize() stream\n");
+    return NULL;
+  }
+  if (cfg->multi || cfg->cuckoo) {
+    printf("MapV_Deserialize(): can't load into a multimap or cuckoo map\n");
+    return NULL;
   }
 
-  new.meta.slotsCapReal = new.meta.bktsCntReal * MAPV_BKT_SLOTS;
-
-  new.meta.tblBytes = new.meta.slotsCapReal
-                    / MAPV_BKT_SLOTS
-                    * sizeof(*new.tbl.bkt);
-
-  // allocate extra, then trim for alignment
-  new.meta.tblBytesReal = new.meta.tblBytes + (2 * new.cfg.memAlign);
+  MapV_Cfg_st c = *cfg;
+  c.fpBits     = hdr.fpBits;
+  c.set        = hdr.set;
+  c.hashLo     = hdr.hashLo;
+  c.hashHi     = hdr.hashHi;
+  c.seed       = hdr.seed;
+  c.cacheBytes = 0;
+  if (c.capPctMax > 0) {
+    c.initialSlotCount = (uint64_t)(hdr.entsCnt * 100 / c.capPctMax) + 1;
+  }
 
-  //--------------------------------------------------------------------
-  // setup is done. now alloc and align.
+  MapV_st* map;
+  if (NULL == (map = MapV_Create(&c))) {
+    return NULL;
+  }
+  uint8_t*      buf        = calloc(1, MAPV_SER_BLK_BYTES_MAX);
+  MapV_HV_st*   hvs        = malloc(MAPV_SER_BLOCK_ENTS * sizeof(*hvs));
+  bool          ok         = (NULL != buf && NULL != hvs);
+  uint64_t      entsCnt    = 0;
+  uint64_t      prevHi     = 0;
+  MapV_SlotId_t fillSlotId = 0;
+
+  for (uint64_t i = 0; ok && i < hdr.blksCnt; i++)
+  {
+    MapV_SerBlk_st blk;
+    ok = (1 == fread(&blk, sizeof(blk), 1, in))
+      && blk.entsCnt > 0 && blk.entsCnt <= MAPV_SER_BLOCK_ENTS
+      && blk.bytes <= MAPV_SER_BLK_BYTES_MAX - MAPV_SER_PAD
+      && blk.riceBits < 64 && blk.valBits <= 64
+      && (0 == blk.bytes || 1 == fread(buf, blk.bytes, 1, in))
+      && blk.check == _ser_blk_check(&blk, buf);
+    if (ok) {
+      memset(buf + blk.bytes, 0, MAPV_SER_PAD);
+      _SerBits_st b = { .buf = buf, };
+      ok       = _ser_blk_fill(map, &blk, &b, hvs, &fillSlotId, &prevHi);
+      entsCnt += blk.entsCnt;
+    }
+  }
+  free(buf);
+  free(hvs);
 
-  new.tbl.bktPtrReal = calloc(1, new.meta.tblBytesReal);
-  if (NULL == new.tbl.bktPtrReal) {
-    // @TODO: get error
-    return false;
+  if (!ok || entsCnt != hdr.entsCnt) {
+    printf("MapV_Deserialize(): stream is short or damaged\n");
+    MapV_Destroy(map);
+    return NULL;
   }
+  _tbl_cap_update(map);
+  return map;
+}
 
-  _tbl_cap_update(&new);
 
-  // set our bucket to an aligned address
-  new.tbl.bkt = (void*)(((uint64_t)new.tbl.bktPtrReal / new.cfg.memAlign)
-                         * new.cfg.memAlign
-                         + new.cfg.memAlign);
+//==============================================================================
+//
+// _arena...() / _multi...()
+//
+//------------------------------------------------------------------------------
+// returns the offset of a block with room for cap values, or UINT64_MAX.
+// may compact the arena, which moves every block.
+static inline uint64_t
+_arena_alloc(MapV_st* map,
+             uint64_t cap)
+{
+  const uint64_t need = cap + 1; // + header
+  if (map->arena.used + need > map->arena.cap) {
+    if (!_arena_compact_grow(map, need)) {
+      return UINT64_MAX;
+    }
+  }
+  const uint64_t off = map->arena.used;
+  map->arena.used += need;
+  return off;
+}
 
-  if (0 == cur->meta.slotsUsed) {
-    *cur = new;
-    return true;
+//------------------------------------------------------------------------------
+// copy every live block into a new arena, in table order, and repoint slots.
+// the new arena is twice the live size, so this amortizes like a realloc.
+static bool
+_arena_compact_grow(MapV_st* map,
+                    uint64_t need)
+{
+  const uint64_t live   = map->arena.used - map->arena.dead;
+        uint64_t newCap = 2 * (live + need);
+  if (newCap < MAPV_ARENA_CAP_MIN) {
+    newCap = MAPV_ARENA_CAP_MIN;
   }
 
-  if (!_tbl_redistribute_hashes(&new, cur)) {
-    // printf("_tbl_realloc_grow(): _tbl_redistribute_hashes() failed\n");
+  MapV_Val_ut* newVals = malloc(newCap * sizeof(*newVals));
+  if (NULL == newVals) {
     return false;
   }
 
-  free(cur->tbl.bktPtrReal);
-  *cur = new;
+  uint64_t pos = 0;
+  for (MapV_SlotId_t slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  {
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, slotId, &hv);
+    if (_hv_is_empty(&hv) || !(hv.val.u64 & MAPV_MULTI_TAG)) {
+      continue;
+    }
+    const uint64_t off = hv.val.u64 & ~MAPV_MULTI_TAG;
+    const uint64_t cap = map->arena.vals[off].u64 >> 32;
+    memcpy(&newVals[pos], &map->arena.vals[off], (cap + 1) * sizeof(*newVals));
+    _tbl_val_ptr_from_slot(map, slotId)->u64 = MAPV_MULTI_TAG | pos;
+    pos += cap + 1;
+  }
 
+  free(map->arena.vals);
+  map->arena.vals = newVals;
+  map->arena.cap  = newCap;
+  map->arena.used = pos;
+  map->arena.dead = 0;
+  map->arena.compactions++;
   return true;
 }
 
+//------------------------------------------------------------------------------
+// the slot's entry is about to go away; its block, if any, is now dead.
+static inline void
+_multi_release(MapV_st*      map,
+               MapV_SlotId_t slotId)
+{
+  const uint64_t v = _tbl_val_ptr_from_slot(map, slotId)->u64;
+  if (v & MAPV_MULTI_TAG) {
+    map->arena.dead += (map->arena.vals[v & ~MAPV_MULTI_TAG].u64 >> 32) + 1;
+  }
+}
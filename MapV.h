@@ -3,9 +3,14 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 #include <xxhash.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 
 
@@ -22,6 +27,23 @@
 #define MAPV_U64_PER_SLOT    4 // (sizeof(__m256i) / sizeof(uint64_t))
 #define MAPV_BKT_SLOTS       4 // (MAPV_BKT_ENTS / MAPV_U64_PER_SLOT)
 
+#define MAPV_FIND_BATCH        16  // keys hashed+prefetched ahead in _FindBatch()
+#define MAPV_CUCKOO_STASH_BKTS 2   // cfg.cuckoo: overflow buckets after the table
+#define MAPV_CUCKOO_BFS_MAX    256 // cfg.cuckoo: buckets searched for a free slot
+#define MAPV_HOT_SAMPLE        8   // cfg.hotCounters: 1 in this many hits counted
+#define MAPV_SER_BLOCK_ENTS    4096 // MapV_Serialize(): entries per block
+#define MAPV_SER_MAGIC         0x5a53564d // "MVSZ"
+#define MAPV_SER_VERSION       2
+#define MAPV_FILE_PAGE_SPARE   8   // cfg.filePath: 1 in this many buckets of a
+                                   // page hold no home slots, for its overflow
+#define MAPV_SHM_MAGIC         0x4d53564d // "MVSM"
+#define MAPV_RESEED_PCT_MAX    50  // cfg.keyOf: a grow below this load reseeds
+#define MAPV_RESEED_TRIES      3   // cfg.keyOf: reseeds per table size, at most
+#define MAPV_SNAP_PAGE_BKTS    64  // MapV_Snapshot(): buckets per copied page
+#ifndef MAPV_PROBE_SCALAR
+#define MAPV_PROBE_SCALAR      0   // 1: inserts and deletes probe and shift a
+#endif                             // slot at a time, not a bucket at a time
+
 
 
 
@@ -40,9 +62,28 @@ typedef enum MapV_Err_et
 	MAPV_ERR__DESTROY_MAP_IS_NULL,
 	MAPV_ERR__DESTROY_MAP_BKTPTRREAL_IS_NULL, // unused. see MapV_Destroy()
 
+	MAPV_ERR__MULTI_NOT_ENABLED,
+	MAPV_ERR__MULTI_VAL_TOO_BIG,
+	MAPV_ERR__MULTI_VAL_NOT_FOUND,
+	MAPV_ERR__MULTI_ALLOC_FAILED,
+
+	MAPV_ERR__SET_HAS_NO_VALS,
+
+	MAPV_ERR__HASH_OUT_OF_RANGE,
+	MAPV_ERR__SPLIT_TOO_MANY_PARTS,
+
+	MAPV_ERR__OPTIMIZE_NO_COUNTERS,
+
+	MAPV_ERR__SHM_READ_ONLY,
+
+	MAPV_ERR__BULK_LOAD_NOT_EMPTY,
+	MAPV_ERR__BULK_LOAD_UNSUPPORTED,
+
+	MAPV_ERR__SNAPSHOT_READ_ONLY,
+
 	//------------------------------------
 	MAPV_ERR___FIRST = MAPV_ERR__OK,
-	MAPV_ERR___LAST  = MAPV_ERR__DELETE_KEY_NOT_FOUND,
+	MAPV_ERR___LAST  = MAPV_ERR__SNAPSHOT_READ_ONLY,
 	MAPV_ERR___COUNT = MAPV_ERR___LAST,
 } MapV_Err_et;
 
@@ -68,12 +109,32 @@ typedef struct MapV_HV_st {
   MapV_Val_ut  val;
 } MapV_HV_st;
 
+// the default bucket: 128-bit fingerprints, with values.
+// with cfg.fpBits of 96/64 the lo lane shrinks to uint32_t[4] / nothing,
+// and vals[] moves up behind it (see meta.bktValOff), eg: a 64-bit map
+// bucket is slotsHi[4] + vals[4]: 64 bytes.
 typedef struct MapV_Bkt_st {
   MapV_HashHi_t slotsHi[MAPV_BKT_SLOTS];
   MapV_HashLo_t slotsLo[MAPV_BKT_SLOTS];
   MapV_Val_ut   vals   [MAPV_BKT_SLOTS];
 } MapV_Bkt_st;
 
+// set mode (cfg.set): hashes only; one bucket per 64 byte cache line.
+// slotsHi/slotsLo are laid out exactly as in MapV_Bkt_st, so everything that
+// only touches hashes works on either bucket type through a MapV_Bkt_st*.
+typedef struct MapV_SetBkt_st {
+  MapV_HashHi_t slotsHi[MAPV_BKT_SLOTS];
+  MapV_HashLo_t slotsLo[MAPV_BKT_SLOTS];
+} MapV_SetBkt_st;
+
+// cfg.keyOf: the key an entry was inserted with, from its stored hash and
+// value (e.g. an index into the caller's key store). false if unknown.
+typedef bool (*MapV_KeyOf_ft)(void*               ctx,
+                              const MapV_Hash_st  hash,
+                              const MapV_Val_ut   val,
+                              const void**        key,
+                              size_t*             keyLen);
+
 typedef struct MapV_Cfg_st {
   MapV_Dist_t distSlotMax;      // max slot probe distance before resize
   MapV_Dist_t distBktMax;       // max bucket probe distance before resize
@@ -82,16 +143,80 @@ typedef struct MapV_Cfg_st {
   uint64_t    initialSlotCount; // if you know how many entries you have,
                                 // set it here, with extra, to avoid reallocing
                                 // and rebuilding the table as it grows.
+  bool        multi;            // multimap: keys hold lists of values.
+                                // see MapV_Multi*()
+  bool        set;              // set: keys only, no values. 2/3 the memory.
+                                // see MapV_Contains/Add/Remove()
+  uint32_t    fpBits;           // stored fingerprint width: 64, 96 or 128.
+                                // 0 == 128. fewer bits, less memory, more
+                                // false positives; see MapV_FalsePosProb()
+  uint64_t    hashLo;           // only hashes with a high64 in [hashLo,
+  uint64_t    hashHi;           // hashHi] may be inserted, and the table is
+                                // spread over just that range. both 0: all.
+                                // see MapV_Split()/MapV_ExportRange()
+  uint64_t    cacheBytes;       // cache: the table is sized to fit in this
+                                // many bytes and never grows; when an insert
+                                // doesn't fit, an entry is evicted (CLOCK).
+                                // initialSlotCount is ignored. 0: off
+  bool        cuckoo;           // bucketized cuckoo engine instead of robin
+                                // hood: every key is in one of two buckets
+                                // (or a small stash), so a lookup reads at
+                                // most two. distSlotMax/distBktMax are
+                                // unused. no cacheBytes, MapV_Merge() etc.,
+                                // or MapV_Split()/MapV_ExportRange()
+  uint32_t    growPct;          // a table that's full grows to this percent
+                                // of its size, from 110 to 200 (e.g. 125,
+                                // 150). 0 == 200: powers of two. less memory
+                                // between grows, but more of them. caches
+                                // don't grow; unused there
+  uint64_t    hotCounters;      // access counters for MapV_Optimize(): 1 in
+                                // MAPV_HOT_SAMPLE keys found by MapV_Find()
+                                // or MapV_Contains() is counted, in 2 rows
+                                // of this many (to a power of two) 16-bit
+                                // counters. a few times the hot keys is
+                                // enough. 0: off. not with cuckoo
+  const char* filePath;         // out of core: the table lives in a file
+                                // made here (it mustn't exist), mmap()ed and
+                                // unlinked at once, so it's scratch space
+                                // the kernel pages to disk, not a save. no
+                                // entry is stored outside its home slot's
+                                // page; see MAPV_FILE_PAGE_SPARE. NULL: in
+                                // memory. not with cuckoo or cacheBytes
+  const char* shmName;          // shared memory: the table is made in POSIX
+                                // shared memory under this name (e.g.
+                                // "/words"), for MapV_ShmAttach() readers in
+                                // other processes; this map is the one
+                                // writer. NULL: off. not with multi,
+                                // cacheBytes or filePath
+  uint64_t      seed;           // XXH3 seed for every key's hash. 0: xxhash's
+                                // unseeded XXH3_128bits(). for keys from
+                                // outside, pick a random one
+  MapV_KeyOf_ft keyOf;          // reseeding: when an insert can't fit at
+  void*         keyOfCtx;       // under MAPV_RESEED_PCT_MAX load, the table
+                                // is rebuilt at the same size under a new
+                                // random seed, rehashing every key from
+                                // keyOf(), rather than grown; up to
+                                // MAPV_RESEED_TRIES times per size; hashes
+                                // from before are stale. NULL: always grow.
+                                // never with a hook (MapV_Log): its records
+                                // are hashes
 } MapV_Cfg_st;
 
 typedef struct MapV_Meta_st {
   uint64_t tblBytes;      // after "alignment"
   uint64_t tblBytesReal;  // before "alignment"
 
+  uint64_t bktBytes;      // sizeof(MapV_Bkt_st) by default. see fpBits, set
+  uint64_t bktValOff;     // offset of vals[] in a bucket
+  uint64_t hashLoMask;    // bits of hash.low64 kept, per fpBits
   uint64_t bktsCnt;       // buckets have 4 slots for entries
   uint64_t bktsCntReal;   // buckets have 4 slots for entries
 
-  uint64_t slotHashShift; // pre-calc; for finding our bucket index
+  uint64_t slotHashShift; // 64 - log2(slotsCap); 0 if slotsCap isn't a
+                          // power of two. see _slot_from_norm()
+  uint64_t hashLo;        // home slot: ((high64 - hashLo) << hashSkip)
+  uint64_t hashSpan;      //            >> slotHashShift
+  uint64_t hashSkip;      // hashSpan: cfg.hashHi - hashLo
   uint64_t slotsCap;      // number of slots in the table
   uint64_t slotsCapReal;  // including extra final buckets
   uint64_t slotsUsed;     // # values in the table
@@ -106,22 +231,153 @@ typedef struct MapV_Meta_st {
   uint64_t distSlotIter;
   uint64_t distBktMax;
   uint64_t distBktIter;
+
+  uint64_t cacheHand;     // cache: next slot the CLOCK hand looks at
+  uint64_t stashUsed;     // cuckoo: entries in the stash buckets
+
+  uint64_t pageBytes;     // cfg.filePath: the system page size
+  uint64_t pageBkts;      // cfg.filePath: whole buckets per page; the rest
+                          // of each page is padding. 0 in memory
+  uint64_t pageHomeSlots; // cfg.filePath: home slots per page, from its
+                          // start; see _slot_from_norm(). 0 in memory
+
+  uint64_t seed;          // cfg.seed, until a reseed; see cfg.keyOf
+  uint64_t reseeds;       // at this table size; see MAPV_RESEED_TRIES
 } MapV_Meta_st;
 
 typedef struct MapV_Tbl_st {
-  MapV_Bkt_st* bktPtrReal; // ptr to free(). alloc extra for alignment
-  MapV_Bkt_st* bkt;
+  MapV_Bkt_st* bktPtrReal; // ptr to free(). alloc extra for alignment.
+                           // cfg.filePath: the mapping, to munmap()
+  MapV_Bkt_st* bkt;        // meta.bktBytes apart; see _tbl_bkt()
+  uint64_t*    ref;        // cache: a reference bit per slot. NULL otherwise
+  char*        path;       // cfg.filePath, copied; each table's file is made
+                           // there. NULL in memory
 } MapV_Tbl_st;
 
+// multimap value storage. a key's slot value is either
+//  - bit 63 clear: the key's only value, stored inline
+//  - bit 63 set  : offset into .vals of a block:
+//                  [ (cap << 32) | cnt ][ val 0 ] ... [ val cap-1 ]
+// blocks are only ever appended; replaced/freed blocks are counted in .dead
+// and dropped when the arena is compacted, which happens when it's full.
+typedef struct MapV_Arena_st {
+  MapV_Val_ut* vals;
+  uint64_t     cap;  // in values
+  uint64_t     used; // in values, including headers and dead blocks
+  uint64_t     dead; // in values
+  uint64_t     compactions;
+} MapV_Arena_st;
+
+// called after every change made through MapV_Insert*(), MapV_UpsertAdd(),
+// MapV_Add() and MapV_Delete*(), with the entry's stored hash.
+// MapV_Upsert() and MapV_Multi*() changes are not reported. see MapV_Log.h
+typedef struct MapV_Hook_st {
+  void (*onInsert)(void* ctx, MapV_Hash_st hash, MapV_Val_ut val);
+  void (*onDelete)(void* ctx, MapV_Hash_st hash);
+  void*  ctx;
+} MapV_Hook_st;
+
 typedef struct MapV_Stats_st {
 	uint64_t mm256Loads;
+	uint64_t cacheHits;      // cache: MapV_Find()/MapV_Contains() only
+	uint64_t cacheMisses;
+	uint64_t cacheEvictions;
+	uint64_t hotSwaps;       // entries swapped by MapV_Optimize()
+	uint64_t reseeds;        // tables rebuilt under a new seed; see cfg.keyOf
 } MapV_Stats_st;
 
+// cfg.hotCounters: a count-min sketch over hash.high64. it isn't tied to
+// slots, so it needs nothing when entries move or the table grows.
+typedef struct MapV_Hot_st {
+  uint16_t* cnt;   // 2 rows of (1 << (64 - shift)) counters
+  uint64_t  shift;
+  uint64_t  tick;  // hits seen; sampled every MAPV_HOT_SAMPLE
+} MapV_Hot_st;
+
+// MapV_Serialize(): a MapV_SerHdr_st, then blocks of up to
+// MAPV_SER_BLOCK_ENTS entries, each a MapV_SerBlk_st and its payload.
+// entries are in hash order. a payload is one little-endian bit stream:
+//   - every high64 after the block's first, as the difference from the one
+//     before, rice coded with riceBits low bits
+//   - every low64, in fpBits - 64 bits
+//   - every value, in valBits bits (none in a set)
+// blocks don't depend on each other, so they can be decoded in any order.
+typedef struct MapV_SerHdr_st {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t fpBits;
+  uint32_t set;
+  uint64_t hashLo;
+  uint64_t hashHi;
+  uint64_t seed;
+  uint64_t entsCnt;
+  uint64_t blksCnt;
+} MapV_SerHdr_st;
+
+typedef struct MapV_SerBlk_st {
+  uint64_t hiFirst;
+  uint32_t entsCnt;
+  uint32_t bytes;    // payload
+  uint8_t  riceBits;
+  uint8_t  valBits;
+  uint16_t pad;
+  uint32_t check;    // XXH32 of this header (check = 0) and the payload
+} MapV_SerBlk_st;
+
+// cfg.shmName: the shared memory object named cfg.shmName. the table is
+// another, "<cfg.shmName>.<gen>"; a grow makes the next one and bumps gen.
+// seq is a seqlock: odd while the writer changes the table or meta, so a
+// reader's lookup that saw it change is retried. see _shm...()
+typedef struct MapV_ShmHdr_st {
+  uint32_t     magic;
+  uint32_t     pad;
+  uint64_t     seq;
+  uint64_t     gen;
+  MapV_Cfg_st  cfg;  // the writer's; its pointers mean nothing here
+  MapV_Meta_st meta;
+} MapV_ShmHdr_st;
+
+typedef struct MapV_Shm_st {
+  MapV_ShmHdr_st* hdr;    // NULL: not shared
+  char*           name;   // cfg.shmName, copied
+  uint64_t        gen;    // of the table mapped here
+  uint64_t        seq;    // reader: hdr->seq that meta was copied at
+  bool            reader; // from MapV_ShmAttach(): lookups only
+} MapV_Shm_st;
+
+// MapV_Snapshot(): the table's own memory, shared by the map and every
+// snapshot that has any of its pages; the last of them to let go frees it
+typedef struct MapV_SnapBase_st {
+  uint64_t     refs;
+  MapV_Bkt_st* bktPtrReal;
+  MapV_Bkt_st* bkt;
+} MapV_SnapBase_st;
+
+// MapV_Snapshot(): a map that's had one reads its table through pages of
+// MAPV_SNAP_PAGE_BKTS buckets. each page is in base, or a copy with its own
+// count of the page tables holding it. a page held by any other is copied
+// before it's written to, so a snapshot's pages never change. see _snap...()
+typedef struct MapV_Snap_st {
+  MapV_SnapBase_st* base;
+  uint64_t          pageBytes;
+  uint64_t          pagesCnt;
+  uint64_t          copies;   // pages copied ahead of a write
+  uint64_t          foldAt;   // writer, with no snapshots left: pages up to
+                              // here are back in base; see _snap_fold()
+  bool              frozen;   // from MapV_Snapshot(): lookups only
+  char*             page[];   // each page's first bucket
+} MapV_Snap_st;
+
 typedef struct MapV_st {
   MapV_Cfg_st   cfg;
   MapV_Meta_st  meta;
   MapV_Tbl_st   tbl;
   MapV_Stats_st stats;
+  MapV_Arena_st arena;
+  MapV_Hook_st  hook;
+  MapV_Hot_st   hot;
+  MapV_Shm_st   shm;
+  MapV_Snap_st* snap; // NULL: tbl.bkt is the whole table
 } MapV_st;
 
 
@@ -138,29 +394,370 @@ MapV_Insert(      MapV_st*    map,
             const MapV_Val_ut val,
             const bool        overwriteIfExists);
 
+// find the key, or insert it with a value of 0, hashing and probing once.
+// *valPtr points at the value in the table, to be read/updated in place;
+// it's valid until the map is next modified.
+MapV_Err_et
+MapV_Upsert(      MapV_st*      map,
+            const void*         key,
+            const size_t        keyLen,
+                  MapV_Val_ut** valPtr,
+                  bool*         inserted);
+
+// MapV_Upsert(), then add delta to the value. newVal may be NULL. like every
+// write, one thread at a time, even for keys that already exist.
+MapV_Err_et
+MapV_UpsertAdd(      MapV_st*  map,
+               const void*     key,
+               const size_t    keyLen,
+               const uint64_t  delta,
+                     uint64_t* newVal);
+
+// the hash as stored by this map (see cfg.fpBits, cfg.seed); for the *Hash()
+// calls. a reseed (cfg.keyOf) changes every key's.
+MapV_Hash_st
+MapV_Hash(const MapV_st* map,
+          const void*    key,
+          const size_t   keyLen);
+
+// MapV_Insert(), for a hash from MapV_Hash() or MapV_Next(). in a set, val
+// is ignored.
+MapV_Err_et
+MapV_InsertHash(      MapV_st*     map,
+                const MapV_Hash_st hash,
+                const MapV_Val_ut  val,
+                const bool         overwriteIfExists);
+
+// start loading the bucket a *Hash() call for hash will probe first, so
+// calls for a group of hashes wait on memory together rather than in turn.
+// see MapV_FindBatch().
+void
+MapV_Prefetch(const MapV_st*     map,
+              const MapV_Hash_st hash);
+
+// MapV_Upsert(), for a hash from MapV_Hash(). the table only grows; it
+// isn't reseeded, since there's no key to hash again.
+MapV_Err_et
+MapV_UpsertHash(      MapV_st*      map,
+                const MapV_Hash_st  hash,
+                      MapV_Val_ut** valPtr,
+                      bool*         inserted);
+
 bool
 MapV_Find(      MapV_st*     map,
           const void*        key,
           const size_t       keyLen,
                 MapV_Val_ut* val);
 
+// look up keysCnt keys at once. vals[i]/found[i] are set for keys[i].
+// returns the number of keys found. a file backed map (cfg.filePath) asks
+// the kernel to read in every page a group will probe before probing any.
+uint64_t
+MapV_FindBatch(const MapV_st*     map,
+               const void* const* keys,
+               const size_t*      keyLens,
+               const uint64_t     keysCnt,
+                     MapV_Val_ut* vals,
+                     bool*        found);
+
+// MapV_FindBatch(), for hashes from MapV_Hash()/MapV_HashBatch(). not on a
+// MapV_ShmAttach() map, which finds nothing: its lookups need the key.
+uint64_t
+MapV_FindHashBatch(const MapV_st*      map,
+                   const MapV_Hash_st* hashes,
+                   const uint64_t      hashesCnt,
+                         MapV_Val_ut*  vals,
+                         bool*         found);
+
+// a pointer to the value stored for hash, or NULL if it isn't there. nothing
+// is inserted, the table never grows, and after a MapV_Snapshot() no page is
+// copied. valid until the map is next modified. NULL in sets, multimaps and
+// MapV_ShmAttach() maps.
+const MapV_Val_ut*
+MapV_FindHashPtr(const MapV_st*     map,
+                 const MapV_Hash_st hash);
+
+// MapV_FindHashPtr(), for a value that's about to be written in place: after
+// a MapV_Snapshot(), the value's page is copied first if a snapshot shares
+// it. NULL on a snapshot, too.
+MapV_Val_ut*
+MapV_FindHashPtrForWrite(      MapV_st*     map,
+                         const MapV_Hash_st hash);
+
+// MapV_Hash() for keysCnt keys into hashes[]. keys of 1 to 16 bytes are
+// hashed several at a time, a SIMD lane each; the hashes are the same.
+void
+MapV_HashBatch(const MapV_st*      map,
+               const void* const*  keys,
+               const size_t*       keyLens,
+               const uint64_t      keysCnt,
+                     MapV_Hash_st* hashes);
+
+// MapV_Insert() for keysCnt keys, hashed as by MapV_HashBatch(). keys that
+// exist are skipped or overwritten as usual. stops at, and returns, the
+// first other error; keys before it were inserted.
+MapV_Err_et
+MapV_InsertBatch(      MapV_st*     map,
+                 const void* const* keys,
+                 const size_t*      keyLens,
+                 const uint64_t     keysCnt,
+                 const MapV_Val_ut* vals,
+                 const bool         overwriteIfExists);
+
+// fill an empty map with hashesCnt hashes from MapV_Hash(), and vals[i]
+// for hashes[i] (NULL: 0s; unused in a set). the table is sized for all of
+// them, they're put in hash order, and it's filled front to back without
+// probing or shifting, like MapV_Deserialize(). a hash given more than once
+// keeps its last value. MAPV_ERR__BULK_LOAD_NOT_EMPTY if the map has
+// entries; MAPV_ERR__BULK_LOAD_UNSUPPORTED for multimaps, cuckoo maps and
+// caches.
+MapV_Err_et
+MapV_BulkLoad(      MapV_st*      map,
+              const MapV_Hash_st* hashes,
+              const MapV_Val_ut*  vals,
+              const uint64_t      hashesCnt);
+
+// a MapV_ScanText() match: the token is buf[off, off + len)
+typedef void (*MapV_ScanHit_ft)(void*       ctx,
+                                uint64_t    off,
+                                uint64_t    len,
+                                MapV_Val_ut val);
+
+// split buf into tokens, look every token up, and call onHit for each one
+// found, in text order. a token is a run of ASCII letters/digits and bytes
+// >= 0x80 (so UTF-8 words stay whole); every other byte separates tokens.
+// tokens are hashed where they are, so matches are exact: case isn't
+// folded. returns the number of matches.
+uint64_t
+MapV_ScanText(const MapV_st*        map,
+              const char*           buf,
+              const uint64_t        len,
+              const MapV_ScanHit_ft onHit,
+                    void*           ctx);
+
 MapV_Err_et
 MapV_Delete(      MapV_st* map,
             const void*    key,
             const size_t   keyLen);
 
+MapV_Err_et
+MapV_DeleteHash(      MapV_st*     map,
+                const MapV_Hash_st hash);
+
 MapV_Err_et
 MapV_Destroy(MapV_st* map);
 
+// walk every entry, in slot order. start with *slotId = 0; each call sets
+// the next entry's hash and value (0 in a set), and returns false after the
+// last one. the map must not change during the walk; a MapV_Snapshot() never
+// does.
+bool
+MapV_Next(const MapV_st*       map,
+                MapV_SlotId_t* slotId,
+                MapV_Hash_st*  hash,
+                MapV_Val_ut*   val);
+
+//------------------------------------------------------------------------------
+// multimap (cfg.multi). values must be < 2^63; bit 63 tags arena blocks.
+// MapV_Insert()/MapV_Find() must not be used on a multimap;
+// MapV_Delete() removes a key along with all of its values.
+
+MapV_Err_et
+MapV_MultiAppend(      MapV_st*    map,
+                 const void*       key,
+                 const size_t      keyLen,
+                 const MapV_Val_ut val);
+
+// returns the key's values, and their count in *cnt; NULL if not found.
+// the pointer is only valid until the map is next modified.
+const MapV_Val_ut*
+MapV_MultiFind(      MapV_st*  map,
+               const void*     key,
+               const size_t    keyLen,
+                     uint64_t* cnt);
+
+// removes one occurrence of val. removing a key's last value deletes the key.
+// value order is not preserved.
+MapV_Err_et
+MapV_MultiRemove(      MapV_st*    map,
+                 const void*       key,
+                 const size_t      keyLen,
+                 const MapV_Val_ut val);
+
+//------------------------------------------------------------------------------
+// set mode (cfg.set). MapV_Find() works, always returning a value of 0;
+// MapV_Insert()/MapV_Upsert*()/MapV_MultiAppend()/MapV_MultiRemove() return
+// MAPV_ERR__SET_HAS_NO_VALS, and MapV_MultiFind() finds nothing.
+// MapV_Contains()/MapV_Remove() work on any map.
+
+bool
+MapV_Contains(      MapV_st* map,
+              const void*    key,
+              const size_t   keyLen);
+
+// MAPV_ERR__INSERT_KEY_EXISTS if the key was already in the set.
+MapV_Err_et
+MapV_Add(      MapV_st* map,
+         const void*    key,
+         const size_t   keyLen);
+
+MapV_Err_et
+MapV_Remove(      MapV_st* map,
+            const void*    key,
+            const size_t   keyLen);
+
+//------------------------------------------------------------------------------
+// set operations between two maps, in one sequential pass over each table.
+// both must have the same cfg.fpBits, and neither can be a multimap.
+// the result is a new map configured like a; if a is a set, so is it.
+// onConflict picks the value for keys in both maps; NULL keeps a's.
+
+typedef MapV_Val_ut (*MapV_Conflict_ft)(void*        ctx,
+                                        MapV_Hash_st hash,
+                                        MapV_Val_ut  valA,
+                                        MapV_Val_ut  valB);
+
+// keys in a or b
+MapV_st*
+MapV_Merge(const MapV_st*         a,
+           const MapV_st*         b,
+           const MapV_Conflict_ft onConflict,
+                 void*            ctx);
+
+// keys in a and b
+MapV_st*
+MapV_Intersect(const MapV_st*         a,
+               const MapV_st*         b,
+               const MapV_Conflict_ft onConflict,
+                     void*            ctx);
+
+// keys in a but not in b, with a's values
+MapV_st*
+MapV_Diff(const MapV_st* a,
+          const MapV_st* b);
+
+// keys in any of maps[0..mapsCnt), in one pass over every table; configured
+// like maps[0]. a key in several has onConflict folded over its values, in
+// maps order: onConflict(onConflict(v0, v1), v2)...
+MapV_st*
+MapV_MergeMany(const MapV_st* const*  maps,
+               const uint64_t         mapsCnt,
+               const MapV_Conflict_ft onConflict,
+                     void*            ctx);
+
+//------------------------------------------------------------------------------
+// partitions by hash range, in one pass, without rehashing.
+// each partition's table is spread over its own range only, so it's sized
+// for its own entries (see cfg.hashLo/hashHi), and only takes keys in range.
+
+// split map's hash range into 2^bits equal ranges: out[i] gets the i'th.
+// for a map over every hash, that's by the top bits of hash.high64.
+// out must hold 2^bits maps. bits may be 0..16.
+MapV_Err_et
+MapV_Split(const MapV_st*  map,
+           const uint32_t  bits,
+                 MapV_st** out);
+
+// a new map with every entry whose hash.high64 is in [hashLo, hashHi].
+// only the part of the table holding that range is read.
+MapV_st*
+MapV_ExportRange(const MapV_st* map,
+                 const uint64_t hashLo,
+                 const uint64_t hashHi);
+
+//------------------------------------------------------------------------------
+// compact serialization; see MapV_SerHdr_st. sorted hashes are stored as
+// their differences, and values in as few bits as the biggest one in their
+// block, so a stream is a fraction of the table's size, and loading it
+// fills the table front to back without probing.
+// returns the bytes written; 0 for a multimap or cuckoo map, or if writing
+// failed.
+uint64_t
+MapV_Serialize(const MapV_st* map,
+                     FILE*    out);
+
+// a new map from a MapV_Serialize() stream, made with cfg except for
+// fpBits, set and the hash range, which are the stream's. cacheBytes is
+// ignored, and multi/cuckoo aren't allowed. NULL if the stream is short,
+// fails its checks, or isn't sorted.
+MapV_st*
+MapV_Deserialize(      FILE*        in,
+                 const MapV_Cfg_st* cfg);
+
+//------------------------------------------------------------------------------
+// shared memory (cfg.shmName). attach, read-only, to a map another process
+// made with cfg.shmName. MapV_Find(), MapV_Contains() and MapV_FindBatch()
+// see the writer's changes, grows included, as they're made; a lookup that
+// overlaps a change is retried. changes return MAPV_ERR__SHM_READ_ONLY. one
+// thread per reader map; MapV_Destroy() detaches. NULL if there's no such
+// map, or it has no table yet.
+MapV_st*
+MapV_ShmAttach(const char* name);
+
+//------------------------------------------------------------------------------
+// a read-only copy of map as it is now, that stays as it is while map is
+// changed: MapV_Find(), MapV_FindBatch(), MapV_Next(), MapV_Serialize(),
+// MapV_Merge(), ... on it see this moment's entries, and changes return
+// MAPV_ERR__SNAPSHOT_READ_ONLY. nothing is copied up front but a pointer per
+// MAPV_SNAP_PAGE_BKTS buckets; from then on, map's writes copy each page a
+// snapshot shares, once, before changing it. a grow leaves the old table
+// to the snapshots. it's made on map's writer thread, but can be read, and
+// MapV_Destroy()ed, on any one other, while map is written. pointers from
+// MapV_Upsert*() taken before it must not be written through after.
+// NULL for multimaps, file backed and shared memory maps, and snapshots.
+MapV_st*
+MapV_Snapshot(MapV_st* map);
+
+//------------------------------------------------------------------------------
+// cache mode (cfg.cacheBytes). the table never grows; an insert that doesn't
+// fit evicts an entry that hasn't been looked up since the CLOCK hand last
+// passed it: any entry when the table is at cfg.capPctMax, or one near the
+// new key's home slot when it's out of probe distance. evictions are
+// reported to hook.onDelete. MapV_Find()/MapV_Contains()/MapV_Upsert*() mark
+// an entry as used; MapV_FindBatch() doesn't. can't be a multimap, and maps
+// made from a cache (MapV_Merge(), MapV_Split(), ...) aren't caches.
+
+// stats.cacheHits / (stats.cacheHits + stats.cacheMisses). 0 with no lookups.
+double
+MapV_CacheHitRate(const MapV_st* map);
+
+//------------------------------------------------------------------------------
+// access counters (cfg.hotCounters). entries that share a home slot can sit
+// in any order; MapV_Optimize() puts the most looked up first, so they're
+// found at the lowest probe distance, and sometimes a bucket sooner. nothing
+// else moves, and the table isn't resized. counters are halved afterwards,
+// so the next pass follows recent lookups more than old ones.
+// MAPV_ERR__OPTIMIZE_NO_COUNTERS without cfg.hotCounters.
+MapV_Err_et
+MapV_Optimize(MapV_st* map);
+
+//------------------------------------------------------------------------------
+// odds that looking up a key that was never inserted finds a match anyway,
+// at the map's current size. ie: slotsUsed / 2^fpBits
+double
+MapV_FalsePosProb(const MapV_st* map);
+
+// odds that at least two of the keys in the map share a fingerprint,
+// and were silently merged into one entry when inserted.
+double
+MapV_CollisionProb(const MapV_st* map);
+
 void
 MapV_PrintTableCfg(const MapV_st* map);
 
 void
 MapV_PrintTableData(const MapV_st* map);
 
+void
+MapV_PrintTableStats(const MapV_st* map);
+
 const char*
 MapV_PrintErr(MapV_Err_et err);
 
 
 
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
 #endif // _MapV_MapV_h_
@@ -0,0 +1,348 @@
+#ifndef _MapV_MapV_hpp_
+#define _MapV_MapV_hpp_
+
+#include <immintrin.h>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "MapV.h"
+
+
+
+
+//==============================================================================
+//
+// mapv::Map<Value, KeyPolicy, Config> : header-only C++ front-end
+//
+// the table is a plain MapV_st, built and grown by the C core (MapV.o);
+// inserts and deletes go through MapV_Upsert()/MapV_Delete*(). what's here
+// is find(), with everything MapV_Find() reads from cfg at runtime fixed by
+// Config instead:
+//   - the bucket layout (fingerprint width), so bucket offsets are constants
+//   - the bucket probe bound, so the probe loop has a constant trip count
+//     and is unrolled. it still stops at meta.distBktIter, like MapV_Find();
+//     stopping at the first empty slot instead was slower on misses, as
+//     that branch is hard to predict.
+//   - maps cover every hash (no cfg.hashLo/hashHi), so the home slot is
+//     just a shift
+//
+// values that are trivially copyable and fit in 8 bytes are stored in the
+// slot. anything else, including move-only types, is heap allocated and
+// owned by the map; the slot holds its address.
+//
+// hashing is always the C core's, so c_map() can be handed to the C API
+// (MapV_Log, MapV_Merge(), ...) for maps with values stored in the slot.
+// KeyPolicy only says which bytes of a key are hashed. after a
+// MapV_Snapshot() of c_map(), find() and for_each() go through the C core;
+// the const ones never copy a page, the others copy the pages of values
+// stored in the slot that they hand out.
+//
+//------------------------------------------------------------------------------
+namespace mapv {
+
+template <uint32_t FpBits       = 128, // cfg.fpBits
+          uint64_t BktProbeMax  = 8,   // cfg.distBktMax
+          uint64_t SlotProbeMax = 32,  // cfg.distSlotMax
+          uint32_t CapPctMax    = 90>  // cfg.capPctMax
+struct Config {
+  static_assert(64 == FpBits || 96 == FpBits || 128 == FpBits,
+                "fingerprints are 64, 96 or 128 bits");
+  static_assert(BktProbeMax >= 1 && BktProbeMax <= 64,
+                "probe 1 to 64 buckets");
+  static_assert(CapPctMax > 0 && CapPctMax <= 100, "capacity is a percentage");
+
+  static constexpr uint32_t fpBits       = FpBits;
+  static constexpr uint64_t bktProbeMax  = BktProbeMax;
+  static constexpr uint64_t slotProbeMax = SlotProbeMax;
+  static constexpr uint32_t capPctMax    = CapPctMax;
+
+  // as computed in MapV_Create()
+  static constexpr uint64_t bktValOff = sizeof(MapV_HashHi_t) * MAPV_BKT_SLOTS
+                                      + (FpBits - 64) / 8 * MAPV_BKT_SLOTS;
+  static constexpr uint64_t bktBytes  = bktValOff
+                                      + sizeof(MapV_Val_ut) * MAPV_BKT_SLOTS;
+};
+
+//------------------------------------------------------------------------------
+// key policies: the bytes of a key that get hashed
+
+// std::string, std::string_view, const char*, ...
+struct BytesKey {
+  static std::string_view bytes(std::string_view key) { return key; }
+};
+
+// integers, and structs without padding
+template <typename T>
+struct PodKey {
+  static_assert(std::is_trivially_copyable_v<T>
+                && std::has_unique_object_representations_v<T>,
+                "every byte of a PodKey must be part of its value");
+  static std::string_view bytes(const T& key) {
+    return { reinterpret_cast<const char*>(&key), sizeof(T) };
+  }
+};
+
+//------------------------------------------------------------------------------
+template <typename Value,
+          typename KeyPolicy = BytesKey,
+          typename Cfg       = Config<>>
+class Map {
+ public:
+  static constexpr bool kInline = std::is_trivially_copyable_v<Value>
+                               && sizeof(Value)  <= sizeof(MapV_Val_ut)
+                               && alignof(Value) <= alignof(MapV_Val_ut);
+
+  explicit Map(uint64_t initialSlotCount = 0) {
+    MapV_Cfg_st cfg      = {};
+    cfg.distSlotMax      = Cfg::slotProbeMax;
+    cfg.distBktMax       = Cfg::bktProbeMax;
+    cfg.capPctMax        = Cfg::capPctMax;
+    cfg.memAlign         = 4096;
+    cfg.initialSlotCount = initialSlotCount;
+    cfg.fpBits           = Cfg::fpBits;
+    if (nullptr == (map_ = MapV_Create(&cfg))) {
+      throw std::bad_alloc();
+    }
+  }
+
+  ~Map() { release(); }
+
+  Map(const Map&)            = delete;
+  Map& operator=(const Map&) = delete;
+
+  Map(Map&& other) noexcept : map_(other.map_) { other.map_ = nullptr; }
+  Map& operator=(Map&& other) noexcept {
+    if (this != &other) {
+      release();
+      map_       = other.map_;
+      other.map_ = nullptr;
+    }
+    return *this;
+  }
+
+  //----------------------------------------------------------------------------
+  // nullptr if not found. valid until the map is next changed.
+  template <typename K>
+  Value* find(const K& key) {
+    return value(find_slot_for_write(hash(key)));
+  }
+
+  template <typename K>
+  const Value* find(const K& key) const {
+    return value(find_slot(hash(key)));
+  }
+
+  template <typename K>
+  bool contains(const K& key) const {
+    return nullptr != find(key);
+  }
+
+  // insert, or overwrite. true if the key is new.
+  template <typename K, typename V>
+  bool insert(const K& key, V&& val) {
+    bool         inserted;
+    MapV_Val_ut* slot = upsert(key, &inserted);
+    if (inserted) {
+      construct(key, slot, std::forward<V>(val));
+    } else {
+      *value(slot) = std::forward<V>(val);
+    }
+    return inserted;
+  }
+
+  // the key's value, default constructed if it's new
+  template <typename K>
+  Value& operator[](const K& key) {
+    bool         inserted;
+    MapV_Val_ut* slot = upsert(key, &inserted);
+    if (inserted) {
+      construct(key, slot, Value());
+    }
+    return *value(slot);
+  }
+
+  template <typename K>
+  bool erase(const K& key) {
+    const MapV_Hash_st h   = hash(key);
+    const Value*       val = value(find_slot(h));
+    if (nullptr == val) {
+      return false;
+    }
+    if constexpr (!kInline) {
+      delete val;
+    }
+    MapV_DeleteHash(map_, h);
+    return true;
+  }
+
+  // f(MapV_Hash_st, Value&) for every entry, in slot order
+  template <typename F>
+  void for_each(F&& f) {
+    MapV_SlotId_t slotId = 0;
+    MapV_Hash_st  h;
+    MapV_Val_ut   v;
+    while (MapV_Next(map_, &slotId, &h, &v)) {
+      MapV_Val_ut* slot = (nullptr == map_->snap)
+                        ? slot_val(slotId - 1) // it's one past the entry
+                        : find_slot_for_write(h);
+      f(h, *value(slot));
+    }
+  }
+
+  // f(MapV_Hash_st, const Value&) for every entry, in slot order
+  template <typename F>
+  void for_each(F&& f) const {
+    MapV_SlotId_t slotId = 0;
+    MapV_Hash_st  h;
+    MapV_Val_ut   v;
+    while (MapV_Next(map_, &slotId, &h, &v)) {
+      const MapV_Val_ut* slot = (nullptr == map_->snap)
+                              ? slot_val(slotId - 1)
+                              : MapV_FindHashPtr(map_, h);
+      f(h, *value(slot));
+    }
+  }
+
+  uint64_t size() const { return map_->meta.slotsUsed; }
+
+  // the underlying map, for the C API
+  MapV_st*       c_map()       { return map_; }
+  const MapV_st* c_map() const { return map_; }
+
+  //----------------------------------------------------------------------------
+ private:
+  MapV_st* map_;
+
+  template <typename K>
+  MapV_Hash_st hash(const K& key) const {
+    const std::string_view b = KeyPolicy::bytes(key);
+    return MapV_Hash(map_, b.data(), b.size());
+  }
+
+  template <typename K>
+  MapV_Val_ut* upsert(const K& key, bool* inserted) {
+    const std::string_view b = KeyPolicy::bytes(key);
+    MapV_Val_ut*           slot;
+    if (MAPV_ERR__OK != MapV_Upsert(map_, b.data(), b.size(), &slot, inserted)) {
+      throw std::bad_alloc();
+    }
+    return slot;
+  }
+
+  // the slot's value is 0 after an insert
+  template <typename K, typename V>
+  void construct(const K& key, MapV_Val_ut* slot, V&& val) {
+    if constexpr (kInline) {
+      const Value tmp(std::forward<V>(val));
+      std::memcpy(slot, &tmp, sizeof(Value));
+    } else {
+      try {
+        slot->ptr = new Value(std::forward<V>(val));
+      } catch (...) {
+        const std::string_view b = KeyPolicy::bytes(key);
+        MapV_Delete(map_, b.data(), b.size());
+        throw;
+      }
+    }
+  }
+
+  static Value* value(MapV_Val_ut* slot) {
+    if (nullptr == slot) {
+      return nullptr;
+    }
+    if constexpr (kInline) {
+      return reinterpret_cast<Value*>(slot);
+    } else {
+      return static_cast<Value*>(const_cast<void*>(slot->ptr));
+    }
+  }
+
+  static const Value* value(const MapV_Val_ut* slot) {
+    return value(const_cast<MapV_Val_ut*>(slot));
+  }
+
+  MapV_Val_ut* slot_val(const MapV_SlotId_t slotId) const {
+    char* bkt = reinterpret_cast<char*>(map_->tbl.bkt)
+              + (slotId / MAPV_BKT_SLOTS) * Cfg::bktBytes;
+    return reinterpret_cast<MapV_Val_ut*>(bkt + Cfg::bktValOff)
+         + (slotId % MAPV_BKT_SLOTS);
+  }
+
+  // find_slot(), for a value that may be written through. once c_map() has
+  // had a MapV_Snapshot(), its buckets are reached through a page table,
+  // and a page may still be a snapshot's: the C core copies it first. a
+  // heap allocated value isn't in the page, so it's never copied for.
+  MapV_Val_ut* find_slot_for_write(const MapV_Hash_st h) {
+    if (kInline && nullptr != map_->snap) {
+      return MapV_FindHashPtrForWrite(map_, h);
+    }
+    return const_cast<MapV_Val_ut*>(find_slot(h));
+  }
+
+  // MapV_Find(), for this Config: where h's value is, or nullptr. reads
+  // only; after a snapshot, MapV_FindHashPtr() follows the page table.
+  const MapV_Val_ut* find_slot(const MapV_Hash_st h) const {
+    if (nullptr != map_->snap) {
+      return MapV_FindHashPtr(map_, h);
+    }
+
+    const MapV_SlotId_t home = h.high64 >> map_->meta.slotHashShift;
+    const char*         bkt  = reinterpret_cast<const char*>(map_->tbl.bkt)
+                             + (home / MAPV_BKT_SLOTS) * Cfg::bktBytes;
+
+    const __m256i needleHi   = _mm256_set1_epi64x(h.high64);
+    const __m256i needleLo   = _mm256_set1_epi64x(h.low64);
+    const __m128i needleLo32 = _mm_set1_epi32((uint32_t)h.low64);
+
+    // the trip count is Config's, so this unrolls; no entry is further than
+    // meta.distBktIter buckets from home, though, so stop there too
+    const uint64_t iters = map_->meta.distBktIter;
+
+#pragma GCC unroll 64
+    for (uint64_t i = 0; i < Cfg::bktProbeMax; i++, bkt += Cfg::bktBytes)
+    {
+      const __m256i hi    = _mm256_loadu_si256((const __m256i*)bkt);
+            int     found = _mm256_movemask_pd(
+                              (__m256d)_mm256_cmpeq_epi64(hi, needleHi));
+      if (0 != found) {
+        if constexpr (128 == Cfg::fpBits) {
+          found &= _mm256_movemask_pd((__m256d)_mm256_cmpeq_epi64(
+                     _mm256_loadu_si256((const __m256i*)(bkt + 32)), needleLo));
+        } else if constexpr (96 == Cfg::fpBits) {
+          found &= _mm_movemask_ps((__m128)_mm_cmpeq_epi32(
+                     _mm_loadu_si128((const __m128i*)(bkt + 32)), needleLo32));
+        }
+        if (0 != found) {
+          return reinterpret_cast<const MapV_Val_ut*>(bkt + Cfg::bktValOff)
+               + __builtin_ctz(found);
+        }
+      }
+
+      if (i + 1 >= iters) {
+        return nullptr;
+      }
+    }
+    return nullptr;
+  }
+
+  void release() {
+    if (nullptr == map_) {
+      return;
+    }
+    if constexpr (!kInline) {
+      std::as_const(*this).for_each(
+          [](MapV_Hash_st, const Value& val) { delete &val; });
+    }
+    MapV_Destroy(map_);
+    map_ = nullptr;
+  }
+};
+
+} // namespace mapv
+
+
+
+#endif // _MapV_MapV_hpp_
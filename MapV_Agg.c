@@ -0,0 +1,445 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "MapV.h"
+#include "MapV_Agg.h"
+
+
+
+
+//------------------------------------------------------------------------------
+//
+// static function declarations
+//
+
+static MapV_Cfg_st
+_part_cfg(const MapV_Agg_st* agg,
+          const uint64_t     part);
+
+static inline uint64_t
+_part_of(const MapV_Agg_st* agg,
+         const MapV_Hash_st hash);
+
+static void
+_path_spill(const MapV_Agg_st* agg,
+            const uint32_t     threadId,
+            const uint64_t     part,
+            const uint64_t     n,
+                  char*        path);
+
+static inline void
+_apply(const MapV_AggOp_et op,
+             MapV_Val_ut*  val,
+       const bool          inserted,
+       const uint64_t      delta);
+
+static MapV_Val_ut
+_on_conflict(void*        ctx,
+             MapV_Hash_st hash,
+             MapV_Val_ut  valA,
+             MapV_Val_ut  valB);
+
+static uint64_t
+_thread_bytes(const MapV_Agg_st*       agg,
+              const MapV_AggThread_st* th);
+
+static bool
+_spill(      MapV_Agg_st* agg,
+       const uint32_t     threadId);
+
+
+
+
+//==============================================================================
+//
+// MapV_Agg*() : Public Functions
+//
+//------------------------------------------------------------------------------
+MapV_Agg_st*
+MapV_AggCreate(const MapV_AggCfg_st* cfg)
+{
+  const MapV_Cfg_st* mc = &cfg->mapCfg;
+  if (cfg->partBits > MAPV_AGG_PART_BITS_MAX) {
+    printf("MapV_AggCreate(): partBits %"PRIu32" is over %d\n",
+           cfg->partBits, MAPV_AGG_PART_BITS_MAX);
+    return NULL;
+  }
+  if (   mc->set || mc->multi || mc->cuckoo || mc->cacheBytes
+      || NULL != mc->filePath || NULL != mc->shmName || NULL != mc->keyOf) {
+    printf("MapV_AggCreate(): partial tables can't be sets, multimaps, "
+           "cuckoo, caches, file backed, shared or reseeded\n");
+    return NULL;
+  }
+
+  MapV_Agg_st* agg = calloc(1, sizeof(*agg));
+  if (NULL == agg) {
+    printf("MapV_AggCreate(): out of memory\n");
+    return NULL;
+  }
+  agg->cfg = *cfg;
+  if (0 == agg->cfg.threadsCnt) {
+    agg->cfg.threadsCnt = 1;
+  }
+  agg->partsCnt       = (uint64_t)1 << agg->cfg.partBits;
+  agg->threadBytesMax = agg->cfg.memBytesMax / agg->cfg.threadsCnt;
+
+  if (agg->cfg.memBytesMax > 0)
+  {
+    const char* in = (NULL != cfg->spillDir) ? cfg->spillDir : "/tmp";
+    char        dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/MapV_Agg.XXXXXX", in);
+    if (NULL == mkdtemp(dir)) {
+      printf("MapV_AggCreate(): can't make a spill directory in %s\n", in);
+      free(agg);
+      return NULL;
+    }
+    if (NULL == (agg->dir = strdup(dir))) {
+      printf("MapV_AggCreate(): out of memory\n");
+      rmdir(dir);
+      free(agg);
+      return NULL;
+    }
+  }
+
+  agg->threads = calloc(agg->cfg.threadsCnt, sizeof(*agg->threads));
+  if (NULL == agg->threads) {
+    printf("MapV_AggCreate(): out of memory\n");
+    MapV_AggFree(agg);
+    return NULL;
+  }
+  for (uint32_t t = 0; t < agg->cfg.threadsCnt; t++)
+  {
+    MapV_AggThread_st* th = &agg->threads[t];
+    th->parts     = calloc(agg->partsCnt, sizeof(*th->parts));
+    th->spillsCnt = calloc(agg->partsCnt, sizeof(*th->spillsCnt));
+    if (NULL == th->parts || NULL == th->spillsCnt) {
+      printf("MapV_AggCreate(): out of memory\n");
+      MapV_AggFree(agg);
+      return NULL;
+    }
+    for (uint64_t p = 0; p < agg->partsCnt; p++)
+    {
+      const MapV_Cfg_st pc = _part_cfg(agg, p);
+      if (NULL == (th->parts[p] = MapV_Create(&pc))) {
+        MapV_AggFree(agg);
+        return NULL;
+      }
+    }
+  }
+
+  return agg;
+}
+
+//------------------------------------------------------------------------------
+MapV_Err_et
+MapV_AggUpdate(      MapV_Agg_st* agg,
+               const uint32_t     threadId,
+               const void* const* keys,
+               const size_t*      keyLens,
+               const uint64_t*    deltas,
+               const uint64_t     keysCnt)
+{
+  MapV_AggThread_st* th = &agg->threads[threadId];
+  MapV_Hash_st       hashes[MAPV_AGG_BATCH];
+
+  for (uint64_t i = 0; i < keysCnt; i += MAPV_AGG_BATCH)
+  {
+    const uint64_t n = (keysCnt - i < MAPV_AGG_BATCH)
+                     ? keysCnt - i : MAPV_AGG_BATCH;
+
+    // every partial table hashes the same way; any of them will do
+    MapV_HashBatch(th->parts[0], keys + i, keyLens + i, n, hashes);
+    for (uint64_t j = 0; j < n && j < MAPV_FIND_BATCH; j++) {
+      MapV_Prefetch(th->parts[_part_of(agg, hashes[j])], hashes[j]);
+    }
+
+    for (uint64_t j = 0; j < n; j++)
+    {
+      // keep MAPV_FIND_BATCH buckets loading ahead of the one being updated
+      if (j + MAPV_FIND_BATCH < n) {
+        const MapV_Hash_st ahead = hashes[j + MAPV_FIND_BATCH];
+        MapV_Prefetch(th->parts[_part_of(agg, ahead)], ahead);
+      }
+
+      MapV_Val_ut* val;
+      bool         inserted;
+      MapV_Err_et  err;
+      if (MAPV_ERR__OK != (err = MapV_UpsertHash(th->parts[_part_of(agg, hashes[j])],
+                                                 hashes[j], &val, &inserted))) {
+        th->rowsCnt += j;
+        return err;
+      }
+      _apply(agg->cfg.op, val, inserted,
+             (NULL != deltas) ? deltas[i + j] : 1);
+    }
+    th->rowsCnt += n;
+
+    // tables only get bigger when they grow, so once per batch is enough
+    if (   agg->threadBytesMax > 0
+        && _thread_bytes(agg, th) > agg->threadBytesMax
+        && !_spill(agg, threadId)) {
+      return MAPV_ERR__TABLE_GROW_FAILED;
+    }
+  }
+
+  return MAPV_ERR__OK;
+}
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_AggMerge(      MapV_Agg_st* agg,
+              const uint64_t     part)
+{
+  if (part >= agg->partsCnt || NULL == agg->threads[0].parts[part]) {
+    printf("MapV_AggMerge(): no partition %"PRIu64"\n", part);
+    return NULL;
+  }
+
+  uint64_t mapsCnt = agg->cfg.threadsCnt;
+  for (uint32_t t = 0; t < agg->cfg.threadsCnt; t++) {
+    mapsCnt += agg->threads[t].spillsCnt[part];
+  }
+
+  //---------------------------
+  // every thread's partial, then its spills read back
+  const MapV_Cfg_st pc   = _part_cfg(agg, part);
+  MapV_st**         maps = calloc(mapsCnt, sizeof(*maps));
+  uint64_t          cnt  = 0;
+  bool              ok   = true;
+  for (uint32_t t = 0; t < agg->cfg.threadsCnt; t++)
+  {
+    MapV_AggThread_st* th = &agg->threads[t];
+    maps[cnt++] = th->parts[part];
+    th->parts[part] = NULL;
+
+    for (uint64_t n = 0; n < th->spillsCnt[part]; n++)
+    {
+      char path[PATH_MAX];
+      _path_spill(agg, t, part, n, path);
+      FILE* file = fopen(path, "rb");
+      if (ok && NULL != file) {
+        ok = (NULL != (maps[cnt++] = MapV_Deserialize(file, &pc)));
+      } else {
+        ok = false;
+      }
+      if (NULL != file) {
+        fclose(file);
+      }
+      unlink(path);
+    }
+    th->spillsCnt[part] = 0;
+  }
+
+  MapV_st* out = NULL;
+  if (!ok) {
+    printf("MapV_AggMerge(): can't read back partition %"PRIu64"'s spills\n",
+           part);
+  } else {
+    out = MapV_MergeMany((const MapV_st* const*)maps, cnt, _on_conflict,
+                         &agg->cfg.op);
+  }
+
+  for (uint64_t i = 0; i < cnt; i++) {
+    if (NULL != maps[i]) {
+      MapV_Destroy(maps[i]);
+    }
+  }
+  free(maps);
+  return out;
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_AggFree(MapV_Agg_st* agg)
+{
+  if (NULL == agg) {
+    return;
+  }
+
+  for (uint32_t t = 0; NULL != agg->threads && t < agg->cfg.threadsCnt; t++)
+  {
+    MapV_AggThread_st* th = &agg->threads[t];
+    for (uint64_t p = 0; p < agg->partsCnt; p++)
+    {
+      if (NULL != th->parts && NULL != th->parts[p]) {
+        MapV_Destroy(th->parts[p]);
+      }
+      for (uint64_t n = 0; NULL != th->spillsCnt && n < th->spillsCnt[p]; n++) {
+        char path[PATH_MAX];
+        _path_spill(agg, t, p, n, path);
+        unlink(path);
+      }
+    }
+    free(th->parts);
+    free(th->spillsCnt);
+  }
+  free(agg->threads);
+
+  if (NULL != agg->dir) {
+    rmdir(agg->dir);
+    free(agg->dir);
+  }
+  free(agg);
+}
+
+
+
+
+//==============================================================================
+//
+// Static Functions
+//
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// partition part covers the high64s whose top partBits bits are part
+static MapV_Cfg_st
+_part_cfg(const MapV_Agg_st* agg,
+          const uint64_t     part)
+{
+  const uint32_t bits = agg->cfg.partBits;
+  MapV_Cfg_st    cfg  = agg->cfg.mapCfg;
+  cfg.hashLo = bits ? (part << (64 - bits)) : 0;
+  cfg.hashHi = bits ? (cfg.hashLo | (UINT64_MAX >> bits)) : UINT64_MAX;
+  return cfg;
+}
+
+//------------------------------------------------------------------------------
+static inline uint64_t
+_part_of(const MapV_Agg_st* agg,
+         const MapV_Hash_st hash)
+{
+  return agg->cfg.partBits ? (hash.high64 >> (64 - agg->cfg.partBits)) : 0;
+}
+
+//------------------------------------------------------------------------------
+static void
+_path_spill(const MapV_Agg_st* agg,
+            const uint32_t     threadId,
+            const uint64_t     part,
+            const uint64_t     n,
+                  char*        path)
+{
+  snprintf(path, PATH_MAX, "%s/%"PRIu32".%"PRIu64".%"PRIu64, agg->dir,
+           threadId, part, n);
+}
+
+//------------------------------------------------------------------------------
+// a new key's value is 0
+static inline void
+_apply(const MapV_AggOp_et op,
+             MapV_Val_ut*  val,
+       const bool          inserted,
+       const uint64_t      delta)
+{
+  switch (op) {
+    case MAPV_AGG_OP__COUNT: val->u64++;         break;
+    case MAPV_AGG_OP__SUM:   val->u64 += delta;  break;
+    case MAPV_AGG_OP__MIN:
+      if (inserted || delta < val->u64) {
+        val->u64 = delta;
+      }
+      break;
+    case MAPV_AGG_OP__MAX:
+      if (delta > val->u64) {
+        val->u64 = delta;
+      }
+      break;
+  }
+}
+
+//------------------------------------------------------------------------------
+// two partial results for the same key
+static MapV_Val_ut
+_on_conflict(void*        ctx,
+             MapV_Hash_st hash,
+             MapV_Val_ut  valA,
+             MapV_Val_ut  valB)
+{
+  (void)hash;
+  switch (*(const MapV_AggOp_et*)ctx) {
+    case MAPV_AGG_OP__COUNT:
+    case MAPV_AGG_OP__SUM:
+      return (MapV_Val_ut){ .u64 = valA.u64 + valB.u64 };
+    case MAPV_AGG_OP__MIN:
+      return (valB.u64 < valA.u64) ? valB : valA;
+    case MAPV_AGG_OP__MAX:
+      return (valB.u64 > valA.u64) ? valB : valA;
+  }
+  return valA;
+}
+
+//------------------------------------------------------------------------------
+static uint64_t
+_thread_bytes(const MapV_Agg_st*       agg,
+              const MapV_AggThread_st* th)
+{
+  uint64_t bytes = 0;
+  for (uint64_t p = 0; p < agg->partsCnt; p++) {
+    bytes += th->parts[p]->meta.tblBytes;
+  }
+  return bytes;
+}
+
+//------------------------------------------------------------------------------
+// write out the biggest partitions, and start them over, until the thread
+// is back under its share. an empty table's bytes can't be spilled, so a
+// share smaller than those is left over.
+static bool
+_spill(      MapV_Agg_st* agg,
+       const uint32_t     threadId)
+{
+  MapV_AggThread_st* th = &agg->threads[threadId];
+
+  while (_thread_bytes(agg, th) > agg->threadBytesMax)
+  {
+    uint64_t big = 0;
+    for (uint64_t p = 1; p < agg->partsCnt; p++) {
+      if (th->parts[p]->meta.slotsUsed > th->parts[big]->meta.slotsUsed) {
+        big = p;
+      }
+    }
+    if (0 == th->parts[big]->meta.slotsUsed) {
+      return true;
+    }
+
+    // the partition's table is only swapped out once its spill is written
+    // and there's an empty one to take its place
+    const MapV_Cfg_st pc    = _part_cfg(agg, big);
+          MapV_st*    empty = MapV_Create(&pc);
+    if (NULL == empty) {
+      printf("MapV_AggUpdate(): out of memory for partition %"PRIu64"\n", big);
+      return false;
+    }
+
+    char path[PATH_MAX];
+    _path_spill(agg, threadId, big, th->spillsCnt[big], path);
+    FILE* file = fopen(path, "wb");
+    if (NULL == file) {
+      printf("MapV_AggUpdate(): can't write spill file %s\n", path);
+      MapV_Destroy(empty);
+      return false;
+    }
+    const uint64_t bytes = MapV_Serialize(th->parts[big], file);
+    if (0 != fclose(file) || 0 == bytes) {
+      printf("MapV_AggUpdate(): writing spill file %s failed\n", path);
+      unlink(path);
+      MapV_Destroy(empty);
+      return false;
+    }
+    th->spillsCnt[big]++;
+    th->spillsCntAll++;
+    th->spillBytes += bytes;
+
+    MapV_Destroy(th->parts[big]);
+    th->parts[big] = empty;
+  }
+
+  return true;
+}
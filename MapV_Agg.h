@@ -0,0 +1,116 @@
+#ifndef _MapV_MapV_Agg_h_
+#define _MapV_MapV_Agg_h_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "MapV.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+
+//==============================================================================
+//
+// MapV_Agg: group by key, with count/sum/min/max in each key's value
+//
+// - every thread that calls MapV_AggUpdate() has its own partial tables, one
+//   per partition, so updates don't share anything. a partition is a range
+//   of hashes, by the top cfg.partBits bits of high64 (see MapV_Split()),
+//   and its tables are spread over just that range.
+// - keys are hashed MAPV_AGG_BATCH at a time (MapV_HashBatch()), and found
+//   or added with one probe each (MapV_UpsertHash()).
+// - when a thread's tables are over its share of cfg.memBytesMax, its
+//   biggest partition is written to a spill file (MapV_Serialize()) and
+//   started over empty.
+// - MapV_AggMerge() builds a partition's result from every thread's partial
+//   and spill files of it, in one sorted pass over all of them
+//   (MapV_MergeMany()). only that partition is in memory, and different
+//   partitions can be merged by different threads at once.
+//
+//------------------------------------------------------------------------------
+#define MAPV_AGG_BATCH         256 // keys hashed at a time
+#define MAPV_AGG_PART_BITS_MAX 12
+
+typedef enum MapV_AggOp_et {
+  MAPV_AGG_OP__COUNT = 0, // rows per key; deltas are ignored
+  MAPV_AGG_OP__SUM,       // wraps around, so signed deltas add up too
+  MAPV_AGG_OP__MIN,       // unsigned; for signed values, add 2^63
+  MAPV_AGG_OP__MAX,       // "
+} MapV_AggOp_et;
+
+typedef struct MapV_AggCfg_st {
+  MapV_AggOp_et op;
+  uint32_t      threadsCnt;  // MapV_AggUpdate() callers, threadId
+                             // 0..threadsCnt-1 (0: 1)
+  uint32_t      partBits;    // 2^partBits partitions, 0..MAPV_AGG_PART_BITS_MAX
+  uint64_t      memBytesMax; // partial tables, all threads, before spilling
+                             // (0: never spill)
+  const char*   spillDir;    // spill files go in a new directory in here
+                             // (NULL: "/tmp")
+  MapV_Cfg_st   mapCfg;      // for every table: fpBits, seed, tuning.
+                             // initialSlotCount is per partial table. no
+                             // set, multi, cuckoo, cacheBytes, filePath,
+                             // shmName or keyOf; hashLo/hashHi are set
+                             // per partition
+} MapV_AggCfg_st;
+
+typedef struct MapV_AggThread_st {
+  MapV_st** parts;      // [2^partBits]; NULL once merged
+  uint64_t* spillsCnt;  // [2^partBits] spill files per partition
+  uint64_t  rowsCnt;
+  uint64_t  spillsCntAll;
+  uint64_t  spillBytes;
+} MapV_AggThread_st;
+
+typedef struct MapV_Agg_st {
+  MapV_AggCfg_st     cfg;
+  uint64_t           partsCnt;
+  uint64_t           threadBytesMax; // each thread's share of memBytesMax
+  char*              dir;            // spill directory; NULL if never spilling
+  MapV_AggThread_st* threads;        // [cfg.threadsCnt]
+} MapV_Agg_st;
+
+
+
+
+//------------------------------------------------------------------------------
+// NULL if cfg isn't usable, or the tables or spill directory can't be made
+MapV_Agg_st*
+MapV_AggCreate(const MapV_AggCfg_st* cfg);
+
+// add keysCnt rows. keys[i]'s value is updated with deltas[i] (NULL: 1 for
+// every row). threadId is the caller's; no two threads may use the same
+// one at once. returns the first error, with the rows before it added.
+MapV_Err_et
+MapV_AggUpdate(      MapV_Agg_st* agg,
+               const uint32_t     threadId,
+               const void* const* keys,
+               const size_t*      keyLens,
+               const uint64_t*    deltas,
+               const uint64_t     keysCnt);
+
+// partition part's result, once every update is done: a new map, the
+// caller's, over just the partition's hash range. the partition's partial
+// tables and spill files are freed. NULL if a spill can't be read back or
+// memory runs out, or the partition was already merged.
+MapV_st*
+MapV_AggMerge(      MapV_Agg_st* agg,
+              const uint64_t     part);
+
+// frees everything, including partitions that weren't merged, and removes
+// the spill directory
+void
+MapV_AggFree(MapV_Agg_st* agg);
+
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // _MapV_MapV_Agg_h_
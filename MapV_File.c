@@ -0,0 +1,236 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <immintrin.h>
+
+#include "MapV_File.h"
+
+
+
+
+//------------------------------------------------------------------------------
+//
+// static function declarations
+//
+
+static inline uint32_t
+_nl_mask_32(const char* p);
+
+static uint64_t
+_nl_count(const char* data,
+          uint64_t    bytes);
+
+static void
+_line_add(MapV_File_st* file,
+          uint64_t      lineBeg,
+          uint64_t      lineEnd);
+
+static void
+_nl_index(MapV_File_st* file);
+
+
+
+
+//==============================================================================
+//
+// MapV_File*() : Public Functions
+//
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+MapV_File_st*
+MapV_FileOpen(const char* path)
+{
+  MapV_File_st* file = calloc(1, sizeof(*file));
+  if (NULL == file) {
+    return NULL;
+  }
+  file->fd = -1;
+
+  if (-1 == (file->fd = open(path, O_RDONLY))) {
+    printf("MapV_FileOpen(): can't open: %s: %s\n", path, strerror(errno));
+    goto fail;
+  }
+
+  struct stat st;
+  if (-1 == fstat(file->fd, &st)) {
+    printf("MapV_FileOpen(): can't stat: %s: %s\n", path, strerror(errno));
+    goto fail;
+  }
+  file->bytes = st.st_size;
+
+  // an empty file is valid; it just has no lines.
+  // mmap() refuses zero lengths, so skip it.
+  if (file->bytes > 0) {
+    void* data = mmap(NULL, file->bytes, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (MAP_FAILED == data) {
+      printf("MapV_FileOpen(): can't mmap: %s: %s\n", path, strerror(errno));
+      goto fail;
+    }
+    madvise(data, file->bytes, MADV_SEQUENTIAL | MADV_WILLNEED);
+    file->data = data;
+  }
+
+  // one extra for a final line that has no trailing newline
+  const uint64_t linesMax = _nl_count(file->data, file->bytes) + 1;
+  file->lineOffs = malloc(linesMax * sizeof(*file->lineOffs));
+  file->lineLens = malloc(linesMax * sizeof(*file->lineLens));
+  if (NULL == file->lineOffs || NULL == file->lineLens) {
+    printf("MapV_FileOpen(): can't allocate index for %"PRIu64" lines\n",
+           linesMax);
+    goto fail;
+  }
+
+  _nl_index(file);
+
+  return file;
+
+fail:
+  MapV_FileClose(file);
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_FileClose(MapV_File_st* file)
+{
+  if (NULL == file) {
+    return;
+  }
+  if (NULL != file->data) {
+    munmap((void*)file->data, file->bytes);
+  }
+  if (-1 != file->fd) {
+    close(file->fd);
+  }
+  free(file->lineOffs);
+  free(file->lineLens);
+  free(file);
+}
+
+//------------------------------------------------------------------------------
+bool
+MapV_FileLinesToU64(const MapV_File_st* file,
+                          uint64_t*     vals)
+{
+  char buf[32];
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* line = MapV_FileLine(file, i, &len);
+
+    // lines aren't null terminated, so strtoull() needs a copy.
+    // anything this long isn't a u64 anyway.
+    if (len >= sizeof(buf)) {
+      printf("MapV_FileLinesToU64(): line %"PRIu64" is too long\n", i + 1);
+      return false;
+    }
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+
+    char* end;
+    errno   = 0;
+    vals[i] = strtoull(buf, &end, 0);
+    if (0 != errno || end == buf || '\0' != *end) {
+      printf("MapV_FileLinesToU64(): line %"PRIu64" is not a number: %s\n",
+             i + 1, buf);
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+
+//==============================================================================
+//
+// Static Functions
+//
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static inline uint32_t
+_nl_mask_32(const char* p)
+{
+  const __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+  const __m256i found = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'));
+  return (uint32_t)_mm256_movemask_epi8(found);
+}
+
+//------------------------------------------------------------------------------
+static uint64_t
+_nl_count(const char* data,
+          uint64_t    bytes)
+{
+  uint64_t cnt = 0;
+  uint64_t pos = 0;
+  for (; pos + 32 <= bytes; pos += 32) {
+    cnt += __builtin_popcount(_nl_mask_32(data + pos));
+  }
+  for (; pos < bytes; pos++) {
+    cnt += ('\n' == data[pos]);
+  }
+  return cnt;
+}
+
+//------------------------------------------------------------------------------
+static void
+_line_add(MapV_File_st* file,
+          uint64_t      lineBeg,
+          uint64_t      lineEnd)
+{
+  if (lineEnd > lineBeg && '\r' == file->data[lineEnd - 1]) {
+    lineEnd--;
+  }
+  if (lineEnd == lineBeg) {
+    return;
+  }
+  file->lineOffs[file->linesCnt] = lineBeg;
+  file->lineLens[file->linesCnt] = (uint32_t)(lineEnd - lineBeg);
+  file->lineLenSum += lineEnd - lineBeg;
+  file->linesCnt++;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: one movemask per 32 bytes, then walk the set bits.
+//        short-line files (ips, words) have several newlines per chunk,
+//        so this is mostly tzcnt + blsr.
+static void
+_nl_index(MapV_File_st* file)
+{
+  const char*    data    = file->data;
+  const uint64_t bytes   = file->bytes;
+        uint64_t lineBeg = 0;
+        uint64_t pos     = 0;
+
+  for (; pos + 32 <= bytes; pos += 32)
+  {
+    uint32_t mask = _nl_mask_32(data + pos);
+    while (mask) {
+      const uint64_t nl = pos + __builtin_ctz(mask);
+      _line_add(file, lineBeg, nl);
+      lineBeg = nl + 1;
+      mask   &= mask - 1;
+    }
+  }
+  for (; pos < bytes; pos++) {
+    if ('\n' == data[pos]) {
+      _line_add(file, lineBeg, pos);
+      lineBeg = pos + 1;
+    }
+  }
+
+  // final line without a trailing newline
+  if (lineBeg < bytes) {
+    _line_add(file, lineBeg, bytes);
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef _MapV_MapV_File_h_
+#define _MapV_MapV_File_h_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+
+//==============================================================================
+//
+// MapV_File: zero-copy, line-oriented key/value file loader
+//
+// the file is mmap()ed read-only and an offset/length index is built over it
+// with an avx2 newline scan. lines are never copied or terminated; callers
+// get a pointer into the mapping plus a length, which is exactly what
+// MapV_Insert()/MapV_Find() take.
+//
+// - empty lines are skipped (same as the old file_to_str_arr() in the tests)
+// - a trailing '\r' is not part of the line
+// - the last line does not need a trailing newline
+//
+//------------------------------------------------------------------------------
+typedef struct MapV_File_st {
+  const char* data;     // mmap()ed file contents. NOT null terminated
+  uint64_t    bytes;    // file size
+  uint64_t    linesCnt; // number of non-empty lines
+  uint64_t*   lineOffs; // byte offset of each line into .data
+  uint32_t*   lineLens; // byte length of each line, without "\r\n"
+  uint64_t    lineLenSum;
+  int         fd;
+} MapV_File_st;
+
+
+
+
+//------------------------------------------------------------------------------
+MapV_File_st*
+MapV_FileOpen(const char* path);
+
+void
+MapV_FileClose(MapV_File_st* file);
+
+// parse every line as an unsigned integer (base auto-detected, like strtoull)
+// into vals[]. vals must hold file->linesCnt entries.
+// returns false, and prints the offending line, on anything not a number.
+bool
+MapV_FileLinesToU64(const MapV_File_st* file,
+                          uint64_t*     vals);
+
+//------------------------------------------------------------------------------
+static inline const char*
+MapV_FileLine(const MapV_File_st* file,
+              const uint64_t      lineId,
+                    size_t*       len)
+{
+  *len = file->lineLens[lineId];
+  return file->data + file->lineOffs[lineId];
+}
+
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // _MapV_MapV_File_h_
@@ -0,0 +1,332 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "MapV.h"
+#include "MapV_Join.h"
+
+#define MAPV_JOIN_LLC_BYTES  (32 << 20) // when sysconf() doesn't know
+#define MAPV_JOIN_PART_BYTES (1 << 20)  // "
+
+
+
+
+//------------------------------------------------------------------------------
+//
+// static function declarations
+//
+
+static uint64_t
+_cache_size(const int      name,
+            const uint64_t dflt);
+
+static inline uint64_t
+_part_of(const MapV_Join_st* join,
+         const MapV_Hash_st  hash);
+
+static MapV_Cfg_st
+_part_cfg(const MapV_Join_st* join,
+          const uint64_t      part);
+
+static uint64_t*
+_part_offs(const MapV_Join_st* join,
+           const MapV_Hash_st* hashes,
+           const uint64_t      hashesCnt);
+
+static bool
+_build_parts(      MapV_Join_st* join,
+             const MapV_Hash_st* hashes,
+             const MapV_Val_ut*  vals,
+             const uint64_t      hashesCnt);
+
+
+
+
+//==============================================================================
+//
+// MapV_Join*() : Public Functions
+//
+//------------------------------------------------------------------------------
+MapV_Join_st*
+MapV_JoinBuild(const MapV_JoinCfg_st* cfg,
+               const void* const*     keys,
+               const size_t*          keyLens,
+               const MapV_Val_ut*     vals,
+               const uint64_t         keysCnt)
+{
+  const MapV_Cfg_st* mc = &cfg->mapCfg;
+  if (   mc->multi || mc->cuckoo || mc->cacheBytes
+      || NULL != mc->filePath || NULL != mc->shmName) {
+    printf("MapV_JoinBuild(): build tables can't be multimaps, cuckoo, "
+           "caches, file backed or shared\n");
+    return NULL;
+  }
+
+  MapV_Join_st* join = calloc(1, sizeof(*join));
+  if (NULL == join) {
+    printf("MapV_JoinBuild(): out of memory\n");
+    return NULL;
+  }
+  join->cfg          = *cfg;
+  if (0 == join->cfg.llcBytes) {
+    join->cfg.llcBytes = _cache_size(_SC_LEVEL3_CACHE_SIZE, MAPV_JOIN_LLC_BYTES);
+  }
+  if (0 == join->cfg.partBytes) {
+    join->cfg.partBytes = _cache_size(_SC_LEVEL2_CACHE_SIZE, MAPV_JOIN_PART_BYTES);
+  }
+
+  //---------------------------
+  // hashed by a map like the build tables; unpartitioned, it's the table
+  MapV_st*      map    = MapV_Create(mc);
+  MapV_Hash_st* hashes = malloc((keysCnt ? keysCnt : 1) * sizeof(*hashes));
+  if (NULL == map || NULL == hashes) {
+    MapV_Destroy(map);
+    free(hashes);
+    free(join);
+    return NULL;
+  }
+  MapV_HashBatch(map, keys, keyLens, keysCnt, hashes);
+
+  // the one table's size, for every key
+  const uint64_t slotsNeed = (mc->capPctMax > 0)
+                           ? (uint64_t)(keysCnt * 100 / mc->capPctMax) + 1
+                           : keysCnt;
+  const uint64_t bytes     = slotsNeed / MAPV_BKT_SLOTS * map->meta.bktBytes;
+  if (bytes > join->cfg.llcBytes) {
+    while (   join->partBits < MAPV_JOIN_PART_BITS_MAX
+           && (bytes >> join->partBits) > join->cfg.partBytes) {
+      join->partBits++;
+    }
+  }
+  join->partsCnt = (uint64_t)1 << join->partBits;
+  join->parts    = calloc(join->partsCnt, sizeof(*join->parts));
+  if (NULL == join->parts) {
+    printf("MapV_JoinBuild(): out of memory for %"PRIu64" partitions\n",
+           join->partsCnt);
+    MapV_Destroy(map);
+    free(hashes);
+    free(join);
+    return NULL;
+  }
+
+  bool ok;
+  if (0 == join->partBits) {
+    join->parts[0] = map;
+    ok = (MAPV_ERR__OK == MapV_BulkLoad(map, hashes, vals, keysCnt));
+  } else {
+    MapV_Destroy(map);
+    ok = _build_parts(join, hashes, vals, keysCnt);
+  }
+  free(hashes);
+  if (!ok) {
+    printf("MapV_JoinBuild(): loading the build side failed\n");
+    MapV_JoinFree(join);
+    return NULL;
+  }
+
+  for (uint64_t p = 0; p < join->partsCnt; p++) {
+    join->buildCnt += join->parts[p]->meta.slotsUsed;
+    join->tblBytes += join->parts[p]->meta.tblBytes;
+  }
+  return join;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: MapV_FindBatch()/MapV_FindHashBatch() don't touch map->stats, so
+//        this writes only to hits and its own stack and heap.
+uint64_t
+MapV_JoinProbe(const MapV_Join_st*    join,
+               const void* const*     keys,
+               const size_t*          keyLens,
+               const uint64_t         keysCnt,
+               const uint64_t         rowIdBeg,
+                     MapV_JoinHit_st* hits)
+{
+  MapV_Val_ut vals [MAPV_JOIN_BATCH];
+  bool        found[MAPV_JOIN_BATCH];
+  uint64_t    hitsCnt = 0;
+
+  if (0 == join->partBits)
+  {
+    for (uint64_t beg = 0; beg < keysCnt; beg += MAPV_JOIN_BATCH)
+    {
+      const uint64_t n = (keysCnt - beg < MAPV_JOIN_BATCH)
+                       ? keysCnt - beg : MAPV_JOIN_BATCH;
+      MapV_FindBatch(join->parts[0], keys + beg, keyLens + beg, n, vals, found);
+      for (uint64_t i = 0; i < n; i++) {
+        if (found[i]) {
+          hits[hitsCnt++] = (MapV_JoinHit_st){ rowIdBeg + beg + i, vals[i] };
+        }
+      }
+    }
+    return hitsCnt;
+  }
+
+  //---------------------------
+  // partitioned: hash every row, split them by partition, then probe one
+  // partition's rows at a time
+  MapV_Hash_st* hashes  = malloc((keysCnt ? keysCnt : 1) * sizeof(*hashes));
+  MapV_Hash_st* pHashes = malloc((keysCnt ? keysCnt : 1) * sizeof(*pHashes));
+  uint64_t*     pRows   = malloc((keysCnt ? keysCnt : 1) * sizeof(*pRows));
+  uint64_t*     offs    = NULL;
+  if (NULL != hashes) {
+    MapV_HashBatch(join->parts[0], keys, keyLens, keysCnt, hashes);
+    offs = _part_offs(join, hashes, keysCnt);
+  }
+  if (NULL == offs || NULL == pHashes || NULL == pRows) {
+    printf("MapV_JoinProbe(): out of memory for %"PRIu64" rows\n", keysCnt);
+    free(hashes);
+    free(pHashes);
+    free(pRows);
+    free(offs);
+    return 0;
+  }
+
+  for (uint64_t i = 0; i < keysCnt; i++) {
+    const uint64_t at = offs[_part_of(join, hashes[i])]++;
+    pHashes[at] = hashes[i];
+    pRows[at]   = i;
+  }
+  free(hashes);
+
+  // offs[p] is now partition p's end
+  uint64_t beg = 0;
+  for (uint64_t p = 0; p < join->partsCnt; p++)
+  {
+    for (; beg < offs[p]; beg += MAPV_JOIN_BATCH)
+    {
+      const uint64_t n = (offs[p] - beg < MAPV_JOIN_BATCH)
+                       ? offs[p] - beg : MAPV_JOIN_BATCH;
+      MapV_FindHashBatch(join->parts[p], pHashes + beg, n, vals, found);
+      for (uint64_t i = 0; i < n; i++) {
+        if (found[i]) {
+          hits[hitsCnt++] = (MapV_JoinHit_st){ rowIdBeg + pRows[beg + i], vals[i] };
+        }
+      }
+    }
+    beg = offs[p];
+  }
+
+  free(offs);
+  free(pHashes);
+  free(pRows);
+  return hitsCnt;
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_JoinFree(MapV_Join_st* join)
+{
+  if (NULL == join) {
+    return;
+  }
+  for (uint64_t p = 0; NULL != join->parts && p < join->partsCnt; p++) {
+    if (NULL != join->parts[p]) {
+      MapV_Destroy(join->parts[p]);
+    }
+  }
+  free(join->parts);
+  free(join);
+}
+
+
+
+
+//==============================================================================
+//
+// Static Functions
+//
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static uint64_t
+_cache_size(const int      name,
+            const uint64_t dflt)
+{
+  const long bytes = sysconf(name);
+  return (bytes > 0) ? (uint64_t)bytes : dflt;
+}
+
+//------------------------------------------------------------------------------
+static inline uint64_t
+_part_of(const MapV_Join_st* join,
+         const MapV_Hash_st  hash)
+{
+  return join->partBits ? (hash.high64 >> (64 - join->partBits)) : 0;
+}
+
+//------------------------------------------------------------------------------
+// partition part covers the high64s whose top partBits bits are part
+static MapV_Cfg_st
+_part_cfg(const MapV_Join_st* join,
+          const uint64_t      part)
+{
+  const uint32_t bits = join->partBits;
+  MapV_Cfg_st    cfg  = join->cfg.mapCfg;
+  cfg.hashLo           = part << (64 - bits);
+  cfg.hashHi           = cfg.hashLo | (UINT64_MAX >> bits);
+  cfg.initialSlotCount = (cfg.initialSlotCount >> bits) + MAPV_BKT_SLOTS;
+  return cfg;
+}
+
+//------------------------------------------------------------------------------
+// where each partition's hashes start, once they're grouped by partition.
+// NULL if out of memory.
+static uint64_t*
+_part_offs(const MapV_Join_st* join,
+           const MapV_Hash_st* hashes,
+           const uint64_t      hashesCnt)
+{
+  uint64_t* offs = calloc(join->partsCnt + 1, sizeof(*offs));
+  if (NULL == offs) {
+    return NULL;
+  }
+  for (uint64_t i = 0; i < hashesCnt; i++) {
+    offs[_part_of(join, hashes[i]) + 1]++;
+  }
+  for (uint64_t p = 1; p <= join->partsCnt; p++) {
+    offs[p] += offs[p - 1];
+  }
+  return offs;
+}
+
+//------------------------------------------------------------------------------
+// group the build side by partition, keeping its order (so the last of a
+// repeated key still wins), and bulk load each partition's table
+static bool
+_build_parts(      MapV_Join_st* join,
+             const MapV_Hash_st* hashes,
+             const MapV_Val_ut*  vals,
+             const uint64_t      hashesCnt)
+{
+  uint64_t*     offs    = _part_offs(join, hashes, hashesCnt);
+  MapV_Hash_st* pHashes = malloc((hashesCnt ? hashesCnt : 1) * sizeof(*pHashes));
+  MapV_Val_ut*  pVals   = malloc((hashesCnt ? hashesCnt : 1) * sizeof(*pVals));
+  bool          ok      = (NULL != offs && NULL != pHashes && NULL != pVals);
+
+  for (uint64_t i = 0; ok && i < hashesCnt; i++) {
+    const uint64_t at = offs[_part_of(join, hashes[i])]++;
+    pHashes[at] = hashes[i];
+    pVals[at]   = (NULL != vals) ? vals[i] : (MapV_Val_ut){0};
+  }
+
+  // offs[p] is now partition p's end
+  uint64_t beg = 0;
+  for (uint64_t p = 0; ok && p < join->partsCnt; p++)
+  {
+    const MapV_Cfg_st pc = _part_cfg(join, p);
+    ok = (   NULL != (join->parts[p] = MapV_Create(&pc))
+          && MAPV_ERR__OK == MapV_BulkLoad(join->parts[p], pHashes + beg,
+                                           pVals + beg, offs[p] - beg));
+    beg = offs[p];
+  }
+
+  free(offs);
+  free(pHashes);
+  free(pVals);
+  return ok;
+}
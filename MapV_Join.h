@@ -0,0 +1,100 @@
+#ifndef _MapV_MapV_Join_h_
+#define _MapV_MapV_Join_h_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "MapV.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+
+//==============================================================================
+//
+// MapV_Join: hash join of a stream of probe rows against a build side
+//
+// - the build side's keys are hashed (MapV_HashBatch()) and bulk loaded
+//   (MapV_BulkLoad()): sorted by hash and written front to back, with no
+//   probing.
+// - probing hashes rows in groups, prefetches every group's buckets, then
+//   looks them up (MapV_FindBatch()). each row found is a hit: its row id
+//   and the build side's value. nothing in the join is written to, so any
+//   number of threads can probe it at once.
+// - partitioned (radix) mode, for build tables bigger than cfg.llcBytes:
+//   the build side is split by the top bits of high64 into tables of about
+//   cfg.partBytes, each over its own hash range. a probe call hashes all of
+//   its rows, splits them the same way, then probes one partition's rows at
+//   a time, while that partition's table is in cache. it pays off with many
+//   rows per call: a call's rows are held twice over while it runs, and each
+//   partition's table is read in from memory once per call.
+//
+//------------------------------------------------------------------------------
+#define MAPV_JOIN_BATCH         256 // rows hashed and probed at a time
+#define MAPV_JOIN_PART_BITS_MAX 10
+
+typedef struct MapV_JoinCfg_st {
+  uint64_t    llcBytes;  // partition build tables bigger than this
+                         // (0: the L3 cache's size; UINT64_MAX: never)
+  uint64_t    partBytes; // partitioned: table bytes per partition, about
+                         // (0: the L2 cache's size)
+  MapV_Cfg_st mapCfg;    // for the build tables. no multi, cuckoo,
+                         // cacheBytes, filePath or shmName
+} MapV_JoinCfg_st;
+
+typedef struct MapV_JoinHit_st {
+  uint64_t    probeRowId;
+  MapV_Val_ut val;
+} MapV_JoinHit_st;
+
+typedef struct MapV_Join_st {
+  MapV_JoinCfg_st cfg;
+  uint32_t        partBits;  // 0: not partitioned
+  uint64_t        partsCnt;
+  MapV_st**       parts;     // [partsCnt]
+  uint64_t        buildCnt;  // distinct build keys
+  uint64_t        tblBytes;  // all partitions'
+} MapV_Join_st;
+
+
+
+
+//------------------------------------------------------------------------------
+// build the join from keysCnt keys, vals[i] for keys[i] (NULL: 0s). a key
+// given more than once keeps its last value. NULL if cfg isn't usable or
+// memory runs out.
+MapV_Join_st*
+MapV_JoinBuild(const MapV_JoinCfg_st* cfg,
+               const void* const*     keys,
+               const size_t*          keyLens,
+               const MapV_Val_ut*     vals,
+               const uint64_t         keysCnt);
+
+// probe with keysCnt rows, whose row ids are rowIdBeg on. a hit for each
+// row whose key is in the build side goes into hits, which must hold
+// keysCnt. returns the number of hits (0 if out of memory). unpartitioned,
+// they're in row order. partitioned, they're grouped by partition, in row
+// order within each: not in row order overall, so sort by probeRowId if
+// that matters.
+uint64_t
+MapV_JoinProbe(const MapV_Join_st*    join,
+               const void* const*     keys,
+               const size_t*          keyLens,
+               const uint64_t         keysCnt,
+               const uint64_t         rowIdBeg,
+                     MapV_JoinHit_st* hits);
+
+void
+MapV_JoinFree(MapV_Join_st* join);
+
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // _MapV_MapV_Join_h_
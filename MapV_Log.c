@@ -0,0 +1,614 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <xxhash.h>
+
+#include "MapV.h"
+#include "MapV_Log.h"
+
+#define MAPV_LOG_GROUP_OPS 1024
+#define MAPV_LOG_GROUP_US  1000
+#define MAPV_LOG_READ_RECS 4096 // records per read() when recovering
+
+
+
+
+//------------------------------------------------------------------------------
+//
+// static function declarations
+//
+
+static uint64_t
+_now_ns(void);
+
+static void
+_path_ckpt(const MapV_LogCfg_st* cfg,
+                 char*           path);
+
+static void
+_path_seg(const MapV_LogCfg_st* cfg,
+          const uint64_t        seq,
+                char*           path);
+
+static bool
+_seg_exists(const MapV_LogCfg_st* cfg,
+            const uint64_t        seq);
+
+static bool
+_ckpt_hdr_read(const MapV_LogCfg_st*     cfg,
+                     MapV_LogCkptHdr_st* hdr,
+                     FILE**              fileOut);
+
+static bool
+_ckpt_write(const MapV_LogCfg_st* cfg,
+            const MapV_st*        map,
+            const uint64_t        logSeq);
+
+static bool
+_ckpt_poll(MapV_Log_st* log,
+           bool         block);
+
+static uint64_t
+_seg_replay(MapV_st* map,
+            int      fd);
+
+static bool
+_seg_open(MapV_Log_st* log);
+
+static bool
+_write_all(int         fd,
+           const void* buf,
+           size_t      len);
+
+static bool
+_commit(MapV_Log_st* log);
+
+static void
+_append(MapV_Log_st*       log,
+        MapV_LogOp_et      op,
+        const MapV_Hash_st hash,
+        const MapV_Val_ut  val);
+
+static void
+_on_insert(void* ctx, MapV_Hash_st hash, MapV_Val_ut val);
+
+static void
+_on_delete(void* ctx, MapV_Hash_st hash);
+
+
+
+
+//==============================================================================
+//
+// MapV_Log*() : Public Functions
+//
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+MapV_st*
+MapV_LogRecover(const MapV_LogCfg_st* cfg,
+                const MapV_Cfg_st*    mapCfg)
+{
+  MapV_Cfg_st        c    = *mapCfg;
+  MapV_LogCkptHdr_st hdr  = {0};
+  FILE*              file = NULL;
+
+  if (!_ckpt_hdr_read(cfg, &hdr, &file)) {
+    return NULL;
+  }
+  if (NULL != file) {
+    const uint32_t fpBits = c.fpBits ? c.fpBits : 128;
+    if (hdr.fpBits != fpBits || hdr.set != c.set || hdr.seed != c.seed) {
+      printf("MapV_LogRecover(): checkpoint is fpBits %"PRIu32", set %"PRIu32
+             ", seed %016"PRIx64"; map is fpBits %"PRIu32", set %d, seed %016"
+             PRIx64"\n", hdr.fpBits, hdr.set, hdr.seed, fpBits, c.set, c.seed);
+      fclose(file);
+      return NULL;
+    }
+    // size for the checkpoint up front; the log usually adds little
+    if (c.capPctMax > 0) {
+      c.initialSlotCount = hdr.entsCnt * 100 / c.capPctMax + 1;
+    }
+  }
+
+  MapV_st* map;
+  if (NULL == (map = MapV_Create(&c))) {
+    if (NULL != file) {
+      fclose(file);
+    }
+    return NULL;
+  }
+
+  //---------------------------
+  // checkpoint entries are in slot order: every insert lands past the last
+  if (NULL != file) {
+    for (uint64_t i = 0; i < hdr.entsCnt; i++)
+    {
+      uint64_t ent[3]; // hi, lo, val
+      if (1 != fread(ent, sizeof(ent), 1, file)) {
+        printf("MapV_LogRecover(): checkpoint is short: %"PRIu64" of %"PRIu64
+               " entries\n", i, hdr.entsCnt);
+        fclose(file);
+        MapV_Destroy(map);
+        return NULL;
+      }
+      const MapV_Hash_st hash = { .high64 = ent[0], .low64 = ent[1], };
+      if (MAPV_ERR__OK != MapV_InsertHash(map, hash,
+                                          (MapV_Val_ut){ .u64 = ent[2] }, true)) {
+        fclose(file);
+        MapV_Destroy(map);
+        return NULL;
+      }
+    }
+    fclose(file);
+  }
+
+  //---------------------------
+  for (uint64_t seq = hdr.logSeq; ; seq++)
+  {
+    char path[PATH_MAX];
+    _path_seg(cfg, seq, path);
+    const int fd = open(path, O_RDONLY);
+    if (-1 == fd) {
+      break;
+    }
+    _seg_replay(map, fd);
+    close(fd);
+  }
+
+  return map;
+}
+
+//------------------------------------------------------------------------------
+MapV_Log_st*
+MapV_LogOpen(const MapV_LogCfg_st* cfg,
+                   MapV_st*        map)
+{
+  if (map->cfg.multi) {
+    printf("MapV_LogOpen(): multimaps can't be logged\n");
+    return NULL;
+  }
+  if (NULL != map->tbl.path || NULL != map->shm.hdr) {
+    // a MAP_SHARED table isn't copied on write by the checkpoint's fork()
+    printf("MapV_LogOpen(): file backed and shared memory maps can't be "
+           "logged\n");
+    return NULL;
+  }
+
+  MapV_LogCkptHdr_st hdr  = {0};
+  FILE*              file = NULL;
+  if (!_ckpt_hdr_read(cfg, &hdr, &file)) {
+    return NULL;
+  }
+  if (NULL != file) {
+    fclose(file);
+  }
+
+  MapV_Log_st* log = calloc(1, sizeof(*log));
+  if (NULL == log) {
+    return NULL;
+  }
+  log->cfg = *cfg;
+  if (0 == log->cfg.groupOps) {
+    log->cfg.groupOps = MAPV_LOG_GROUP_OPS;
+  }
+  if (0 == log->cfg.groupUs) {
+    log->cfg.groupUs = MAPV_LOG_GROUP_US;
+  }
+  log->map      = map;
+  log->fd       = -1;
+  log->seqFirst = hdr.logSeq;
+
+  // segments left behind by a checkpoint that finished, but whose old
+  // segments weren't all unlinked yet
+  for (uint64_t seq = hdr.logSeq; seq > 0 && _seg_exists(cfg, seq - 1); seq--) {
+    char path[PATH_MAX];
+    _path_seg(cfg, seq - 1, path);
+    unlink(path);
+  }
+
+  // never append to an existing segment; it may end in a torn record
+  log->seq = hdr.logSeq;
+  while (_seg_exists(cfg, log->seq)) {
+    log->seq++;
+  }
+
+  if (   NULL == (log->buf = malloc(log->cfg.groupOps * sizeof(*log->buf)))
+      || !_seg_open(log)) {
+    free(log->buf);
+    free(log);
+    return NULL;
+  }
+
+  map->hook = (MapV_Hook_st){
+    .onInsert = _on_insert,
+    .onDelete = _on_delete,
+    .ctx      = log,
+  };
+  return log;
+}
+
+//------------------------------------------------------------------------------
+bool
+MapV_LogSync(MapV_Log_st* log)
+{
+  if (log->bufCnt > 0) {
+    _commit(log);
+  }
+  return !log->failed;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: everything before the fork() goes into the current segment, which
+//        is synced and closed; everything after goes into the new one.
+//        so the checkpoint is exactly "every segment before .ckptSeq".
+bool
+MapV_LogCheckpoint(MapV_Log_st* log)
+{
+  if (0 != log->ckptPid) {
+    _ckpt_poll(log, false);
+    if (0 != log->ckptPid) {
+      return false;
+    }
+  }
+  if (!MapV_LogSync(log)) {
+    return false;
+  }
+
+  close(log->fd);
+  log->seq++;
+  if (!_seg_open(log)) {
+    return false;
+  }
+  log->opsSinceCkpt = 0;
+
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (-1 == pid) {
+    printf("MapV_LogCheckpoint(): fork() failed: %s\n", strerror(errno));
+    return false;
+  }
+  if (0 == pid) {
+    _exit(_ckpt_write(&log->cfg, log->map, log->seq) ? 0 : 1);
+  }
+
+  log->ckptPid = pid;
+  log->ckptSeq = log->seq;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool
+MapV_LogCheckpointWait(MapV_Log_st* log)
+{
+  if (0 == log->ckptPid) {
+    return true;
+  }
+  return _ckpt_poll(log, true);
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_LogClose(MapV_Log_st* log)
+{
+  if (NULL == log) {
+    return;
+  }
+  MapV_LogSync(log);
+  MapV_LogCheckpointWait(log);
+  close(log->fd);
+  log->map->hook = (MapV_Hook_st){0};
+  free(log->buf);
+  free(log);
+}
+
+
+
+
+//==============================================================================
+//
+// Static Functions
+//
+//==============================================================================
+
+//------------------------------------------------------------------------------
+static uint64_t
+_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static void
+_path_ckpt(const MapV_LogCfg_st* cfg,
+                 char*           path)
+{
+  snprintf(path, PATH_MAX, "%s.ckpt", cfg->path);
+}
+
+//------------------------------------------------------------------------------
+static void
+_path_seg(const MapV_LogCfg_st* cfg,
+          const uint64_t        seq,
+                char*           path)
+{
+  snprintf(path, PATH_MAX, "%s.log.%"PRIu64, cfg->path, seq);
+}
+
+//------------------------------------------------------------------------------
+static bool
+_seg_exists(const MapV_LogCfg_st* cfg,
+            const uint64_t        seq)
+{
+  char path[PATH_MAX];
+  _path_seg(cfg, seq, path);
+  return 0 == access(path, F_OK);
+}
+
+//------------------------------------------------------------------------------
+// no checkpoint isn't an error: *hdr is left zeroed and *fileOut NULL.
+// otherwise *fileOut is left positioned at the first entry.
+static bool
+_ckpt_hdr_read(const MapV_LogCfg_st*     cfg,
+                     MapV_LogCkptHdr_st* hdr,
+                     FILE**              fileOut)
+{
+  char path[PATH_MAX];
+  _path_ckpt(cfg, path);
+
+  *fileOut = NULL;
+  FILE* file = fopen(path, "rb");
+  if (NULL == file) {
+    if (ENOENT == errno) {
+      return true;
+    }
+    printf("MapV_Log: can't open %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  if (   1 != fread(hdr, sizeof(*hdr), 1, file)
+      || MAPV_LOG_MAGIC_CKPT != hdr->magic
+      || MAPV_LOG_VERSION    != hdr->version) {
+    printf("MapV_Log: %s is not a checkpoint\n", path);
+    fclose(file);
+    return false;
+  }
+  *fileOut = file;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// runs in the forked child. writes to .tmp, then renames over the old
+// checkpoint, so a crash part way through leaves the old one in place.
+static bool
+_ckpt_write(const MapV_LogCfg_st* cfg,
+            const MapV_st*        map,
+            const uint64_t        logSeq)
+{
+  char path[PATH_MAX];
+  char pathTmp[PATH_MAX + 8];
+  _path_ckpt(cfg, path);
+  snprintf(pathTmp, sizeof(pathTmp), "%s.tmp", path);
+
+  FILE* file = fopen(pathTmp, "wb");
+  if (NULL == file) {
+    fprintf(stderr, "MapV_Log: can't create %s: %s\n", pathTmp, strerror(errno));
+    return false;
+  }
+
+  const MapV_LogCkptHdr_st hdr = {
+    .magic   = MAPV_LOG_MAGIC_CKPT,
+    .version = MAPV_LOG_VERSION,
+    .fpBits  = map->cfg.fpBits,
+    .set     = map->cfg.set,
+    .seed    = map->meta.seed,
+    .logSeq  = logSeq,
+    .entsCnt = map->meta.slotsUsed,
+  };
+  bool ok = (1 == fwrite(&hdr, sizeof(hdr), 1, file));
+
+  MapV_SlotId_t slotId = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  while (ok && MapV_Next(map, &slotId, &hash, &val)) {
+    const uint64_t ent[3] = { hash.high64, hash.low64, val.u64, };
+    ok = (1 == fwrite(ent, sizeof(ent), 1, file));
+  }
+
+  ok = ok && (0 == fflush(file)) && (0 == fsync(fileno(file)));
+  ok = (0 == fclose(file)) && ok;
+  ok = ok && (0 == rename(pathTmp, path));
+  if (!ok) {
+    fprintf(stderr, "MapV_Log: writing %s failed: %s\n", path, strerror(errno));
+    unlink(pathTmp);
+  }
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+static bool
+_ckpt_poll(MapV_Log_st* log,
+           bool         block)
+{
+  int         status;
+  const pid_t pid = waitpid(log->ckptPid, &status, block ? 0 : WNOHANG);
+  if (0 == pid) {
+    return true; // still running
+  }
+  log->ckptPid = 0;
+
+  if (-1 == pid || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+    printf("MapV_Log: checkpoint failed; keeping log segments\n");
+    return false;
+  }
+
+  for (; log->seqFirst < log->ckptSeq; log->seqFirst++) {
+    char path[PATH_MAX];
+    _path_seg(&log->cfg, log->seqFirst, path);
+    unlink(path);
+  }
+  log->ckptsCnt++;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// returns the number of records applied. stops at the end of the segment,
+// or at a torn/corrupt record, which can only be the last one written
+// before a crash.
+static uint64_t
+_seg_replay(MapV_st* map,
+            int      fd)
+{
+  MapV_LogRec_st* recs = malloc(MAPV_LOG_READ_RECS * sizeof(*recs));
+  uint64_t        done = 0;
+
+  for (;;)
+  {
+    ssize_t n = read(fd, recs, MAPV_LOG_READ_RECS * sizeof(*recs));
+    if (n < 0 && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    const uint64_t cnt = n / sizeof(*recs);
+    for (uint64_t i = 0; i < cnt; i++)
+    {
+      const MapV_LogRec_st* rec = &recs[i];
+      if (rec->check != XXH32(rec, offsetof(MapV_LogRec_st, check), 0)) {
+        goto done;
+      }
+      const MapV_Hash_st hash = { .high64 = rec->hi, .low64 = rec->lo, };
+      switch (rec->op) {
+        case MAPV_LOG_OP__INSERT: MapV_InsertHash(map, hash, rec->val, true); break;
+        case MAPV_LOG_OP__DELETE: MapV_DeleteHash(map, hash);                 break;
+        default                 : goto done;
+      }
+      done++;
+    }
+    if (n % sizeof(*recs)) {
+      break; // torn record at the end
+    }
+  }
+
+done:
+  free(recs);
+  return done;
+}
+
+//------------------------------------------------------------------------------
+static bool
+_seg_open(MapV_Log_st* log)
+{
+  char path[PATH_MAX];
+  _path_seg(&log->cfg, log->seq, path);
+  log->fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0644);
+  if (-1 == log->fd) {
+    printf("MapV_Log: can't create %s: %s\n", path, strerror(errno));
+    log->failed = true;
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static bool
+_write_all(int         fd,
+           const void* buf,
+           size_t      len)
+{
+  const char* p = buf;
+  while (len > 0) {
+    const ssize_t n = write(fd, p, len);
+    if (n < 0 && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p   += n;
+    len -= n;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// one write() and one fdatasync() for the whole group
+static bool
+_commit(MapV_Log_st* log)
+{
+  if (   !_write_all(log->fd, log->buf, log->bufCnt * sizeof(*log->buf))
+      || 0 != fdatasync(log->fd)) {
+    printf("MapV_Log: write failed: %s. logging stopped\n", strerror(errno));
+    log->failed = true;
+  }
+  log->bufCnt = 0;
+  log->syncsCnt++;
+
+  // a good time to notice a finished checkpoint; we've just paid a syscall
+  if (0 != log->ckptPid) {
+    _ckpt_poll(log, false);
+  }
+  return !log->failed;
+}
+
+//------------------------------------------------------------------------------
+static void
+_append(MapV_Log_st*       log,
+        MapV_LogOp_et      op,
+        const MapV_Hash_st hash,
+        const MapV_Val_ut  val)
+{
+  if (log->failed) {
+    return;
+  }
+
+  MapV_LogRec_st* rec = &log->buf[log->bufCnt++];
+  rec->hi    = hash.high64;
+  rec->lo    = hash.low64;
+  rec->val   = val;
+  rec->op    = op;
+  rec->check = XXH32(rec, offsetof(MapV_LogRec_st, check), 0);
+  log->recsCnt++;
+
+  const uint64_t now = _now_ns();
+  if (1 == log->bufCnt) {
+    log->bufBegNs = now;
+  }
+  if (   log->bufCnt == log->cfg.groupOps
+      || now - log->bufBegNs >= (uint64_t)log->cfg.groupUs * 1000) {
+    _commit(log);
+  }
+
+  // a checkpoint still running is noticed at the next commit
+  if (   log->cfg.ckptOps && ++log->opsSinceCkpt >= log->cfg.ckptOps
+      && 0 == log->ckptPid) {
+    MapV_LogCheckpoint(log);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+_on_insert(void* ctx, MapV_Hash_st hash, MapV_Val_ut val)
+{
+  _append(ctx, MAPV_LOG_OP__INSERT, hash, val);
+}
+
+//------------------------------------------------------------------------------
+static void
+_on_delete(void* ctx, MapV_Hash_st hash)
+{
+  _append(ctx, MAPV_LOG_OP__DELETE, hash, (MapV_Val_ut){0});
+}
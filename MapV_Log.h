@@ -0,0 +1,138 @@
+#ifndef _MapV_MapV_Log_h_
+#define _MapV_MapV_Log_h_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "MapV.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+
+//==============================================================================
+//
+// MapV_Log: write-ahead change log + background checkpoints
+//
+// files, for cfg.path = "/data/urls":
+//   /data/urls.ckpt       every entry, as of the start of log segment .logSeq
+//   /data/urls.log.<seq>  inserts/deletes since, one segment per checkpoint
+//
+// - records hold the stored hash and value, never the key, so every record
+//   is the same 32 bytes, and replaying one doesn't hash anything.
+// - group commit: records are buffered, then written and fdatasync()ed once
+//   per cfg.groupOps records or cfg.groupUs microseconds, whichever is first.
+//   a change is durable once MapV_LogSync() returns, or once its group has
+//   been committed. call MapV_LogSync() when going idle.
+// - checkpoints fork(): the child writes the map out while the parent keeps
+//   going (the kernel copies pages on write). the parent moves on to a new
+//   log segment first, so the checkpoint plus the segments from .logSeq on
+//   are always the whole map. old segments are unlinked once the child is
+//   done. don't checkpoint from a process with other threads running.
+// - recovery loads the checkpoint in slot order, so nothing is shifted, then
+//   replays each segment, stopping at the first torn/corrupt record.
+// - multimaps, file backed maps (cfg.filePath) and shared memory maps
+//   (cfg.shmName) aren't supported: the last two's tables are shared with
+//   the checkpoint's child, not copied.
+//   MapV_Upsert() writes through the returned pointer aren't logged
+//   (MapV_UpsertAdd() is).
+//
+//------------------------------------------------------------------------------
+#define MAPV_LOG_MAGIC_CKPT 0x4b43564d // "MVCK"
+#define MAPV_LOG_VERSION    2
+
+typedef enum MapV_LogOp_et {
+  MAPV_LOG_OP__INSERT = 1,
+  MAPV_LOG_OP__DELETE = 2,
+} MapV_LogOp_et;
+
+typedef struct MapV_LogRec_st {
+  MapV_HashHi_t hi;
+  MapV_HashLo_t lo;
+  MapV_Val_ut   val;
+  uint32_t      op;
+  uint32_t      check; // XXH32 of the 28 bytes before it
+} MapV_LogRec_st;
+
+typedef struct MapV_LogCkptHdr_st {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t fpBits;
+  uint32_t set;
+  uint64_t seed;     // the map's; its hashes are only good under it
+  uint64_t logSeq;   // first log segment that isn't in this checkpoint
+  uint64_t entsCnt;  // followed by entsCnt x { hi, lo, val }
+} MapV_LogCkptHdr_st;
+
+typedef struct MapV_LogCfg_st {
+  const char* path;     // file name prefix. see above
+  uint32_t    groupOps; // commit every n records       (0: 1024)
+  uint32_t    groupUs;  // ...or every n microseconds   (0: 1000)
+  uint64_t    ckptOps;  // checkpoint every n records   (0: only when asked)
+} MapV_LogCfg_st;
+
+typedef struct MapV_Log_st {
+  MapV_LogCfg_st  cfg;
+  MapV_st*        map;
+  int             fd;         // current segment
+  uint64_t        seq;        // current segment
+  uint64_t        seqFirst;   // oldest segment still on disk
+  MapV_LogRec_st* buf;        // [cfg.groupOps]
+  uint32_t        bufCnt;
+  uint64_t        bufBegNs;   // when the oldest buffered record was added
+  uint64_t        opsSinceCkpt;
+  pid_t           ckptPid;    // 0 when no checkpoint is being written
+  uint64_t        ckptSeq;    // .logSeq of the checkpoint being written
+  uint64_t        recsCnt;
+  uint64_t        syncsCnt;
+  uint64_t        ckptsCnt;
+  bool            failed;     // a write failed; nothing more is logged
+} MapV_Log_st;
+
+
+
+
+//------------------------------------------------------------------------------
+// load cfg.path's checkpoint, if any, and replay its log segments.
+// mapCfg gives the table tuning for the new map; its .set/.fpBits/.seed must
+// match the checkpoint's. returns an empty map when there's nothing on disk.
+MapV_st*
+MapV_LogRecover(const MapV_LogCfg_st* cfg,
+                const MapV_Cfg_st*    mapCfg);
+
+// start a new log segment and hook it up to map, so every later change is
+// logged. map must already hold everything on disk (ie: MapV_LogRecover()).
+MapV_Log_st*
+MapV_LogOpen(const MapV_LogCfg_st* cfg,
+                   MapV_st*        map);
+
+// commit everything buffered
+bool
+MapV_LogSync(MapV_Log_st* log);
+
+// start writing a checkpoint in the background.
+// false if one is already running, or it couldn't be started.
+bool
+MapV_LogCheckpoint(MapV_Log_st* log);
+
+// wait for a running checkpoint, and drop the segments it replaces.
+// true if there was nothing to wait for, or it succeeded.
+bool
+MapV_LogCheckpointWait(MapV_Log_st* log);
+
+// sync, wait for any checkpoint, and unhook the map
+void
+MapV_LogClose(MapV_Log_st* log);
+
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // _MapV_MapV_Log_h_
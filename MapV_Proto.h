@@ -0,0 +1,79 @@
+#ifndef _MapV_MapV_Proto_h_
+#define _MapV_MapV_Proto_h_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+
+
+
+//==============================================================================
+//
+// mapv-server wire protocol
+//
+// little endian, native struct layout; this is for a unix domain socket,
+// so both ends are always on the same host.
+//
+// a client may write any number of requests without waiting (pipelining).
+// the server answers every request, in the order they were received.
+// reqId is opaque to the server and copied into the response.
+//
+// request:
+//   MapV_ProtoReq_st
+//   uint16_t keyLens[keysCnt]
+//   uint8_t  keyBytes[sum(keyLens)]
+//
+// response:
+//   MapV_ProtoRes_st
+//   uint64_t vals [keysCnt]     // 0 when not found
+//   uint8_t  found[keysCnt]     // 1 / 0
+//   (padded to a multiple of 8 bytes)
+//
+//------------------------------------------------------------------------------
+#define MAPV_PROTO_MAGIC_REQ   0x5152564d // "MVRQ"
+#define MAPV_PROTO_MAGIC_RES   0x5352564d // "MVRS"
+#define MAPV_PROTO_KEYS_MAX    65536
+#define MAPV_PROTO_BYTES_MAX   (64 * 1024 * 1024)
+
+
+//------------------------------------------------------------------------------
+typedef struct MapV_ProtoReq_st {
+  uint32_t magic;
+  uint32_t bytes;   // whole frame, including this header
+  uint32_t reqId;
+  uint32_t keysCnt;
+} MapV_ProtoReq_st;
+
+typedef struct MapV_ProtoRes_st {
+  uint32_t magic;
+  uint32_t bytes;   // whole frame, including this header
+  uint32_t reqId;
+  uint32_t keysCnt;
+  uint32_t hits;
+  uint32_t err;     // 0, or a MAPV_PROTO_ERR__* value; no vals/found follow
+} MapV_ProtoRes_st;
+
+typedef enum MapV_ProtoErr_et {
+  MAPV_PROTO_ERR__OK,
+  MAPV_PROTO_ERR__BAD_FRAME,
+} MapV_ProtoErr_et;
+
+
+//------------------------------------------------------------------------------
+static inline uint64_t
+MapV_ProtoPad8(uint64_t bytes)
+{
+  return (bytes + 7) & ~(uint64_t)7;
+}
+
+static inline uint64_t
+MapV_ProtoResBytes(uint32_t keysCnt)
+{
+  return MapV_ProtoPad8(sizeof(MapV_ProtoRes_st)
+                        + (uint64_t)keysCnt * sizeof(uint64_t)
+                        + keysCnt);
+}
+
+
+
+#endif // _MapV_MapV_Proto_h_
@@ -0,0 +1,415 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <immintrin.h>
+#include <x86intrin.h>
+
+#include "MapV.h"
+#include "MapV_Tune.h"
+
+#define MAPV_TUNE_LOOKUPS_MIN 200000 // lookups per point, for finds per second
+#define MAPV_TUNE_LAT_ROUNDS  3      // timed passes per point; the best is kept
+
+// the grid. every combination is measured.
+static const MapV_Dist_t _distSlotMaxes[] = { 8, 16, 32, 64 };
+static const MapV_Dist_t _distBktMaxes[]  = { 2, 4, 8, 16 };
+static const double      _capPctMaxes[]   = { 50, 70, 80, 90, 95, 98 };
+
+#define _GRID_CNT(arr) (sizeof(arr) / sizeof(arr[0]))
+
+
+
+
+//------------------------------------------------------------------------------
+//
+// static function declarations
+//
+
+typedef struct _Lookups_st _Lookups_st;
+
+static double
+_now_sec(void);
+
+static double
+_tsc_per_ns(void);
+
+static uint64_t
+_tsc_overhead(void);
+
+static bool
+_lookups_init(      _Lookups_st*     lk,
+              const MapV_TuneCfg_st* cfg);
+
+static void
+_lookups_free(_Lookups_st* lk);
+
+static bool
+_point_measure(const MapV_TuneCfg_st*   cfg,
+               const _Lookups_st*       lk,
+                     MapV_TunePoint_st* pt);
+
+static int
+_cmp_u64(const void* a, const void* b);
+
+static int
+_cmp_point(const void* a, const void* b);
+
+static bool
+_point_better(const MapV_TuneCfg_st*   cfg,
+              const MapV_TunePoint_st* pt,
+              const MapV_TunePoint_st* best);
+
+
+
+
+//------------------------------------------------------------------------------
+// every key, and a miss per key (the key plus one byte), shuffled.
+// the same order is used for every point.
+struct _Lookups_st {
+  const char** keys;
+  size_t*      lens;
+  uint64_t     cnt;
+  char*        missBuf;
+  uint64_t*    cycles;    // per-lookup latency, for one pass
+  double       tscPerNs;
+  uint64_t     tscOverhead;
+};
+
+
+
+
+//==============================================================================
+//
+// MapV_Tune*() : Public Functions
+//
+//------------------------------------------------------------------------------
+MapV_TuneResult_st*
+MapV_Tune(const MapV_TuneCfg_st* cfg)
+{
+  if (0 == cfg->keysCnt) {
+    printf("MapV_Tune(): no keys\n");
+    return NULL;
+  }
+
+  _Lookups_st lk;
+  if (!_lookups_init(&lk, cfg)) {
+    return NULL;
+  }
+
+  const uint64_t gridCnt = _GRID_CNT(_distSlotMaxes)
+                         * _GRID_CNT(_distBktMaxes)
+                         * _GRID_CNT(_capPctMaxes);
+
+  MapV_TuneResult_st* res = calloc(1, sizeof(*res));
+  if (NULL == res || NULL == (res->points = calloc(gridCnt, sizeof(*res->points)))) {
+    free(res);
+    _lookups_free(&lk);
+    return NULL;
+  }
+
+  for (uint64_t s = 0; s < _GRID_CNT(_distSlotMaxes); s++) {
+  for (uint64_t b = 0; b < _GRID_CNT(_distBktMaxes);  b++) {
+  for (uint64_t c = 0; c < _GRID_CNT(_capPctMaxes);   c++)
+  {
+    MapV_TunePoint_st* pt = &res->points[res->pointsCnt];
+    pt->cfg = (MapV_Cfg_st){
+      .distSlotMax = _distSlotMaxes[s],
+      .distBktMax  = _distBktMaxes[b],
+      .capPctMax   = _capPctMaxes[c],
+      .memAlign    = 4096,
+      .fpBits      = cfg->fpBits,
+      .set         = cfg->set,
+    };
+    pt->cfg.initialSlotCount = (uint64_t)(cfg->keysCnt * 100.0
+                                          / pt->cfg.capPctMax);
+    if (_point_measure(cfg, &lk, pt)) {
+      res->pointsCnt++;
+    }
+  }
+  }
+  }
+  _lookups_free(&lk);
+
+  // the memory/latency curve, smallest tables first
+  qsort(res->points, res->pointsCnt, sizeof(*res->points), _cmp_point);
+
+  res->best = -1;
+  for (uint64_t i = 0; i < res->pointsCnt; i++)
+  {
+    const MapV_TunePoint_st* pt = &res->points[i];
+    if (   (cfg->memBytesMax && pt->tblBytes > cfg->memBytesMax)
+        || (cfg->p99NsMax    && pt->p99Ns    > cfg->p99NsMax)) {
+      continue;
+    }
+    if (-1 == res->best || _point_better(cfg, pt, &res->points[res->best])) {
+      res->best = i;
+    }
+  }
+
+  return res;
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_TunePrint(const MapV_TuneResult_st* res,
+                     FILE*               out)
+{
+  fprintf(out, " slot  bkt   cap%%     table bytes  bytes/key       finds/s"
+               "   p50 ns   p99 ns\n");
+  for (uint64_t i = 0; i < res->pointsCnt; i++)
+  {
+    const MapV_TunePoint_st* pt = &res->points[i];
+    fprintf(out, "%5"PRIu64" %4"PRIu64" %6.1f %15"PRIu64" %10.2f %13.0f"
+                 " %8.1f %8.1f%s\n",
+            pt->cfg.distSlotMax, pt->cfg.distBktMax, pt->cfg.capPctMax,
+            pt->tblBytes, pt->bytesPerKey, pt->findsPerSec,
+            pt->p50Ns, pt->p99Ns, ((int64_t)i == res->best) ? "  *" : "");
+  }
+
+  fprintf(out, "\n");
+  if (-1 == res->best) {
+    fprintf(out, "no config met the target\n");
+    return;
+  }
+  const MapV_TunePoint_st* pt = &res->points[res->best];
+  fprintf(out, "best: -s %"PRIu64" -b %"PRIu64" -c %g\n",
+          pt->cfg.distSlotMax, pt->cfg.distBktMax, pt->cfg.capPctMax);
+  fprintf(out, "      .distSlotMax = %"PRIu64", .distBktMax = %"PRIu64
+               ", .capPctMax = %g,\n",
+          pt->cfg.distSlotMax, pt->cfg.distBktMax, pt->cfg.capPctMax);
+  fprintf(out, "      %"PRIu64" table bytes, p99 %.1f ns, %.0f finds/s\n",
+          pt->tblBytes, pt->p99Ns, pt->findsPerSec);
+}
+
+//------------------------------------------------------------------------------
+void
+MapV_TuneFree(MapV_TuneResult_st* res)
+{
+  if (NULL != res) {
+    free(res->points);
+    free(res);
+  }
+}
+
+
+
+
+//==============================================================================
+//
+// static functions
+//
+//------------------------------------------------------------------------------
+static double
+_now_sec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------------------------------
+// rdtsc ticks at a constant rate, but not necessarily 1/ns
+static double
+_tsc_per_ns(void)
+{
+  const double   beg    = _now_sec();
+  const uint64_t tscBeg = __rdtsc();
+  while (_now_sec() - beg < 0.02) {
+  }
+  const double   secs   = _now_sec() - beg;
+  return (double)(__rdtsc() - tscBeg) / (secs * 1e9);
+}
+
+//------------------------------------------------------------------------------
+// the cost of timing nothing; subtracted from every lookup
+static uint64_t
+_tsc_overhead(void)
+{
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < 1000; i++)
+  {
+    _mm_lfence();
+    const uint64_t beg = __rdtsc();
+    _mm_lfence();
+    const uint64_t end = __rdtsc();
+    if (end - beg < best) {
+      best = end - beg;
+    }
+  }
+  return best;
+}
+
+//------------------------------------------------------------------------------
+static bool
+_lookups_init(      _Lookups_st*     lk,
+              const MapV_TuneCfg_st* cfg)
+{
+  memset(lk, 0, sizeof(*lk));
+  lk->cnt = cfg->keysCnt * 2;
+
+  uint64_t missBytes = 0;
+  for (uint64_t i = 0; i < cfg->keysCnt; i++) {
+    missBytes += cfg->keyLens[i] + 1;
+  }
+  lk->keys    = malloc(lk->cnt * sizeof(*lk->keys));
+  lk->lens    = malloc(lk->cnt * sizeof(*lk->lens));
+  lk->cycles  = malloc(lk->cnt * sizeof(*lk->cycles));
+  lk->missBuf = malloc(missBytes);
+  if (NULL == lk->keys || NULL == lk->lens || NULL == lk->cycles
+      || NULL == lk->missBuf) {
+    _lookups_free(lk);
+    return false;
+  }
+
+  char* miss = lk->missBuf;
+  for (uint64_t i = 0; i < cfg->keysCnt; i++)
+  {
+    const size_t len = cfg->keyLens[i];
+    lk->keys[i * 2]     = cfg->keys[i];
+    lk->lens[i * 2]     = len;
+    memcpy(miss, cfg->keys[i], len);
+    miss[len]           = '\x01';
+    lk->keys[i * 2 + 1] = miss;
+    lk->lens[i * 2 + 1] = len + 1;
+    miss += len + 1;
+  }
+
+  // fixed seed: every point, and every run, sees the same order
+  uint64_t rnd = 0x9e3779b97f4a7c15ull;
+  for (uint64_t i = lk->cnt - 1; i > 0; i--)
+  {
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 7;
+    rnd ^= rnd << 17;
+    const uint64_t j = rnd % (i + 1);
+    const char*  k = lk->keys[i]; lk->keys[i] = lk->keys[j]; lk->keys[j] = k;
+    const size_t l = lk->lens[i]; lk->lens[i] = lk->lens[j]; lk->lens[j] = l;
+  }
+
+  lk->tscPerNs    = _tsc_per_ns();
+  lk->tscOverhead = _tsc_overhead();
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static void
+_lookups_free(_Lookups_st* lk)
+{
+  free(lk->keys);
+  free(lk->lens);
+  free(lk->cycles);
+  free(lk->missBuf);
+  memset(lk, 0, sizeof(*lk));
+}
+
+//------------------------------------------------------------------------------
+// build pt->cfg from the keys, and measure it
+static bool
+_point_measure(const MapV_TuneCfg_st*   cfg,
+               const _Lookups_st*       lk,
+                     MapV_TunePoint_st* pt)
+{
+  MapV_st* map;
+  if (NULL == (map = MapV_Create(&pt->cfg))) {
+    return false;
+  }
+  for (uint64_t i = 0; i < cfg->keysCnt; i++)
+  {
+    const MapV_Err_et err = cfg->set
+      ? MapV_Add(map, cfg->keys[i], cfg->keyLens[i])
+      : MapV_Insert(map, cfg->keys[i], cfg->keyLens[i],
+                    (MapV_Val_ut){ .u64 = i }, true);
+    if (MAPV_ERR__OK != err && MAPV_ERR__INSERT_KEY_EXISTS != err) {
+      MapV_Destroy(map);
+      return false;
+    }
+  }
+  pt->tblBytes    = map->meta.tblBytes;
+  pt->bytesPerKey = (double)map->meta.tblBytes / map->meta.slotsUsed;
+
+  //---------------------------
+  // throughput: back to back, untimed individually
+  const uint64_t rounds = (MAPV_TUNE_LOOKUPS_MIN + lk->cnt - 1) / lk->cnt;
+  uint64_t       found  = 0;
+  const double   beg    = _now_sec();
+  for (uint64_t r = 0; r < rounds; r++) {
+    for (uint64_t i = 0; i < lk->cnt; i++) {
+      MapV_Val_ut val;
+      found += MapV_Find(map, lk->keys[i], lk->lens[i], &val);
+    }
+  }
+  pt->findsPerSec = (rounds * lk->cnt) / (_now_sec() - beg);
+
+  //---------------------------
+  // latency: each lookup timed on its own. passes can be disturbed by
+  // whatever else the machine is doing, so the best pass is kept.
+  pt->p50Ns = pt->p99Ns = 1e300;
+  for (int r = 0; r < MAPV_TUNE_LAT_ROUNDS; r++)
+  {
+    for (uint64_t i = 0; i < lk->cnt; i++)
+    {
+      MapV_Val_ut val;
+      _mm_lfence();
+      const uint64_t tBeg = __rdtsc();
+      _mm_lfence();
+      found += MapV_Find(map, lk->keys[i], lk->lens[i], &val);
+      _mm_lfence();
+      const uint64_t cycles = __rdtsc() - tBeg;
+      lk->cycles[i] = (cycles > lk->tscOverhead) ? (cycles - lk->tscOverhead) : 0;
+    }
+    qsort(lk->cycles, lk->cnt, sizeof(*lk->cycles), _cmp_u64);
+    const double p50 = lk->cycles[lk->cnt / 2]          / lk->tscPerNs;
+    const double p99 = lk->cycles[lk->cnt * 99 / 100]   / lk->tscPerNs;
+    if (p99 < pt->p99Ns) {
+      pt->p50Ns = p50;
+      pt->p99Ns = p99;
+    }
+  }
+
+  MapV_Destroy(map);
+  return (0 != found);
+}
+
+//------------------------------------------------------------------------------
+static int
+_cmp_u64(const void* a, const void* b)
+{
+  const uint64_t x = *(const uint64_t*)a;
+  const uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+//------------------------------------------------------------------------------
+static int
+_cmp_point(const void* a, const void* b)
+{
+  const MapV_TunePoint_st* x = a;
+  const MapV_TunePoint_st* y = b;
+  if (x->tblBytes != y->tblBytes) {
+    return (x->tblBytes > y->tblBytes) ? 1 : -1;
+  }
+  return (x->p99Ns > y->p99Ns) - (x->p99Ns < y->p99Ns);
+}
+
+//------------------------------------------------------------------------------
+// both pt and best already meet the target
+static bool
+_point_better(const MapV_TuneCfg_st*   cfg,
+              const MapV_TunePoint_st* pt,
+              const MapV_TunePoint_st* best)
+{
+  if (cfg->p99NsMax) {
+    if (pt->tblBytes != best->tblBytes) {
+      return pt->tblBytes < best->tblBytes;
+    }
+    return pt->p99Ns < best->p99Ns;
+  }
+  if (pt->p99Ns != best->p99Ns) {
+    return pt->p99Ns < best->p99Ns;
+  }
+  return pt->findsPerSec > best->findsPerSec;
+}
@@ -0,0 +1,81 @@
+#ifndef _MapV_MapV_Tune_h_
+#define _MapV_MapV_Tune_h_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "MapV.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+
+//==============================================================================
+//
+// MapV_Tune: pick distSlotMax / distBktMax / capPctMax for a set of keys
+//
+// every combination in a fixed grid is built from the sample keys, and
+// measured: table bytes, lookups per second, and per-lookup latency
+// (p50/p99, timed with rdtsc) over every key plus as many misses.
+// the best point for the target is picked from those measurements:
+//   - memBytesMax : lowest p99 whose table fits in memBytesMax
+//   - p99NsMax    : smallest table whose p99 is within p99NsMax
+//   - both        : smallest table within both
+//   - neither     : lowest p99
+// the sample should be the real keys, or a big enough random part of them;
+// table sizes are powers of two, so how many there are matters.
+//
+//------------------------------------------------------------------------------
+typedef struct MapV_TuneCfg_st {
+  const void* const* keys;
+  const size_t*      keyLens;
+  uint64_t           keysCnt;
+  uint64_t           memBytesMax; // 0: no memory target
+  double             p99NsMax;    // 0: no latency target
+  uint32_t           fpBits;      // passed through to every cfg; not tuned
+  bool               set;         // "
+} MapV_TuneCfg_st;
+
+typedef struct MapV_TunePoint_st {
+  MapV_Cfg_st cfg;
+  uint64_t    tblBytes;
+  double      bytesPerKey;
+  double      findsPerSec;
+  double      p50Ns;
+  double      p99Ns;
+} MapV_TunePoint_st;
+
+typedef struct MapV_TuneResult_st {
+  MapV_TunePoint_st* points;    // sorted by tblBytes, then p99Ns
+  uint64_t           pointsCnt;
+  int64_t            best;      // index into points; -1 if nothing met the target
+} MapV_TuneResult_st;
+
+
+
+
+//------------------------------------------------------------------------------
+// NULL if there are no keys, or memory runs out
+MapV_TuneResult_st*
+MapV_Tune(const MapV_TuneCfg_st* cfg);
+
+// every point, one per line, with the best one marked, then the best cfg
+void
+MapV_TunePrint(const MapV_TuneResult_st* res,
+                     FILE*               out);
+
+void
+MapV_TuneFree(MapV_TuneResult_st* res);
+
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // _MapV_MapV_Tune_h_
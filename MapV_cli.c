@@ -0,0 +1,268 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "MapV.h"
+#include "MapV_File.h"
+
+/*
+mapv build -k ./input.english_words.10k.txt
+mapv query -k ./input.english_words.10k.txt -q ./input.stop_words.536.txt -p
+mapv stats -k ./input.ips_sort_of.3901.txt
+*/
+
+//------------------------------------------------------------------------------
+typedef struct Cli_st {
+  const char* cmd;
+  const char* fileKeys;
+  const char* fileVals;
+  const char* fileQueries;
+  bool        printResults;
+  int         iterations;
+  MapV_Cfg_st cfg;
+} Cli_st;
+
+static void
+usage(void);
+
+static double
+now_sec(void);
+
+static MapV_st*
+build(const Cli_st* cli);
+
+static int
+cmd_query(const Cli_st* cli, MapV_st* map);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    usage();
+    return 1;
+  }
+
+  Cli_st cli = {
+    .cmd        = argv[1],
+    .iterations = 1,
+    .cfg = {
+      .distSlotMax      = 32,
+      .distBktMax       = 8,
+      .capPctMax        = 90,
+      .memAlign         = 4096,
+      .initialSlotCount = 0, // 0: sized from the key file
+    },
+  };
+
+  int opt;
+  optind = 2;
+  while (-1 != (opt = getopt(argc, argv, "k:v:q:pi:s:b:c:n:f:h"))) {
+    switch (opt) {
+      case 'k': cli.fileKeys             = optarg;                  break;
+      case 'v': cli.fileVals             = optarg;                  break;
+      case 'q': cli.fileQueries          = optarg;                  break;
+      case 'p': cli.printResults         = true;                    break;
+      case 'i': cli.iterations           = atoi(optarg);            break;
+      case 's': cli.cfg.distSlotMax      = strtoull(optarg, 0, 0);  break;
+      case 'b': cli.cfg.distBktMax       = strtoull(optarg, 0, 0);  break;
+      case 'c': cli.cfg.capPctMax        = atof(optarg);            break;
+      case 'n': cli.cfg.initialSlotCount = strtoull(optarg, 0, 0);  break;
+      case 'f': cli.cfg.fpBits           = strtoul(optarg, 0, 0);   break;
+      default : usage(); return 1;
+    }
+  }
+
+  if (NULL == cli.fileKeys) {
+    printf("FATAL: a key file is required (-k)\n\n");
+    usage();
+    return 1;
+  }
+
+  int ret = 0;
+  if (0 == strcmp(cli.cmd, "build")) {
+    MapV_st* map = build(&cli);
+    MapV_Destroy(map);
+  } else if (0 == strcmp(cli.cmd, "query")) {
+    if (NULL == cli.fileQueries) {
+      printf("FATAL: query requires a query file (-q)\n\n");
+      usage();
+      return 1;
+    }
+    MapV_st* map = build(&cli);
+    ret = cmd_query(&cli, map);
+    MapV_Destroy(map);
+  } else if (0 == strcmp(cli.cmd, "stats")) {
+    MapV_st* map = build(&cli);
+    MapV_PrintTableCfg(map);
+    MapV_PrintTableStats(map);
+    MapV_Destroy(map);
+  } else {
+    printf("FATAL: unknown command: %s\n\n", cli.cmd);
+    usage();
+    return 1;
+  }
+
+  return ret;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+usage(void)
+{
+  printf(
+    "usage: mapv <command> -k <keys file> [options]\n"
+    "\n"
+    "commands:\n"
+    "  build   build a map from the key file and report timings\n"
+    "  query   build, then look up every line of the query file\n"
+    "  stats   build, then print table config and distance histograms\n"
+    "\n"
+    "options:\n"
+    "  -k <file>  keys, one per line\n"
+    "  -v <file>  values, one unsigned integer per line, parallel to -k.\n"
+    "             without it, a key's value is its line index\n"
+    "  -q <file>  keys to query, one per line\n"
+    "  -p         print \"key<TAB>value\" (or \"key<TAB>-\") for each query\n"
+    "  -i <n>     run the queries n times (default 1)\n"
+    "  -s <n>     cfg.distSlotMax      (default 32)\n"
+    "  -b <n>     cfg.distBktMax       (default 8)\n"
+    "  -c <pct>   cfg.capPctMax        (default 90)\n"
+    "  -n <n>     cfg.initialSlotCount (default: key count / capPctMax)\n"
+    "  -f <bits>  cfg.fpBits: 64, 96 or 128 (default 128)\n"
+  );
+}
+
+//------------------------------------------------------------------------------
+static double
+now_sec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------------------------------
+static MapV_st*
+build(const Cli_st* cli)
+{
+  double tBeg = now_sec();
+
+  MapV_File_st* keys = MapV_FileOpen(cli->fileKeys);
+  if (NULL == keys) {
+    exit(1);
+  }
+
+  uint64_t* vals = NULL;
+  if (NULL != cli->fileVals) {
+    MapV_File_st* valFile = MapV_FileOpen(cli->fileVals);
+    if (NULL == valFile) {
+      exit(1);
+    }
+    if (valFile->linesCnt != keys->linesCnt) {
+      printf("FATAL: %"PRIu64" keys but %"PRIu64" values\n",
+             keys->linesCnt, valFile->linesCnt);
+      exit(1);
+    }
+    vals = malloc(valFile->linesCnt * sizeof(*vals));
+    if (!MapV_FileLinesToU64(valFile, vals)) {
+      exit(1);
+    }
+    MapV_FileClose(valFile);
+  }
+
+  double tLoad = now_sec();
+
+  MapV_Cfg_st cfg = cli->cfg;
+  if (0 == cfg.initialSlotCount) {
+    cfg.initialSlotCount = (uint64_t)(keys->linesCnt * 100.0 / cfg.capPctMax);
+  }
+
+  MapV_st* map;
+  if (NULL == (map = MapV_Create(&cfg))) {
+    printf("FATAL: MapV_Create failed\n");
+    exit(1);
+  }
+
+  for (uint64_t i = 0; i < keys->linesCnt; i++)
+  {
+    size_t            keyLen;
+    const char*       key = MapV_FileLine(keys, i, &keyLen);
+    const MapV_Val_ut val = { .u64 = vals ? vals[i] : i, };
+
+    MapV_Err_et err;
+    if (MAPV_ERR__OK != (err = MapV_Insert(map, key, keyLen, val, true))) {
+      printf("FATAL: MapV_Insert failed on line %"PRIu64": %s\n",
+             i + 1, MapV_PrintErr(err));
+      exit(1);
+    }
+  }
+
+  double tBuild = now_sec();
+
+  fprintf(stderr, "keys file          : %s\n", cli->fileKeys);
+  fprintf(stderr, "keys               : %"PRIu64"\n", keys->linesCnt);
+  fprintf(stderr, "avg key len        : %.2f\n",
+          keys->linesCnt ? (double)keys->lineLenSum / keys->linesCnt : 0.0);
+  fprintf(stderr, "load time (s)      : %.6f\n", tLoad  - tBeg);
+  fprintf(stderr, "build time (s)     : %.6f\n", tBuild - tLoad);
+  fprintf(stderr, "inserts per second : %.0f\n",
+          keys->linesCnt / (tBuild - tLoad));
+  fprintf(stderr, "table bytes        : %"PRIu64"\n", map->meta.tblBytes);
+
+  free(vals);
+  MapV_FileClose(keys);
+
+  return map;
+}
+
+//------------------------------------------------------------------------------
+static int
+cmd_query(const Cli_st* cli, MapV_st* map)
+{
+  MapV_File_st* queries = MapV_FileOpen(cli->fileQueries);
+  if (NULL == queries) {
+    return 1;
+  }
+
+  uint64_t hits   = 0;
+  uint64_t misses = 0;
+  double   tBeg   = now_sec();
+
+  for (int iter = 0; iter < cli->iterations; iter++)
+  {
+    for (uint64_t i = 0; i < queries->linesCnt; i++)
+    {
+      size_t      keyLen;
+      const char* key = MapV_FileLine(queries, i, &keyLen);
+      MapV_Val_ut val = {0};
+
+      if (MapV_Find(map, key, keyLen, &val)) {
+        hits++;
+        if (cli->printResults && 0 == iter) {
+          printf("%.*s\t%"PRIu64"\n", (int)keyLen, key, val.u64);
+        }
+      } else {
+        misses++;
+        if (cli->printResults && 0 == iter) {
+          printf("%.*s\t-\n", (int)keyLen, key);
+        }
+      }
+    }
+  }
+
+  double tEnd = now_sec();
+
+  fprintf(stderr, "queries            : %"PRIu64"\n", hits + misses);
+  fprintf(stderr, "hits               : %"PRIu64"\n", hits);
+  fprintf(stderr, "misses             : %"PRIu64"\n", misses);
+  fprintf(stderr, "lookups per second : %.0f\n", (hits + misses) / (tEnd - tBeg));
+
+  MapV_FileClose(queries);
+  return 0;
+}
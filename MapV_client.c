@@ -0,0 +1,298 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "MapV_File.h"
+#include "MapV_Proto.h"
+
+/*
+mapv-client -s /tmp/mapv.sock -k ./input.english_words.10k.txt -b 64 -d 16
+*/
+
+//------------------------------------------------------------------------------
+// load generator for mapv-server.
+// keeps `depth` requests of `batch` keys in flight on one connection, cycling
+// through the key file, and reports throughput and per-request latency.
+
+typedef struct Client_st {
+  const char*   sockPath;
+  MapV_File_st* keys;
+  uint32_t      batch;
+  uint32_t      depth;
+  uint64_t      reqsCnt;
+  bool          expectAll; // every key must be found (the server's key file)
+  int           fd;
+  uint64_t      nextKey;
+  uint8_t*      reqBuf;
+  uint8_t*      resBuf;
+  uint64_t*     sentNs;    // [depth], send time by reqId % depth
+  uint64_t*     latNs;     // [reqsCnt]
+} Client_st;
+
+static void     usage(void);
+static uint64_t now_ns(void);
+static int      connect_unix(const char* path);
+static bool     write_all(int fd, const uint8_t* buf, size_t len);
+static bool     read_all(int fd, uint8_t* buf, size_t len);
+static bool     req_send(Client_st* cl, uint64_t reqId);
+static bool     res_recv(Client_st* cl, uint64_t reqId);
+static int      cmp_u64(const void* a, const void* b);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  Client_st cl = {
+    .batch   = 64,
+    .depth   = 16,
+    .reqsCnt = 100000,
+  };
+  const char* fileKeys = NULL;
+
+  int opt;
+  while (-1 != (opt = getopt(argc, argv, "s:k:b:d:n:eh"))) {
+    switch (opt) {
+      case 's': cl.sockPath  = optarg;                   break;
+      case 'k': fileKeys     = optarg;                   break;
+      case 'b': cl.batch     = strtoul(optarg, 0, 0);    break;
+      case 'd': cl.depth     = strtoul(optarg, 0, 0);    break;
+      case 'n': cl.reqsCnt   = strtoull(optarg, 0, 0);   break;
+      case 'e': cl.expectAll = true;                     break;
+      default : usage(); return 1;
+    }
+  }
+  if (   NULL == cl.sockPath || NULL == fileKeys
+      || 0 == cl.batch || cl.batch > MAPV_PROTO_KEYS_MAX
+      || 0 == cl.depth || 0 == cl.reqsCnt) {
+    usage();
+    return 1;
+  }
+
+  if (NULL == (cl.keys = MapV_FileOpen(fileKeys))) {
+    return 1;
+  }
+  if (0 == cl.keys->linesCnt) {
+    printf("FATAL: no keys in %s\n", fileKeys);
+    return 1;
+  }
+  if (-1 == (cl.fd = connect_unix(cl.sockPath))) {
+    return 1;
+  }
+
+  cl.reqBuf = malloc(sizeof(MapV_ProtoReq_st)
+                     + (uint64_t)cl.batch * (sizeof(uint16_t) + UINT16_MAX));
+  cl.resBuf = malloc(MapV_ProtoResBytes(cl.batch));
+  cl.sentNs = calloc(cl.depth,   sizeof(*cl.sentNs));
+  cl.latNs  = calloc(cl.reqsCnt, sizeof(*cl.latNs));
+
+  //---------------------------
+  // fill the pipeline, then send one for every response received
+  const uint64_t tBeg  = now_ns();
+  uint64_t       sent  = 0;
+  uint64_t       recvd = 0;
+
+  while (sent < cl.reqsCnt && sent < cl.depth) {
+    if (!req_send(&cl, sent++)) {
+      return 1;
+    }
+  }
+  while (recvd < cl.reqsCnt) {
+    if (!res_recv(&cl, recvd++)) {
+      return 1;
+    }
+    if (sent < cl.reqsCnt) {
+      if (!req_send(&cl, sent++)) {
+        return 1;
+      }
+    }
+  }
+  const uint64_t tEnd = now_ns();
+
+  //---------------------------
+  qsort(cl.latNs, cl.reqsCnt, sizeof(*cl.latNs), cmp_u64);
+
+  const double secs = (tEnd - tBeg) / 1e9;
+  #define PCT(p) (cl.latNs[(uint64_t)((cl.reqsCnt - 1) * (p))] / 1000.0)
+  printf("requests           : %"PRIu64"\n", cl.reqsCnt);
+  printf("keys per request   : %"PRIu32"\n", cl.batch);
+  printf("pipeline depth     : %"PRIu32"\n", cl.depth);
+  printf("seconds            : %.3f\n", secs);
+  printf("requests per second: %.0f\n", cl.reqsCnt / secs);
+  printf("lookups per second : %.0f\n", cl.reqsCnt * cl.batch / secs);
+  printf("latency us p50     : %.1f\n", PCT(0.50));
+  printf("latency us p90     : %.1f\n", PCT(0.90));
+  printf("latency us p99     : %.1f\n", PCT(0.99));
+  printf("latency us p99.9   : %.1f\n", PCT(0.999));
+  printf("latency us max     : %.1f\n", PCT(1.00));
+  #undef PCT
+
+  close(cl.fd);
+  MapV_FileClose(cl.keys);
+  free(cl.reqBuf);
+  free(cl.resBuf);
+  free(cl.sentNs);
+  free(cl.latNs);
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+usage(void)
+{
+  printf(
+    "usage: mapv-client -s <socket path> -k <keys file> [options]\n"
+    "\n"
+    "  -b <n>  keys per request        (default 64)\n"
+    "  -d <n>  requests in flight      (default 16)\n"
+    "  -n <n>  total requests          (default 100000)\n"
+    "  -e      fail unless every key is found\n"
+  );
+}
+
+//------------------------------------------------------------------------------
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//------------------------------------------------------------------------------
+static int
+connect_unix(const char* path)
+{
+  struct sockaddr_un addr = { .sun_family = AF_UNIX, };
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    printf("FATAL: socket path is too long: %s\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (-1 == fd || -1 == connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+    printf("FATAL: can't connect to %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  return fd;
+}
+
+//------------------------------------------------------------------------------
+static bool
+write_all(int fd, const uint8_t* buf, size_t len)
+{
+  while (len > 0) {
+    const ssize_t n = write(fd, buf, len);
+    if (n < 0 && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) {
+      perror("write");
+      return false;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static bool
+read_all(int fd, uint8_t* buf, size_t len)
+{
+  while (len > 0) {
+    const ssize_t n = read(fd, buf, len);
+    if (n < 0 && EINTR == errno) {
+      continue;
+    }
+    if (n <= 0) {
+      printf("FATAL: server closed the connection\n");
+      return false;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// reqIds are counted in 64 bits; the wire's are their low 32, which is all
+// an in-order check needs
+static bool
+req_send(Client_st* cl, uint64_t reqId)
+{
+  MapV_ProtoReq_st* req  = (MapV_ProtoReq_st*)cl->reqBuf;
+  uint16_t*         lens = (uint16_t*)(cl->reqBuf + sizeof(*req));
+  uint8_t*          dst  = (uint8_t*)(lens + cl->batch);
+
+  for (uint32_t i = 0; i < cl->batch; i++) {
+    size_t      len;
+    const char* key = MapV_FileLine(cl->keys, cl->nextKey, &len);
+    if (len > UINT16_MAX) {
+      len = UINT16_MAX;
+    }
+    lens[i] = len;
+    memcpy(dst, key, len);
+    dst += len;
+    if (++cl->nextKey == cl->keys->linesCnt) {
+      cl->nextKey = 0;
+    }
+  }
+
+  req->magic   = MAPV_PROTO_MAGIC_REQ;
+  req->bytes   = dst - cl->reqBuf;
+  req->reqId   = (uint32_t)reqId;
+  req->keysCnt = cl->batch;
+
+  cl->sentNs[reqId % cl->depth] = now_ns();
+  return write_all(cl->fd, cl->reqBuf, req->bytes);
+}
+
+//------------------------------------------------------------------------------
+static bool
+res_recv(Client_st* cl, uint64_t reqId)
+{
+  MapV_ProtoRes_st* res = (MapV_ProtoRes_st*)cl->resBuf;
+  if (!read_all(cl->fd, cl->resBuf, sizeof(*res))) {
+    return false;
+  }
+  cl->latNs[reqId] = now_ns() - cl->sentNs[reqId % cl->depth];
+
+  if (MAPV_PROTO_MAGIC_RES != res->magic || MAPV_PROTO_ERR__OK != res->err) {
+    printf("FATAL: bad response (err %"PRIu32")\n", res->err);
+    return false;
+  }
+  if (res->reqId != (uint32_t)reqId || res->keysCnt != cl->batch
+      || res->bytes != MapV_ProtoResBytes(cl->batch)) {
+    printf("FATAL: out of order or malformed response: %"PRIu32"\n",
+           res->reqId);
+    return false;
+  }
+  if (!read_all(cl->fd, cl->resBuf + sizeof(*res), res->bytes - sizeof(*res))) {
+    return false;
+  }
+  if (cl->expectAll && res->hits != res->keysCnt) {
+    printf("FATAL: request %"PRIu64": %"PRIu32" of %"PRIu32" keys found\n",
+           reqId, res->hits, res->keysCnt);
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static int
+cmp_u64(const void* a, const void* b)
+{
+  const uint64_t x = *(const uint64_t*)a;
+  const uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,511 @@
+#define _GNU_SOURCE // accept4()
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "MapV.h"
+#include "MapV_File.h"
+#include "MapV_Proto.h"
+
+/*
+mapv-server -s /tmp/mapv.sock -k ./input.english_words.10k.txt
+*/
+
+//------------------------------------------------------------------------------
+#define CONN_BUF_INIT   (64 * 1024)
+#define CONN_OUT_HIGH   (4 * 1024 * 1024) // stop reading with this much unsent
+#define EPOLL_EVENTS    64
+
+typedef struct Buf_st {
+  uint8_t* data;
+  size_t   beg;  // first unconsumed byte
+  size_t   end;  // one past the last valid byte
+  size_t   cap;
+} Buf_st;
+
+typedef struct Conn_st {
+  int    fd;
+  bool   wantOut;  // registered for EPOLLOUT
+  bool   paused;   // not registered for EPOLLIN: out is over CONN_OUT_HIGH
+  bool   closing;  // flush, then close. set on a bad frame
+  Buf_st in;
+  Buf_st out;
+} Conn_st;
+
+typedef struct Server_st {
+  MapV_st*      map;
+  int           epfd;
+  int           lfd;
+  const void**  keys;    // scratch for one request's keys
+  size_t*       keyLens;
+  uint64_t      reqs;
+  uint64_t      lookups;
+} Server_st;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void     usage(void);
+static void     on_signal(int sig);
+static MapV_st* build(const char* fileKeys, const char* fileVals);
+static int      listen_unix(const char* path);
+static bool     buf_reserve(Buf_st* buf, size_t bytes);
+static void     conn_close(Server_st* srv, Conn_st* conn);
+static bool     conn_out_full(const Conn_st* conn);
+static bool     conn_read(Server_st* srv, Conn_st* conn);
+static bool     conn_flush(Server_st* srv, Conn_st* conn);
+static bool     conn_process(Server_st* srv, Conn_st* conn);
+static bool     req_handle(Server_st* srv, Conn_st* conn,
+                           const MapV_ProtoReq_st* req, const uint8_t* frame);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* sockPath = NULL;
+  const char* fileKeys = NULL;
+  const char* fileVals = NULL;
+
+  int opt;
+  while (-1 != (opt = getopt(argc, argv, "s:k:v:h"))) {
+    switch (opt) {
+      case 's': sockPath = optarg;  break;
+      case 'k': fileKeys = optarg;  break;
+      case 'v': fileVals = optarg;  break;
+      default : usage(); return 1;
+    }
+  }
+  if (NULL == sockPath || NULL == fileKeys) {
+    usage();
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT,  on_signal);
+  signal(SIGTERM, on_signal);
+
+  Server_st srv = {0};
+  srv.map     = build(fileKeys, fileVals);
+  srv.keys    = malloc(MAPV_PROTO_KEYS_MAX * sizeof(*srv.keys));
+  srv.keyLens = malloc(MAPV_PROTO_KEYS_MAX * sizeof(*srv.keyLens));
+
+  if (-1 == (srv.lfd = listen_unix(sockPath))) {
+    return 1;
+  }
+  if (-1 == (srv.epfd = epoll_create1(0))) {
+    perror("epoll_create1");
+    return 1;
+  }
+
+  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL, };
+  epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.lfd, &ev);
+
+  printf("mapv-server: listening on %s\n", sockPath);
+  fflush(stdout);
+
+  struct epoll_event events[EPOLL_EVENTS];
+  while (!g_stop)
+  {
+    const int n = epoll_wait(srv.epfd, events, EPOLL_EVENTS, 500);
+    if (n < 0) {
+      if (EINTR == errno) {
+        continue;
+      }
+      perror("epoll_wait");
+      break;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+      // listener
+      if (NULL == events[i].data.ptr) {
+        int fd;
+        while (-1 != (fd = accept4(srv.lfd, NULL, NULL, SOCK_NONBLOCK))) {
+          Conn_st* conn = calloc(1, sizeof(*conn));
+          conn->fd = fd;
+          struct epoll_event cev = { .events = EPOLLIN, .data.ptr = conn, };
+          epoll_ctl(srv.epfd, EPOLL_CTL_ADD, fd, &cev);
+        }
+        continue;
+      }
+
+      Conn_st* conn = events[i].data.ptr;
+
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+        // still answer whatever was sent before the hangup
+        if (!(events[i].events & EPOLLIN)) {
+          conn_close(&srv, conn);
+          continue;
+        }
+      }
+      if (events[i].events & EPOLLIN) {
+        if (!conn_read(&srv, conn)) {
+          conn_close(&srv, conn);
+          continue;
+        }
+      }
+      if (!conn_flush(&srv, conn)) {
+        conn_close(&srv, conn);
+        continue;
+      }
+    }
+  }
+
+  printf("mapv-server: requests: %"PRIu64", lookups: %"PRIu64"\n",
+         srv.reqs, srv.lookups);
+  close(srv.lfd);
+  unlink(sockPath);
+  MapV_Destroy(srv.map);
+  free(srv.keys);
+  free(srv.keyLens);
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+usage(void)
+{
+  printf(
+    "usage: mapv-server -s <socket path> -k <keys file> [-v <values file>]\n"
+    "\n"
+    "  serves lookups of the keys in -k over a unix domain socket.\n"
+    "  see MapV_Proto.h for the wire format.\n"
+  );
+}
+
+//------------------------------------------------------------------------------
+static void
+on_signal(int sig)
+{
+  (void)sig;
+  g_stop = 1;
+}
+
+//------------------------------------------------------------------------------
+static MapV_st*
+build(const char* fileKeys, const char* fileVals)
+{
+  MapV_File_st* keys = MapV_FileOpen(fileKeys);
+  if (NULL == keys) {
+    exit(1);
+  }
+
+  uint64_t* vals = NULL;
+  if (NULL != fileVals) {
+    MapV_File_st* valFile = MapV_FileOpen(fileVals);
+    if (NULL == valFile || valFile->linesCnt != keys->linesCnt) {
+      printf("FATAL: values file missing or not parallel to the keys file\n");
+      exit(1);
+    }
+    vals = malloc(valFile->linesCnt * sizeof(*vals));
+    if (!MapV_FileLinesToU64(valFile, vals)) {
+      exit(1);
+    }
+    MapV_FileClose(valFile);
+  }
+
+  MapV_Cfg_st cfg = {
+    .distSlotMax      = 32,
+    .distBktMax       = 8,
+    .capPctMax        = 90,
+    .memAlign         = 4096,
+    .initialSlotCount = (uint64_t)(keys->linesCnt * 100.0 / 90),
+  };
+  MapV_st* map;
+  if (NULL == (map = MapV_Create(&cfg))) {
+    printf("FATAL: MapV_Create failed\n");
+    exit(1);
+  }
+
+  for (uint64_t i = 0; i < keys->linesCnt; i++)
+  {
+    size_t            keyLen;
+    const char*       key = MapV_FileLine(keys, i, &keyLen);
+    const MapV_Val_ut val = { .u64 = vals ? vals[i] : i, };
+
+    MapV_Err_et err;
+    if (MAPV_ERR__OK != (err = MapV_Insert(map, key, keyLen, val, true))) {
+      printf("FATAL: MapV_Insert: %s\n", MapV_PrintErr(err));
+      exit(1);
+    }
+  }
+
+  printf("mapv-server: loaded %"PRIu64" keys from %s\n",
+         keys->linesCnt, fileKeys);
+
+  free(vals);
+  MapV_FileClose(keys);
+  return map;
+}
+
+//------------------------------------------------------------------------------
+static int
+listen_unix(const char* path)
+{
+  struct sockaddr_un addr = { .sun_family = AF_UNIX, };
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    printf("FATAL: socket path is too long: %s\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (-1 == fd) {
+    perror("socket");
+    return -1;
+  }
+
+  unlink(path);
+  if (   -1 == bind(fd, (struct sockaddr*)&addr, sizeof(addr))
+      || -1 == listen(fd, 128)) {
+    printf("FATAL: can't listen on %s: %s\n", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+//------------------------------------------------------------------------------
+// make room for `bytes` more at buf->end, compacting before growing
+static bool
+buf_reserve(Buf_st* buf, size_t bytes)
+{
+  if (buf->cap - buf->end >= bytes) {
+    return true;
+  }
+  // keep the offset mod 8, so frames written at .end stay 8 byte aligned
+  const size_t shift = buf->beg & ~(size_t)7;
+  if (shift > 0) {
+    memmove(buf->data + buf->beg - shift, buf->data + buf->beg,
+            buf->end - buf->beg);
+    buf->beg -= shift;
+    buf->end -= shift;
+    if (buf->cap - buf->end >= bytes) {
+      return true;
+    }
+  }
+
+  size_t cap = buf->cap ? buf->cap : CONN_BUF_INIT;
+  while (cap - buf->end < bytes) {
+    cap *= 2;
+  }
+  uint8_t* data = realloc(buf->data, cap);
+  if (NULL == data) {
+    return false;
+  }
+  buf->data = data;
+  buf->cap  = cap;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static void
+conn_close(Server_st* srv, Conn_st* conn)
+{
+  epoll_ctl(srv->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+  close(conn->fd);
+  free(conn->in.data);
+  free(conn->out.data);
+  free(conn);
+}
+
+//------------------------------------------------------------------------------
+// a client that sends requests without reading the answers is stopped here:
+// nothing more is read from it until conn_flush() gets out back under.
+static bool
+conn_out_full(const Conn_st* conn)
+{
+  return conn->out.end - conn->out.beg > CONN_OUT_HIGH;
+}
+
+//------------------------------------------------------------------------------
+// read everything available, answering each complete request as we go,
+// until out is full. returns false when the connection should be closed.
+static bool
+conn_read(Server_st* srv, Conn_st* conn)
+{
+  while (!conn->closing && !conn_out_full(conn))
+  {
+    if (!buf_reserve(&conn->in, CONN_BUF_INIT)) {
+      return false;
+    }
+    const ssize_t n = read(conn->fd, conn->in.data + conn->in.end,
+                           conn->in.cap - conn->in.end);
+    if (n > 0) {
+      conn->in.end += n;
+      if (!conn_process(srv, conn)) {
+        return false;
+      }
+      continue;
+    }
+    if (0 == n) {
+      // peer is done sending. answer what we have, then close.
+      conn->closing = true;
+      break;
+    }
+    if (EAGAIN == errno || EWOULDBLOCK == errno) {
+      break;
+    }
+    if (EINTR != errno) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static bool
+conn_flush(Server_st* srv, Conn_st* conn)
+{
+  Buf_st* out = &conn->out;
+  while (out->beg < out->end) {
+    const ssize_t n = write(conn->fd, out->data + out->beg,
+                            out->end - out->beg);
+    if (n > 0) {
+      out->beg += n;
+      continue;
+    }
+    if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+      break;
+    }
+    if (n < 0 && EINTR == errno) {
+      continue;
+    }
+    return false;
+  }
+
+  if (out->beg == out->end) {
+    out->beg = out->end = 0;
+    if (conn->closing) {
+      return false;
+    }
+  }
+
+  // back under: answer the requests read before reading stopped
+  if (conn->paused && !conn_out_full(conn)) {
+    if (!conn_process(srv, conn)) {
+      return false;
+    }
+  }
+
+  const bool wantOut = (out->beg < out->end);
+  const bool paused  = conn_out_full(conn);
+  if (wantOut != conn->wantOut || paused != conn->paused) {
+    struct epoll_event ev = {
+      .events   = (paused ? 0 : EPOLLIN) | (wantOut ? EPOLLOUT : 0),
+      .data.ptr = conn,
+    };
+    epoll_ctl(srv->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->wantOut = wantOut;
+    conn->paused  = paused;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// answer every complete request in the input buffer, in order, until out
+// is full.
+static bool
+conn_process(Server_st* srv, Conn_st* conn)
+{
+  Buf_st* in = &conn->in;
+  while (in->end - in->beg >= sizeof(MapV_ProtoReq_st) && !conn_out_full(conn))
+  {
+    MapV_ProtoReq_st req;
+    memcpy(&req, in->data + in->beg, sizeof(req));
+
+    if (   MAPV_PROTO_MAGIC_REQ != req.magic
+        || req.bytes < sizeof(req)
+        || req.bytes > MAPV_PROTO_BYTES_MAX
+        || req.keysCnt > MAPV_PROTO_KEYS_MAX) {
+      goto bad_frame;
+    }
+    if (in->end - in->beg < req.bytes) {
+      break; // wait for the rest of the frame
+    }
+    if (!req_handle(srv, conn, &req, in->data + in->beg)) {
+      goto bad_frame;
+    }
+    in->beg += req.bytes;
+  }
+  if (in->beg == in->end) {
+    in->beg = in->end = 0;
+  }
+  return true;
+
+bad_frame:;
+  MapV_ProtoRes_st res = {
+    .magic = MAPV_PROTO_MAGIC_RES,
+    .bytes = sizeof(res),
+    .err   = MAPV_PROTO_ERR__BAD_FRAME,
+  };
+  if (!buf_reserve(&conn->out, sizeof(res))) {
+    return false;
+  }
+  memcpy(conn->out.data + conn->out.end, &res, sizeof(res));
+  conn->out.end += sizeof(res);
+  conn->closing  = true;
+  in->beg = in->end = 0;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// @NOTE: the request is still in the input buffer; keys are pointed at,
+//        not copied, and the whole batch goes to MapV_FindBatch() so the
+//        bucket loads are prefetched and overlap.
+static bool
+req_handle(Server_st* srv, Conn_st* conn,
+           const MapV_ProtoReq_st* req, const uint8_t* frame)
+{
+  const uint32_t keysCnt = req->keysCnt;
+  const uint8_t* lens    = frame + sizeof(*req);
+  const uint8_t* key     = lens + (uint64_t)keysCnt * sizeof(uint16_t);
+  const uint8_t* end     = frame + req->bytes;
+  if (key > end) {
+    return false;
+  }
+  for (uint32_t i = 0; i < keysCnt; i++) {
+    uint16_t len;
+    memcpy(&len, lens + i * sizeof(len), sizeof(len));
+    if (key + len > end) {
+      return false;
+    }
+    srv->keys   [i] = key;
+    srv->keyLens[i] = len;
+    key += len;
+  }
+  if (key != end) {
+    return false;
+  }
+
+  const uint64_t resBytes = MapV_ProtoResBytes(keysCnt);
+  if (!buf_reserve(&conn->out, resBytes)) {
+    return false;
+  }
+  uint8_t*          out   = conn->out.data + conn->out.end;
+  MapV_ProtoRes_st* res   = (MapV_ProtoRes_st*)out;
+  MapV_Val_ut*      vals  = (MapV_Val_ut*)(out + sizeof(*res));
+  bool*             found = (bool*)(vals + keysCnt);
+
+  memset(out, 0, resBytes);
+  res->magic   = MAPV_PROTO_MAGIC_RES;
+  res->bytes   = resBytes;
+  res->reqId   = req->reqId;
+  res->keysCnt = keysCnt;
+  res->hits    = MapV_FindBatch(srv->map, (const void* const*)srv->keys,
+                                srv->keyLens, keysCnt, vals, found);
+  conn->out.end += resBytes;
+
+  srv->reqs++;
+  srv->lookups += keysCnt;
+  return true;
+}
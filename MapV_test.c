@@ -5,6 +5,7 @@
 
 #include "MapV.h"
 #include "MapV.c"
+#include "MapV_File.h"
 
 /*
 make clean && make && make test
@@ -17,9 +18,6 @@ timer_start();
 long
 timer_end(struct timespec start_time);
 
-char**
-file_to_str_arr(const char* fname, uint64_t* cnt);
-
 uint64_t rngstate[4];
 uint64_t randNext(void);
 void     randSeed(void);
@@ -44,14 +42,12 @@ int main(int argc, char *argv[])
 	printf("Running test using key file: %s\n\n", file_keys);
 
   //---------------------------
-  uint64_t valArrCnt = 0;
-  uint64_t valLenSum = 0;
-  char**   valArr    = file_to_str_arr(file_keys, &valArrCnt);
-  size_t*  strLenArr = calloc(valArrCnt, sizeof(size_t));
-  for (uint64_t i = 0; i < valArrCnt; i++) {
-    strLenArr[i] = strlen(valArr[i]);
-    valLenSum   += strlen(valArr[i]);
+  MapV_File_st* keyFile = MapV_FileOpen(file_keys);
+  if (NULL == keyFile) {
+    exit(1);
   }
+  const uint64_t valArrCnt = keyFile->linesCnt;
+  const uint64_t valLenSum = keyFile->lineLenSum;
 
   //------------------------------------------------------------
   // Init
@@ -79,8 +75,8 @@ int main(int argc, char *argv[])
   fflush(stdout);
   for (uint64_t i = 0; i < valArrCnt; i++)
   {
-  	const char*  key    = valArr[i];
-  	const size_t keyLen = strLenArr[i];
+  	size_t       keyLen;
+  	const char*  key    = MapV_FileLine(keyFile, i, &keyLen);
 	  const MapV_Val_ut val = {
 			.u64 = i,
 			// .ptr = (const void*)&(LookupArr[i]),
@@ -123,8 +119,8 @@ int main(int argc, char *argv[])
   {
     for (uint64_t i = 0; i < valArrCnt; i++)
     {
-      const char*  key    = valArr[i];
-      const size_t keyLen = strLenArr[i];
+      size_t       keyLen;
+      const char*  key    = MapV_FileLine(keyFile, i, &keyLen);
 
 	    MapV_Val_ut val = {0};
       bool ret = MapV_Find(map, key, keyLen, &val);
@@ -175,6 +171,7 @@ int main(int argc, char *argv[])
   } else {
 	  printf("ok\n\n");fflush(stdout);
   }
+  MapV_FileClose(keyFile);
 
   return 0;
 }
@@ -247,44 +244,3 @@ void printNsWithCommas(uint64_t ns)
 	printf("%s", pos);
 }
 
-
-//------------------------------------------------------------------------------
-char**
-file_to_str_arr(const char* fname, uint64_t* cnt)
-{
-  char**  arr  = NULL;
-  size_t  len  = 0;
-  ssize_t chs  = 0;
-  char*   line = NULL;
-  FILE*   fp   = fopen(fname, "r");
-
-  if (fp == NULL) {
-    printf("Tried to open: %s\n", fname);
-    perror("Can't open input file.");
-    fflush(stdout);
-    exit(1);
-  }
-
-  *cnt = 0;
-  fseek(fp, 0, SEEK_SET);
-  while ((chs = getline(&line, &len, fp)) != -1) {
-    if ((chs - 1) > 0) { // includes newline
-      ++*cnt;
-    }
-  }
-  arr = malloc(*cnt * sizeof(char*));
-
-  *cnt = 0;
-  fseek(fp, 0, SEEK_SET);
-  while ((chs = getline(&line, &len, fp)) != -1) {
-    if ((chs - 1) > 0) {
-      arr[*cnt] = (char*)malloc(chs * sizeof(char));
-      strncpy(arr[*cnt], line, chs);
-      arr[*cnt][chs-1] = '\0';
-      ++*cnt;
-    }
-  }
-  fclose (fp);
-
-  return arr;
-}
@@ -0,0 +1,342 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_Agg.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// ROWS rows of (key, delta), keys picked at random from KEYS, like
+// "user0012345". every op is run through MapV_Agg with THREADS threads and
+// a budget small enough to spill, and each partition's result is checked
+// against a map built the plain way: MapV_Find(), then MapV_Insert().
+// then group-by sum is timed: the plain way, MapV_UpsertAdd(), and MapV_Agg
+// with 1 and THREADS threads, with and without spilling.
+
+#define ROWS      2000000
+#define KEYS      250000
+#define THREADS   4
+#define PART_BITS 4
+#define BATCH     4096 // rows per MapV_AggUpdate() call
+
+typedef struct Rows_st {
+  const void** keys;
+  size_t*      lens;
+  uint64_t*    deltas;
+  char*        buf;
+} Rows_st;
+
+typedef struct Job_st {
+  MapV_Agg_st*   agg;
+  const Rows_st* rows;
+  uint32_t       threadId;
+  uint64_t       beg;
+  uint64_t       end;
+} Job_st;
+
+static const char* opNames[] = { "count", "sum", "min", "max" };
+
+static MapV_Cfg_st
+map_cfg(void);
+
+static MapV_st*
+plain(const Rows_st* rows, MapV_AggOp_et op);
+
+static MapV_st*
+upsert_add(const Rows_st* rows);
+
+static void*
+job_run(void* arg);
+
+static MapV_st**
+agg_run(const Rows_st* rows, MapV_AggOp_et op, uint32_t threadsCnt,
+        uint64_t memBytesMax, double* secsUpdate, double* secsMerge,
+        uint64_t* spills);
+
+static void
+check(const char* name, const MapV_st* want, MapV_st** parts);
+
+static void
+parts_free(MapV_st** parts);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  Rows_st rows = {
+    .keys   = malloc(ROWS * sizeof(*rows.keys)),
+    .lens   = malloc(ROWS * sizeof(*rows.lens)),
+    .deltas = malloc(ROWS * sizeof(*rows.deltas)),
+    .buf    = malloc(KEYS * 16),
+  };
+  for (uint64_t k = 0; k < KEYS; k++) {
+    snprintf(rows.buf + k * 16, 16, "user%07"PRIu64, k);
+  }
+  uint64_t s = 0x9e3779b97f4a7c15ull;
+  for (uint64_t i = 0; i < ROWS; i++) {
+    const uint64_t k = rand_u64(&s) % KEYS;
+    rows.keys[i]   = rows.buf + k * 16;
+    rows.lens[i]   = 11;
+    rows.deltas[i] = rand_u64(&s) % 1000000;
+  }
+
+  //---------------------------
+  // every op, with spills, then without
+  for (int op = MAPV_AGG_OP__COUNT; op <= MAPV_AGG_OP__MAX; op++)
+  {
+    MapV_st* want = plain(&rows, op);
+    double   secsUpdate;
+    double   secsMerge;
+    uint64_t spills;
+    char     name[64];
+
+    MapV_st** parts = agg_run(&rows, op, THREADS, 4 << 20,
+                              &secsUpdate, &secsMerge, &spills);
+    if (0 == spills) {
+      printf("%s: nothing was spilled\n", opNames[op]);
+      exit(1);
+    }
+    snprintf(name, sizeof(name), "%s, %d threads, %"PRIu64" spills",
+             opNames[op], THREADS, spills);
+    check(name, want, parts);
+    parts_free(parts);
+
+    parts = agg_run(&rows, op, 1, 0, &secsUpdate, &secsMerge, &spills);
+    snprintf(name, sizeof(name), "%s, 1 thread", opNames[op]);
+    check(name, want, parts);
+    parts_free(parts);
+
+    MapV_Destroy(want);
+  }
+
+  //---------------------------
+  printf("group-by sum, %d rows, %d keys (best of 3), Mrows/s:\n", ROWS, KEYS);
+
+  double best = 1e9;
+  for (int iter = 0; iter < 3; iter++) {
+    const double t   = now_sec();
+    MapV_st*     map = plain(&rows, MAPV_AGG_OP__SUM);
+    best = (now_sec() - t < best) ? now_sec() - t : best;
+    MapV_Destroy(map);
+  }
+  printf("  MapV_Find() + MapV_Insert()      %6.1f\n", ROWS / best / 1e6);
+
+  best = 1e9;
+  for (int iter = 0; iter < 3; iter++) {
+    const double t   = now_sec();
+    MapV_st*     map = upsert_add(&rows);
+    best = (now_sec() - t < best) ? now_sec() - t : best;
+    MapV_Destroy(map);
+  }
+  printf("  MapV_UpsertAdd()                 %6.1f\n", ROWS / best / 1e6);
+
+  const struct { uint32_t threadsCnt; uint64_t memBytesMax; } runs[] = {
+    { 1, 0 }, { THREADS, 0 }, { THREADS, 16 << 20 },
+  };
+  for (uint64_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++)
+  {
+    double   bestUpdate = 1e9;
+    double   bestMerge  = 1e9;
+    uint64_t spills     = 0;
+    for (int iter = 0; iter < 3; iter++)
+    {
+      double    secsUpdate;
+      double    secsMerge;
+      MapV_st** parts = agg_run(&rows, MAPV_AGG_OP__SUM, runs[r].threadsCnt,
+                                runs[r].memBytesMax, &secsUpdate, &secsMerge,
+                                &spills);
+      bestUpdate = (secsUpdate < bestUpdate) ? secsUpdate : bestUpdate;
+      bestMerge  = (secsMerge  < bestMerge)  ? secsMerge  : bestMerge;
+      parts_free(parts);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "MapV_Agg, %"PRIu32" thread%s%s",
+             runs[r].threadsCnt, (1 == runs[r].threadsCnt) ? "" : "s",
+             runs[r].memBytesMax ? ", 16MB" : "");
+    printf("  %-32s %6.1f   (merge %5.1f ms, %"PRIu64" spills)\n", name,
+           ROWS / (bestUpdate + bestMerge) / 1e6, bestMerge * 1e3, spills);
+  }
+
+  free(rows.keys);
+  free(rows.lens);
+  free(rows.deltas);
+  free(rows.buf);
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_Cfg_st
+map_cfg(void)
+{
+  return (MapV_Cfg_st){
+  	.initialSlotCount = 1024,
+  	.distSlotMax      = 32,
+  	.distBktMax       = 8,
+  	.capPctMax        = 95,
+  	.memAlign         = 4096,
+  };
+}
+
+//------------------------------------------------------------------------------
+// the way it's done without MapV_Agg: look the key up, then write it back
+static MapV_st*
+plain(const Rows_st* rows, MapV_AggOp_et op)
+{
+  const MapV_Cfg_st cfg = map_cfg();
+  MapV_st*          map = MapV_Create(&cfg);
+  for (uint64_t i = 0; i < ROWS; i++)
+  {
+    MapV_Val_ut    val;
+    const bool     found = MapV_Find(map, rows->keys[i], rows->lens[i], &val);
+    const uint64_t d     = rows->deltas[i];
+    switch (op) {
+      case MAPV_AGG_OP__COUNT: val.u64 = found ? val.u64 + 1 : 1;               break;
+      case MAPV_AGG_OP__SUM:   val.u64 = found ? val.u64 + d : d;               break;
+      case MAPV_AGG_OP__MIN:   val.u64 = (found && val.u64 < d) ? val.u64 : d;  break;
+      case MAPV_AGG_OP__MAX:   val.u64 = (found && val.u64 > d) ? val.u64 : d;  break;
+    }
+    MapV_Insert(map, rows->keys[i], rows->lens[i], val, true);
+  }
+  return map;
+}
+
+//------------------------------------------------------------------------------
+static MapV_st*
+upsert_add(const Rows_st* rows)
+{
+  const MapV_Cfg_st cfg = map_cfg();
+  MapV_st*          map = MapV_Create(&cfg);
+  for (uint64_t i = 0; i < ROWS; i++) {
+    MapV_UpsertAdd(map, rows->keys[i], rows->lens[i], rows->deltas[i], NULL);
+  }
+  return map;
+}
+
+//------------------------------------------------------------------------------
+static void*
+job_run(void* arg)
+{
+  const Job_st* job = arg;
+  for (uint64_t i = job->beg; i < job->end; i += BATCH)
+  {
+    const uint64_t n = (job->end - i < BATCH) ? job->end - i : BATCH;
+    if (MAPV_ERR__OK != MapV_AggUpdate(job->agg, job->threadId,
+                                       job->rows->keys + i, job->rows->lens + i,
+                                       job->rows->deltas + i, n)) {
+      printf("MapV_AggUpdate() failed\n");
+      exit(1);
+    }
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+// every row, split between threadsCnt threads, then every partition merged.
+// returns the 2^PART_BITS results.
+static MapV_st**
+agg_run(const Rows_st* rows, MapV_AggOp_et op, uint32_t threadsCnt,
+        uint64_t memBytesMax, double* secsUpdate, double* secsMerge,
+        uint64_t* spills)
+{
+  const MapV_AggCfg_st cfg = {
+    .op          = op,
+    .threadsCnt  = threadsCnt,
+    .partBits    = PART_BITS,
+    .memBytesMax = memBytesMax,
+    .mapCfg      = map_cfg(),
+  };
+  MapV_Agg_st* agg = MapV_AggCreate(&cfg);
+  if (NULL == agg) {
+    exit(1);
+  }
+
+  pthread_t tids[THREADS];
+  Job_st    jobs[THREADS];
+  double    t = now_sec();
+  for (uint32_t i = 0; i < threadsCnt; i++) {
+    jobs[i] = (Job_st){ .agg = agg, .rows = rows, .threadId = i,
+                        .beg = ROWS * i / threadsCnt,
+                        .end = ROWS * (i + 1) / threadsCnt, };
+    pthread_create(&tids[i], NULL, job_run, &jobs[i]);
+  }
+  for (uint32_t i = 0; i < threadsCnt; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  *secsUpdate = now_sec() - t;
+
+  *spills = 0;
+  for (uint32_t i = 0; i < threadsCnt; i++) {
+    *spills += agg->threads[i].spillsCntAll;
+  }
+
+  t = now_sec();
+  MapV_st** parts = calloc(agg->partsCnt + 1, sizeof(*parts));
+  for (uint64_t p = 0; p < agg->partsCnt; p++) {
+    if (NULL == (parts[p] = MapV_AggMerge(agg, p))) {
+      printf("MapV_AggMerge(%"PRIu64") failed\n", p);
+      exit(1);
+    }
+  }
+  *secsMerge = now_sec() - t;
+
+  MapV_AggFree(agg);
+  return parts;
+}
+
+//------------------------------------------------------------------------------
+// every key in exactly one partition, with want's value
+static void
+check(const char* name, const MapV_st* want, MapV_st** parts)
+{
+  printf("%-32s ...", name);
+  uint64_t entsCnt = 0;
+  for (uint64_t p = 0; NULL != parts[p]; p++)
+  {
+    MapV_SlotId_t slotId = 0;
+    MapV_Hash_st  hash;
+    MapV_Val_ut   val;
+    while (MapV_Next(parts[p], &slotId, &hash, &val))
+    {
+      MapV_Val_ut wantVal;
+      if (hash.high64 >> (64 - PART_BITS) != p) {
+        printf("entry in partition %"PRIu64" belongs in %"PRIu64"\n", p,
+               hash.high64 >> (64 - PART_BITS));
+        exit(1);
+      }
+      if (!_find_hash(want, hash, &wantVal) || wantVal.u64 != val.u64) {
+        printf("%016"PRIx64": %"PRIu64", want %"PRIu64"\n", hash.high64,
+               val.u64, wantVal.u64);
+        exit(1);
+      }
+      entsCnt++;
+    }
+  }
+  if (entsCnt != want->meta.slotsUsed) {
+    printf("%"PRIu64" keys, want %"PRIu64"\n", entsCnt, want->meta.slotsUsed);
+    exit(1);
+  }
+  printf("ok: %"PRIu64" keys\n", entsCnt);
+}
+
+//------------------------------------------------------------------------------
+static void
+parts_free(MapV_st** parts)
+{
+  for (uint64_t p = 0; NULL != parts[p]; p++) {
+    MapV_Destroy(parts[p]);
+  }
+  free(parts);
+}
@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// every word goes into a cache with room for a fraction of them.
+// the first HOT_CNT words are looked up after every insert; the rest are
+// never looked at again.
+//   - the table never grows past cfg.cacheBytes
+//   - every key still in the cache has its own value
+//   - CLOCK keeps (nearly) all of the hot keys, while cold ones are evicted
+//   - every eviction is reported to hook.onDelete
+
+#define CACHE_BYTES (64 * 1024)
+#define HOT_CNT     100
+
+static void
+on_delete(void* ctx, MapV_Hash_st hash);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  MapV_Cfg_st cfg = test_cfg(0);
+  cfg.cacheBytes  = CACHE_BYTES;
+  MapV_st* map = test_create(&cfg);
+  uint64_t deletes = 0;
+  map->hook.onDelete = on_delete;
+  map->hook.ctx      = &deletes;
+
+  const uint64_t slotsCap = map->meta.slotsCap;
+  const uint64_t memBytes = map->meta.tblBytesReal
+                          + (map->meta.slotsCapReal + 63) / 64 * sizeof(uint64_t);
+  if (memBytes > CACHE_BYTES) {
+    printf("cache uses %"PRIu64" bytes, budget is %d\n", memBytes, CACHE_BYTES);
+    exit(1);
+  }
+
+  //---------------------------
+  printf("Caching...");
+  fflush(stdout);
+  const double tBeg = now_sec();
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Err_et err;
+    if (MAPV_ERR__OK != (err = MapV_Insert(map, key, len,
+                                           (MapV_Val_ut){ .u64 = i }, false))) {
+      printf("insert failed: %"PRIu64" %s\n", i, MapV_PrintErr(err));
+      exit(1);
+    }
+    for (uint64_t h = 0; h < HOT_CNT && h <= i; h++)
+    {
+      const char* hot = MapV_FileLine(file, h, &len);
+      MapV_Val_ut val;
+      MapV_Find(map, hot, len, &val);
+    }
+  }
+  const double secs = now_sec() - tBeg;
+  printf("done. %.6f s\n", secs);
+
+  if (map->meta.slotsCap != slotsCap) {
+    printf("the cache grew from %"PRIu64" to %"PRIu64" slots\n",
+           slotsCap, map->meta.slotsCap);
+    exit(1);
+  }
+  if (0 == map->stats.cacheEvictions || deletes != map->stats.cacheEvictions) {
+    printf("%"PRIu64" evictions, %"PRIu64" reported\n",
+           map->stats.cacheEvictions, deletes);
+    exit(1);
+  }
+  if (map->meta.slotsUsed + map->stats.cacheEvictions != file->linesCnt) {
+    printf("%"PRIu64" entries + %"PRIu64" evictions != %"PRIu64" keys\n",
+           map->meta.slotsUsed, map->stats.cacheEvictions, file->linesCnt);
+    exit(1);
+  }
+
+  //---------------------------
+  printf("Checking...");
+  fflush(stdout);
+  uint64_t hotKept  = 0;
+  uint64_t coldKept = 0;
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Val_ut val;
+    if (!MapV_Find(map, key, len, &val)) {
+      continue;
+    }
+    if (val.u64 != i) {
+      printf("key %.*s: val %"PRIu64", expected %"PRIu64"\n",
+             (int)len, key, val.u64, i);
+      exit(1);
+    }
+    hotKept  += (i <  HOT_CNT);
+    coldKept += (i >= HOT_CNT);
+  }
+  printf("ok. hot kept: %"PRIu64"/%d, cold kept: %"PRIu64"/%"PRIu64
+         ", hit rate %.3f, evictions %"PRIu64"\n",
+         hotKept, HOT_CNT, coldKept, file->linesCnt - HOT_CNT,
+         MapV_CacheHitRate(map), map->stats.cacheEvictions);
+
+  const double coldPct = (double)coldKept / (file->linesCnt - HOT_CNT);
+  if (hotKept < HOT_CNT * 95 / 100 || (double)hotKept / HOT_CNT <= coldPct) {
+    printf("hot keys weren't kept over cold ones\n");
+    exit(1);
+  }
+
+  //---------------------------
+  // deletes still work, and what's left is all still found
+  for (uint64_t i = 0; i < HOT_CNT; i += 2)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Delete(map, key, len);
+  }
+  for (uint64_t i = 1; i < HOT_CNT; i += 2)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Val_ut val;
+    if (MapV_Find(map, key, len, &val) && val.u64 != i) {
+      printf("key %.*s is wrong after deletes\n", (int)len, key);
+      exit(1);
+    }
+  }
+
+  cfg.cacheBytes = 1024;
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a 1KB cache should be too small\n");
+    exit(1);
+  }
+  cfg.cacheBytes = CACHE_BYTES;
+  cfg.multi      = true;
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a cache can't be a multimap\n");
+    exit(1);
+  }
+
+  MapV_Destroy(map);
+  MapV_FileClose(file);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+on_delete(void* ctx, MapV_Hash_st hash)
+{
+  (*(uint64_t*)ctx)++;
+}
@@ -0,0 +1,302 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "MapV.hpp"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// mapv::Map against the C API on the same words:
+//   - same values from Map::find() and MapV_Find(), hits and misses, for a
+//     few Configs, and both timed
+//   - a move-only value type, through inserts, overwrites, erases and the
+//     map's destructor, with every instance accounted for
+//   - integer keys (PodKey), and a Map's c_map() used from C
+
+#define ITERATIONS 100
+
+using mapv::BytesKey;
+using mapv::Config;
+using mapv::Map;
+using mapv::PodKey;
+
+// a move-only value that counts its live instances
+struct Tracked {
+  static inline int live = 0;
+  std::string       word;
+
+  explicit Tracked(std::string_view w) : word(w) { live++; }
+  Tracked(Tracked&& other) : word(std::move(other.word)) { live++; }
+  Tracked& operator=(Tracked&& other) { word = std::move(other.word); return *this; }
+  Tracked(const Tracked&)            = delete;
+  Tracked& operator=(const Tracked&) = delete;
+  ~Tracked() { live--; }
+};
+
+template <typename Cfg>
+static void
+bench(const char* name, MapV_File_st* file);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  bench<Config<>>             ("Config<128, 8>", file);
+  bench<Config<64, 4, 16>>    ("Config< 64, 4>", file);
+  bench<Config<96, 8, 32, 80>>("Config< 96, 8>", file);
+
+  //---------------------------
+  printf("Move-only values...");
+  fflush(stdout);
+  {
+    Map<Tracked> map;
+    for (uint64_t i = 0; i < file->linesCnt; i++) {
+      size_t      len;
+      const char* key = MapV_FileLine(file, i, &len);
+      map.insert(std::string_view(key, len), Tracked(std::string_view(key, len)));
+    }
+    for (uint64_t i = 0; i < file->linesCnt; i += 3) {
+      size_t      len;
+      const char* key = MapV_FileLine(file, i, &len);
+      map.erase(std::string_view(key, len));
+    }
+    for (uint64_t i = 1; i < file->linesCnt; i += 3) {
+      size_t      len;
+      const char* key = MapV_FileLine(file, i, &len);
+      map.insert(std::string_view(key, len), Tracked("again"));
+    }
+    for (uint64_t i = 0; i < file->linesCnt; i++)
+    {
+      size_t            len;
+      const char*       key    = MapV_FileLine(file, i, &len);
+      const Tracked*    val    = map.find(std::string_view(key, len));
+      const std::string expect = (i % 3 == 1) ? "again" : std::string(key, len);
+      if ((nullptr == val) != (i % 3 == 0) || (val && val->word != expect)) {
+        printf("key %.*s is wrong\n", (int)len, key);
+        exit(1);
+      }
+    }
+    if (Tracked::live != (int)map.size()) {
+      printf("%d values alive for %" PRIu64 " entries\n", Tracked::live, map.size());
+      exit(1);
+    }
+
+    Map<std::unique_ptr<int>> ptrs;
+    ptrs["one"] = std::make_unique<int>(1);
+    ptrs.insert("two", std::make_unique<int>(2));
+    if (1 != *ptrs["one"] || 2 != **ptrs.find("two") || ptrs.contains("three")) {
+      printf("unique_ptr values are wrong\n");
+      exit(1);
+    }
+  }
+  if (0 != Tracked::live) {
+    printf("%d values leaked\n", Tracked::live);
+    exit(1);
+  }
+  printf("ok\n");
+
+  //---------------------------
+  printf("Integer keys...");
+  fflush(stdout);
+  Map<uint32_t, PodKey<uint64_t>> ints;
+  for (uint64_t i = 0; i < 100000; i++) {
+    ints[i * 7919] = (uint32_t)i;
+  }
+  for (uint64_t i = 0; i < 100000; i++) {
+    const uint32_t* val = ints.find(i * 7919);
+    if (nullptr == val || *val != i || ints.contains(i * 7919 + 1)) {
+      printf("integer key %" PRIu64 " is wrong\n", i);
+      exit(1);
+    }
+  }
+  const uint64_t key = 7919;
+  MapV_Val_ut    val;
+  if (!MapV_Find(ints.c_map(), &key, sizeof(key), &val) || 1 != val.u64) {
+    printf("c_map() doesn't see the template's entries\n");
+    exit(1);
+  }
+  printf("ok\n");
+
+  //---------------------------
+  printf("A MapV_Snapshot() of c_map()...");
+  fflush(stdout);
+  {
+    Map<uint64_t, PodKey<uint64_t>> snapped;
+    for (uint64_t i = 0; i < 500; i++) {
+      snapped[i] = i;
+    }
+    MapV_st* snap = MapV_Snapshot(snapped.c_map());
+    for (uint64_t i = 0; i < 500; i++) {
+      snapped[i] = i + 1000;
+    }
+    for (uint64_t i = 0; i < 500; i++) {
+      const uint64_t* v = snapped.find(i);
+      if (nullptr == v || *v != i + 1000 || snapped.contains(i + 500)) {
+        printf("find() after a snapshot is wrong for %" PRIu64 "\n", i);
+        exit(1);
+      }
+    }
+    snapped.for_each([](MapV_Hash_st, uint64_t& v) { v += 1000000; });
+    for (uint64_t i = 0; i < 500; i++)
+    {
+      MapV_Val_ut     sval;
+      const uint64_t* v = snapped.find(i);
+      if (   NULL == snap || !MapV_Find(snap, &i, sizeof(i), &sval) || sval.u64 != i
+          || nullptr == v || *v != i + 1001000) {
+        printf("the snapshot or the map is wrong for %" PRIu64 "\n", i);
+        exit(1);
+      }
+    }
+    MapV_Destroy(snap);
+  }
+  printf("ok\n");
+
+  //---------------------------
+  // a table due to grow on its next write: const lookups mustn't write
+  printf("const find()/for_each() after a MapV_Snapshot() copy nothing...");
+  fflush(stdout);
+  {
+    Map<uint64_t, PodKey<uint64_t>> full;
+    uint64_t                        cnt = 0;
+    while (full.c_map()->meta.slotsCapPct <= full.c_map()->cfg.capPctMax) {
+      full[cnt] = cnt;
+      cnt++;
+    }
+    MapV_st*       snap   = MapV_Snapshot(full.c_map());
+    const uint64_t cap    = full.c_map()->meta.slotsCap;
+    const auto&    cfull  = full;
+    uint64_t       sum    = 0;
+    for (uint64_t i = 0; NULL != snap && i < cnt; i++) {
+      const uint64_t* v = cfull.find(i);
+      sum += (nullptr == v) ? UINT64_MAX : *v;
+    }
+    cfull.for_each([&](MapV_Hash_st, const uint64_t& v) { sum += v; });
+    if (   NULL == snap || sum != cnt * (cnt - 1)
+        || cap != full.c_map()->meta.slotsCap
+        || 0   != full.c_map()->snap->copies) {
+      printf("the map changed: %" PRIu64 " slots, %" PRIu64 " pages copied\n",
+             full.c_map()->meta.slotsCap,
+             (NULL == snap) ? 0 : full.c_map()->snap->copies);
+      exit(1);
+    }
+    // through the non-const find(): the one page, and still no grow
+    const uint64_t zero = 0;
+    MapV_Val_ut    sval;
+    *full.find(zero) = 1;
+    if (   1   != full.c_map()->snap->copies
+        || cap != full.c_map()->meta.slotsCap
+        || 1   != *cfull.find(zero)
+        || !MapV_Find(snap, &zero, sizeof(zero), &sval) || 0 != sval.u64) {
+      printf("a write through find() should copy its page only\n");
+      exit(1);
+    }
+    MapV_Destroy(snap);
+  }
+  printf("ok\n");
+
+  MapV_FileClose(file);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+template <typename Cfg>
+static void
+bench(const char* name, MapV_File_st* file)
+{
+  Map<uint64_t, BytesKey, Cfg> map;
+
+  MapV_Cfg_st cfg = {};
+  cfg.distSlotMax = Cfg::slotProbeMax;
+  cfg.distBktMax  = Cfg::bktProbeMax;
+  cfg.capPctMax   = Cfg::capPctMax;
+  cfg.memAlign    = 4096;
+  cfg.fpBits      = Cfg::fpBits;
+  MapV_st* cmap   = MapV_Create(&cfg);
+
+  std::string* misses = new std::string[file->linesCnt];
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    map.insert(std::string_view(key, len), i);
+    MapV_Val_ut cval;
+    cval.u64 = i;
+    MapV_Insert(cmap, key, len, cval, false);
+    misses[i] = std::string(key, len) + "#";
+  }
+
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t          len;
+    const char*     key = MapV_FileLine(file, i, &len);
+    const uint64_t* val = map.find(std::string_view(key, len));
+    MapV_Val_ut     cval;
+    if (   nullptr == val || *val != i
+        || !MapV_Find(cmap, key, len, &cval) || cval.u64 != i
+        || map.contains(misses[i])) {
+      printf("%s: key %.*s is wrong\n", name, (int)len, key);
+      exit(1);
+    }
+  }
+
+  // hits, then misses
+  double   t[2][2];
+  uint64_t found[2] = {0};
+  for (int miss = 0; miss < 2; miss++)
+  {
+    double beg = now_sec();
+    for (int iter = 0; iter < ITERATIONS; iter++) {
+      for (uint64_t i = 0; i < file->linesCnt; i++) {
+        size_t      len;
+        const char* key = miss ? misses[i].data() : MapV_FileLine(file, i, &len);
+        len = miss ? misses[i].size() : len;
+        MapV_Val_ut val;
+        found[0] += MapV_Find(cmap, key, len, &val);
+      }
+    }
+    t[miss][0] = now_sec() - beg;
+
+    beg = now_sec();
+    for (int iter = 0; iter < ITERATIONS; iter++) {
+      for (uint64_t i = 0; i < file->linesCnt; i++) {
+        size_t      len;
+        const char* key = miss ? misses[i].data() : MapV_FileLine(file, i, &len);
+        len = miss ? misses[i].size() : len;
+        found[1] += map.contains(std::string_view(key, len));
+      }
+    }
+    t[miss][1] = now_sec() - beg;
+  }
+  if (found[0] != found[1]) {
+    printf("%s: C found %" PRIu64 ", template found %" PRIu64 "\n",
+           name, found[0], found[1]);
+    exit(1);
+  }
+
+  const double n = (double)ITERATIONS * file->linesCnt;
+  printf("%s  hits/s: C %10.0f  template %10.0f (x%.2f)   "
+         "misses/s: C %10.0f  template %10.0f (x%.2f)\n", name,
+         n / t[0][0], n / t[0][1], t[0][0] / t[0][1],
+         n / t[1][0], n / t[1][1], t[1][0] / t[1][1]);
+
+  delete[] misses;
+  MapV_Destroy(cmap);
+}
@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// cfg.cuckoo:
+//   - the words, for each fingerprint width and as a set: growing from a
+//     tiny table, finds/misses, deletes, re-inserts, MapV_FindBatch(), and
+//     every entry in one of its two buckets or the stash
+//   - hashes made to share two buckets fill them, then the stash, then
+//     grow the table
+//   - robin hood and cuckoo at 90% and 95% load, same keys, same table:
+//     build time, hits and misses per second, and buckets read per lookup
+
+#define BENCH_SLOTS (1 << 20)
+#define BENCH_ITERS 3
+#define KEY_BYTES   16
+
+static void
+check_words(MapV_File_st* file, uint32_t fpBits, bool set);
+
+static void
+check_placement(const MapV_st* map);
+
+static void
+check_stash(void);
+
+static void
+bench(double loadPct);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  check_words(file, 128, false);
+  check_words(file,  96, false);
+  check_words(file,  64, false);
+  check_words(file, 128, true);
+  check_stash();
+
+  MapV_FileClose(file);
+
+  bench(90);
+  bench(95);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+check_words(MapV_File_st* file, uint32_t fpBits, bool set)
+{
+  printf("Words, %3"PRIu32"-bit%s...", fpBits, set ? " set" : "    ");
+  fflush(stdout);
+
+  MapV_Cfg_st cfg = {
+  	.capPctMax        = 95,
+  	.memAlign         = 4096,
+  	.initialSlotCount = 10,
+  	.fpBits           = fpBits,
+  	.set              = set,
+  	.cuckoo           = true,
+  };
+  MapV_st* map = test_create(&cfg);
+
+  const uint64_t n = file->linesCnt;
+  for (uint64_t i = 0; i < n; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    test_put(map, key, len, i);
+  }
+  if (map->meta.slotsUsed != n) {
+    printf("%"PRIu64" entries for %"PRIu64" keys\n", map->meta.slotsUsed, n);
+    exit(1);
+  }
+  check_placement(map);
+
+  // every third key deleted, then every sixth put back
+  for (uint64_t i = 0; i < n; i += 3) {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    if (MAPV_ERR__OK != MapV_Delete(map, key, len)) {
+      printf("delete %"PRIu64" failed\n", i);
+      exit(1);
+    }
+  }
+  for (uint64_t i = 0; i < n; i += 6) {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    set ? MapV_Add(map, key, len)
+        : MapV_Insert(map, key, len, (MapV_Val_ut){ .u64 = i }, false);
+  }
+
+  char        miss[256];
+  const void* keys[1] = { NULL };
+  size_t      lens[1];
+  uint64_t    cnt     = 0;
+  for (uint64_t i = 0; i < n; i++)
+  {
+    size_t      len;
+    const char* key    = MapV_FileLine(file, i, &len);
+    const bool  expect = (i % 3 != 0) || (i % 6 == 0);
+    MapV_Val_ut val;
+    bool        batchFound;
+    MapV_Val_ut batchVal;
+    keys[0] = key;
+    lens[0] = len;
+    MapV_FindBatch(map, keys, lens, 1, &batchVal, &batchFound);
+    if (MapV_Find(map, key, len, &val) != expect || batchFound != expect
+        || (expect && !set && (val.u64 != i || batchVal.u64 != i))) {
+      printf("key %"PRIu64" is wrong\n", i);
+      exit(1);
+    }
+    cnt += expect;
+
+    if (MapV_Find(map, miss, test_miss(key, len, miss, sizeof(miss)), &val)) {
+      printf("miss %"PRIu64" was found\n", i);
+      exit(1);
+    }
+  }
+  if (map->meta.slotsUsed != cnt) {
+    printf("%"PRIu64" entries, expected %"PRIu64"\n", map->meta.slotsUsed, cnt);
+    exit(1);
+  }
+
+  // a walk sees every entry, once
+  MapV_SlotId_t slotId = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  uint64_t      walked = 0;
+  while (MapV_Next(map, &slotId, &hash, &val)) {
+    walked++;
+  }
+  if (walked != cnt) {
+    printf("walked %"PRIu64" of %"PRIu64" entries\n", walked, cnt);
+    exit(1);
+  }
+  check_placement(map);
+
+  printf("ok: %.1f%% full, %"PRIu64" in stash\n",
+         map->meta.slotsCapPct, map->meta.stashUsed);
+  MapV_Destroy(map);
+}
+
+//------------------------------------------------------------------------------
+// every entry is in its first bucket, its second, or the stash
+static void
+check_placement(const MapV_st* map)
+{
+  uint64_t stashed = 0;
+  for (MapV_SlotId_t slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  {
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, slotId, &hv);
+    if (_hv_is_empty(&hv)) {
+      continue;
+    }
+    const MapV_BktId_t bktId = _bkt_from_slot(slotId);
+    if (bktId >= map->meta.bktsCnt) {
+      stashed++;
+    } else if (bktId != _bkt_from_slot(_slot_from_hash_hi(map, hv.hash.high64))
+            && bktId != _cuckoo_bkt_alt(map, hv.hash)) {
+      printf("slot %"PRIu64" holds an entry for other buckets\n", slotId);
+      exit(1);
+    }
+  }
+  if (stashed != map->meta.stashUsed) {
+    printf("%"PRIu64" entries in the stash, meta says %"PRIu64"\n",
+           stashed, map->meta.stashUsed);
+    exit(1);
+  }
+}
+
+//------------------------------------------------------------------------------
+// hashes whose two buckets are buckets 0 and 1 of a 64 slot table: 8 fit in
+// the buckets, the next MAPV_CUCKOO_STASH_BKTS * 4 go to the stash, and the
+// one after that grows the table
+static void
+check_stash(void)
+{
+  printf("Stash...");
+  fflush(stdout);
+
+  MapV_Cfg_st cfg = {
+  	.capPctMax        = 100,
+  	.memAlign         = 4096,
+  	.initialSlotCount = 60, // rounded up to 64
+  	.cuckoo           = true,
+  };
+  MapV_st* map = MapV_Create(&cfg);
+  if (NULL == map || 64 != map->meta.slotsCap) {
+    printf("MapV_Create failed\n");
+    exit(1);
+  }
+
+  const uint64_t stashSlots = MAPV_CUCKOO_STASH_BKTS * MAPV_BKT_SLOTS;
+  const uint64_t cnt        = 2 * MAPV_BKT_SLOTS + stashSlots + 1;
+  MapV_Hash_st   hashes[64];
+  uint64_t       rnd = 12345;
+  for (uint64_t i = 0; i < cnt; i++)
+  {
+    do {
+      rnd = rnd * 6364136223846793005ull + 1442695040888963407ull;
+      hashes[i].high64 = (rnd >> 8) | 1;           // bucket 0: top bits 0
+      rnd = rnd * 6364136223846793005ull + 1442695040888963407ull;
+      hashes[i].low64  = rnd;
+    } while (1 != _cuckoo_bkt_alt(map, hashes[i]));
+
+    MapV_InsertHash(map, hashes[i], (MapV_Val_ut){ .u64 = i }, false);
+
+    const uint64_t stashExpect = (i < 2 * MAPV_BKT_SLOTS) ? 0
+                               : i + 1 - 2 * MAPV_BKT_SLOTS;
+    if (i + 1 < cnt && (64 != map->meta.slotsCap
+                        || stashExpect != map->meta.stashUsed)) {
+      printf("entry %"PRIu64": %"PRIu64" slots, %"PRIu64" in stash\n",
+             i, map->meta.slotsCap, map->meta.stashUsed);
+      exit(1);
+    }
+    check_placement(map);
+  }
+  if (64 == map->meta.slotsCap) {
+    printf("a full stash didn't grow the table\n");
+    exit(1);
+  }
+
+  // deletes from the stash, and finds after growing
+  for (uint64_t i = 0; i < cnt; i++) {
+    const MapV_SlotId_t slotId = _slot_from_hash(map, hashes[i]);
+    if (UINT64_MAX == slotId || _tbl_val_ptr_from_slot(map, slotId)->u64 != i) {
+      printf("entry %"PRIu64" is lost\n", i);
+      exit(1);
+    }
+  }
+  for (uint64_t i = 0; i < cnt; i++) {
+    MapV_DeleteHash(map, hashes[i]);
+  }
+  if (0 != map->meta.slotsUsed || 0 != map->meta.stashUsed) {
+    printf("%"PRIu64" entries left\n", map->meta.slotsUsed);
+    exit(1);
+  }
+  MapV_Destroy(map);
+  printf("ok\n");
+}
+
+//------------------------------------------------------------------------------
+// one table size for both engines. robin hood gets probe bounds wide enough
+// not to grow at this load; if it grows anyway, the load it ran at is shown.
+static void
+bench(double loadPct)
+{
+  const uint64_t n    = (uint64_t)(BENCH_SLOTS * loadPct / 100);
+  char*          keys = malloc(2 * n * KEY_BYTES); // hits, then misses
+  for (uint64_t i = 0; i < 2 * n; i++) {
+    snprintf(keys + i * KEY_BYTES, KEY_BYTES, "key:%011u", (unsigned)i);
+  }
+
+  printf("\n%.0f%% load, %"PRIu64" keys:\n", loadPct, n);
+  for (int cuckoo = 0; cuckoo < 2; cuckoo++)
+  {
+    MapV_Cfg_st cfg = {
+    	.distSlotMax      = 1024,
+    	.distBktMax       = 256,
+    	.capPctMax        = 99,
+    	.memAlign         = 4096,
+    	.initialSlotCount = BENCH_SLOTS - 1, // rounded up to BENCH_SLOTS
+    	.cuckoo           = cuckoo,
+    };
+    MapV_st* map = MapV_Create(&cfg);
+
+    double t = now_sec();
+    for (uint64_t i = 0; i < n; i++) {
+      MapV_Insert(map, keys + i * KEY_BYTES, KEY_BYTES - 1,
+                  (MapV_Val_ut){ .u64 = i }, false);
+    }
+    const double tBuild = now_sec() - t;
+
+    uint64_t found = 0;
+    double   tFind[2];
+    for (int miss = 0; miss < 2; miss++)
+    {
+      const char* base = keys + (miss ? n * KEY_BYTES : 0);
+      t = now_sec();
+      for (int iter = 0; iter < BENCH_ITERS; iter++) {
+        for (uint64_t i = 0; i < n; i++) {
+          MapV_Val_ut val;
+          found += MapV_Find(map, base + i * KEY_BYTES, KEY_BYTES - 1, &val);
+        }
+      }
+      tFind[miss] = now_sec() - t;
+    }
+    if (found != BENCH_ITERS * n) {
+      printf("found %"PRIu64" of %"PRIu64"\n", found, BENCH_ITERS * n);
+      exit(1);
+    }
+
+    const double finds = (double)BENCH_ITERS * n;
+    printf("  %-10s: load %5.1f%%  build %6.0f ns/key  "
+           "hits/s %10.0f  misses/s %10.0f  max bkts/find %"PRIu64"\n",
+           cuckoo ? "cuckoo" : "robin hood", map->meta.slotsCapPct,
+           tBuild / n * 1e9, finds / tFind[0], finds / tFind[1],
+           cuckoo ? (2 + (map->meta.stashUsed ? MAPV_CUCKOO_STASH_BKTS : 0))
+                  : map->meta.distBktIter);
+    MapV_Destroy(map);
+  }
+  free(keys);
+}
@@ -0,0 +1,449 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_Log.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// cfg.filePath:
+//   - the words, growing from a tiny file backed table, at each fingerprint
+//     width and as a set: the file is gone once mapped, no entry is outside
+//     its home slot's page, and finds, MapV_FindBatch(), misses and deletes
+//     agree with an in-memory map
+//   - a file that exists isn't touched; a directory that doesn't, cuckoo,
+//     and cacheBytes are refused
+//   - a table of BENCH_KEYS random keys, in a child process in its own
+//     memory cgroup (root only; skipped otherwise): lookups per second by
+//     MapV_Find() and MapV_FindBatch() as the memory limit shrinks from the
+//     whole table to an eighth of it
+
+#define BENCH_KEYS    (4 << 20)
+#define BENCH_LOOKUPS (1 << 20)
+#define BENCH_SECS    3.0
+
+static MapV_st*
+create(const char* path, uint32_t fpBits, bool set, uint64_t slots);
+
+static void
+check_words(MapV_File_st* file, const char* path, uint32_t fpBits, bool set);
+
+static void
+check_pages(const MapV_st* map);
+
+static void
+check_bad(const char* path);
+
+static void
+bench(const char* path);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/MapV_testFile.%d", (int)getpid());
+
+  MapV_File_st* file = MapV_FileOpen("./input.english_words.10k.txt");
+  if (NULL == file) {
+    exit(1);
+  }
+  check_words(file, path, 128, false);
+  check_words(file, path,  96, false);
+  check_words(file, path,  64, false);
+  check_words(file, path, 128, true);
+  MapV_FileClose(file);
+
+  check_bad(path);
+  bench(path);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_st*
+create(const char* path, uint32_t fpBits, bool set, uint64_t slots)
+{
+  MapV_Cfg_st cfg = test_cfg(slots);
+  cfg.distSlotMax = 64;
+  cfg.distBktMax  = 16;
+  cfg.fpBits      = fpBits;
+  cfg.set         = set;
+  cfg.filePath    = path;
+  return MapV_Create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_words(MapV_File_st* file, const char* path, uint32_t fpBits, bool set)
+{
+  printf("Words, %3"PRIu32"-bit%s...", fpBits, set ? " set" : "    ");
+  fflush(stdout);
+
+  MapV_st* map = create(path, fpBits, set, 10);
+  MapV_st* mem = create(NULL, fpBits, set, 10);
+  if (NULL == map || NULL == mem) {
+    printf("MapV_Create failed\n");
+    exit(1);
+  }
+  struct stat st;
+  if (0 == stat(path, &st)) {
+    printf("%s is still there\n", path);
+    exit(1);
+  }
+
+  const uint64_t n     = file->linesCnt;
+  uint64_t       grows = 0;
+  uint64_t       cap   = map->meta.slotsCap;
+  for (uint64_t i = 0; i < n; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    test_put(map, key, len, i);
+    test_put(mem, key, len, i);
+    if (cap != map->meta.slotsCap) {
+      cap = map->meta.slotsCap;
+      grows++;
+      check_pages(map);
+    }
+  }
+  check_pages(map);
+
+  const void** keys  = malloc(n * sizeof(*keys));
+  size_t*      lens  = malloc(n * sizeof(*lens));
+  MapV_Val_ut* vals  = malloc(n * sizeof(*vals));
+  bool*        found = malloc(n * sizeof(*found));
+  for (uint64_t i = 0; i < n; i++) {
+    keys[i] = MapV_FileLine(file, i, &lens[i]);
+  }
+
+  // every key found, every key with a byte added missed, then every
+  // third key deleted
+  for (uint64_t pass = 0; pass < 2; pass++)
+  {
+    for (uint64_t i = 0; i < n; i++)
+    {
+      char        miss[256];
+      MapV_Val_ut val  = { .u64 = UINT64_MAX };
+      MapV_Val_ut want = { .u64 = UINT64_MAX };
+      const bool  got  = test_has(map, keys[i], lens[i], &val);
+      const bool  in   = test_has(mem, keys[i], lens[i], &want);
+      if (got != in || got != ((0 == pass) || (0 != i % 3))
+          || val.u64 != want.u64) {
+        printf("pass %"PRIu64": key %"PRIu64" found %d\n", pass, i, got);
+        exit(1);
+      }
+      if (test_has(map, miss, test_miss(keys[i], lens[i], miss,
+                                        sizeof(miss)), &val)) {
+        printf("pass %"PRIu64": miss %"PRIu64" found\n", pass, i);
+        exit(1);
+      }
+    }
+
+    const uint64_t hits = MapV_FindBatch(map, keys, lens, n, vals, found);
+    if (hits != map->meta.slotsUsed) {
+      printf("pass %"PRIu64": MapV_FindBatch found %"PRIu64" of %"PRIu64"\n",
+             pass, hits, map->meta.slotsUsed);
+      exit(1);
+    }
+    for (uint64_t i = 0; !set && i < n; i++) {
+      if (found[i] && vals[i].u64 != i) {
+        printf("pass %"PRIu64": MapV_FindBatch key %"PRIu64"\n", pass, i);
+        exit(1);
+      }
+    }
+
+    for (uint64_t i = 0; 0 == pass && i < n; i += 3) {
+      if (MAPV_ERR__OK != (set ? MapV_Remove(map, keys[i], lens[i])
+                               : MapV_Delete(map, keys[i], lens[i]))
+          || MAPV_ERR__OK != (set ? MapV_Remove(mem, keys[i], lens[i])
+                                  : MapV_Delete(mem, keys[i], lens[i]))) {
+        printf("delete %"PRIu64" failed\n", i);
+        exit(1);
+      }
+    }
+  }
+  check_pages(map);
+
+  printf("ok: %"PRIu64" grows, %.1f%% full, %"PRIu64" buckets/page, "
+         "%"PRIu64" KB (in memory: %"PRIu64" KB)\n",
+         grows, map->meta.slotsCapPct, map->meta.pageBkts,
+         map->meta.tblBytes >> 10, mem->meta.tblBytes >> 10);
+
+  free(keys);
+  free(lens);
+  free(vals);
+  free(found);
+  MapV_Destroy(mem);
+  MapV_Destroy(map);
+}
+
+//------------------------------------------------------------------------------
+// every entry at or after its home slot, and in the same page
+static void
+check_pages(const MapV_st* map)
+{
+  for (MapV_SlotId_t slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  {
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, slotId, &hv);
+    if (_hv_is_empty(&hv)) {
+      continue;
+    }
+    const MapV_SlotId_t home = _slot_from_hash_hi(map, hv.hash.high64);
+    if (home > slotId
+        ||    _bkt_from_slot(home)   / map->meta.pageBkts
+           != _bkt_from_slot(slotId) / map->meta.pageBkts) {
+      printf("slot %"PRIu64" (home %"PRIu64") is outside its page\n",
+             slotId, home);
+      exit(1);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+check_bad(const char* path)
+{
+  // an existing file is left alone
+  FILE* f = fopen(path, "w");
+  fputs("not a table", f);
+  fclose(f);
+  if (NULL != create(path, 128, false, 10)) {
+    printf("an existing file was used\n");
+    exit(1);
+  }
+  char  buf[32] = {0};
+  f = fopen(path, "r");
+  if (NULL == f || NULL == fgets(buf, sizeof(buf), f)
+      || 0 != strcmp(buf, "not a table")) {
+    printf("an existing file was changed\n");
+    exit(1);
+  }
+  fclose(f);
+  unlink(path);
+
+  // a checkpoint's fork() wouldn't get its own copy of the table
+  MapV_st* map = create(path, 128, false, 10);
+  if (NULL == map || NULL != MapV_LogOpen(&(MapV_LogCfg_st){ .path = path }, map)) {
+    printf("a file backed map was logged\n");
+    exit(1);
+  }
+  MapV_Destroy(map);
+  unlink(path);
+
+  if (NULL != create("/nonexistent/MapV_testFile", 128, false, 10)) {
+    printf("a table was made in a directory that doesn't exist\n");
+    exit(1);
+  }
+
+  MapV_Cfg_st cfg = {
+  	.distSlotMax = 64,
+  	.distBktMax  = 16,
+  	.capPctMax   = 90,
+  	.memAlign    = 4096,
+  	.filePath    = path,
+  	.cuckoo      = true,
+  };
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a file backed cuckoo table was made\n");
+    exit(1);
+  }
+  cfg.cuckoo     = false;
+  cfg.cacheBytes = 1 << 20;
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a file backed cache was made\n");
+    exit(1);
+  }
+  printf("bad cfgs: ok\n");
+}
+
+//==============================================================================
+// the memory cgroup bench
+
+//------------------------------------------------------------------------------
+static bool
+cg_write(const char* dir, const char* name, uint64_t v)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE* f = fopen(path, "w");
+  if (NULL == f) {
+    return false;
+  }
+  const bool ok = (fprintf(f, "%"PRIu64"\n", v) > 0);
+  return (0 == fclose(f)) && ok;
+}
+
+//------------------------------------------------------------------------------
+// the cgroup's anonymous memory: what a limit can't take back without swap
+static uint64_t
+cg_anon(const char* dir, const char* key)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "%s/memory.stat", dir);
+  FILE* f = fopen(path, "r");
+  if (NULL == f) {
+    return 0;
+  }
+  char     name[64];
+  uint64_t v, anon = 0;
+  while (2 == fscanf(f, "%63s %"SCNu64, name, &v)) {
+    if (0 == strcmp(name, key)) {
+      anon = v;
+      break;
+    }
+  }
+  fclose(f);
+  return anon;
+}
+
+//------------------------------------------------------------------------------
+// lookups per second, by MapV_Find() and by MapV_FindBatch(), of random
+// keys; as many as fit in BENCH_SECS, up to BENCH_LOOKUPS
+static void
+bench_lookups(MapV_st* map, const uint64_t* keys, double* perSec)
+{
+  const void*  ptrs[MAPV_FIND_BATCH * 16];
+  size_t       lens[MAPV_FIND_BATCH * 16];
+  MapV_Val_ut  vals[MAPV_FIND_BATCH * 16];
+  bool         found[MAPV_FIND_BATCH * 16];
+  const uint64_t group = MAPV_FIND_BATCH * 16;
+  uint64_t       s     = 0x2545f4914f6cdd1dull;
+
+  for (uint64_t how = 0; how < 2; how++)
+  {
+    uint64_t n = 0, hits = 0;
+    double   t = now_sec(), el = 0;
+    while (n < BENCH_LOOKUPS && (el = now_sec() - t) < BENCH_SECS)
+    {
+      for (uint64_t i = 0; i < group; i++) {
+        ptrs[i] = &keys[rand_u64(&s) % BENCH_KEYS];
+        lens[i] = sizeof(*keys);
+      }
+      if (0 == how) {
+        for (uint64_t i = 0; i < group; i++) {
+          hits += MapV_Find(map, ptrs[i], lens[i], &vals[i]);
+        }
+      } else {
+        hits += MapV_FindBatch(map, ptrs, lens, group, vals, found);
+      }
+      n += group;
+    }
+    el = now_sec() - t;
+    if (hits != n) {
+      printf("found %"PRIu64" of %"PRIu64"\n", hits, n);
+      exit(1);
+    }
+    perSec[how] = n / el;
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+bench_child(const char* path, const char* cg, const char* anonKey,
+            const char* limitName)
+{
+  uint64_t* keys = malloc(BENCH_KEYS * sizeof(*keys));
+  uint64_t  s    = 0x9e3779b97f4a7c15ull;
+  for (uint64_t i = 0; i < BENCH_KEYS; i++) {
+    keys[i] = rand_u64(&s);
+  }
+
+  // as a baseline, the same table in memory
+  MapV_st* mem = create(NULL, 128, false, BENCH_KEYS * 100 / 70);
+  for (uint64_t i = 0; i < BENCH_KEYS; i++) {
+    MapV_Insert(mem, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i }, true);
+  }
+  double perSec[2];
+  bench_lookups(mem, keys, perSec);
+  printf("  in memory    %5"PRIu64" MB  find %9.0f/s  batch %9.0f/s\n",
+         mem->meta.tblBytes >> 20, perSec[0], perSec[1]);
+  MapV_Destroy(mem);
+
+  MapV_st* map = create(path, 128, false, BENCH_KEYS * 100 / 70);
+  if (NULL == map) {
+    exit(1);
+  }
+  double t = now_sec();
+  for (uint64_t i = 0; i < BENCH_KEYS; i++) {
+    MapV_Insert(map, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i }, true);
+  }
+  printf("  file backed  %5"PRIu64" MB  %.1f%% full, built in %.1f s\n",
+         map->meta.tblBytes >> 20, map->meta.slotsCapPct, now_sec() - t);
+
+  // the limit covers what can't be paged out, plus this much of the table
+  const uint64_t anon      = cg_anon(cg, anonKey);
+  const uint64_t slack     = 32 << 20;
+  const double   ratios[]  = { 1.0, 0.5, 0.25, 0.125 };
+  for (uint64_t r = 0; r < sizeof(ratios) / sizeof(*ratios); r++)
+  {
+    const uint64_t limit = anon + slack + (uint64_t)(ratios[r] * map->meta.tblBytes);
+    if (!cg_write(cg, limitName, limit)) {
+      printf("  couldn't set a %"PRIu64" MB limit\n", limit >> 20);
+      break;
+    }
+    bench_lookups(map, keys, perSec); // warm up to the limit
+    bench_lookups(map, keys, perSec);
+    printf("  RAM:table %5.3f  find %9.0f/s  batch %9.0f/s\n",
+           ratios[r], perSec[0], perSec[1]);
+  }
+
+  MapV_Destroy(map);
+  free(keys);
+  exit(0);
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(const char* path)
+{
+  // cgroup v2 has one hierarchy; v1 has a memory one
+  struct stat st;
+  const bool  v2        = (0 == stat("/sys/fs/cgroup/cgroup.controllers", &st));
+  const char* root      = v2 ? "/sys/fs/cgroup" : "/sys/fs/cgroup/memory";
+  const char* anonKey   = v2 ? "anon" : "rss";
+  const char* limitName = v2 ? "memory.max" : "memory.limit_in_bytes";
+
+  char cg[128];
+  snprintf(cg, sizeof(cg), "%s/MapV_testFile.%d", root, (int)getpid());
+  if (0 != mkdir(cg, 0755)) {
+    printf("%"PRIu64" keys: no memory cgroup (%s); skipping the bench\n",
+           (uint64_t)BENCH_KEYS, strerror(errno));
+    return;
+  }
+
+  printf("%"PRIu64" keys, random lookups:\n", (uint64_t)BENCH_KEYS);
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (0 == pid) {
+    if (!cg_write(cg, "cgroup.procs", getpid())) {
+      printf("  couldn't join %s; skipping the bench\n", cg);
+      exit(0);
+    }
+    bench_child(path, cg, anonKey, limitName);
+  }
+
+  int status = 1;
+  waitpid(pid, &status, 0);
+  rmdir(cg);
+  if (!WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+    printf("bench failed\n");
+    exit(1);
+  }
+}
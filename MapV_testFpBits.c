@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// every fingerprint width (cfg.fpBits), as a map and as a set:
+//   - every key is found, with its value; a key with one byte changed isn't
+//   - delete every other key, and check again
+//   - table size per width, and the reported false positive odds
+
+#define ITERATIONS 100
+
+static MapV_st*
+map_create(uint32_t fpBits, bool set);
+
+static void
+check(MapV_st* map, MapV_File_st* file, const bool* removed);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  bool* removed = calloc(file->linesCnt, sizeof(bool));
+
+  const uint32_t widths[] = { 64, 96, 128 };
+  for (int w = 0; w < 3; w++) {
+  for (int set = 0; set < 2; set++)
+  {
+    memset(removed, 0, file->linesCnt * sizeof(bool));
+
+    MapV_st* map = map_create(widths[w], set);
+    for (uint64_t i = 0; i < file->linesCnt; i++)
+    {
+      size_t      len;
+      const char* key = MapV_FileLine(file, i, &len);
+      test_put(map, key, len, i);
+    }
+
+    const double tBeg = now_sec();
+    uint64_t     hits = 0;
+    for (int iter = 0; iter < ITERATIONS; iter++) {
+      for (uint64_t i = 0; i < file->linesCnt; i++) {
+        size_t      len;
+        const char* key = MapV_FileLine(file, i, &len);
+        MapV_Val_ut val;
+        hits += MapV_Find(map, key, len, &val);
+      }
+    }
+    const double secs = now_sec() - tBeg;
+    if (hits != ITERATIONS * file->linesCnt) {
+      printf("lookups missed keys\n");
+      exit(1);
+    }
+
+    printf("fpBits %3"PRIu32" %s : bucket %3"PRIu64" bytes, table %8"PRIu64
+           " bytes, false pos %.3g, lookups/s %.0f\n",
+           map->cfg.fpBits, set ? "set" : "map", map->meta.bktBytes,
+           map->meta.tblBytes, MapV_FalsePosProb(map), hits / secs);
+
+    check(map, file, removed);
+    for (uint64_t i = 0; i < file->linesCnt; i += 2)
+    {
+      size_t      len;
+      const char* key = MapV_FileLine(file, i, &len);
+      MapV_Err_et err;
+      if (MAPV_ERR__OK != (err = MapV_Delete(map, key, len))) {
+        printf("MapV_Delete failed: %s\n", MapV_PrintErr(err));
+        exit(1);
+      }
+      removed[i] = true;
+    }
+    check(map, file, removed);
+
+    MapV_Destroy(map);
+  }
+  }
+
+  MapV_st* map = map_create(64, false);
+  MapV_Insert(map, "x", 1, (MapV_Val_ut){ .u64 = 1 }, false);
+  if (MapV_FalsePosProb(map) != 1.0 / 18446744073709551616.0) {
+    printf("one key in a 64-bit map should be 2^-64 false positive odds\n");
+    exit(1);
+  }
+  MapV_Destroy(map);
+
+  // an entry sharing the key's high64 comes first in the bucket; only the
+  // slot where both lanes match is the key's
+  map = map_create(128, false);
+  MapV_Hash_st decoy = MapV_Hash(map, "key", 3);
+  decoy.low64       ^= 1;
+  MapV_InsertHash(map, decoy, (MapV_Val_ut){ .u64 = 1 }, false);
+  MapV_Insert(map, "key", 3, (MapV_Val_ut){ .u64 = 2 }, false);
+  MapV_Val_ut val;
+  if (!MapV_Find(map, "key", 3, &val) || 2 != val.u64 || !MapV_Contains(map, "key", 3)) {
+    printf("a key behind an entry with the same high64 wasn't found\n");
+    exit(1);
+  }
+  MapV_Destroy(map);
+
+  MapV_Cfg_st cfg = { .distSlotMax = 32, .distBktMax = 8, .capPctMax = 90,
+                      .memAlign = 4096, .fpBits = 32, };
+  if (NULL != MapV_Create(&cfg)) {
+    printf("32-bit fingerprints should be rejected\n");
+    exit(1);
+  }
+
+  MapV_FileClose(file);
+  free(removed);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_st*
+map_create(uint32_t fpBits, bool set)
+{
+  MapV_Cfg_st cfg = test_cfg(10);
+  cfg.set         = set;
+  cfg.fpBits      = fpBits;
+  return test_create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+static void
+check(MapV_st* map, MapV_File_st* file, const bool* removed)
+{
+  char buf[4096];
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Val_ut val;
+    const bool  found  = MapV_Find(map, key, len, &val);
+    const uint64_t expect = map->cfg.set ? 0 : i;
+    if (found == removed[i] || (found && val.u64 != expect)) {
+      printf("fpBits %"PRIu32": key %.*s: found %d, val %"PRIu64"\n",
+             map->cfg.fpBits, (int)len, key, found, val.u64);
+      exit(1);
+    }
+
+    if (len < sizeof(buf)) {
+      memcpy(buf, key, len);
+      buf[len] = '#';
+      if (MapV_Contains(map, buf, len + 1)) {
+        printf("fpBits %"PRIu32": key %.*s should not be found\n",
+               map->cfg.fpBits, (int)len + 1, buf);
+        exit(1);
+      }
+    }
+  }
+}
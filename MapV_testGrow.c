@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// cfg.growPct:
+//   - the words, growing from a tiny table at 125%, 150% and 200%, for each
+//     fingerprint width, as a set, and with the cuckoo engine: every grow is
+//     by at least growPct (200: to a power of two), entries stay in home
+//     slot order, and finds/misses/deletes work throughout
+//   - random keys at a few counts, for each growPct: table bytes per key
+//     against build time and lookups per second
+
+#define BENCH_ITERS 3
+
+static void
+check_words(MapV_File_st* file, uint32_t growPct, uint32_t fpBits,
+            bool set, bool cuckoo);
+
+static void
+check_order(const MapV_st* map);
+
+static void
+bench(uint64_t keysCnt);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  const uint32_t growPcts[] = { 125, 150, 200 };
+  for (uint64_t i = 0; i < sizeof(growPcts) / sizeof(*growPcts); i++) {
+    check_words(file, growPcts[i], 128, false, false);
+    check_words(file, growPcts[i],  96, false, false);
+    check_words(file, growPcts[i],  64, false, false);
+    check_words(file, growPcts[i], 128, true,  false);
+    check_words(file, growPcts[i], 128, false, true);
+  }
+  MapV_FileClose(file);
+
+  MapV_Cfg_st bad = { .capPctMax = 90, .memAlign = 4096, .growPct = 300 };
+  if (NULL != MapV_Create(&bad)) {
+    printf("growPct 300 was accepted\n");
+    exit(1);
+  }
+
+  // just past a power of two, where doubling wastes the most, and just
+  // below the next one, where it wastes the least
+  bench(1200000);
+  bench(1800000);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+check_words(MapV_File_st* file, uint32_t growPct, uint32_t fpBits,
+            bool set, bool cuckoo)
+{
+  printf("Words, grow %3"PRIu32"%%, %3"PRIu32"-bit%s...", growPct, fpBits,
+         set ? " set   " : cuckoo ? " cuckoo" : "       ");
+  fflush(stdout);
+
+  MapV_Cfg_st cfg = test_cfg(10);
+  cfg.fpBits      = fpBits;
+  cfg.set         = set;
+  cfg.cuckoo      = cuckoo;
+  cfg.growPct     = growPct;
+  MapV_st* map = test_create(&cfg);
+
+  const uint64_t n      = file->linesCnt;
+  uint64_t       grows  = 0;
+  uint64_t       cap    = map->meta.slotsCap;
+  for (uint64_t i = 0; i < n; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    test_put(map, key, len, i);
+
+    if (cap == map->meta.slotsCap) {
+      continue;
+    }
+    // a grow that didn't fit is retried at the next size up, so a table
+    // may grow by more; never by less
+    const uint64_t want = (200 == growPct)
+                        ? cap * 2
+                        : (cap * growPct / 100 + MAPV_BKT_SLOTS - 1)
+                          / MAPV_BKT_SLOTS * MAPV_BKT_SLOTS;
+    const bool pow2 = (0 == (map->meta.slotsCap & (map->meta.slotsCap - 1)));
+    if (map->meta.slotsCap < want
+        || 0 != map->meta.slotsCap % MAPV_BKT_SLOTS
+        || (200 == growPct && !pow2)
+        || (pow2 != (0 != map->meta.slotHashShift))) {
+      printf("grew from %"PRIu64" to %"PRIu64" slots\n", cap, map->meta.slotsCap);
+      exit(1);
+    }
+    cap = map->meta.slotsCap;
+    grows++;
+    check_order(map);
+  }
+  check_order(map);
+
+  // every key found, every key with a byte added missed, then every
+  // third key deleted
+  test_words_check(map, file, false);
+  test_words_del(map, file);
+  test_words_check(map, file, true);
+  check_order(map);
+
+  printf("ok: %"PRIu64" grows, %"PRIu64" slots, %.1f%% full\n",
+         grows, map->meta.slotsCap, map->meta.slotsCapPct);
+  MapV_Destroy(map);
+}
+
+//------------------------------------------------------------------------------
+// robin hood: every entry at or after its home slot, in home slot order.
+// cuckoo: every entry in one of its buckets, or the stash.
+static void
+check_order(const MapV_st* map)
+{
+  uint64_t prev = 0;
+  for (MapV_SlotId_t slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  {
+    MapV_HV_st hv;
+    _tbl_get_hv_from_slot(map, slotId, &hv);
+    if (_hv_is_empty(&hv)) {
+      continue;
+    }
+
+    const MapV_SlotId_t home = _slot_from_hash_hi(map, hv.hash.high64);
+    if (home >= map->meta.slotsCap) {
+      printf("slot %"PRIu64": home %"PRIu64" is past the table\n", slotId, home);
+      exit(1);
+    }
+    if (map->cfg.cuckoo) {
+      const MapV_BktId_t bktId = _bkt_from_slot(slotId);
+      if (bktId != _bkt_from_slot(home)
+          && bktId != _cuckoo_bkt_alt(map, hv.hash)
+          && bktId < map->meta.bktsCnt) {
+        printf("slot %"PRIu64": in neither of its buckets\n", slotId);
+        exit(1);
+      }
+      continue;
+    }
+    if (home > slotId || home < prev) {
+      printf("slot %"PRIu64": out of order\n", slotId);
+      exit(1);
+    }
+    prev = home;
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(uint64_t keysCnt)
+{
+  uint64_t* keys = malloc(keysCnt * sizeof(*keys));
+  uint64_t  s    = 0x9e3779b97f4a7c15ull;
+  for (uint64_t i = 0; i < keysCnt; i++) {
+    keys[i] = rand_u64(&s);
+  }
+
+  printf("%"PRIu64" keys:\n", keysCnt);
+  const uint32_t growPcts[] = { 125, 150, 200 };
+  for (uint64_t g = 0; g < sizeof(growPcts) / sizeof(*growPcts); g++)
+  {
+    MapV_Cfg_st cfg = {
+    	.distSlotMax      = 64,
+    	.distBktMax       = 16,
+    	.capPctMax        = 90,
+    	.memAlign         = 4096,
+    	.initialSlotCount = 1000,
+    	.growPct          = growPcts[g],
+    };
+    MapV_st* map = test_create(&cfg);
+
+    double t = now_sec();
+    for (uint64_t i = 0; i < keysCnt; i++) {
+      MapV_Insert(map, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i }, true);
+    }
+    const double tBuild = now_sec() - t;
+
+    // best of BENCH_ITERS, in a scattered order
+    double   tFind = 1e9;
+    uint64_t found = 0;
+    for (uint64_t it = 0; it < BENCH_ITERS; it++)
+    {
+      t = now_sec();
+      for (uint64_t i = 0; i < keysCnt; i++) {
+        MapV_Val_ut val;
+        found += MapV_Find(map, &keys[(i * 7919) % keysCnt], sizeof(*keys), &val);
+      }
+      t = now_sec() - t;
+      tFind = (t < tFind) ? t : tFind;
+    }
+    if (found != BENCH_ITERS * keysCnt) {
+      printf("found %"PRIu64" of %"PRIu64"\n", found, BENCH_ITERS * keysCnt);
+      exit(1);
+    }
+
+    printf("  grow %3"PRIu32"%%: %4"PRIu64" MB  %5.1f bytes/key  %4.1f%% full  "
+           "build %5.0f ns/key  find %5.1f ns\n",
+           growPcts[g], map->meta.tblBytes >> 20,
+           (double)map->meta.tblBytes / keysCnt, map->meta.slotsCapPct,
+           tBuild * 1e9 / keysCnt, tFind * 1e9 / keysCnt);
+    MapV_Destroy(map);
+  }
+  free(keys);
+}
@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// MapV_HashBatch():
+//   - random keys of 0 to 40 bytes, lengths mixed, and every line of the
+//     input files, for each fingerprint width: every hash is MapV_Hash()'s
+//   - MapV_InsertBatch() builds the same table, byte for byte, as a
+//     MapV_Insert() loop
+//   - MapV_Hash() vs MapV_HashBatch() on the words, and MapV_Find() vs
+//     MapV_FindBatch(), timed
+
+#define RAND_KEYS    (1 << 16)
+#define RAND_LEN_MAX 40
+#define BENCH_ITERS  200
+
+static MapV_st*
+create(uint32_t fpBits, bool set);
+
+static void
+check_hashes(const MapV_st* map, const void* const* keys, const size_t* lens,
+             uint64_t cnt, const char* what);
+
+static void
+check_insert(const void* const* keys, const size_t* lens, uint64_t cnt);
+
+static void
+bench(const void* const* keys, const size_t* lens, uint64_t cnt);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  const char* files[] = {
+    "./input.english_words.10k.txt",
+    "./input.ips_sort_of.3901.txt",
+    "./input.stop_words.536.txt",
+  };
+
+  // random keys; lengths are random too, so the three short groups fill
+  // at different rates and flush with partly used lanes
+  uint64_t s    = 0x9e3779b97f4a7c15ull;
+  uint8_t* buf  = malloc((uint64_t)RAND_KEYS * RAND_LEN_MAX);
+  const void** rKeys = malloc(RAND_KEYS * sizeof(*rKeys));
+  size_t*      rLens = malloc(RAND_KEYS * sizeof(*rLens));
+  for (uint64_t i = 0; i < (uint64_t)RAND_KEYS * RAND_LEN_MAX; i++) {
+    buf[i] = (uint8_t)rand_u64(&s);
+  }
+  for (uint64_t i = 0; i < RAND_KEYS; i++) {
+    rLens[i] = rand_u64(&s) % (RAND_LEN_MAX + 1);
+    rKeys[i] = buf + i * RAND_LEN_MAX;
+  }
+
+  const uint32_t fpBits[] = { 128, 96, 64 };
+  for (uint64_t f = 0; f < sizeof(fpBits) / sizeof(*fpBits); f++)
+  {
+    MapV_st* map = create(fpBits[f], false);
+    check_hashes(map, rKeys, rLens, RAND_KEYS, "random");
+
+    // every count up to a few groups, so every tail is covered
+    for (uint64_t cnt = 0; cnt <= 40; cnt++) {
+      check_hashes(map, rKeys, rLens, cnt, "random, short");
+    }
+
+    for (uint64_t i = 0; i < sizeof(files) / sizeof(*files); i++)
+    {
+      MapV_File_st* file = MapV_FileOpen(files[i]);
+      if (NULL == file) {
+        exit(1);
+      }
+      const void** keys = malloc(file->linesCnt * sizeof(*keys));
+      size_t*      lens = malloc(file->linesCnt * sizeof(*lens));
+      for (uint64_t j = 0; j < file->linesCnt; j++) {
+        keys[j] = MapV_FileLine(file, j, &lens[j]);
+      }
+      check_hashes(map, keys, lens, file->linesCnt, files[i]);
+      free(keys);
+      free(lens);
+      MapV_FileClose(file);
+    }
+    MapV_Destroy(map);
+    printf("fpBits %3u: ok\n", fpBits[f]);
+  }
+
+  MapV_File_st* file = MapV_FileOpen(files[0]);
+  if (NULL == file) {
+    exit(1);
+  }
+  const void** keys = malloc(file->linesCnt * sizeof(*keys));
+  size_t*      lens = malloc(file->linesCnt * sizeof(*lens));
+  for (uint64_t j = 0; j < file->linesCnt; j++) {
+    keys[j] = MapV_FileLine(file, j, &lens[j]);
+  }
+  check_insert(keys, lens, file->linesCnt);
+  check_insert(rKeys, rLens, RAND_KEYS);
+  bench(keys, lens, file->linesCnt);
+
+  free(keys);
+  free(lens);
+  MapV_FileClose(file);
+  free(rKeys);
+  free(rLens);
+  free(buf);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_st*
+create(uint32_t fpBits, bool set)
+{
+  MapV_Cfg_st cfg = test_cfg(1024);
+  cfg.distSlotMax = 64;
+  cfg.distBktMax  = 16;
+  cfg.fpBits      = fpBits;
+  cfg.set         = set;
+  return test_create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_hashes(const MapV_st*     map,
+             const void* const* keys,
+             const size_t*      lens,
+             uint64_t           cnt,
+             const char*        what)
+{
+  MapV_Hash_st* hashes = malloc((cnt + 1) * sizeof(*hashes));
+  MapV_HashBatch(map, keys, lens, cnt, hashes);
+
+  for (uint64_t i = 0; i < cnt; i++)
+  {
+    const MapV_Hash_st want = MapV_Hash(map, keys[i], lens[i]);
+    if (want.high64 != hashes[i].high64 || want.low64 != hashes[i].low64) {
+      printf("%s, fpBits %u: key %"PRIu64" (%zu bytes) hashed to "
+             "%016"PRIx64"%016"PRIx64", not %016"PRIx64"%016"PRIx64"\n",
+             what, map->cfg.fpBits, i, lens[i],
+             hashes[i].high64, hashes[i].low64, want.high64, want.low64);
+      exit(1);
+    }
+  }
+  free(hashes);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_insert(const void* const* keys,
+             const size_t*      lens,
+             uint64_t           cnt)
+{
+  MapV_st*     one   = create(128, false);
+  MapV_st*     batch = create(128, false);
+  MapV_Val_ut* vals  = malloc(cnt * sizeof(*vals));
+
+  for (uint64_t i = 0; i < cnt; i++) {
+    vals[i].u64 = i;
+    MapV_Insert(one, keys[i], lens[i], vals[i], true);
+  }
+  MapV_Err_et err = MapV_InsertBatch(batch, keys, lens, cnt, vals, true);
+  if (MAPV_ERR__OK != err) {
+    printf("MapV_InsertBatch failed: %s\n", MapV_PrintErr(err));
+    exit(1);
+  }
+
+  if (one->meta.slotsUsed != batch->meta.slotsUsed
+      || one->meta.tblBytes != batch->meta.tblBytes
+      || 0 != memcmp(one->tbl.bkt, batch->tbl.bkt, one->meta.tblBytes)) {
+    printf("MapV_InsertBatch built a different table: "
+           "%"PRIu64" entries, not %"PRIu64"\n",
+           batch->meta.slotsUsed, one->meta.slotsUsed);
+    exit(1);
+  }
+
+  MapV_st* set = create(128, true);
+  if (MAPV_ERR__SET_HAS_NO_VALS
+      != MapV_InsertBatch(set, keys, lens, cnt, vals, true)) {
+    printf("MapV_InsertBatch into a set\n");
+    exit(1);
+  }
+  MapV_Destroy(set);
+
+  MapV_Destroy(one);
+  MapV_Destroy(batch);
+  free(vals);
+  printf("MapV_InsertBatch, %"PRIu64" keys: ok\n", cnt);
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(const void* const* keys,
+      const size_t*      lens,
+      uint64_t           cnt)
+{
+  MapV_st*      map    = create(128, false);
+  MapV_Hash_st* hashes = malloc(cnt * sizeof(*hashes));
+  MapV_Val_ut*  vals   = malloc(cnt * sizeof(*vals));
+  bool*         found  = malloc(cnt * sizeof(*found));
+  uint64_t      sum    = 0;
+
+  for (uint64_t i = 0; i < cnt; i++) {
+    MapV_Insert(map, keys[i], lens[i], (MapV_Val_ut){ .u64 = i }, true);
+  }
+
+  double t = now_sec();
+  for (uint64_t it = 0; it < BENCH_ITERS; it++) {
+    for (uint64_t i = 0; i < cnt; i++) {
+      hashes[i] = MapV_Hash(map, keys[i], lens[i]);
+    }
+    sum += hashes[it % cnt].high64;
+  }
+  const double tHash = now_sec() - t;
+
+  t = now_sec();
+  for (uint64_t it = 0; it < BENCH_ITERS; it++) {
+    MapV_HashBatch(map, keys, lens, cnt, hashes);
+    sum += hashes[it % cnt].high64;
+  }
+  const double tHashBatch = now_sec() - t;
+
+  t = now_sec();
+  for (uint64_t it = 0; it < BENCH_ITERS; it++) {
+    for (uint64_t i = 0; i < cnt; i++) {
+      sum += MapV_Find(map, keys[i], lens[i], &vals[i]);
+    }
+  }
+  const double tFind = now_sec() - t;
+
+  t = now_sec();
+  for (uint64_t it = 0; it < BENCH_ITERS; it++) {
+    sum += MapV_FindBatch(map, keys, lens, cnt, vals, found);
+  }
+  const double tFindBatch = now_sec() - t;
+
+  const double n = (double)BENCH_ITERS * cnt;
+  printf("hash      : %5.1f ns/key   batch: %5.1f ns/key  (%u lanes)\n",
+         tHash * 1e9 / n, tHashBatch * 1e9 / n, MAPV_HASH_LANES);
+  printf("find      : %5.1f ns/key   batch: %5.1f ns/key\n",
+         tFind * 1e9 / n, tFindBatch * 1e9 / n);
+  printf("(checksum %"PRIu64")\n", sum);
+
+  MapV_Destroy(map);
+  free(hashes);
+  free(vals);
+  free(found);
+}
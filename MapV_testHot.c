@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// cfg.hotCounters / MapV_Optimize():
+//   - the words, looked up with a skew (key i about n / (i + 1) times), for
+//     each fingerprint width, as a set, and as a cache: after MapV_Optimize()
+//     every run of entries with the same home slot is sorted by count, the
+//     table is still in home slot order, and finds/misses/deletes/inserts
+//     work
+//   - no counters: MapV_Optimize() fails; the cuckoo engine can't have them
+//   - random keys at 95% load, looked up zipfian (s = 1): buckets read per
+//     lookup and lookup time, before and after MapV_Optimize()
+
+#define BENCH_SLOTS   (1 << 20)
+#define BENCH_LOOKUPS (8 * 1024 * 1024)
+#define BENCH_ITERS   3
+
+static void
+check_words(MapV_File_st* file, uint32_t fpBits, bool set, bool cache);
+
+static void
+check_runs(const MapV_st* map);
+
+static void
+bench(void);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+  check_words(file, 128, false, false);
+  check_words(file,  96, false, false);
+  check_words(file,  64, false, false);
+  check_words(file, 128, true,  false);
+  check_words(file, 128, false, true);
+  MapV_FileClose(file);
+
+  MapV_Cfg_st cfg = { .capPctMax = 90, .memAlign = 4096 };
+  MapV_st*    map = MapV_Create(&cfg);
+  if (MAPV_ERR__OPTIMIZE_NO_COUNTERS != MapV_Optimize(map)) {
+    printf("MapV_Optimize() without counters\n");
+    exit(1);
+  }
+  MapV_Destroy(map);
+  cfg.hotCounters = 1024;
+  cfg.cuckoo      = true;
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a cuckoo map with counters was created\n");
+    exit(1);
+  }
+
+  bench();
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+check_words(MapV_File_st* file, uint32_t fpBits, bool set, bool cache)
+{
+  printf("Words, %3"PRIu32"-bit%s...", fpBits,
+         set ? " set  " : cache ? " cache" : "      ");
+  fflush(stdout);
+
+  // a table the words just fit in, so runs are long enough to sort
+  const uint64_t n   = file->linesCnt;
+  MapV_Cfg_st    cfg = {
+  	.distSlotMax      = 64,
+  	.distBktMax       = 16,
+  	.capPctMax        = 99,
+  	.memAlign         = 4096,
+  	.initialSlotCount = n + n / 20,
+  	.fpBits           = fpBits,
+  	.set              = set,
+  	.hotCounters      = 4 * n,
+  	.cacheBytes       = cache ? 1024 * 1024 : 0,
+  };
+  MapV_st* map = test_create(&cfg);
+
+  // coldest first, so every hot key starts behind the colder ones
+  for (uint64_t i = n; i-- > 0; )
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    test_put(map, key, len, i);
+  }
+
+  for (uint64_t i = 0; i < n; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    for (uint64_t j = 0; j < n / (i + 1); j++) {
+      MapV_Val_ut val;
+      set ? MapV_Contains(map, key, len) : MapV_Find(map, key, len, &val);
+    }
+  }
+
+  if (MAPV_ERR__OK != MapV_Optimize(map)) {
+    printf("MapV_Optimize failed\n");
+    exit(1);
+  }
+  check_runs(map);
+
+  // the hottest key is first in its run
+  size_t              len;
+  const char*         key  = MapV_FileLine(file, 0, &len);
+  const MapV_SlotId_t slot = _slot_from_key(map, key, len);
+  const MapV_SlotId_t home = _slot_from_hash_hi(map, _hashhi_from_slot(map, slot));
+  if (slot != home && home == _slot_from_hash_hi(map,
+                                                 _hashhi_from_slot(map, slot - 1))) {
+    printf("the hottest key isn't first in its run\n");
+    exit(1);
+  }
+
+  // every key found, every key with a byte added missed, then every third
+  // key deleted and put back
+  test_words_check(map, file, false);
+  test_words_del(map, file);
+  for (uint64_t i = 0; i < n; i += 3) {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    test_put(map, key, len, i);
+  }
+  test_words_check(map, file, false);
+  if (map->meta.slotsUsed != n) {
+    printf("%"PRIu64" entries for %"PRIu64" keys\n", map->meta.slotsUsed, n);
+    exit(1);
+  }
+
+  printf("ok: %"PRIu64" swaps\n", map->stats.hotSwaps);
+  MapV_Destroy(map);
+}
+
+//------------------------------------------------------------------------------
+// home slot order throughout, and each home slot's entries by count
+static void
+check_runs(const MapV_st* map)
+{
+  MapV_SlotId_t prevHome = 0;
+  uint64_t      prevCnt  = 0;
+  for (MapV_SlotId_t slotId = 0; slotId < map->meta.slotsCapReal; slotId++)
+  {
+    const MapV_HashHi_t hashHi = _hashhi_from_slot(map, slotId);
+    if (0 == hashHi) {
+      prevCnt = UINT64_MAX;
+      continue;
+    }
+    const MapV_SlotId_t home = _slot_from_hash_hi(map, hashHi);
+    const uint64_t      cnt  = _hot_get(map, hashHi);
+    if (home > slotId || home < prevHome) {
+      printf("slot %"PRIu64": out of home slot order\n", slotId);
+      exit(1);
+    }
+    // counts were halved after sorting; the order holds either way
+    if (home == prevHome && cnt > prevCnt) {
+      printf("slot %"PRIu64": %"PRIu64" lookups after %"PRIu64"\n",
+             slotId, cnt, prevCnt);
+      exit(1);
+    }
+    prevHome = home;
+    prevCnt  = cnt;
+  }
+}
+
+//------------------------------------------------------------------------------
+// buckets read per lookup, from where the keys are: 1 + the key's bucket's
+// distance from its home bucket
+static double
+bkts_per_lookup(const MapV_st* map, const uint64_t* keys,
+                const uint64_t* lookups, uint64_t lookupsCnt)
+{
+  uint64_t bkts = 0;
+  for (uint64_t i = 0; i < lookupsCnt; i++)
+  {
+    const uint64_t*     key  = &keys[lookups[i]];
+    const MapV_SlotId_t slot = _slot_from_key(map, key, sizeof(*key));
+    const MapV_SlotId_t home = _slot_from_hash_hi(map, _hashhi_from_slot(map, slot));
+    bkts += 1 + _bkt_from_slot(slot) - _bkt_from_slot(home);
+  }
+  return (double)bkts / lookupsCnt;
+}
+
+//------------------------------------------------------------------------------
+static double
+find_ns(MapV_st* map, const uint64_t* keys,
+        const uint64_t* lookups, uint64_t lookupsCnt)
+{
+  double best = 1e9;
+  for (uint64_t it = 0; it < BENCH_ITERS; it++)
+  {
+    uint64_t found = 0;
+    double   t     = now_sec();
+    for (uint64_t i = 0; i < lookupsCnt; i++) {
+      MapV_Val_ut val;
+      found += MapV_Find(map, &keys[lookups[i]], sizeof(*keys), &val);
+    }
+    t = now_sec() - t;
+    if (found != lookupsCnt) {
+      printf("found %"PRIu64" of %"PRIu64"\n", found, lookupsCnt);
+      exit(1);
+    }
+    best = (t < best) ? t : best;
+  }
+  return best * 1e9 / lookupsCnt;
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(void)
+{
+  const uint64_t n    = BENCH_SLOTS * 95 / 100;
+  uint64_t*      keys = malloc(n * sizeof(*keys));
+  uint64_t       s    = 0x9e3779b97f4a7c15ull;
+  for (uint64_t i = 0; i < n; i++) {
+    keys[i] = rand_u64(&s);
+  }
+
+  // zipfian, s = 1: key i is looked up in proportion to 1 / (i + 1)
+  double* cdf = malloc(n * sizeof(*cdf));
+  double  sum = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    sum   += 1.0 / (i + 1);
+    cdf[i] = sum;
+  }
+  uint64_t* lookups = malloc(BENCH_LOOKUPS * sizeof(*lookups));
+  for (uint64_t i = 0; i < BENCH_LOOKUPS; i++)
+  {
+    const double u  = (double)(rand_u64(&s) >> 11) / (1ull << 53) * sum;
+    uint64_t     lo = 0;
+    uint64_t     hi = n - 1;
+    while (lo < hi) {
+      const uint64_t mid = (lo + hi) / 2;
+      if (cdf[mid] < u) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    lookups[i] = lo;
+  }
+  free(cdf);
+
+  // keys inserted in random order, not by heat
+  MapV_Cfg_st cfg = {
+  	.distSlotMax      = 1024,
+  	.distBktMax       = 256,
+  	.capPctMax        = 99,
+  	.memAlign         = 4096,
+  	.initialSlotCount = BENCH_SLOTS - 1,
+  	.hotCounters      = 4 * n,
+  };
+  MapV_st* map = test_create(&cfg);
+  uint64_t* order = malloc(n * sizeof(*order));
+  for (uint64_t i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  for (uint64_t i = n - 1; i > 0; i--) {
+    const uint64_t j   = rand_u64(&s) % (i + 1);
+    const uint64_t tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    const uint64_t k = order[i];
+    MapV_Insert(map, &keys[k], sizeof(*keys), (MapV_Val_ut){ .u64 = k }, true);
+  }
+  free(order);
+
+  const double bktsBefore = bkts_per_lookup(map, keys, lookups, BENCH_LOOKUPS);
+  const double nsBefore   = find_ns(map, keys, lookups, BENCH_LOOKUPS);
+  double       t          = now_sec();
+  MapV_Optimize(map);
+  const double tOptimize  = now_sec() - t;
+  const double bktsAfter  = bkts_per_lookup(map, keys, lookups, BENCH_LOOKUPS);
+  const double nsAfter    = find_ns(map, keys, lookups, BENCH_LOOKUPS);
+
+  printf("zipfian, %"PRIu64" keys, %.1f%% full:\n", n, map->meta.slotsCapPct);
+  printf("  before : %.4f buckets/lookup  %5.1f ns/lookup\n", bktsBefore, nsBefore);
+  printf("  after  : %.4f buckets/lookup  %5.1f ns/lookup  "
+         "(MapV_Optimize: %.0f ms, %"PRIu64" swaps)\n",
+         bktsAfter, nsAfter, tOptimize * 1e3, map->stats.hotSwaps);
+  if (bktsAfter > bktsBefore) {
+    printf("more buckets per lookup after MapV_Optimize()\n");
+    exit(1);
+  }
+
+  MapV_Destroy(map);
+  free(lookups);
+  free(keys);
+}
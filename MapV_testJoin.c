@@ -0,0 +1,398 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_Join.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// build side: the english words, value = line + 1, with the first 100
+// repeated at the end with new values (the last must win). probe side: the
+// stop words, the ips and the english words, PROBE_REPS times over. every
+// join (one table or partitioned, 1 or THREADS probe threads, 128 or 64-bit)
+// must give exactly the hits a MapV_Find() per row gives on a
+// MapV_Insert()ed map.
+// then a build side of BENCH_BUILD keys is timed: bulk loading against
+// MapV_Insert(), and probing BENCH_PROBE rows (half of them hits) against
+// a MapV_Find() loop.
+
+#define PROBE_REPS  20
+#define REPEATS     100
+#define THREADS     4
+#define BENCH_BUILD 2000000
+#define BENCH_PROBE 8000000
+#define BENCH_CALL  (1 << 20) // rows per MapV_JoinProbe() call
+
+typedef struct Side_st {
+  const void** keys;
+  size_t*      lens;
+  MapV_Val_ut* vals;
+  uint64_t     cnt;
+} Side_st;
+
+typedef struct Job_st {
+  const MapV_Join_st* join;
+  const Side_st*      probe;
+  uint64_t            beg;
+  uint64_t            end;
+  MapV_JoinHit_st*    hits;
+  uint64_t            hitsCnt;
+} Job_st;
+
+static MapV_Cfg_st
+map_cfg(void);
+
+static void
+side_add(Side_st* side, const char* key, size_t len, uint64_t val);
+
+static void*
+job_run(void* arg);
+
+static uint64_t
+probe(const MapV_Join_st* join, const Side_st* side, uint32_t threadsCnt,
+      MapV_JoinHit_st* hits);
+
+static int
+cmp_hit(const void* a, const void* b);
+
+static void
+check(const char* name, const MapV_JoinCfg_st* cfg, const Side_st* build,
+      const Side_st* probeSide, uint32_t threadsCnt,
+      const MapV_JoinHit_st* want, uint64_t wantCnt);
+
+static void
+bench(void);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  const char* paths[] = { "./input.stop_words.536.txt",
+                          "./input.ips_sort_of.3901.txt",
+                          "./input.english_words.10k.txt", };
+  MapV_File_st* files[3];
+  for (int f = 0; f < 3; f++) {
+    if (NULL == (files[f] = MapV_FileOpen(paths[f]))) {
+      exit(1);
+    }
+  }
+
+  Side_st build = {0};
+  Side_st probeSide = {0};
+  for (uint64_t i = 0; i < files[2]->linesCnt; i++) {
+    size_t      len;
+    const char* key = MapV_FileLine(files[2], i, &len);
+    side_add(&build, key, len, i + 1);
+  }
+  for (uint64_t i = 0; i < REPEATS; i++) {
+    side_add(&build, build.keys[i], build.lens[i], 1000000 + i);
+  }
+  for (int rep = 0; rep < PROBE_REPS; rep++) {
+  for (int f = 0; f < 3; f++) {
+  for (uint64_t i = 0; i < files[f]->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(files[f], i, &len);
+    side_add(&probeSide, key, len, 0);
+  }
+  }
+  }
+
+  //---------------------------
+  // the plain way
+  const MapV_Cfg_st cfg = map_cfg();
+  MapV_st*          ref = MapV_Create(&cfg);
+  for (uint64_t i = 0; i < build.cnt; i++) {
+    MapV_Insert(ref, build.keys[i], build.lens[i], build.vals[i], true);
+  }
+  MapV_JoinHit_st* want    = malloc(probeSide.cnt * sizeof(*want));
+  uint64_t         wantCnt = 0;
+  for (uint64_t i = 0; i < probeSide.cnt; i++) {
+    MapV_Val_ut val;
+    if (MapV_Find(ref, probeSide.keys[i], probeSide.lens[i], &val)) {
+      want[wantCnt++] = (MapV_JoinHit_st){ i, val };
+    }
+  }
+  MapV_Destroy(ref);
+
+  MapV_JoinCfg_st one  = { .llcBytes = UINT64_MAX, .mapCfg = map_cfg(), };
+  MapV_JoinCfg_st part = { .llcBytes = 1, .partBytes = 16 << 10,
+                           .mapCfg = map_cfg(), };
+  check("one table, 1 thread",          &one,  &build, &probeSide, 1,
+        want, wantCnt);
+  check("one table, 4 threads",         &one,  &build, &probeSide, THREADS,
+        want, wantCnt);
+  check("partitioned, 1 thread",        &part, &build, &probeSide, 1,
+        want, wantCnt);
+  check("partitioned, 4 threads",       &part, &build, &probeSide, THREADS,
+        want, wantCnt);
+  one.mapCfg.fpBits  = 64;
+  part.mapCfg.fpBits = 64;
+  check("64-bit, one table",            &one,  &build, &probeSide, 1,
+        want, wantCnt);
+  check("64-bit, partitioned",          &part, &build, &probeSide, THREADS,
+        want, wantCnt);
+
+  // maps MapV_BulkLoad() won't fill
+  MapV_Cfg_st  bad    = map_cfg();
+  MapV_st*     full   = MapV_Create(&bad);
+  MapV_Hash_st hash   = MapV_Hash(full, "key", 3);
+  MapV_Insert(full, "key", 3, (MapV_Val_ut){ .u64 = 1 }, false);
+  bad.cuckoo          = true;
+  MapV_st*     cuckoo = MapV_Create(&bad);
+  if (   MAPV_ERR__BULK_LOAD_NOT_EMPTY   != MapV_BulkLoad(full,   &hash, NULL, 1)
+      || MAPV_ERR__BULK_LOAD_UNSUPPORTED != MapV_BulkLoad(cuckoo, &hash, NULL, 1)) {
+    printf("MapV_BulkLoad() filled a map it shouldn't have\n");
+    exit(1);
+  }
+  MapV_Destroy(full);
+  MapV_Destroy(cuckoo);
+
+  free(want);
+  for (int f = 0; f < 3; f++) {
+    MapV_FileClose(files[f]);
+  }
+
+  bench();
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_Cfg_st
+map_cfg(void)
+{
+  return (MapV_Cfg_st){
+  	.initialSlotCount = 1024,
+  	.distSlotMax      = 32,
+  	.distBktMax       = 8,
+  	.capPctMax        = 90,
+  	.memAlign         = 4096,
+  };
+}
+
+//------------------------------------------------------------------------------
+static void
+side_add(Side_st* side, const char* key, size_t len, uint64_t val)
+{
+  if (0 == (side->cnt & (side->cnt - 1))) {
+    const uint64_t cap = side->cnt ? side->cnt * 2 : 1;
+    side->keys = realloc(side->keys, cap * sizeof(*side->keys));
+    side->lens = realloc(side->lens, cap * sizeof(*side->lens));
+    side->vals = realloc(side->vals, cap * sizeof(*side->vals));
+  }
+  side->keys[side->cnt]     = key;
+  side->lens[side->cnt]     = len;
+  side->vals[side->cnt].u64 = val;
+  side->cnt++;
+}
+
+//------------------------------------------------------------------------------
+static void*
+job_run(void* arg)
+{
+  Job_st* job = arg;
+  for (uint64_t i = job->beg; i < job->end; i += BENCH_CALL)
+  {
+    const uint64_t n = (job->end - i < BENCH_CALL) ? job->end - i : BENCH_CALL;
+    job->hitsCnt += MapV_JoinProbe(job->join, job->probe->keys + i,
+                                   job->probe->lens + i, n, i,
+                                   job->hits + job->hitsCnt);
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+// every probe row, split between threadsCnt threads, each probing its own
+// share in BENCH_CALL row calls. the hits are gathered into hits, thread by
+// thread.
+static uint64_t
+probe(const MapV_Join_st* join, const Side_st* side, uint32_t threadsCnt,
+      MapV_JoinHit_st* hits)
+{
+  pthread_t tids[THREADS];
+  Job_st    jobs[THREADS];
+  for (uint32_t t = 0; t < threadsCnt; t++) {
+    jobs[t] = (Job_st){ .join = join, .probe = side,
+                        .beg  = side->cnt * t / threadsCnt,
+                        .end  = side->cnt * (t + 1) / threadsCnt, };
+    jobs[t].hits = malloc((jobs[t].end - jobs[t].beg + 1) * sizeof(*hits));
+    pthread_create(&tids[t], NULL, job_run, &jobs[t]);
+  }
+
+  uint64_t hitsCnt = 0;
+  for (uint32_t t = 0; t < threadsCnt; t++) {
+    pthread_join(tids[t], NULL);
+    memcpy(hits + hitsCnt, jobs[t].hits, jobs[t].hitsCnt * sizeof(*hits));
+    hitsCnt += jobs[t].hitsCnt;
+    free(jobs[t].hits);
+  }
+  return hitsCnt;
+}
+
+//------------------------------------------------------------------------------
+static int
+cmp_hit(const void* a, const void* b)
+{
+  const MapV_JoinHit_st* ha = a;
+  const MapV_JoinHit_st* hb = b;
+  return (ha->probeRowId > hb->probeRowId) - (ha->probeRowId < hb->probeRowId);
+}
+
+//------------------------------------------------------------------------------
+static void
+check(const char* name, const MapV_JoinCfg_st* cfg, const Side_st* build,
+      const Side_st* probeSide, uint32_t threadsCnt,
+      const MapV_JoinHit_st* want, uint64_t wantCnt)
+{
+  printf("%-24s ...", name);
+  MapV_Join_st* join = MapV_JoinBuild(cfg, build->keys, build->lens,
+                                      build->vals, build->cnt);
+  if (NULL == join) {
+    exit(1);
+  }
+  if (join->buildCnt != build->cnt - REPEATS) {
+    printf("%"PRIu64" build keys, want %"PRIu64"\n", join->buildCnt,
+           build->cnt - REPEATS);
+    exit(1);
+  }
+
+  MapV_JoinHit_st* hits    = malloc(probeSide->cnt * sizeof(*hits));
+  const uint64_t   hitsCnt = probe(join, probeSide, threadsCnt, hits);
+  qsort(hits, hitsCnt, sizeof(*hits), cmp_hit);
+  if (hitsCnt != wantCnt) {
+    printf("%"PRIu64" hits, want %"PRIu64"\n", hitsCnt, wantCnt);
+    exit(1);
+  }
+  for (uint64_t i = 0; i < hitsCnt; i++) {
+    if (   hits[i].probeRowId != want[i].probeRowId
+        || hits[i].val.u64    != want[i].val.u64) {
+      printf("hit %"PRIu64": row %"PRIu64" = %"PRIu64", want row %"PRIu64
+             " = %"PRIu64"\n", i, hits[i].probeRowId, hits[i].val.u64,
+             want[i].probeRowId, want[i].val.u64);
+      exit(1);
+    }
+  }
+  printf("ok: %"PRIu64" partitions, %"PRIu64" hits of %"PRIu64" rows\n",
+         join->partsCnt, hitsCnt, probeSide->cnt);
+  free(hits);
+  MapV_JoinFree(join);
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(void)
+{
+  printf("%d build keys, %d probe rows, half of them hits (best of 3):\n",
+         BENCH_BUILD, BENCH_PROBE);
+
+  // keys like "url/0001234567"; probe rows are build keys or their misses
+  char*   buf   = malloc((uint64_t)BENCH_BUILD * 2 * 16);
+  Side_st build = {0};
+  Side_st side  = {0};
+  for (uint64_t k = 0; k < (uint64_t)BENCH_BUILD * 2; k++) {
+    snprintf(buf + k * 16, 16, "url/%010"PRIu64, k * 2654435761u % 10000000000u);
+  }
+  for (uint64_t k = 0; k < BENCH_BUILD; k++) {
+    side_add(&build, buf + k * 16, 14, k);
+  }
+  uint64_t s = 0x9e3779b97f4a7c15ull;
+  for (uint64_t i = 0; i < BENCH_PROBE; i++) {
+    side_add(&side, buf + (rand_u64(&s) % (BENCH_BUILD * 2)) * 16, 14, 0);
+  }
+
+  //---------------------------
+  const MapV_Cfg_st cfg  = map_cfg();
+  double            best = 1e9;
+  MapV_st*          map  = NULL;
+  for (int iter = 0; iter < 3; iter++) {
+    MapV_Destroy(map);
+    const double t = now_sec();
+    map = MapV_Create(&cfg);
+    for (uint64_t i = 0; i < build.cnt; i++) {
+      MapV_Insert(map, build.keys[i], build.lens[i], build.vals[i], true);
+    }
+    best = (now_sec() - t < best) ? now_sec() - t : best;
+  }
+  printf("  build, MapV_Insert()               %6.0f ms\n", best * 1e3);
+
+  MapV_JoinCfg_st jc[2] = {
+    { .llcBytes = UINT64_MAX, .mapCfg = map_cfg(), },
+    { .mapCfg = map_cfg(), },
+  };
+  jc[1].llcBytes = 1;
+  MapV_Join_st* joins[2] = { NULL, NULL };
+  for (int j = 0; j < 2; j++)
+  {
+    best = 1e9;
+    for (int iter = 0; iter < 3; iter++) {
+      MapV_JoinFree(joins[j]);
+      const double t = now_sec();
+      joins[j] = MapV_JoinBuild(&jc[j], build.keys, build.lens, build.vals,
+                                build.cnt);
+      best = (now_sec() - t < best) ? now_sec() - t : best;
+    }
+    printf("  build, MapV_JoinBuild(), %-9s %6.0f ms   (%"PRIu64" partitions,"
+           " %.0f MB)\n", j ? "partition" : "one table", best * 1e3,
+           joins[j]->partsCnt, joins[j]->tblBytes / 1e6);
+  }
+
+  //---------------------------
+  uint64_t hitsWant = 0;
+  best = 1e9;
+  for (int iter = 0; iter < 3; iter++) {
+    const double t = now_sec();
+    hitsWant = 0;
+    for (uint64_t i = 0; i < side.cnt; i++) {
+      MapV_Val_ut val;
+      hitsWant += MapV_Find(map, side.keys[i], side.lens[i], &val);
+    }
+    best = (now_sec() - t < best) ? now_sec() - t : best;
+  }
+  printf("  probe, MapV_Find()                 %6.1f ns/row\n",
+         best / side.cnt * 1e9);
+
+  MapV_JoinHit_st* hits = malloc(side.cnt * sizeof(*hits));
+  for (int j = 0; j < 2; j++)
+  {
+    best = 1e9;
+    for (int iter = 0; iter < 3; iter++) {
+      const double   t       = now_sec();
+      const uint64_t hitsCnt = probe(joins[j], &side, 1, hits);
+      best = (now_sec() - t < best) ? now_sec() - t : best;
+      if (hitsCnt != hitsWant) {
+        printf("%"PRIu64" hits, want %"PRIu64"\n", hitsCnt, hitsWant);
+        exit(1);
+      }
+    }
+    printf("  probe, MapV_JoinProbe(), %-9s %6.1f ns/row\n",
+           j ? "partition" : "one table", best / side.cnt * 1e9);
+  }
+
+  free(hits);
+  for (int j = 0; j < 2; j++) {
+    MapV_JoinFree(joins[j]);
+  }
+  MapV_Destroy(map);
+  free(build.keys);
+  free(build.lens);
+  free(build.vals);
+  free(side.keys);
+  free(side.lens);
+  free(side.vals);
+  free(buf);
+}
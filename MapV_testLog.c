@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_Log.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// a logged map goes through inserts, overwrites and deletes, with a
+// checkpoint in the middle and automatic ones along the way. then it's
+// "crashed" (never closed), and a map recovered from disk must match it.
+// a torn record is then appended to the last segment; recovery must stop at
+// it and still match.
+
+#define LOG_PATH "/tmp/mapv_testLog"
+
+static void
+files_remove(void);
+
+static void
+compare(MapV_st* live, MapV_st* rec, MapV_File_st* file);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  files_remove();
+
+  const MapV_Cfg_st cfg = {
+  	.distSlotMax      = 32,
+  	.distBktMax       = 8,
+  	.capPctMax        = 90,
+  	.memAlign         = 4096,
+  	.initialSlotCount = 10,
+  };
+  const MapV_LogCfg_st logCfg = {
+    .path     = LOG_PATH,
+    .groupOps = 256,
+    .ckptOps  = 7000,
+  };
+
+  MapV_st*     map = MapV_LogRecover(&logCfg, &cfg);
+  MapV_Log_st* log = MapV_LogOpen(&logCfg, map);
+  if (NULL == map || NULL == log) {
+    printf("opening an empty log failed\n");
+    exit(1);
+  }
+
+  //---------------------------
+  printf("Logging...");
+  fflush(stdout);
+  const double tBeg = now_sec();
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Insert(map, key, len, (MapV_Val_ut){ .u64 = i }, false);
+    if (i == file->linesCnt / 2) {
+      MapV_LogCheckpoint(log);
+    }
+  }
+  for (uint64_t i = 0; i < file->linesCnt; i += 3)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Delete(map, key, len);
+  }
+  for (uint64_t i = 1; i < file->linesCnt; i += 5)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_UpsertAdd(map, key, len, 1000000, NULL);
+  }
+  MapV_LogSync(log);
+  const double tLog = now_sec() - tBeg;
+  MapV_LogCheckpointWait(log);
+  printf("done. records: %"PRIu64", syncs: %"PRIu64", checkpoints: %"PRIu64
+         ", %.0f records/s\n", log->recsCnt, log->syncsCnt, log->ckptsCnt,
+         log->recsCnt / tLog);
+  if (0 == log->ckptsCnt) {
+    printf("no checkpoint was taken\n");
+    exit(1);
+  }
+
+  //---------------------------
+  // "crash": the log is synced, but never closed
+  double   tRec = now_sec();
+  MapV_st* rec  = MapV_LogRecover(&logCfg, &cfg);
+  tRec = now_sec() - tRec;
+  if (NULL == rec) {
+    printf("MapV_LogRecover failed\n");
+    exit(1);
+  }
+  printf("recovered %"PRIu64" entries in %.6f s\n", rec->meta.slotsUsed, tRec);
+  compare(map, rec, file);
+  MapV_Destroy(rec);
+
+  //---------------------------
+  // half a record at the end of the last segment
+  char path[256];
+  snprintf(path, sizeof(path), "%s.log.%"PRIu64, LOG_PATH, log->seq);
+  const int fd = open(path, O_WRONLY | O_APPEND);
+  const MapV_LogRec_st junk = { .hi = 1, .lo = 2, .op = MAPV_LOG_OP__INSERT, };
+  if (-1 == fd || sizeof(junk) / 2 != write(fd, &junk, sizeof(junk) / 2)) {
+    printf("can't tear %s\n", path);
+    exit(1);
+  }
+  close(fd);
+
+  if (NULL == (rec = MapV_LogRecover(&logCfg, &cfg))) {
+    printf("MapV_LogRecover failed after a torn write\n");
+    exit(1);
+  }
+  compare(map, rec, file);
+
+  // keep going from the recovered map; a new segment is started
+  MapV_LogClose(log);
+  MapV_Destroy(map);
+  if (NULL == (log = MapV_LogOpen(&logCfg, rec))) {
+    printf("reopening the log failed\n");
+    exit(1);
+  }
+  MapV_Insert(rec, "one more", 8, (MapV_Val_ut){ .u64 = 1 }, false);
+  MapV_LogClose(log);
+
+  MapV_st* rec2 = MapV_LogRecover(&logCfg, &cfg);
+  MapV_Val_ut val;
+  if (   NULL == rec2 || rec2->meta.slotsUsed != rec->meta.slotsUsed
+      || !MapV_Find(rec2, "one more", 8, &val) || 1 != val.u64) {
+    printf("records after a torn write were lost\n");
+    exit(1);
+  }
+
+  MapV_Destroy(rec);
+  MapV_Destroy(rec2);
+  MapV_FileClose(file);
+  files_remove();
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+files_remove(void)
+{
+  char path[256];
+  unlink(LOG_PATH ".ckpt");
+  unlink(LOG_PATH ".ckpt.tmp");
+  for (int seq = 0; seq < 1000; seq++) {
+    snprintf(path, sizeof(path), "%s.log.%d", LOG_PATH, seq);
+    unlink(path);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+compare(MapV_st* live, MapV_st* rec, MapV_File_st* file)
+{
+  printf("Comparing...");
+  fflush(stdout);
+  if (live->meta.slotsUsed != rec->meta.slotsUsed) {
+    printf("entry counts differ: %"PRIu64" vs %"PRIu64"\n",
+           live->meta.slotsUsed, rec->meta.slotsUsed);
+    exit(1);
+  }
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Val_ut valLive = {0};
+    MapV_Val_ut valRec  = {0};
+    const bool  inLive  = MapV_Find(live, key, len, &valLive);
+    const bool  inRec   = MapV_Find(rec,  key, len, &valRec);
+    if (inLive != inRec || valLive.u64 != valRec.u64) {
+      printf("key %.*s: %d/%"PRIu64" vs %d/%"PRIu64"\n", (int)len, key,
+             inLive, valLive.u64, inRec, valRec.u64);
+      exit(1);
+    }
+  }
+  printf("ok\n");
+}
@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// a = lines [0, 60%), value i
+// b = lines [40%, 100%), value i + B_OFF, in a much bigger table, so the two
+//     tables order entries at different granularities
+// then every key of Merge (values summed), Intersect and Diff is checked,
+// and Merge is timed against inserting b's keys into a copy of a.
+
+#define B_OFF 1000000
+
+static MapV_Val_ut
+sum(void* ctx, MapV_Hash_st hash, MapV_Val_ut valA, MapV_Val_ut valB);
+
+static void
+check(const char* name, MapV_st* map, MapV_File_st* file,
+      uint64_t aEnd, uint64_t bBeg, int op);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  const uint64_t aEnd = file->linesCnt * 6 / 10;
+  const uint64_t bBeg = file->linesCnt * 4 / 10;
+
+  MapV_st* a = test_map(10);
+  MapV_st* b = test_map(file->linesCnt * 16);
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    if (i < aEnd) {
+      MapV_Insert(a, key, len, (MapV_Val_ut){ .u64 = i }, true);
+    }
+    if (i >= bBeg) {
+      MapV_Insert(b, key, len, (MapV_Val_ut){ .u64 = i + B_OFF }, true);
+    }
+  }
+
+  //---------------------------
+  double   t     = now_sec();
+  MapV_st* merge = MapV_Merge(a, b, sum, NULL);
+  const double tMerge = now_sec() - t;
+
+  MapV_st* inter = MapV_Intersect(a, b, sum, NULL);
+  MapV_st* diff  = MapV_Diff(a, b);
+  if (NULL == merge || NULL == inter || NULL == diff) {
+    printf("set operation failed\n");
+    exit(1);
+  }
+
+  check("merge",     merge, file, aEnd, bBeg, 0);
+  check("intersect", inter, file, aEnd, bBeg, 1);
+  check("diff",      diff,  file, aEnd, bBeg, 2);
+
+  //---------------------------
+  // the same merge, done with inserts
+  MapV_st* ins = test_map(merge->meta.slotsCap);
+  t = now_sec();
+  MapV_SlotId_t slotId = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  while (MapV_Next(a, &slotId, &hash, &val)) {
+    MapV_InsertHash(ins, hash, val, true);
+  }
+  slotId = 0;
+  while (MapV_Next(b, &slotId, &hash, &val)) {
+    MapV_InsertHash(ins, hash, val, false);
+  }
+  const double tIns = now_sec() - t;
+  if (ins->meta.slotsUsed != merge->meta.slotsUsed) {
+    printf("insert loop and merge disagree\n");
+    exit(1);
+  }
+  printf("merge: %.6f s, insert loop: %.6f s\n", tMerge, tIns);
+
+  MapV_st* set = MapV_Create(&(MapV_Cfg_st){ .distSlotMax = 32, .distBktMax = 8,
+                                              .capPctMax = 90, .memAlign = 4096,
+                                              .fpBits = 64, });
+  if (NULL != MapV_Merge(a, set, NULL, NULL)) {
+    printf("merging different fingerprint widths should fail\n");
+    exit(1);
+  }
+
+  MapV_Destroy(a);
+  MapV_Destroy(b);
+  MapV_Destroy(merge);
+  MapV_Destroy(inter);
+  MapV_Destroy(diff);
+  MapV_Destroy(ins);
+  MapV_Destroy(set);
+  MapV_FileClose(file);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_Val_ut
+sum(void* ctx, MapV_Hash_st hash, MapV_Val_ut valA, MapV_Val_ut valB)
+{
+  return (MapV_Val_ut){ .u64 = valA.u64 + valB.u64 };
+}
+
+//------------------------------------------------------------------------------
+// op: 0 merge, 1 intersect, 2 diff
+static void
+check(const char* name, MapV_st* map, MapV_File_st* file,
+      uint64_t aEnd, uint64_t bBeg, int op)
+{
+  printf("Checking %s...", name);
+  fflush(stdout);
+
+  uint64_t expectCnt = 0;
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    const bool inA = (i <  aEnd);
+    const bool inB = (i >= bBeg);
+    const bool in  = (0 == op) ? (inA || inB)
+                   : (1 == op) ? (inA && inB)
+                   :             (inA && !inB);
+    const uint64_t expect = (inA && inB && op != 2) ? i + i + B_OFF
+                          : inA                     ? i
+                          :                           i + B_OFF;
+
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Val_ut val = {0};
+    const bool  found = MapV_Find(map, key, len, &val);
+    if (found != in || (found && val.u64 != expect)) {
+      printf("key %.*s: found %d val %"PRIu64", expected %d %"PRIu64"\n",
+             (int)len, key, found, val.u64, in, expect);
+      exit(1);
+    }
+    expectCnt += in;
+  }
+  if (expectCnt != map->meta.slotsUsed) {
+    printf("%"PRIu64" entries, expected %"PRIu64"\n",
+           map->meta.slotsUsed, expectCnt);
+    exit(1);
+  }
+  printf("ok\n");
+}
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// builds a tiny inverted index: key = first two bytes of each word,
+// values = the line numbers of the words starting with it.
+// every list is checked against a brute force scan of the file,
+// then half the values are removed and everything is checked again.
+
+#define PREFIX_LEN 2
+
+static void
+check(MapV_st* map, MapV_File_st* file, const bool* removed);
+
+static int
+cmp_u64(const void* a, const void* b);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  MapV_Cfg_st cfg = test_cfg(10);
+  cfg.multi       = true;
+  MapV_st* map = test_create(&cfg);
+
+  //---------------------------
+  printf("Appending : %"PRIu64" values...", file->linesCnt);
+  fflush(stdout);
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Err_et err;
+    if (MAPV_ERR__OK != (err = MapV_MultiAppend(map, key,
+                                                len < PREFIX_LEN ? len : PREFIX_LEN,
+                                                (MapV_Val_ut){ .u64 = i }))) {
+      printf("MapV_MultiAppend failed: %"PRIu64" %s\n", i, MapV_PrintErr(err));
+      exit(1);
+    }
+  }
+  printf("done. keys: %"PRIu64"\n", map->meta.slotsUsed);
+
+  bool* removed = calloc(file->linesCnt, sizeof(bool));
+  check(map, file, removed);
+
+  //---------------------------
+  printf("Removing every other value...");
+  fflush(stdout);
+  for (uint64_t i = 0; i < file->linesCnt; i += 2)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Err_et err;
+    if (MAPV_ERR__OK != (err = MapV_MultiRemove(map, key,
+                                                len < PREFIX_LEN ? len : PREFIX_LEN,
+                                                (MapV_Val_ut){ .u64 = i }))) {
+      printf("MapV_MultiRemove failed: %s\n", MapV_PrintErr(err));
+      exit(1);
+    }
+    removed[i] = true;
+  }
+  printf("done. keys: %"PRIu64"\n", map->meta.slotsUsed);
+
+  if (MAPV_ERR__MULTI_VAL_NOT_FOUND
+      != MapV_MultiRemove(map, "th", 2, (MapV_Val_ut){ .u64 = 0 })) {
+    printf("removing a missing value should fail\n");
+    exit(1);
+  }
+
+  check(map, file, removed);
+
+  //---------------------------
+  // add the removed values back; forces more block growth + compaction
+  for (uint64_t i = 0; i < file->linesCnt; i += 2)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_MultiAppend(map, key, len < PREFIX_LEN ? len : PREFIX_LEN,
+                     (MapV_Val_ut){ .u64 = i });
+    removed[i] = false;
+  }
+  check(map, file, removed);
+
+  MapV_PrintTableCfg(map);
+
+  MapV_Destroy(map);
+  MapV_FileClose(file);
+  free(removed);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+check(MapV_st* map, MapV_File_st* file, const bool* removed)
+{
+  uint64_t* expect = malloc(file->linesCnt * sizeof(*expect));
+  uint64_t* got    = malloc(file->linesCnt * sizeof(*got));
+
+  printf("Checking lists...");
+  fflush(stdout);
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    const size_t keyLen = len < PREFIX_LEN ? len : PREFIX_LEN;
+
+    uint64_t expectCnt = 0;
+    for (uint64_t j = 0; j < file->linesCnt; j++) {
+      size_t      len2;
+      const char* key2 = MapV_FileLine(file, j, &len2);
+      if (!removed[j]
+          && keyLen == (len2 < PREFIX_LEN ? len2 : PREFIX_LEN)
+          && 0 == memcmp(key, key2, keyLen)) {
+        expect[expectCnt++] = j;
+      }
+    }
+
+    uint64_t           gotCnt;
+    const MapV_Val_ut* vals = MapV_MultiFind(map, key, keyLen, &gotCnt);
+    if (0 == expectCnt) {
+      if (NULL != vals) {
+        printf("key %.*s should have been deleted\n", (int)keyLen, key);
+        exit(1);
+      }
+      continue;
+    }
+    if (NULL == vals || gotCnt != expectCnt) {
+      printf("key %.*s: expected %"PRIu64" values, got %"PRIu64"\n",
+             (int)keyLen, key, expectCnt, gotCnt);
+      exit(1);
+    }
+    for (uint64_t j = 0; j < gotCnt; j++) {
+      got[j] = vals[j].u64;
+    }
+    qsort(got, gotCnt, sizeof(*got), cmp_u64);
+    if (0 != memcmp(got, expect, gotCnt * sizeof(*got))) {
+      printf("key %.*s: wrong values\n", (int)keyLen, key);
+      exit(1);
+    }
+  }
+  printf("ok\n");
+
+  free(expect);
+  free(got);
+}
+
+//------------------------------------------------------------------------------
+static int
+cmp_u64(const void* a, const void* b)
+{
+  const uint64_t x = *(const uint64_t*)a;
+  const uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// insert/delete probing, a bucket at a time against a slot at a time
+// (MAPV_PROBE_SCALAR). both are compiled in; this calls each directly.
+//   - two maps, the same random inserts, upserts of keys already in, and
+//     deletes, one map through each: every call returns the same, and
+//     after it the tables are byte for byte the same, with the same
+//     distances and counts. tight probe limits, so inserts are refused
+//     (MAPV_ERR__TABLE_MUST_GROW) and the tables grown, too. for each
+//     fingerprint width, as a set, growing by 150%, over part of the hash
+//     range, file backed, and as a cache (whose CLOCK bits move too)
+//   - random keys into a presized table, then half deleted and inserted
+//     again, then all inserted again (found): ns per op, each way
+
+#define OPS         200000
+#define KEYS        10000
+#define BENCH_SLOTS (1 << 20)
+#define BENCH_ITERS 3
+
+typedef enum Layout_et {
+  LAYOUT_FP128,
+  LAYOUT_FP96,
+  LAYOUT_FP64,
+  LAYOUT_SET,
+  LAYOUT_SET64,
+  LAYOUT_GROW150,
+  LAYOUT_RANGE,
+  LAYOUT_FILE,
+  LAYOUT_CACHE,
+  LAYOUT_CNT,
+} Layout_et;
+
+static const char* layoutNames[LAYOUT_CNT] = {
+  "128-bit map", "96-bit map", "64-bit map", "128-bit set", "64-bit set",
+  "growPct 150", "hash range", "file backed", "cache",
+};
+
+static MapV_Cfg_st
+layout_cfg(Layout_et layout, char* path);
+
+static MapV_Err_et
+upsert(MapV_st* map, bool scalar, MapV_HV_st hv, MapV_SlotId_t* slotId,
+       bool* inserted);
+
+static void
+delete(MapV_st* map, bool scalar, MapV_SlotId_t slotId);
+
+static void
+check_same(const MapV_st* a, const MapV_st* b, Layout_et layout, uint64_t op);
+
+static void
+check_layout(Layout_et layout);
+
+static void
+bench(uint32_t fpBits, uint64_t pct);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  for (int layout = 0; layout < LAYOUT_CNT; layout++) {
+    check_layout(layout);
+  }
+
+  bench(128, 50);
+  bench(128, 90);
+  bench(64, 90);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_Cfg_st
+layout_cfg(Layout_et layout, char* path)
+{
+  MapV_Cfg_st cfg = {
+  	.initialSlotCount = 1024,
+  	.distSlotMax      = 24,
+  	.distBktMax       = 8,
+  	.capPctMax        = 95,
+  	.memAlign         = 4096,
+  };
+  switch (layout) {
+    case LAYOUT_FP96:    cfg.fpBits     = 96;          break;
+    case LAYOUT_FP64:    cfg.fpBits     = 64;          break;
+    case LAYOUT_SET:     cfg.set        = true;        break;
+    case LAYOUT_SET64:   cfg.set        = true;
+                         cfg.fpBits     = 64;          break;
+    case LAYOUT_GROW150: cfg.growPct    = 150;         break;
+    case LAYOUT_RANGE:   cfg.hashLo     = 0;
+                         cfg.hashHi     = UINT64_MAX / 4; break;
+    case LAYOUT_FILE:    cfg.filePath   = path;        break;
+    case LAYOUT_CACHE:   cfg.cacheBytes = 64 << 10;    break;
+    default:                                           break;
+  }
+  return cfg;
+}
+
+//------------------------------------------------------------------------------
+// _tbl_upsert_hv() and _tbl_delete_slot(), one way or the other
+static MapV_Err_et
+upsert(      MapV_st*       map,
+       const bool           scalar,
+       const MapV_HV_st     hv,
+             MapV_SlotId_t* slotId,
+             bool*          inserted)
+{
+  if (_tbl_should_realloc(map)) {
+    return MAPV_ERR__TABLE_MUST_GROW;
+  }
+  const MapV_Err_et err = scalar
+                        ? _tbl_upsert_probe_scalar(map, hv, slotId, inserted)
+                        : _tbl_upsert_probe(map, hv, slotId, inserted);
+  _tbl_cap_update(map);
+  return err;
+}
+
+//------------------------------------------------------------------------------
+static void
+delete(      MapV_st*      map,
+       const bool          scalar,
+             MapV_SlotId_t slotId)
+{
+  slotId = scalar ? _tbl_delete_shift_scalar(map, slotId)
+                  : _tbl_delete_shift(map, slotId);
+  _cache_ref_put(map, slotId, false);
+  map->meta.slotsUsed--;
+  _tbl_cap_update(map);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_same(const MapV_st* a,
+           const MapV_st* b,
+           Layout_et      layout,
+           uint64_t       op)
+{
+  if (   a->meta.slotsCap     != b->meta.slotsCap
+      || a->meta.slotsUsed    != b->meta.slotsUsed
+      || a->meta.distSlotMax  != b->meta.distSlotMax
+      || a->meta.distSlotIter != b->meta.distSlotIter
+      || a->meta.distBktMax   != b->meta.distBktMax
+      || a->meta.distBktIter  != b->meta.distBktIter
+      || 0 != memcmp(a->tbl.bkt, b->tbl.bkt, a->meta.tblBytes)) {
+    printf("%s, op %"PRIu64": tables differ\n", layoutNames[layout], op);
+    exit(1);
+  }
+  for (MapV_SlotId_t slotId = 0;
+       NULL != a->tbl.ref && slotId < a->meta.slotsCapReal; slotId++) {
+    if (_cache_ref_get(a, slotId) != _cache_ref_get(b, slotId)) {
+      printf("%s, op %"PRIu64": cache bits differ\n", layoutNames[layout], op);
+      exit(1);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+check_layout(Layout_et layout)
+{
+  printf("%-12s...", layoutNames[layout]);
+  fflush(stdout);
+
+  char pathA[64];
+  char pathB[64];
+  snprintf(pathA, sizeof(pathA), "/tmp/MapV_testProbe.%d.a", (int)getpid());
+  snprintf(pathB, sizeof(pathB), "/tmp/MapV_testProbe.%d.b", (int)getpid());
+  MapV_Cfg_st cfgA = layout_cfg(layout, pathA);
+  MapV_Cfg_st cfgB = layout_cfg(layout, pathB);
+  MapV_st*    a    = MapV_Create(&cfgA);
+  MapV_st*    b    = MapV_Create(&cfgB);
+  if (NULL == a || NULL == b) {
+    printf("MapV_Create failed\n");
+    exit(1);
+  }
+
+  uint64_t      s       = 0x853c49e6748fea9bull + layout;
+  uint64_t      refused = 0;
+  uint64_t      deletes = 0;
+  MapV_Hash_st* hashes  = malloc(KEYS * sizeof(*hashes));
+  for (uint64_t i = 0; i < KEYS; i++) {
+    const uint64_t key = rand_u64(&s);
+    hashes[i] = MapV_Hash(a, &key, sizeof(key));
+    // over part of the range: fold the rest into it
+    hashes[i].high64 = (LAYOUT_RANGE == layout)
+                     ? hashes[i].high64 / 4 + (0 == hashes[i].high64 / 4)
+                     : hashes[i].high64;
+  }
+
+  for (uint64_t op = 0; op < OPS; op++)
+  {
+    const uint64_t r = rand_u64(&s);
+    const uint64_t k = (r >> 8) % KEYS;
+
+    // deletes, a third of the time; keeps the load moving up and down
+    if (0 == r % 3) {
+      const MapV_SlotId_t slotA = _slot_from_hash(a, hashes[k]);
+      const MapV_SlotId_t slotB = _slot_from_hash(b, hashes[k]);
+      if (slotA != slotB) {
+        printf("%s, op %"PRIu64": found in different slots\n",
+               layoutNames[layout], op);
+        exit(1);
+      }
+      if (UINT64_MAX != slotA) {
+        delete(a, true,  slotA);
+        delete(b, false, slotB);
+        deletes++;
+      }
+    }
+    else
+    {
+      const MapV_HV_st hv = { .hash = hashes[k], .val = { .u64 = op } };
+      MapV_SlotId_t slotA = 0;
+      MapV_SlotId_t slotB = 0;
+      bool          insA  = false;
+      bool          insB  = false;
+      const MapV_Err_et errA = upsert(a, true,  hv, &slotA, &insA);
+      const MapV_Err_et errB = upsert(b, false, hv, &slotB, &insB);
+      if (errA != errB || slotA != slotB || insA != insB) {
+        printf("%s, op %"PRIu64": upserts differ: %s/%s\n",
+               layoutNames[layout], op,
+               MapV_PrintErr(errA), MapV_PrintErr(errB));
+        exit(1);
+      }
+      check_same(a, b, layout, op);
+
+      // refused, untouched: grow (or evict) both the same way, and try again
+      // next time round
+      if (MAPV_ERR__TABLE_MUST_GROW == errA) {
+        refused++;
+        if (   !_tbl_make_room(a, hv.hash.high64, false)
+            || !_tbl_make_room(b, hv.hash.high64, false)) {
+          printf("%s, op %"PRIu64": no room\n", layoutNames[layout], op);
+          exit(1);
+        }
+      }
+    }
+    check_same(a, b, layout, op);
+  }
+
+  printf("ok: %"PRIu64" slots, %"PRIu64" used, %"PRIu64" deletes, "
+         "%"PRIu64" refused\n", a->meta.slotsCap, a->meta.slotsUsed, deletes,
+         refused);
+  if (0 == refused) {
+    printf("%s: nothing was refused\n", layoutNames[layout]);
+    exit(1);
+  }
+  free(hashes);
+  MapV_Destroy(a);
+  MapV_Destroy(b);
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(uint32_t fpBits, uint64_t pct)
+{
+  const uint64_t keys = BENCH_SLOTS * pct / 100;
+  printf("%"PRIu64" random keys, %d-bit, %"PRIu64"%% full (best of %d), "
+         "ns/op:\n", keys, fpBits, pct, BENCH_ITERS);
+
+  MapV_Cfg_st cfg = {
+  	.initialSlotCount = BENCH_SLOTS,
+  	.distSlotMax      = 64,
+  	.distBktMax       = 16,
+  	.capPctMax        = 95,
+  	.memAlign         = 4096,
+  	.fpBits           = fpBits,
+  };
+
+  uint64_t      s      = 0x9e3779b97f4a7c15ull;
+  MapV_Hash_st* hashes = malloc(keys * sizeof(*hashes));
+  MapV_st*      map    = MapV_Create(&cfg);
+  for (uint64_t i = 0; i < keys; i++) {
+    const uint64_t key = rand_u64(&s);
+    hashes[i] = MapV_Hash(map, &key, sizeof(key));
+  }
+  MapV_Destroy(map);
+
+  for (int scalar = 1; scalar >= 0; scalar--)
+  {
+    double best[4] = { 1e9, 1e9, 1e9, 1e9 };
+    for (int iter = 0; iter < BENCH_ITERS; iter++)
+    {
+      map = MapV_Create(&cfg);
+      MapV_SlotId_t slotId;
+      bool          inserted;
+      double        secs[4];
+
+      double t = now_sec();
+      for (uint64_t i = 0; i < keys; i++) {
+        upsert(map, scalar, (MapV_HV_st){ hashes[i], { .u64 = i } },
+               &slotId, &inserted);
+      }
+      secs[0] = now_sec() - t;
+
+      t = now_sec();
+      for (uint64_t i = 0; i < keys; i += 2) {
+        delete(map, scalar, _slot_from_hash(map, hashes[i]));
+      }
+      secs[1] = (now_sec() - t) * 2;
+
+      t = now_sec();
+      for (uint64_t i = 0; i < keys; i += 2) {
+        upsert(map, scalar, (MapV_HV_st){ hashes[i], { .u64 = i } },
+               &slotId, &inserted);
+      }
+      secs[2] = (now_sec() - t) * 2;
+
+      t = now_sec();
+      for (uint64_t i = 0; i < keys; i++) {
+        upsert(map, scalar, (MapV_HV_st){ hashes[i], { .u64 = i } },
+               &slotId, &inserted);
+      }
+      secs[3] = now_sec() - t;
+
+      for (int i = 0; i < 4; i++) {
+        best[i] = (secs[i] < best[i]) ? secs[i] : best[i];
+      }
+      MapV_Destroy(map);
+    }
+    printf("  %-16s insert %6.1f  delete %6.1f  insert again %6.1f  "
+           "found %6.1f\n", scalar ? "slot at a time" : "bucket at a time",
+           best[0] / keys * 1e9, best[1] / keys * 1e9,
+           best[2] / keys * 1e9, best[3] / keys * 1e9);
+  }
+  free(hashes);
+}
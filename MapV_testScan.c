@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// a ~TEXT_BYTES document is made of words from the words file, some
+// capitalized, with runs of assorted separators and the odd UTF-8 word.
+// the stop words are the dictionary. every match from MapV_ScanText() must
+// be the same as from splitting the text byte by byte and calling
+// MapV_Find() per token, and the two are timed.
+
+#define TEXT_BYTES (32 * 1024 * 1024)
+#define HITS_MAX   (TEXT_BYTES / 2)
+
+typedef struct Hit_st {
+  uint64_t off;
+  uint64_t len;
+  uint64_t val;
+} Hit_st;
+
+typedef struct Hits_st {
+  Hit_st*  hits;
+  uint64_t cnt;
+} Hits_st;
+
+static bool
+is_token_byte(unsigned char c);
+
+static void
+on_hit(void* ctx, uint64_t off, uint64_t len, MapV_Val_ut val);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileDict  = (argc > 1) ? argv[1] : "./input.stop_words.536.txt";
+  const char* fileWords = (argc > 2) ? argv[2] : "./input.english_words.10k.txt";
+
+  MapV_File_st* dict  = MapV_FileOpen(fileDict);
+  MapV_File_st* words = MapV_FileOpen(fileWords);
+  if (NULL == dict || NULL == words) {
+    exit(1);
+  }
+
+  MapV_st* map = test_map(10);
+  for (uint64_t i = 0; i < dict->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(dict, i, &len);
+    MapV_Insert(map, key, len, (MapV_Val_ut){ .u64 = i + 1 }, false);
+  }
+
+  //---------------------------
+  // the text. stop words are short and common, so about a third of the
+  // tokens are drawn from the dictionary.
+  const char* seps[] = { " ", " ", " ", ", ", ". ", "\n", " -- ", "\t", "(",
+                         ") ", "\"", "'", "; ", "!\n\n", "  " };
+  const int   sepsCnt = sizeof(seps) / sizeof(seps[0]);
+
+  char*    text = malloc(TEXT_BYTES + 256);
+  uint64_t len  = 0;
+  srand(1);
+  while (len < TEXT_BYTES)
+  {
+    const int r = rand();
+    size_t      wordLen;
+    const char* word = (r % 3 == 0)
+                     ? MapV_FileLine(dict,  (r >> 2) % dict->linesCnt,  &wordLen)
+                     : MapV_FileLine(words, (r >> 2) % words->linesCnt, &wordLen);
+    memcpy(text + len, word, wordLen);
+    if (r % 11 == 0) {
+      text[len] -= 'a' - 'A';
+    }
+    len += wordLen;
+    if (r % 97 == 0) {
+      memcpy(text + len, "\xc3\xa9t\xc3\xa9", 6); // UTF-8 in a token
+      len += 6;
+    }
+    const char* sep = seps[(r >> 8) % sepsCnt];
+    memcpy(text + len, sep, strlen(sep));
+    len += strlen(sep);
+  }
+
+  //---------------------------
+  Hits_st scan = { .hits = malloc(HITS_MAX * sizeof(Hit_st)), };
+  double  t    = now_sec();
+  const uint64_t scanCnt = MapV_ScanText(map, text, len, on_hit, &scan);
+  const double   tScan   = now_sec() - t;
+
+  // byte by byte, one MapV_Find() per token
+  Hits_st ref = { .hits = malloc(HITS_MAX * sizeof(Hit_st)), };
+  t = now_sec();
+  for (uint64_t i = 0; i < len; )
+  {
+    if (!is_token_byte(text[i])) {
+      i++;
+      continue;
+    }
+    uint64_t end = i;
+    while (end < len && is_token_byte(text[end])) {
+      end++;
+    }
+    MapV_Val_ut val;
+    if (MapV_Find(map, text + i, end - i, &val)) {
+      on_hit(&ref, i, end - i, val);
+    }
+    i = end;
+  }
+  const double tRef = now_sec() - t;
+
+  printf("scan: %"PRIu64" matches, %.6f s, %.0f MB/s\n",
+         scanCnt, tScan, len / tScan / 1e6);
+  printf("find: %"PRIu64" matches, %.6f s, %.0f MB/s\n",
+         ref.cnt, tRef, len / tRef / 1e6);
+
+  if (scanCnt != scan.cnt || scan.cnt != ref.cnt || 0 == ref.cnt) {
+    printf("match counts differ\n");
+    exit(1);
+  }
+  for (uint64_t i = 0; i < ref.cnt; i++) {
+    if (memcmp(&scan.hits[i], &ref.hits[i], sizeof(Hit_st))) {
+      printf("match %"PRIu64" differs: %"PRIu64"/%"PRIu64" vs %"PRIu64"/%"PRIu64"\n",
+             i, scan.hits[i].off, scan.hits[i].len,
+             ref.hits[i].off, ref.hits[i].len);
+      exit(1);
+    }
+  }
+
+  //---------------------------
+  // edges: a token at the very start and end, exactly 64 bytes, and a
+  // separator-only buffer
+  char edge[200];
+  memset(edge, ' ', sizeof(edge));
+  memcpy(edge, "the", 3);
+  memcpy(edge + sizeof(edge) - 5, "about", 5);
+  scan.cnt = 0;
+  if (2 != MapV_ScanText(map, edge, sizeof(edge), on_hit, &scan)
+      || 0 != scan.hits[0].off || sizeof(edge) - 5 != scan.hits[1].off) {
+    printf("tokens at the buffer edges were missed\n");
+    exit(1);
+  }
+  scan.cnt = 0;
+  if (1 != MapV_ScanText(map, edge, 64 + 3, on_hit, &scan)
+      || 0 != MapV_ScanText(map, edge + 3, 100, on_hit, &scan)
+      || 0 != MapV_ScanText(map, edge, 0, on_hit, &scan)) {
+    printf("short buffers miscounted\n");
+    exit(1);
+  }
+
+  free(scan.hits);
+  free(ref.hits);
+  free(text);
+  MapV_Destroy(map);
+  MapV_FileClose(dict);
+  MapV_FileClose(words);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static bool
+is_token_byte(unsigned char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+      || (c >= '0' && c <= '9') || (c >= 0x80);
+}
+
+//------------------------------------------------------------------------------
+static void
+on_hit(void* ctx, uint64_t off, uint64_t len, MapV_Val_ut val)
+{
+  Hits_st* hits = ctx;
+  if (hits->cnt < HITS_MAX) {
+    hits->hits[hits->cnt++] = (Hit_st){ .off = off, .len = len, .val = val.u64 };
+  }
+}
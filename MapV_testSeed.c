@@ -0,0 +1,383 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// cfg.seed / cfg.keyOf:
+//   - random keys of 0 to 40 bytes under a few seeds: MapV_Hash() is
+//     XXH3_128bits_withSeed(), seed 0 is XXH3_128bits(), and
+//     MapV_HashBatch() agrees with both
+//   - an attack: NORMAL_KEYS random keys, then ATTACK_KEYS picked so their
+//     high64s share their top ATTACK_BITS bits under seed 0, so they all
+//     want the same few slots. without keyOf, the table doubles until they
+//     spread out; with it, it's reseeded at its size. both through
+//     MapV_Insert(), MapV_Upsert() and MapV_InsertBatch(): every key is
+//     found with its value, misses miss, deletes work, and a serialized
+//     copy keeps the seed
+//   - a keyOf() that fails, a hook, or a seed mismatch in MapV_Merge():
+//     no reseed, or no merge
+
+#define RAND_KEYS    (1 << 14)
+#define RAND_LEN_MAX 40
+#define NORMAL_KEYS  (1 << 14)
+#define ATTACK_KEYS  400
+#define ATTACK_BITS  12
+#define KEYS         (NORMAL_KEYS + ATTACK_KEYS)
+
+typedef enum Via_et {
+  VIA_INSERT,
+  VIA_UPSERT,
+  VIA_BATCH,
+} Via_et;
+
+static bool
+key_of(void* ctx, const MapV_Hash_st hash, const MapV_Val_ut val,
+       const void** key, size_t* keyLen);
+
+static bool
+key_of_fail(void* ctx, const MapV_Hash_st hash, const MapV_Val_ut val,
+            const void** key, size_t* keyLen);
+
+static void
+on_insert(void* ctx, MapV_Hash_st hash, MapV_Val_ut val);
+
+static MapV_st*
+create(uint64_t seed, MapV_KeyOf_ft keyOf, void* ctx);
+
+static void
+check_hashes(void);
+
+static void
+make_keys(uint64_t* keys);
+
+static MapV_st*
+build(const uint64_t* keys, MapV_KeyOf_ft keyOf, Via_et via, double* secs);
+
+static void
+check_map(MapV_st* map, const uint64_t* keys);
+
+static void
+check_attack(const uint64_t* keys);
+
+static void
+check_no_reseed(const uint64_t* keys);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  check_hashes();
+
+  uint64_t* keys = malloc(KEYS * sizeof(*keys));
+  make_keys(keys);
+  check_attack(keys);
+  check_no_reseed(keys);
+  free(keys);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// vals are indexes into the keys
+static bool
+key_of(void*              ctx,
+       const MapV_Hash_st hash,
+       const MapV_Val_ut  val,
+       const void**       key,
+       size_t*            keyLen)
+{
+  (void)hash;
+  *key    = (const uint64_t*)ctx + val.u64;
+  *keyLen = sizeof(uint64_t);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static bool
+key_of_fail(void*              ctx,
+            const MapV_Hash_st hash,
+            const MapV_Val_ut  val,
+            const void**       key,
+            size_t*            keyLen)
+{
+  (void)ctx;
+  (void)hash;
+  (void)val;
+  (void)key;
+  (void)keyLen;
+  return false;
+}
+
+//------------------------------------------------------------------------------
+static void
+on_insert(void* ctx, MapV_Hash_st hash, MapV_Val_ut val)
+{
+  (void)hash;
+  (void)val;
+  (*(uint64_t*)ctx)++;
+}
+
+//------------------------------------------------------------------------------
+static MapV_st*
+create(uint64_t seed, MapV_KeyOf_ft keyOf, void* ctx)
+{
+  MapV_Cfg_st cfg = test_cfg(1 << 15);
+  cfg.seed        = seed;
+  cfg.keyOf       = keyOf;
+  cfg.keyOfCtx    = ctx;
+  return test_create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_hashes(void)
+{
+  printf("Hashes under seeds...");
+  fflush(stdout);
+
+  uint64_t s    = 0x9e3779b97f4a7c15ull;
+  uint8_t* buf  = malloc((uint64_t)RAND_KEYS * RAND_LEN_MAX);
+  const void** keys = malloc(RAND_KEYS * sizeof(*keys));
+  size_t*      lens = malloc(RAND_KEYS * sizeof(*lens));
+  MapV_Hash_st* hashes = malloc(RAND_KEYS * sizeof(*hashes));
+  for (uint64_t i = 0; i < (uint64_t)RAND_KEYS * RAND_LEN_MAX; i++) {
+    buf[i] = (uint8_t)rand_u64(&s);
+  }
+  for (uint64_t i = 0; i < RAND_KEYS; i++) {
+    lens[i] = rand_u64(&s) % (RAND_LEN_MAX + 1);
+    keys[i] = buf + i * RAND_LEN_MAX;
+  }
+
+  const uint64_t seeds[] = { 0, 1, 0xffffffffull, UINT64_MAX, rand_u64(&s) };
+  for (uint64_t k = 0; k < sizeof(seeds) / sizeof(*seeds); k++)
+  {
+    MapV_st* map = create(seeds[k], NULL, NULL);
+    MapV_HashBatch(map, keys, lens, RAND_KEYS, hashes);
+    for (uint64_t i = 0; i < RAND_KEYS; i++)
+    {
+      XXH128_hash_t want = (0 == seeds[k])
+                         ? XXH3_128bits(keys[i], lens[i])
+                         : XXH3_128bits_withSeed(keys[i], lens[i], seeds[k]);
+      want.high64 += (0 == want.high64);
+      const MapV_Hash_st one = MapV_Hash(map, keys[i], lens[i]);
+      if (   one.high64 != want.high64 || one.low64 != want.low64
+          || hashes[i].high64 != want.high64 || hashes[i].low64 != want.low64) {
+        printf("seed %016"PRIx64", key %"PRIu64" (%zu bytes): hashed wrong\n",
+               seeds[k], i, lens[i]);
+        exit(1);
+      }
+    }
+    MapV_Destroy(map);
+  }
+  free(buf);
+  free(keys);
+  free(lens);
+  free(hashes);
+  printf("ok\n");
+}
+
+//------------------------------------------------------------------------------
+// random keys, then keys whose seed 0 high64 starts with ATTACK_BITS zeros,
+// as someone who knows the hash function could pick them
+static void
+make_keys(uint64_t* keys)
+{
+  uint64_t s = 0x2545f4914f6cdd1dull;
+  for (uint64_t i = 0; i < NORMAL_KEYS; i++) {
+    keys[i] = rand_u64(&s);
+  }
+  for (uint64_t i = NORMAL_KEYS, k = 0; i < KEYS; k++) {
+    if (0 == (XXH3_128bits(&k, sizeof(k)).high64 >> (64 - ATTACK_BITS))) {
+      keys[i++] = k;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static MapV_st*
+build(const uint64_t* keys,
+      MapV_KeyOf_ft   keyOf,
+      Via_et          via,
+      double*         secs)
+{
+  MapV_st* map = create(0, keyOf, (void*)keys);
+
+  const double t = now_sec();
+  if (VIA_BATCH == via)
+  {
+    const void** ptrs = malloc(KEYS * sizeof(*ptrs));
+    size_t*      lens = malloc(KEYS * sizeof(*lens));
+    MapV_Val_ut* vals = malloc(KEYS * sizeof(*vals));
+    for (uint64_t i = 0; i < KEYS; i++) {
+      ptrs[i]     = &keys[i];
+      lens[i]     = sizeof(*keys);
+      vals[i].u64 = i;
+    }
+    const MapV_Err_et err = MapV_InsertBatch(map, ptrs, lens, KEYS, vals, false);
+    if (MAPV_ERR__OK != err) {
+      printf("MapV_InsertBatch failed: %s\n", MapV_PrintErr(err));
+      exit(1);
+    }
+    free(ptrs);
+    free(lens);
+    free(vals);
+  }
+  for (uint64_t i = 0; VIA_BATCH != via && i < KEYS; i++)
+  {
+    MapV_Err_et err;
+    if (VIA_INSERT == via) {
+      err = MapV_Insert(map, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i },
+                        false);
+    } else {
+      MapV_Val_ut* valPtr;
+      bool         inserted;
+      err = MapV_Upsert(map, &keys[i], sizeof(*keys), &valPtr, &inserted);
+      if (MAPV_ERR__OK == err) {
+        valPtr->u64 = i;
+      }
+    }
+    if (MAPV_ERR__OK != err) {
+      printf("insert %"PRIu64" failed: %s\n", i, MapV_PrintErr(err));
+      exit(1);
+    }
+  }
+  *secs = now_sec() - t;
+  return map;
+}
+
+//------------------------------------------------------------------------------
+// every key found with its index; each with its top bit flipped missed.
+// then a serialized copy, then every third key deleted, and checked again.
+static void
+check_map(MapV_st* map, const uint64_t* keys)
+{
+  for (uint64_t pass = 0; pass < 3; pass++)
+  {
+    MapV_st* m = map;
+    if (1 == pass) {
+      FILE* f = tmpfile();
+      MapV_Serialize(map, f);
+      rewind(f);
+      MapV_Cfg_st cfg = { .capPctMax = 90, .memAlign = 4096,
+                          .distSlotMax = 32, .distBktMax = 8 };
+      if (NULL == (m = MapV_Deserialize(f, &cfg)) || m->meta.seed != map->meta.seed) {
+        printf("MapV_Deserialize() lost the seed\n");
+        exit(1);
+      }
+      fclose(f);
+    }
+
+    for (uint64_t i = 0; i < KEYS; i++)
+    {
+      const uint64_t miss = keys[i] ^ ((uint64_t)1 << 63);
+      const bool     want = (2 != pass) || (0 != i % 3);
+      MapV_Val_ut    val  = { .u64 = UINT64_MAX };
+      const bool     got  = MapV_Find(m, &keys[i], sizeof(*keys), &val);
+      if (got != want || (got && val.u64 != i)) {
+        printf("pass %"PRIu64": key %"PRIu64" found %d\n", pass, i, got);
+        exit(1);
+      }
+      if (MapV_Find(m, &miss, sizeof(miss), &val)) {
+        printf("pass %"PRIu64": miss %"PRIu64" found\n", pass, i);
+        exit(1);
+      }
+    }
+
+    if (1 == pass) {
+      MapV_Destroy(m);
+      for (uint64_t i = 0; i < KEYS; i += 3) {
+        if (MAPV_ERR__OK != MapV_Delete(map, &keys[i], sizeof(*keys))) {
+          printf("delete %"PRIu64" failed\n", i);
+          exit(1);
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+check_attack(const uint64_t* keys)
+{
+  printf("%d random keys, then %d that collide under seed 0 "
+         "(top %d bits):\n", NORMAL_KEYS, ATTACK_KEYS, ATTACK_BITS);
+
+  const char* vias[] = { "MapV_Insert()", "MapV_Upsert()", "MapV_InsertBatch()" };
+  for (int via = VIA_INSERT; via <= VIA_BATCH; via++)
+  {
+    for (int reseed = 0; reseed < 2; reseed++)
+    {
+      double   secs;
+      MapV_st* map = build(keys, reseed ? key_of : NULL, via, &secs);
+      if (reseed != (0 != map->stats.reseeds)
+          || reseed != (0 != map->meta.seed)) {
+        printf("%s: %"PRIu64" reseeds\n", vias[via], map->stats.reseeds);
+        exit(1);
+      }
+      printf("  %-19s %-9s %9"PRIu64" slots  %6.1f MB  %5.2f%% full  "
+             "%"PRIu64" reseeds  %6.1f ms\n",
+             vias[via], reseed ? "keyOf" : "no keyOf", map->meta.slotsCap,
+             map->meta.tblBytes / 1e6, map->meta.slotsCapPct,
+             map->stats.reseeds, secs * 1e3);
+      check_map(map, keys);
+      MapV_Destroy(map);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+check_no_reseed(const uint64_t* keys)
+{
+  printf("No reseed...");
+  fflush(stdout);
+
+  // a keyOf() that can't say: the rebuild stops, and the table grows
+  MapV_st* map = create(0, key_of_fail, NULL);
+  for (uint64_t i = 0; i < KEYS; i++) {
+    MapV_Insert(map, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i }, false);
+  }
+  if (0 != map->stats.reseeds || 0 != map->meta.seed) {
+    printf("a failed keyOf() reseeded\n");
+    exit(1);
+  }
+  check_map(map, keys);
+  MapV_Destroy(map);
+
+  // a hook: its records are hashes
+  uint64_t inserts = 0;
+  map = create(0, key_of, (void*)keys);
+  map->hook.onInsert = on_insert;
+  map->hook.ctx      = &inserts;
+  for (uint64_t i = 0; i < KEYS; i++) {
+    MapV_Insert(map, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i }, false);
+  }
+  if (0 != map->stats.reseeds || KEYS != inserts) {
+    printf("a hooked map reseeded\n");
+    exit(1);
+  }
+
+  // hashes from different seeds don't mix
+  MapV_st* other = create(1, NULL, NULL);
+  if (NULL != MapV_Merge(map, other, NULL, NULL)) {
+    printf("maps with different seeds merged\n");
+    exit(1);
+  }
+  MapV_Destroy(other);
+  MapV_Destroy(map);
+  printf("ok\n");
+}
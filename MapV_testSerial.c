@@ -0,0 +1,342 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// MapV_Serialize() / MapV_Deserialize():
+//   - the words and ips, at each fingerprint width and as a set: saved and
+//     loaded, every key found with its value, every key with a byte added
+//     missed, and entry counts and ranges kept
+//   - a MapV_ExportRange() map keeps its range; an empty map loads empty
+//   - a flipped byte or a cut-off stream loads as NULL; a multimap can't be
+//     saved
+//   - 1M random keys: bytes per entry against the table and the 24 bytes
+//     of a checkpoint entry, and save/load time against an insert loop
+
+#define BENCH_KEYS 1000000
+
+static MapV_st*
+create(uint32_t fpBits, bool set, bool multi);
+
+static MapV_st*
+round_trip(const MapV_st* map, uint64_t* bytes);
+
+static void
+check_file(const char* path, uint32_t fpBits, bool set);
+
+static void
+check_range(const char* path);
+
+static void
+check_bad(const char* path);
+
+static void
+bench(void);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  const char* files[] = {
+    "./input.english_words.10k.txt",
+    "./input.ips_sort_of.3901.txt",
+  };
+  for (uint64_t i = 0; i < sizeof(files) / sizeof(*files); i++) {
+    check_file(files[i], 128, false);
+    check_file(files[i],  96, false);
+    check_file(files[i],  64, false);
+    check_file(files[i], 128, true);
+  }
+  check_range(files[0]);
+  check_bad(files[0]);
+  bench();
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_st*
+create(uint32_t fpBits, bool set, bool multi)
+{
+  MapV_Cfg_st cfg = test_cfg(1024);
+  cfg.distSlotMax = 64;
+  cfg.distBktMax  = 16;
+  cfg.fpBits      = fpBits;
+  cfg.set         = set;
+  cfg.multi       = multi;
+  return test_create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+// save to a temp file and load it back, with the same cfg
+static MapV_st*
+round_trip(const MapV_st* map, uint64_t* bytes)
+{
+  FILE* f = tmpfile();
+  if (NULL == f) {
+    printf("tmpfile failed\n");
+    exit(1);
+  }
+  *bytes = MapV_Serialize(map, f);
+  if (0 == *bytes || (long)*bytes != ftell(f)) {
+    printf("MapV_Serialize wrote %"PRIu64" bytes, %ld in the file\n",
+           *bytes, ftell(f));
+    exit(1);
+  }
+  rewind(f);
+  MapV_st* out = MapV_Deserialize(f, &map->cfg);
+  fclose(f);
+  if (NULL == out) {
+    printf("MapV_Deserialize failed\n");
+    exit(1);
+  }
+  return out;
+}
+
+//------------------------------------------------------------------------------
+static void
+check_file(const char* path, uint32_t fpBits, bool set)
+{
+  printf("%s, %3"PRIu32"-bit%s...", path, fpBits, set ? " set" : "    ");
+  fflush(stdout);
+
+  MapV_File_st* file = MapV_FileOpen(path);
+  if (NULL == file) {
+    exit(1);
+  }
+  MapV_st* map = create(fpBits, set, false);
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    // values of every width, so valBits varies by block
+    const MapV_Val_ut val = { .u64 = (i * 0x9e3779b97f4a7c15ull) >> (i % 64) };
+    if (set) {
+      MapV_Add(map, key, len);
+    } else {
+      MapV_Insert(map, key, len, val, true);
+    }
+  }
+
+  uint64_t bytes;
+  MapV_st* out = round_trip(map, &bytes);
+  if (out->meta.slotsUsed != map->meta.slotsUsed
+      || out->cfg.fpBits != fpBits || out->cfg.set != set) {
+    printf("loaded %"PRIu64" entries, not %"PRIu64"\n",
+           out->meta.slotsUsed, map->meta.slotsUsed);
+    exit(1);
+  }
+
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    char        miss[256];
+    MapV_Val_ut want, got;
+    const bool  ok = set ? MapV_Contains(out, key, len)
+                         : (MapV_Find(map, key, len, &want)
+                            && MapV_Find(out, key, len, &got)
+                            && want.u64 == got.u64);
+    if (!ok) {
+      printf("key %"PRIu64" wasn't loaded\n", i);
+      exit(1);
+    }
+    if (test_has(out, miss, test_miss(key, len, miss, sizeof(miss)), &got)) {
+      printf("miss %"PRIu64" found\n", i);
+      exit(1);
+    }
+  }
+
+  printf("ok: %5.2f bytes/entry (table: %5.2f)\n",
+         (double)bytes / map->meta.slotsUsed,
+         (double)map->meta.tblBytes / map->meta.slotsUsed);
+  MapV_Destroy(out);
+  MapV_Destroy(map);
+  MapV_FileClose(file);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_range(const char* path)
+{
+  MapV_File_st* file = MapV_FileOpen(path);
+  if (NULL == file) {
+    exit(1);
+  }
+  MapV_st* map = create(128, false, false);
+  for (uint64_t i = 0; i < file->linesCnt; i++) {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Insert(map, key, len, (MapV_Val_ut){ .u64 = i }, true);
+  }
+
+  const uint64_t lo  = UINT64_MAX / 4;
+  const uint64_t hi  = UINT64_MAX / 2;
+  MapV_st*       exp = MapV_ExportRange(map, lo, hi);
+  uint64_t       bytes;
+  MapV_st*       out = round_trip(exp, &bytes);
+  if (out->cfg.hashLo != lo || out->cfg.hashHi != hi
+      || out->meta.slotsUsed != exp->meta.slotsUsed) {
+    printf("range: loaded %"PRIu64" entries in [%"PRIx64", %"PRIx64"]\n",
+           out->meta.slotsUsed, out->cfg.hashLo, out->cfg.hashHi);
+    exit(1);
+  }
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key  = MapV_FileLine(file, i, &len);
+    MapV_Val_ut val;
+    const bool  want = MapV_Find(exp, key, len, &val);
+    if (want != MapV_Find(out, key, len, &val) || (want && val.u64 != i)) {
+      printf("range: key %"PRIu64" differs\n", i);
+      exit(1);
+    }
+  }
+  MapV_Destroy(out);
+  MapV_Destroy(exp);
+
+  MapV_st* empty = create(128, false, false);
+  out = round_trip(empty, &bytes);
+  if (0 != out->meta.slotsUsed || bytes != sizeof(MapV_SerHdr_st)) {
+    printf("empty: loaded %"PRIu64" entries\n", out->meta.slotsUsed);
+    exit(1);
+  }
+  MapV_Destroy(out);
+  MapV_Destroy(empty);
+
+  MapV_Destroy(map);
+  MapV_FileClose(file);
+  printf("ranges, empty: ok\n");
+}
+
+//------------------------------------------------------------------------------
+static void
+check_bad(const char* path)
+{
+  MapV_File_st* file = MapV_FileOpen(path);
+  if (NULL == file) {
+    exit(1);
+  }
+  MapV_st* map   = create(128, false, false);
+  MapV_st* multi = create(128, false, true);
+  for (uint64_t i = 0; i < file->linesCnt; i++) {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Insert(map, key, len, (MapV_Val_ut){ .u64 = i }, true);
+    MapV_MultiAppend(multi, key, len, (MapV_Val_ut){ .u64 = i });
+  }
+
+  FILE* f = tmpfile();
+  if (0 != MapV_Serialize(multi, f)) {
+    printf("a multimap was serialized\n");
+    exit(1);
+  }
+  fclose(f);
+
+  // the whole stream, in memory
+  f = tmpfile();
+  const uint64_t bytes = MapV_Serialize(map, f);
+  uint8_t*       buf   = malloc(bytes);
+  rewind(f);
+  if (1 != fread(buf, bytes, 1, f)) {
+    printf("fread failed\n");
+    exit(1);
+  }
+  fclose(f);
+
+  // a byte flipped in each of a few places: the header, a block header,
+  // a payload, and the last byte; then the stream cut short
+  const uint64_t offs[] = {
+    0, sizeof(MapV_SerHdr_st) + 4, sizeof(MapV_SerHdr_st) + 100,
+    bytes / 2, bytes - 1,
+  };
+  for (uint64_t i = 0; i <= sizeof(offs) / sizeof(*offs); i++)
+  {
+    const bool cut = (i == sizeof(offs) / sizeof(*offs));
+    f = tmpfile();
+    fwrite(buf, cut ? bytes - 10 : bytes, 1, f);
+    if (!cut) {
+      fseek(f, offs[i], SEEK_SET);
+      fputc(buf[offs[i]] ^ 0x20, f);
+    }
+    rewind(f);
+    MapV_st* out = MapV_Deserialize(f, &map->cfg);
+    fclose(f);
+    if (NULL != out) {
+      printf("a damaged stream loaded (%"PRIu64")\n", i);
+      exit(1);
+    }
+  }
+
+  free(buf);
+  MapV_Destroy(multi);
+  MapV_Destroy(map);
+  MapV_FileClose(file);
+  printf("damaged streams: ok\n");
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(void)
+{
+  uint64_t s   = 0x9e3779b97f4a7c15ull;
+  MapV_st* map = create(128, false, false);
+  for (uint64_t i = 0; i < BENCH_KEYS; i++) {
+    rand_u64(&s);
+    MapV_Insert(map, &s, sizeof(s), (MapV_Val_ut){ .u64 = i }, true);
+  }
+
+  FILE*  f = tmpfile();
+  double t = now_sec();
+  const uint64_t bytes = MapV_Serialize(map, f);
+  fflush(f);
+  const double tSave = now_sec() - t;
+
+  rewind(f);
+  t = now_sec();
+  MapV_st* out = MapV_Deserialize(f, &map->cfg);
+  const double tLoad = now_sec() - t;
+  fclose(f);
+  if (NULL == out || out->meta.slotsUsed != map->meta.slotsUsed) {
+    printf("bench: load failed\n");
+    exit(1);
+  }
+
+  // the same entries, inserted one by one by hash
+  MapV_st* ins = create(128, false, false);
+  uint64_t slotId = 0;
+  MapV_Hash_st hash;
+  MapV_Val_ut  val;
+  t = now_sec();
+  while (MapV_Next(map, &slotId, &hash, &val)) {
+    MapV_InsertHash(ins, hash, val, true);
+  }
+  const double tIns = now_sec() - t;
+
+  const double n = map->meta.slotsUsed;
+  printf("%"PRIu64" keys, vals 0..n:\n", map->meta.slotsUsed);
+  printf("  serialized : %5.2f bytes/entry  (table %5.2f, checkpoint 24)\n",
+         bytes / n, map->meta.tblBytes / n);
+  printf("  save       : %5.1f ns/entry\n", tSave * 1e9 / n);
+  printf("  load       : %5.1f ns/entry  (insert loop: %5.1f)\n",
+         tLoad * 1e9 / n, tIns * 1e9 / n);
+
+  MapV_Destroy(ins);
+  MapV_Destroy(out);
+  MapV_Destroy(map);
+}
@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// the same keys in a set (cfg.set) and in a regular map:
+//   - every key is in both; a key with one byte changed is in neither
+//   - adding a key twice reports MAPV_ERR__INSERT_KEY_EXISTS
+//   - the set's table is 2/3 the size of the map's
+//   - removing every other key, then checking again
+// and lookups per second for MapV_Contains() on each.
+
+#define ITERATIONS 100
+
+static MapV_st*
+map_create(bool set);
+
+static void
+check(MapV_st* map, MapV_File_st* file, const bool* removed);
+
+static double
+lookups_per_sec(MapV_st* map, MapV_File_st* file);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  MapV_st* set = map_create(true);
+  MapV_st* map = map_create(false);
+
+  //---------------------------
+  printf("Adding : %"PRIu64" keys...", file->linesCnt);
+  fflush(stdout);
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Err_et err;
+    if (MAPV_ERR__OK != (err = MapV_Add(set, key, len))) {
+      printf("MapV_Add failed: %"PRIu64" %s\n", i, MapV_PrintErr(err));
+      exit(1);
+    }
+    if (MAPV_ERR__OK != (err = MapV_Insert(map, key, len,
+                                           (MapV_Val_ut){ .u64 = i }, false))) {
+      printf("MapV_Insert failed: %"PRIu64" %s\n", i, MapV_PrintErr(err));
+      exit(1);
+    }
+  }
+  printf("done\n");
+
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    if (MAPV_ERR__INSERT_KEY_EXISTS != MapV_Add(set, key, len)) {
+      printf("adding an existing key should fail\n");
+      exit(1);
+    }
+  }
+  if (MAPV_ERR__SET_HAS_NO_VALS
+      != MapV_Insert(set, "x", 1, (MapV_Val_ut){ .u64 = 1 }, false)) {
+    printf("MapV_Insert on a set should fail\n");
+    exit(1);
+  }
+  size_t      firstLen;
+  const char* first = MapV_FileLine(file, 0, &firstLen);
+  uint64_t    multiCnt;
+  if (   MAPV_ERR__SET_HAS_NO_VALS
+         != MapV_MultiAppend(set, first, firstLen, (MapV_Val_ut){ .u64 = 1 })
+      || MAPV_ERR__SET_HAS_NO_VALS
+         != MapV_MultiRemove(set, first, firstLen, (MapV_Val_ut){ .u64 = 1 })
+      || NULL != MapV_MultiFind(set, first, firstLen, &multiCnt)
+      || 0    != multiCnt) {
+    printf("MapV_Multi*() on a set should fail\n");
+    exit(1);
+  }
+
+  if (   set->meta.slotsUsed != map->meta.slotsUsed
+      || set->meta.slotsCap  != map->meta.slotsCap) {
+    printf("set and map should hold the same entries in the same slots\n");
+    exit(1);
+  }
+  if (3 * set->meta.tblBytes != 2 * map->meta.tblBytes) {
+    printf("set table should be 2/3 the size of the map table: "
+           "%"PRIu64" vs %"PRIu64"\n", set->meta.tblBytes, map->meta.tblBytes);
+    exit(1);
+  }
+  printf("table bytes: set %"PRIu64", map %"PRIu64"\n",
+         set->meta.tblBytes, map->meta.tblBytes);
+
+  bool* removed = calloc(file->linesCnt, sizeof(bool));
+  check(set, file, removed);
+  check(map, file, removed);
+
+  printf("set Contains() per second : %.0f\n", lookups_per_sec(set, file));
+  printf("map Contains() per second : %.0f\n", lookups_per_sec(map, file));
+
+  //---------------------------
+  printf("Removing every other key...");
+  fflush(stdout);
+  for (uint64_t i = 0; i < file->linesCnt; i += 2)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Err_et err;
+    if (MAPV_ERR__OK != (err = MapV_Remove(set, key, len))) {
+      printf("MapV_Remove failed: %s\n", MapV_PrintErr(err));
+      exit(1);
+    }
+    removed[i] = true;
+  }
+  printf("done. keys: %"PRIu64"\n", set->meta.slotsUsed);
+  check(set, file, removed);
+
+  MapV_Destroy(set);
+  MapV_Destroy(map);
+  MapV_FileClose(file);
+  free(removed);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_st*
+map_create(bool set)
+{
+  MapV_Cfg_st cfg = test_cfg(10);
+  cfg.set         = set;
+  return test_create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+static void
+check(MapV_st* map, MapV_File_st* file, const bool* removed)
+{
+  printf("Checking %s...", map->cfg.set ? "set" : "map");
+  fflush(stdout);
+
+  char buf[4096];
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    if (MapV_Contains(map, key, len) == removed[i]) {
+      printf("key %.*s should%s be in the %s\n", (int)len, key,
+             removed[i] ? " not" : "", map->cfg.set ? "set" : "map");
+      exit(1);
+    }
+
+    // never added. (unless the key file happens to have it already)
+    if (len < sizeof(buf)) {
+      memcpy(buf, key, len);
+      buf[len] = '#';
+      if (MapV_Contains(map, buf, len + 1)) {
+        printf("key %.*s should not be in the %s\n", (int)len + 1, buf,
+               map->cfg.set ? "set" : "map");
+        exit(1);
+      }
+    }
+  }
+  printf("ok\n");
+}
+
+//------------------------------------------------------------------------------
+static double
+lookups_per_sec(MapV_st* map, MapV_File_st* file)
+{
+  uint64_t    hits = 0;
+  const double tBeg = now_sec();
+  for (int iter = 0; iter < ITERATIONS; iter++) {
+    for (uint64_t i = 0; i < file->linesCnt; i++) {
+      size_t      len;
+      const char* key = MapV_FileLine(file, i, &len);
+      hits += MapV_Contains(map, key, len);
+    }
+  }
+  const double secs = now_sec() - tBeg;
+  if (hits != ITERATIONS * file->linesCnt) {
+    printf("lookups missed keys\n");
+    exit(1);
+  }
+  return hits / secs;
+}
@@ -0,0 +1,485 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_Log.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// cfg.shmName / MapV_ShmAttach():
+//   - the words, inserted from a tiny table while READERS child processes
+//     look them all up over and over, for 128- and 64-bit fingerprints, as
+//     a set, and with the cuckoo engine: a key a reader finds has the right
+//     value, grows included. once the writer is done, readers find every
+//     key and miss every key with a byte added, in MapV_Find(),
+//     MapV_Contains() and MapV_FindBatch(); then they miss every third key,
+//     once the writer has deleted them
+//   - a name that isn't there, or is taken, is refused; so are multi,
+//     cacheBytes and filePath. a reader can't change the map. nothing is
+//     left in /dev/shm after MapV_Destroy()
+//   - BENCH_KEYS random keys: lookups per second by the writer, and by a
+//     reader in another process, idle and while the writer inserts
+
+#define READERS       2
+#define BENCH_KEYS    (4 << 20)
+#define BENCH_LOOKUPS (1 << 22)
+
+typedef struct Sync_st {
+  uint32_t phase;          // 0: inserting, 1: inserted, 2: deleted, 3: done
+  uint32_t ready;          // readers attached, then done with each phase
+  uint32_t loops;          // readers' passes over the words while inserting
+  double   rate[3];        // bench: reader lookups/s
+} Sync_st;
+
+static MapV_st*
+create(const char* name, uint32_t fpBits, bool set, bool cuckoo,
+       uint64_t slots);
+
+static void
+wait_children(uint64_t cnt);
+
+static void
+wait_ready(Sync_st* sync, uint32_t cnt);
+
+static void
+check_words(MapV_File_st* file, const char* name, uint32_t fpBits, bool set,
+            bool cuckoo);
+
+static void
+reader_words(MapV_File_st* file, const char* name, Sync_st* sync);
+
+static void
+check_bad(const char* name);
+
+static void
+bench(const char* name);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  char name[64];
+  snprintf(name, sizeof(name), "/MapV_testShm.%d", (int)getpid());
+
+  MapV_File_st* file = MapV_FileOpen("./input.english_words.10k.txt");
+  if (NULL == file) {
+    exit(1);
+  }
+  check_words(file, name, 128, false, false);
+  check_words(file, name,  64, false, false);
+  check_words(file, name, 128, true,  false);
+  check_words(file, name, 128, false, true);
+  MapV_FileClose(file);
+
+  check_bad(name);
+  bench(name);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_st*
+create(const char* name, uint32_t fpBits, bool set, bool cuckoo,
+       uint64_t slots)
+{
+  MapV_Cfg_st cfg = test_cfg(slots);
+  cfg.distSlotMax = 64;
+  cfg.distBktMax  = 16;
+  cfg.fpBits      = fpBits;
+  cfg.set         = set;
+  cfg.cuckoo      = cuckoo;
+  cfg.shmName     = name;
+  return MapV_Create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+static void
+wait_children(uint64_t cnt)
+{
+  for (uint64_t i = 0; i < cnt; i++) {
+    int status;
+    if (wait(&status) < 0 || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+      printf("a reader failed\n");
+      exit(1);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+wait_ready(Sync_st* sync, uint32_t cnt)
+{
+  while (__atomic_load_n(&sync->ready, __ATOMIC_ACQUIRE) < cnt) {
+    usleep(100);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+check_words(MapV_File_st* file, const char* name, uint32_t fpBits, bool set,
+            bool cuckoo)
+{
+  printf("Words, %3"PRIu32"-bit%s...", fpBits,
+         set ? " set   " : cuckoo ? " cuckoo" : "       ");
+  fflush(stdout);
+
+  MapV_st* map = create(name, fpBits, set, cuckoo, 10);
+  if (NULL == map) {
+    printf("MapV_Create failed\n");
+    exit(1);
+  }
+
+  Sync_st* sync = mmap(NULL, sizeof(*sync), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  memset(sync, 0, sizeof(*sync));
+  fflush(stdout);
+  for (uint64_t r = 0; r < READERS; r++) {
+    if (0 == fork()) {
+      reader_words(file, name, sync);
+      _exit(0);
+    }
+  }
+
+  // after each grow, let every reader make a pass over the words, so
+  // they're looking keys up through the grows rather than after them
+  wait_ready(sync, READERS);
+  const uint64_t n     = file->linesCnt;
+  uint64_t       grows = 0;
+  uint64_t       cap   = map->meta.slotsCap;
+  for (uint64_t i = 0; i < n; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    test_put(map, key, len, i + 1);
+    if (cap != map->meta.slotsCap) {
+      cap = map->meta.slotsCap;
+      grows++;
+      const uint32_t loops = __atomic_load_n(&sync->loops, __ATOMIC_ACQUIRE);
+      while (__atomic_load_n(&sync->loops, __ATOMIC_ACQUIRE) < loops + READERS) {
+        usleep(100);
+      }
+    }
+  }
+  __atomic_store_n(&sync->phase, 1, __ATOMIC_RELEASE);
+  wait_ready(sync, 2 * READERS);
+
+  for (uint64_t i = 0; i < n; i += 3) {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    if (MAPV_ERR__OK != (set ? MapV_Remove(map, key, len)
+                             : MapV_Delete(map, key, len))) {
+      printf("delete %"PRIu64" failed\n", i);
+      exit(1);
+    }
+  }
+  __atomic_store_n(&sync->phase, 2, __ATOMIC_RELEASE);
+  wait_ready(sync, 3 * READERS);
+  __atomic_store_n(&sync->phase, 3, __ATOMIC_RELEASE);
+  wait_children(READERS);
+
+  printf("ok: %"PRIu64" grows, gen %"PRIu64", seq %"PRIu64"\n",
+         grows, map->shm.gen, map->shm.hdr->seq);
+  MapV_Destroy(map);
+  munmap(sync, sizeof(*sync));
+}
+
+//------------------------------------------------------------------------------
+// a child: look every key up until the writer's done, then check it all
+static void
+reader_words(MapV_File_st* file, const char* name, Sync_st* sync)
+{
+  MapV_st* map = MapV_ShmAttach(name);
+  if (NULL == map) {
+    printf("MapV_ShmAttach failed\n");
+    exit(1);
+  }
+  __atomic_add_fetch(&sync->ready, 1, __ATOMIC_RELEASE);
+
+  const uint64_t n     = file->linesCnt;
+  const bool     set   = map->cfg.set;
+  const void**   keys  = malloc(n * sizeof(*keys));
+  size_t*        lens  = malloc(n * sizeof(*lens));
+  MapV_Val_ut*   vals  = malloc(n * sizeof(*vals));
+  bool*          found = malloc(n * sizeof(*found));
+  for (uint64_t i = 0; i < n; i++) {
+    keys[i] = MapV_FileLine(file, i, &lens[i]);
+  }
+
+  // while inserting: a key that's found has its value
+  const uint64_t gen0  = map->shm.gen;
+  uint64_t       loops = 0;
+  while (0 == __atomic_load_n(&sync->phase, __ATOMIC_ACQUIRE)) {
+    for (uint64_t i = 0; i < n; i++) {
+      MapV_Val_ut val = { .u64 = UINT64_MAX };
+      if (!set && MapV_Find(map, keys[i], lens[i], &val) && val.u64 != i + 1) {
+        printf("key %"PRIu64" found with %"PRIu64"\n", i, val.u64);
+        exit(1);
+      }
+      if (set) {
+        MapV_Contains(map, keys[i], lens[i]);
+      }
+    }
+    loops++;
+    __atomic_add_fetch(&sync->loops, 1, __ATOMIC_RELEASE);
+  }
+
+  for (uint32_t phase = 1; phase <= 2; phase++)
+  {
+    while (__atomic_load_n(&sync->phase, __ATOMIC_ACQUIRE) < phase) {
+      usleep(100);
+    }
+    for (uint64_t i = 0; i < n; i++)
+    {
+      char        miss[256];
+      const bool  want = (1 == phase) || (0 != i % 3);
+      MapV_Val_ut val  = { .u64 = UINT64_MAX };
+      const bool  got  = set ? MapV_Contains(map, keys[i], lens[i])
+                             : MapV_Find(map, keys[i], lens[i], &val);
+      if (got != want || (got && !set && val.u64 != i + 1)) {
+        printf("phase %"PRIu32": key %"PRIu64" found %d\n", phase, i, got);
+        exit(1);
+      }
+      if (MapV_Contains(map, keys[i], lens[i]) != want
+          || MapV_Contains(map, miss, test_miss(keys[i], lens[i], miss,
+                                                sizeof(miss)))) {
+        printf("phase %"PRIu32": MapV_Contains, key %"PRIu64"\n", phase, i);
+        exit(1);
+      }
+    }
+    const uint64_t hits = MapV_FindBatch(map, keys, lens, n, vals, found);
+    if (hits != n - (2 == phase) * ((n + 2) / 3)) {
+      printf("phase %"PRIu32": MapV_FindBatch found %"PRIu64"\n", phase, hits);
+      exit(1);
+    }
+    __atomic_add_fetch(&sync->ready, 1, __ATOMIC_RELEASE);
+  }
+  if (map->shm.gen == gen0 || 0 == loops) {
+    printf("reader never saw a grow: gen %"PRIu64", %"PRIu64" loops\n",
+           map->shm.gen, loops);
+    exit(1);
+  }
+
+  while (__atomic_load_n(&sync->phase, __ATOMIC_ACQUIRE) < 3) {
+    usleep(100);
+  }
+  free(keys);
+  free(lens);
+  free(vals);
+  free(found);
+  MapV_Destroy(map);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_bad(const char* name)
+{
+  printf("Bad names and cfgs...");
+  fflush(stdout);
+
+  if (NULL != MapV_ShmAttach(name)) {
+    printf("attached to a map that isn't there\n");
+    exit(1);
+  }
+
+  MapV_st* map = create(name, 128, false, false, 1000);
+  if (NULL == map) {
+    printf("MapV_Create failed\n");
+    exit(1);
+  }
+  if (NULL != create(name, 128, false, false, 1000)) {
+    printf("a second writer was created\n");
+    exit(1);
+  }
+  MapV_Insert(map, "key", 3, (MapV_Val_ut){ .u64 = 7 }, false);
+
+  MapV_st* rd = MapV_ShmAttach(name);
+  if (NULL == rd) {
+    printf("MapV_ShmAttach failed\n");
+    exit(1);
+  }
+  MapV_Val_ut  val;
+  MapV_Val_ut* valPtr;
+  bool         inserted;
+  if (MAPV_ERR__SHM_READ_ONLY
+        != MapV_Insert(rd, "new", 3, (MapV_Val_ut){ .u64 = 1 }, false)
+      || MAPV_ERR__SHM_READ_ONLY != MapV_Delete(rd, "key", 3)
+      || MAPV_ERR__SHM_READ_ONLY != MapV_Upsert(rd, "key", 3, &valPtr, &inserted)
+      || NULL != valPtr
+      || !MapV_Find(rd, "key", 3, &val) || 7 != val.u64
+      || MapV_Find(rd, "new", 3, &val)) {
+    printf("a reader changed the map\n");
+    exit(1);
+  }
+  // a checkpoint's fork() wouldn't get its own copy of the table
+  const MapV_LogCfg_st logCfg = { .path = "/tmp/MapV_testShm.log" };
+  if (NULL != MapV_LogOpen(&logCfg, map) || NULL != MapV_LogOpen(&logCfg, rd)) {
+    printf("a shared memory map was logged\n");
+    exit(1);
+  }
+  MapV_Destroy(rd);
+
+  // the reader's gone; the map isn't
+  if (!MapV_Find(map, "key", 3, &val)) {
+    printf("a reader's MapV_Destroy() took the map\n");
+    exit(1);
+  }
+  const uint64_t gen = map->shm.gen;
+  MapV_Destroy(map);
+
+  char path[128];
+  struct stat st;
+  snprintf(path, sizeof(path), "/dev/shm%s", name);
+  if (0 == stat(path, &st)) {
+    printf("%s is still there\n", path);
+    exit(1);
+  }
+  snprintf(path, sizeof(path), "/dev/shm%s.%"PRIu64, name, gen);
+  if (0 == stat(path, &st)) {
+    printf("%s is still there\n", path);
+    exit(1);
+  }
+
+  MapV_Cfg_st cfg = { .capPctMax = 90, .memAlign = 4096, .shmName = name };
+  cfg.multi = true;
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a shared multimap was created\n");
+    exit(1);
+  }
+  cfg.multi      = false;
+  cfg.cacheBytes = 1 << 20;
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a shared cache was created\n");
+    exit(1);
+  }
+  cfg.cacheBytes = 0;
+  cfg.filePath   = "/tmp/MapV_testShm";
+  if (NULL != MapV_Create(&cfg)) {
+    printf("a shared file backed table was created\n");
+    exit(1);
+  }
+  printf("ok\n");
+}
+
+//------------------------------------------------------------------------------
+// the reader's three rates: MapV_Find() idle, MapV_FindBatch() idle, and
+// MapV_Find() while the writer inserts
+static void
+bench(const char* name)
+{
+  uint64_t* keys = malloc(2 * BENCH_KEYS * sizeof(*keys));
+  uint64_t  s    = 0x9e3779b97f4a7c15ull;
+  for (uint64_t i = 0; i < 2 * BENCH_KEYS; i++) {
+    keys[i] = rand_u64(&s);
+  }
+
+  MapV_st* map = create(name, 128, false, false, BENCH_KEYS * 2);
+  if (NULL == map) {
+    printf("MapV_Create failed\n");
+    exit(1);
+  }
+  for (uint64_t i = 0; i < BENCH_KEYS; i++) {
+    MapV_Insert(map, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i }, true);
+  }
+
+  double   t     = now_sec();
+  uint64_t found = 0;
+  for (uint64_t i = 0; i < BENCH_LOOKUPS; i++) {
+    MapV_Val_ut val;
+    found += MapV_Find(map, &keys[(i * 7919) % BENCH_KEYS], sizeof(*keys), &val);
+  }
+  const double tWriter = now_sec() - t;
+  if (found != BENCH_LOOKUPS) {
+    printf("writer found %"PRIu64" of %d\n", found, BENCH_LOOKUPS);
+    exit(1);
+  }
+
+  Sync_st* sync = mmap(NULL, sizeof(*sync), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  memset(sync, 0, sizeof(*sync));
+  fflush(stdout);
+  if (0 == fork())
+  {
+    MapV_st* rd = MapV_ShmAttach(name);
+    if (NULL == rd) {
+      exit(1);
+    }
+
+    const void** ptrs  = malloc(BENCH_LOOKUPS * sizeof(*ptrs));
+    size_t*      lens  = malloc(BENCH_LOOKUPS * sizeof(*lens));
+    MapV_Val_ut* vals  = malloc(BENCH_LOOKUPS * sizeof(*vals));
+    bool*        fnd   = malloc(BENCH_LOOKUPS * sizeof(*fnd));
+    for (uint64_t i = 0; i < BENCH_LOOKUPS; i++) {
+      ptrs[i] = &keys[(i * 7919) % BENCH_KEYS];
+      lens[i] = sizeof(*keys);
+    }
+
+    uint64_t hits = 0;
+    t = now_sec();
+    for (uint64_t i = 0; i < BENCH_LOOKUPS; i++) {
+      hits += MapV_Find(rd, ptrs[i], lens[i], &vals[i]);
+    }
+    sync->rate[0] = BENCH_LOOKUPS / (now_sec() - t);
+
+    t = now_sec();
+    hits += MapV_FindBatch(rd, ptrs, lens, BENCH_LOOKUPS, vals, fnd);
+    sync->rate[1] = BENCH_LOOKUPS / (now_sec() - t);
+
+    __atomic_store_n(&sync->phase, 1, __ATOMIC_RELEASE);
+    while (0 == __atomic_load_n(&sync->ready, __ATOMIC_ACQUIRE)) {
+    }
+    t = now_sec();
+    for (uint64_t i = 0; i < BENCH_LOOKUPS; i++) {
+      hits += MapV_Find(rd, ptrs[i], lens[i], &vals[i]);
+    }
+    sync->rate[2] = BENCH_LOOKUPS / (now_sec() - t);
+    __atomic_store_n(&sync->phase, 2, __ATOMIC_RELEASE);
+
+    MapV_Destroy(rd);
+    _exit(hits == 3ull * BENCH_LOOKUPS ? 0 : 1);
+  }
+
+  // insert the other half of the keys while the reader's third run is on
+  while (0 == __atomic_load_n(&sync->phase, __ATOMIC_ACQUIRE)) {
+    usleep(100);
+  }
+  __atomic_store_n(&sync->ready, 1, __ATOMIC_RELEASE);
+  uint64_t inserts = 0;
+  t = now_sec();
+  for (uint64_t i = BENCH_KEYS;
+       i < 2 * BENCH_KEYS && 1 == __atomic_load_n(&sync->phase, __ATOMIC_ACQUIRE);
+       i++, inserts++) {
+    MapV_Insert(map, &keys[i], sizeof(*keys), (MapV_Val_ut){ .u64 = i }, true);
+  }
+  const double tInserts = now_sec() - t;
+  wait_children(1);
+
+  printf("%d keys, lookups/s:\n", BENCH_KEYS);
+  printf("  writer MapV_Find()                    : %5.2fM\n",
+         BENCH_LOOKUPS / tWriter / 1e6);
+  printf("  reader MapV_Find()                    : %5.2fM\n",
+         sync->rate[0] / 1e6);
+  printf("  reader MapV_FindBatch()               : %5.2fM\n",
+         sync->rate[1] / 1e6);
+  printf("  reader MapV_Find(), writer inserting  : %5.2fM   "
+         "(writer: %.2fM inserts/s)\n",
+         sync->rate[2] / 1e6, inserts / tInserts / 1e6);
+
+  MapV_Destroy(map);
+  munmap(sync, sizeof(*sync));
+  free(keys);
+}
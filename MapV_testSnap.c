@@ -0,0 +1,610 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// MapV_Snapshot():
+//   - KEYS keys, then snapshots between rounds of overwrites, adds, deletes
+//     and inserts that grow the table under them, for 128- and 64-bit
+//     fingerprints and the cuckoo engine: each snapshot finds exactly the
+//     keys and values of its moment, walks them with MapV_Next(), and
+//     serializes to the same bytes the map did then. the map ends up as it
+//     should. snapshots are freed out of order, and the map is right after
+//     each
+//   - a snapshot can't be changed; multimaps, file backed and shared memory
+//     maps can't be snapshotted
+//   - ROUNDS times: a snapshot walked and looked up on another thread while
+//     the map is written, and the walk matches the moment it was taken
+//   - BENCH_KEYS random keys: MapV_Snapshot() vs stopping for a copy or a
+//     walk, and writes and lookups with no snapshot, one alive, and after
+
+#define KEYS          (1 << 16)
+#define ROUNDS        20
+#define BENCH_KEYS    (2 << 20)
+#define BENCH_WRITES  (1 << 20)
+#define BENCH_FINDS   (1 << 22)
+
+typedef struct Walk_st {
+  const MapV_st* snap;
+  const uint64_t* keys;
+  uint64_t       keysCnt;
+  uint64_t       cnt;    // entries walked
+  uint64_t       sum;    // of their values
+  uint64_t       found;  // of keys, by MapV_FindBatch()
+  uint64_t       valSum; // of theirs
+} Walk_st;
+
+static MapV_st*
+create(uint32_t fpBits, bool cuckoo, uint64_t slots);
+
+static void
+write_key(MapV_st* map, uint64_t key, uint64_t val);
+
+static void
+delete_key(MapV_st* map, uint64_t key);
+
+static void
+check_map(const char* what, MapV_st* map, const uint64_t* keys,
+          const uint64_t* vals, uint64_t keysCnt);
+
+static char*
+serialize(const MapV_st* map, size_t* len);
+
+static void
+check_rounds(uint32_t fpBits, bool cuckoo);
+
+static void
+check_refused(void);
+
+static void*
+walk_run(void* arg);
+
+static void
+check_threads(void);
+
+static int
+cmp_dbl(const void* a, const void* b);
+
+static void
+bench_writes(const char* what, MapV_st* map, const uint64_t* keys, uint64_t* s);
+
+static void
+bench_finds(const char* what, MapV_st* map, const uint64_t* keys, uint64_t* s);
+
+static double
+bench_walk(const MapV_st* map);
+
+static void
+bench(void);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  (void)argc;
+  (void)argv;
+
+  check_rounds(128, false);
+  check_rounds(64,  false);
+  check_rounds(128, true);
+  check_refused();
+  check_threads();
+  bench();
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_st*
+create(uint32_t fpBits, bool cuckoo, uint64_t slots)
+{
+  MapV_Cfg_st cfg = test_cfg(slots);
+  cfg.fpBits      = fpBits;
+  cfg.cuckoo      = cuckoo;
+  return test_create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+static void
+write_key(MapV_st* map, uint64_t key, uint64_t val)
+{
+  MapV_Err_et err;
+  if (MAPV_ERR__OK != (err = MapV_Insert(map, &key, sizeof(key),
+                                         (MapV_Val_ut){ .u64 = val }, true))) {
+    printf("MapV_Insert failed: %s\n", MapV_PrintErr(err));
+    exit(1);
+  }
+}
+
+//------------------------------------------------------------------------------
+static void
+delete_key(MapV_st* map, uint64_t key)
+{
+  MapV_Err_et err;
+  if (MAPV_ERR__OK != (err = MapV_Delete(map, &key, sizeof(key)))) {
+    printf("MapV_Delete failed: %s\n", MapV_PrintErr(err));
+    exit(1);
+  }
+}
+
+//------------------------------------------------------------------------------
+// every key with a value (0: not there) is found with it, and nothing else
+// is in the map
+static void
+check_map(const char*     what,
+          MapV_st*        map,
+          const uint64_t* keys,
+          const uint64_t* vals,
+          uint64_t        keysCnt)
+{
+  uint64_t cnt = 0;
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < keysCnt; i++)
+  {
+    MapV_Val_ut val;
+    const bool  found = MapV_Find(map, &keys[i], sizeof(keys[i]), &val);
+    if (found != (0 != vals[i]) || (found && val.u64 != vals[i])) {
+      printf("FAIL: %s: key %"PRIu64" %s, value %"PRIu64", expected %"PRIu64"\n",
+             what, i, found ? "found" : "missing", found ? val.u64 : 0, vals[i]);
+      exit(1);
+    }
+    cnt += found;
+    sum += vals[i];
+  }
+
+  uint64_t      walkCnt = 0;
+  uint64_t      walkSum = 0;
+  MapV_SlotId_t slotId  = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  while (MapV_Next(map, &slotId, &hash, &val)) {
+    walkCnt++;
+    walkSum += val.u64;
+  }
+  if (walkCnt != cnt || walkSum != sum || map->meta.slotsUsed != cnt) {
+    printf("FAIL: %s: walked %"PRIu64" entries summing %"PRIu64
+           ", expected %"PRIu64" summing %"PRIu64"\n",
+           what, walkCnt, walkSum, cnt, sum);
+    exit(1);
+  }
+}
+
+//------------------------------------------------------------------------------
+static char*
+serialize(const MapV_st* map, size_t* len)
+{
+  char* buf = NULL;
+  FILE* f   = open_memstream(&buf, len);
+  if (NULL == f) {
+    printf("open_memstream failed\n");
+    exit(1);
+  }
+  MapV_Serialize(map, f);
+  fclose(f);
+  return buf;
+}
+
+//------------------------------------------------------------------------------
+static void
+check_rounds(uint32_t fpBits, bool cuckoo)
+{
+  printf("%3"PRIu32"-bit%s, snapshots between rounds of writes...",
+         fpBits, cuckoo ? ", cuckoo" : "");
+  fflush(stdout);
+
+  // keys 0 .. KEYS-1 at first; twice as many more come in round 2
+  uint64_t  s       = 0x9e3779b97f4a7c15ull;
+  uint64_t  keysCnt = 3 * KEYS;
+  uint64_t* keys    = malloc(keysCnt * sizeof(*keys));
+  uint64_t* vals[4];
+  for (uint64_t i = 0; i < keysCnt; i++) {
+    keys[i] = rand_u64(&s);
+  }
+  for (int r = 0; r < 4; r++) {
+    vals[r] = calloc(keysCnt, sizeof(*vals[r]));
+  }
+
+  MapV_st* map = create(fpBits, cuckoo, KEYS / 2);
+  for (uint64_t i = 0; i < KEYS; i++) {
+    vals[0][i] = i + 1;
+    write_key(map, keys[i], vals[0][i]);
+  }
+  const uint64_t slotsCap0 = map->meta.slotsCap;
+  size_t         serLen0;
+  char*          ser0  = cuckoo ? NULL : serialize(map, &serLen0);
+  MapV_st*       snap0 = MapV_Snapshot(map);
+
+  // round 1: overwrite, add to, and delete a quarter each
+  memcpy(vals[1], vals[0], keysCnt * sizeof(*vals[1]));
+  for (uint64_t i = 0; i < KEYS; i++)
+  {
+    switch (i % 4) {
+      case 0:
+        delete_key(map, keys[i]);
+        vals[1][i] = 0;
+        break;
+      case 1:
+        vals[1][i] += KEYS;
+        write_key(map, keys[i], vals[1][i]);
+        break;
+      case 2: {
+        uint64_t newVal;
+        MapV_UpsertAdd(map, &keys[i], sizeof(keys[i]), 7, &newVal);
+        vals[1][i] += 7;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  MapV_st* snap1 = MapV_Snapshot(map);
+
+  // round 2: the new keys, so the table grows under both snapshots
+  memcpy(vals[2], vals[1], keysCnt * sizeof(*vals[2]));
+  for (uint64_t i = KEYS; i < keysCnt; i++) {
+    vals[2][i] = 3 * KEYS + i;
+    write_key(map, keys[i], vals[2][i]);
+  }
+  for (uint64_t i = 1; i < KEYS; i += 4) {
+    delete_key(map, keys[i]);
+    vals[2][i] = 0;
+  }
+  if (map->meta.slotsCap == slotsCap0) {
+    printf("FAIL: the table didn't grow\n");
+    exit(1);
+  }
+  MapV_st* snap2 = MapV_Snapshot(map);
+
+  // round 3: every other key goes
+  memcpy(vals[3], vals[2], keysCnt * sizeof(*vals[3]));
+  for (uint64_t i = 0; i < keysCnt; i += 2) {
+    if (vals[3][i]) {
+      delete_key(map, keys[i]);
+      vals[3][i] = 0;
+    }
+  }
+
+  if (NULL == snap0 || NULL == snap1 || NULL == snap2) {
+    printf("FAIL: MapV_Snapshot\n");
+    exit(1);
+  }
+  check_map("snapshot 0", snap0, keys, vals[0], keysCnt);
+  check_map("snapshot 1", snap1, keys, vals[1], keysCnt);
+  check_map("snapshot 2", snap2, keys, vals[2], keysCnt);
+  check_map("map",        map,   keys, vals[3], keysCnt);
+  if (!cuckoo) {
+    size_t serLen;
+    char*  ser = serialize(snap0, &serLen);
+    if (serLen != serLen0 || 0 != memcmp(ser, ser0, serLen)) {
+      printf("FAIL: snapshot 0 serializes to %zu bytes, not the map's %zu\n",
+             serLen, serLen0);
+      exit(1);
+    }
+    free(ser);
+  }
+
+  // read only
+  MapV_Val_ut* valPtr;
+  bool         inserted;
+  uint64_t     key = keys[3];
+  if (   MAPV_ERR__SNAPSHOT_READ_ONLY
+         != MapV_Insert(snap1, &key, sizeof(key), (MapV_Val_ut){ .u64 = 1 }, true)
+      || MAPV_ERR__SNAPSHOT_READ_ONLY != MapV_Delete(snap1, &key, sizeof(key))
+      || MAPV_ERR__SNAPSHOT_READ_ONLY
+         != MapV_Upsert(snap1, &key, sizeof(key), &valPtr, &inserted)
+      || MAPV_ERR__SNAPSHOT_READ_ONLY
+         != MapV_BulkLoad(snap1, NULL, NULL, 0)
+      || NULL != MapV_Snapshot(snap1)) {
+    printf("FAIL: a snapshot was changed\n");
+    exit(1);
+  }
+
+  // let go out of order; what's left stays right, and the map carries on
+  MapV_Destroy(snap1);
+  check_map("snapshot 0, after 1", snap0, keys, vals[0], keysCnt);
+  check_map("snapshot 2, after 1", snap2, keys, vals[2], keysCnt);
+  MapV_Destroy(snap0);
+  for (uint64_t i = 1; i < keysCnt; i += 2) {
+    if (vals[3][i]) {
+      vals[3][i] += 5;
+      write_key(map, keys[i], vals[3][i]);
+    }
+  }
+  check_map("snapshot 2, after 0", snap2, keys, vals[2], keysCnt);
+  MapV_Destroy(snap2);
+  check_map("map, no snapshots",   map,   keys, vals[3], keysCnt);
+  const uint64_t pagesCnt = map->snap ? map->snap->pagesCnt : 0;
+  const uint64_t copies   = map->snap ? map->snap->copies   : 0;
+
+  // with no snapshot left, writes move the copied pages home
+  for (uint64_t i = 1; i < keysCnt && NULL != map->snap; i += 2) {
+    if (vals[3][i]) {
+      vals[3][i] += 5;
+      write_key(map, keys[i], vals[3][i]);
+    }
+  }
+  if (NULL != map->snap) {
+    printf("FAIL: the table wasn't put back together\n");
+    exit(1);
+  }
+  check_map("map, put back together", map, keys, vals[3], keysCnt);
+
+  printf("ok: %"PRIu64" pages, %"PRIu64" copied\n", pagesCnt, copies);
+  MapV_Destroy(map);
+  free(ser0);
+  for (int r = 0; r < 4; r++) {
+    free(vals[r]);
+  }
+  free(keys);
+}
+
+//------------------------------------------------------------------------------
+static void
+check_refused(void)
+{
+  printf("refused for multimaps, file backed and shared memory maps...");
+  fflush(stdout);
+
+  MapV_Cfg_st cfg = {
+  	.initialSlotCount = 1024,
+  	.distSlotMax      = 32,
+  	.distBktMax       = 8,
+  	.capPctMax        = 90,
+  	.memAlign         = 4096,
+  };
+  char path[64];
+  char name[64];
+  snprintf(path, sizeof(path), "/tmp/MapV_testSnap.%d", (int)getpid());
+  snprintf(name, sizeof(name), "/MapV_testSnap.%d", (int)getpid());
+  MapV_Cfg_st cfgs[3] = { cfg, cfg, cfg };
+  cfgs[0].multi    = true;
+  cfgs[1].filePath = path;
+  cfgs[2].shmName  = name;
+  for (int i = 0; i < 3; i++)
+  {
+    MapV_st* map = MapV_Create(&cfgs[i]);
+    if (NULL == map) {
+      printf("FAIL: MapV_Create\n");
+      exit(1);
+    }
+    if (NULL != MapV_Snapshot(map)) {
+      printf("FAIL: a snapshot of cfg %d\n", i);
+      exit(1);
+    }
+    MapV_Destroy(map);
+  }
+  printf("ok\n");
+}
+
+//------------------------------------------------------------------------------
+static void*
+walk_run(void* arg)
+{
+  Walk_st* w = arg;
+
+  MapV_SlotId_t slotId = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  while (MapV_Next(w->snap, &slotId, &hash, &val)) {
+    w->cnt++;
+    w->sum += val.u64;
+  }
+
+  enum { BATCH = 256 };
+  const void*  keys   [BATCH];
+  size_t       keyLens[BATCH];
+  MapV_Val_ut  vals   [BATCH];
+  bool         found  [BATCH];
+  for (uint64_t beg = 0; beg < w->keysCnt; beg += BATCH)
+  {
+    const uint64_t n = (w->keysCnt - beg < BATCH) ? w->keysCnt - beg : BATCH;
+    for (uint64_t i = 0; i < n; i++) {
+      keys[i]    = &w->keys[beg + i];
+      keyLens[i] = sizeof(uint64_t);
+    }
+    w->found += MapV_FindBatch(w->snap, keys, keyLens, n, vals, found);
+    for (uint64_t i = 0; i < n; i++) {
+      w->valSum += found[i] ? vals[i].u64 : 0;
+    }
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+static void
+check_threads(void)
+{
+  printf("snapshots read on a thread while the map is written...");
+  fflush(stdout);
+
+  uint64_t  s       = 0x2545f4914f6cdd1dull;
+  uint64_t  keysCnt = 4 * KEYS;
+  uint64_t* keys    = malloc(keysCnt * sizeof(*keys));
+  uint64_t* vals    = calloc(keysCnt, sizeof(*vals));
+  for (uint64_t i = 0; i < keysCnt; i++) {
+    keys[i] = rand_u64(&s);
+  }
+
+  MapV_st* map = create(128, false, KEYS);
+  uint64_t cnt = 0;
+  uint64_t sum = 0;
+  for (int r = 0; r < ROUNDS; r++)
+  {
+    Walk_st w = { .snap = MapV_Snapshot(map), .keys = keys, .keysCnt = keysCnt };
+    pthread_t tid;
+    pthread_create(&tid, NULL, walk_run, &w);
+
+    // writes of every kind while it walks, the odd grow included
+    for (uint64_t k = 0; k < 2 * KEYS; k++)
+    {
+      const uint64_t i = rand_u64(&s) % keysCnt;
+      if (0 != vals[i] && 0 == k % 3) {
+        delete_key(map, keys[i]);
+        vals[i] = 0;
+      } else {
+        vals[i] = rand_u64(&s) | 1;
+        write_key(map, keys[i], vals[i]);
+      }
+    }
+
+    pthread_join(tid, NULL);
+    if (w.cnt != cnt || w.sum != sum || w.found != cnt || w.valSum != sum) {
+      printf("FAIL: round %d: walked %"PRIu64" summing %"PRIu64", found %"PRIu64
+             " summing %"PRIu64"; expected %"PRIu64" summing %"PRIu64"\n",
+             r, w.cnt, w.sum, w.found, w.valSum, cnt, sum);
+      exit(1);
+    }
+    MapV_Destroy((MapV_st*)w.snap);
+
+    cnt = 0;
+    sum = 0;
+    for (uint64_t i = 0; i < keysCnt; i++) {
+      cnt += (0 != vals[i]);
+      sum += vals[i];
+    }
+  }
+  check_map("map", map, keys, vals, keysCnt);
+
+  printf("ok: %d rounds, %"PRIu64" entries at the end\n", ROUNDS, cnt);
+  MapV_Destroy(map);
+  free(vals);
+  free(keys);
+}
+
+//------------------------------------------------------------------------------
+static int
+cmp_dbl(const void* a, const void* b)
+{
+  const double x = *(const double*)a;
+  const double y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+//------------------------------------------------------------------------------
+// overwrites of random keys, each one timed. the worst few are mostly this
+// box's scheduler; 99.99% shows what page copies add
+static void
+bench_writes(const char* what, MapV_st* map, const uint64_t* keys, uint64_t* s)
+{
+  double* t    = malloc(BENCH_WRITES * sizeof(*t));
+  double  secs = 0;
+  for (uint64_t k = 0; k < BENCH_WRITES; k++)
+  {
+    const uint64_t i  = rand_u64(s) % BENCH_KEYS;
+    const double   t0 = now_sec();
+    write_key(map, keys[i], k + 1);
+    t[k]  = now_sec() - t0;
+    secs += t[k];
+  }
+  qsort(t, BENCH_WRITES, sizeof(*t), cmp_dbl);
+  printf("  writes, %-22s %6.1f ns/op  99.99%% %6.1f us  %6"PRIu64" pages copied\n",
+         what, secs * 1e9 / BENCH_WRITES,
+         t[BENCH_WRITES - BENCH_WRITES / 10000] * 1e6,
+         map->snap ? map->snap->copies : 0);
+  free(t);
+}
+
+//------------------------------------------------------------------------------
+static void
+bench_finds(const char* what, MapV_st* map, const uint64_t* keys, uint64_t* s)
+{
+  uint64_t    found = 0;
+  MapV_Val_ut val;
+  double      beg   = now_sec();
+  for (uint64_t k = 0; k < BENCH_FINDS; k++) {
+    const uint64_t i = rand_u64(s) % BENCH_KEYS;
+    found += MapV_Find(map, &keys[i], sizeof(keys[i]), &val);
+  }
+  const double secs = now_sec() - beg;
+  if (found != BENCH_FINDS) {
+    printf("FAIL: bench: found %"PRIu64" of %d\n", found, BENCH_FINDS);
+    exit(1);
+  }
+  printf("  finds,  %-22s %6.1f ns/op\n", what, secs * 1e9 / BENCH_FINDS);
+}
+
+//------------------------------------------------------------------------------
+static double
+bench_walk(const MapV_st* map)
+{
+  uint64_t      sum    = 0;
+  MapV_SlotId_t slotId = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  double        beg    = now_sec();
+  while (MapV_Next(map, &slotId, &hash, &val)) {
+    sum += val.u64;
+  }
+  const double secs = now_sec() - beg;
+  if (0 == sum) {
+    printf("FAIL: bench: empty walk\n");
+    exit(1);
+  }
+  return secs;
+}
+
+//------------------------------------------------------------------------------
+static void
+bench(void)
+{
+  uint64_t  s    = 0x9e3779b97f4a7c15ull;
+  uint64_t* keys = malloc(BENCH_KEYS * sizeof(*keys));
+  for (uint64_t i = 0; i < BENCH_KEYS; i++) {
+    keys[i] = rand_u64(&s);
+  }
+  MapV_st* map = create(128, false, BENCH_KEYS);
+  for (uint64_t i = 0; i < BENCH_KEYS; i++) {
+    write_key(map, keys[i], i + 1);
+  }
+  printf("%d keys, %"PRIu64" MB table:\n", BENCH_KEYS, map->meta.tblBytes >> 20);
+
+  // what a consistent dump costs the writer without snapshots: a stop for
+  // a copy of the table, or for the whole walk
+  char*  copy = malloc(map->meta.tblBytes);
+  double beg  = now_sec();
+  memcpy(copy, map->tbl.bkt, map->meta.tblBytes);
+  const double copySecs = now_sec() - beg;
+  if (0 != memcmp(copy, map->tbl.bkt, map->meta.tblBytes)) {
+    printf("FAIL: bench: copy\n");
+    exit(1);
+  }
+  free(copy);
+  printf("  stop for a copy of the table     %9.3f ms\n", copySecs * 1e3);
+  printf("  stop for a MapV_Next() walk      %9.3f ms\n", bench_walk(map) * 1e3);
+
+  bench_finds ("no snapshot",   map, keys, &s);
+  bench_writes("no snapshot",   map, keys, &s);
+
+  beg = now_sec();
+  MapV_st* snap = MapV_Snapshot(map);
+  printf("  MapV_Snapshot(), first           %9.3f ms   (%"PRIu64" pages)\n",
+         (now_sec() - beg) * 1e3, map->snap->pagesCnt);
+  MapV_Destroy(snap);
+  beg  = now_sec();
+  snap = MapV_Snapshot(map);
+  printf("  MapV_Snapshot(), again           %9.3f ms\n", (now_sec() - beg) * 1e3);
+
+  printf("  walk of the snapshot             %9.3f ms\n", bench_walk(snap) * 1e3);
+  bench_writes("snapshot alive", map, keys, &s);
+  bench_writes("snapshot, pages copied", map, keys, &s);
+  bench_finds ("snapshot alive", map, keys, &s);
+  bench_finds ("in the snapshot", snap, keys, &s);
+  MapV_Destroy(snap);
+  bench_writes("snapshot let go", map, keys, &s);
+  bench_finds ("snapshot let go", map, keys, &s);
+
+  MapV_Destroy(map);
+  free(keys);
+}
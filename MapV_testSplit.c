@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// the words are split into 2^SPLIT_BITS partitions:
+//   - every key is in exactly the partition its top hash bits say, with its
+//     value, and partition tables are about 1/2^SPLIT_BITS of the original
+//   - a key outside a partition's range can't be inserted into it
+// then an unaligned hash range is exported and checked against a brute force
+// walk, and the partitions are merged back and checked against the original.
+
+#define SPLIT_BITS 3
+#define PARTS_CNT  (1 << SPLIT_BITS)
+
+static void
+compare(const char* name, MapV_st* map, MapV_st* expect);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  MapV_st* map = test_map(10);
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    MapV_Insert(map, key, len, (MapV_Val_ut){ .u64 = i }, true);
+  }
+
+  //---------------------------
+  printf("Splitting...");
+  fflush(stdout);
+  MapV_st*    parts[PARTS_CNT];
+  double      t   = now_sec();
+  MapV_Err_et err = MapV_Split(map, SPLIT_BITS, parts);
+  t = now_sec() - t;
+  if (MAPV_ERR__OK != err) {
+    printf("MapV_Split failed: %s\n", MapV_PrintErr(err));
+    exit(1);
+  }
+
+  uint64_t partsUsed = 0;
+  for (int p = 0; p < PARTS_CNT; p++)
+  {
+    partsUsed += parts[p]->meta.slotsUsed;
+    if (parts[p]->meta.slotsCap > map->meta.slotsCap / PARTS_CNT * 2) {
+      printf("partition %d has %"PRIu64" slots for %"PRIu64" entries\n",
+             p, parts[p]->meta.slotsCap, parts[p]->meta.slotsUsed);
+      exit(1);
+    }
+  }
+  if (partsUsed != map->meta.slotsUsed) {
+    printf("partitions hold %"PRIu64" entries, expected %"PRIu64"\n",
+           partsUsed, map->meta.slotsUsed);
+    exit(1);
+  }
+
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t       len;
+    const char*  key  = MapV_FileLine(file, i, &len);
+    MapV_Hash_st hash = MapV_Hash(map, key, len);
+    const int    part = hash.high64 >> (64 - SPLIT_BITS);
+    for (int p = 0; p < PARTS_CNT; p++)
+    {
+      MapV_Val_ut val   = {0};
+      const bool  found = MapV_Find(parts[p], key, len, &val);
+      if (found != (p == part) || (found && val.u64 != i)) {
+        printf("key %.*s: partition %d found %d val %"PRIu64", expected %d\n",
+               (int)len, key, p, found, val.u64, part);
+        exit(1);
+      }
+      if (p != part && MAPV_ERR__HASH_OUT_OF_RANGE
+                       != MapV_InsertHash(parts[p], hash, val, false)) {
+        printf("key %.*s was inserted outside partition %d's range\n",
+               (int)len, key, p);
+        exit(1);
+      }
+    }
+  }
+  printf("ok, %.6f s\n", t);
+
+  //---------------------------
+  printf("Exporting...");
+  fflush(stdout);
+  const uint64_t lo  = 0x3141592653589793ull;
+  const uint64_t hi  = 0x9e3779b97f4a7c15ull;
+  MapV_st*       exp = MapV_ExportRange(map, lo, hi);
+  MapV_st*       bf  = test_map(10);
+  if (NULL == exp) {
+    printf("MapV_ExportRange failed\n");
+    exit(1);
+  }
+  MapV_SlotId_t slotId = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  while (MapV_Next(map, &slotId, &hash, &val)) {
+    if (hash.high64 >= lo && hash.high64 <= hi) {
+      MapV_InsertHash(bf, hash, val, false);
+    }
+  }
+  compare("export", exp, bf);
+
+  //---------------------------
+  MapV_st* merged = MapV_Merge(parts[0], parts[1], NULL, NULL);
+  for (int p = 2; p < PARTS_CNT && NULL != merged; p++)
+  {
+    MapV_st* next = MapV_Merge(merged, parts[p], NULL, NULL);
+    MapV_Destroy(merged);
+    merged = next;
+  }
+  if (NULL == merged) {
+    printf("merging the partitions failed\n");
+    exit(1);
+  }
+  compare("merge back", merged, map);
+
+  if (MAPV_ERR__SPLIT_TOO_MANY_PARTS != MapV_Split(map, 17, parts + 0)) {
+    printf("splitting into 2^17 parts should fail\n");
+    exit(1);
+  }
+
+  for (int p = 0; p < PARTS_CNT; p++) {
+    MapV_Destroy(parts[p]);
+  }
+  MapV_Destroy(merged);
+  MapV_Destroy(exp);
+  MapV_Destroy(bf);
+  MapV_Destroy(map);
+  MapV_FileClose(file);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+compare(const char* name, MapV_st* map, MapV_st* expect)
+{
+  printf("Checking %s...", name);
+  fflush(stdout);
+  if (map->meta.slotsUsed != expect->meta.slotsUsed) {
+    printf("%"PRIu64" entries, expected %"PRIu64"\n",
+           map->meta.slotsUsed, expect->meta.slotsUsed);
+    exit(1);
+  }
+  MapV_SlotId_t slotId = 0;
+  MapV_Hash_st  hash;
+  MapV_Val_ut   val;
+  while (MapV_Next(expect, &slotId, &hash, &val))
+  {
+    MapV_Val_ut* got = NULL;
+    bool         inserted;
+    // a find by hash: upsert, and it's a failure if it inserted
+    if (   MAPV_ERR__OK != _upsert_hash(map, hash, NULL, 0, &got, &inserted)
+        || inserted || got->u64 != val.u64) {
+      printf("hash %016"PRIx64" missing or wrong\n", hash.high64);
+      exit(1);
+    }
+  }
+  printf("ok\n");
+}
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_Tune.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// MapV_Tune() on the words file:
+//   - every grid point is measured, and sorted by table bytes, then p99
+//   - with no target, best is the lowest p99
+//   - with a memory target, best fits it and no fitting point has a lower p99
+//   - with a loose latency target, best is the smallest table
+//   - a target nothing can meet gives no best
+//   - the recommended cfg builds a table of the reported size
+
+static MapV_TuneResult_st*
+tune(MapV_TuneCfg_st cfg, uint64_t memBytesMax, double p99NsMax);
+
+static void
+check_sorted(const MapV_TuneResult_st* res);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  const void** keys = malloc(file->linesCnt * sizeof(*keys));
+  size_t*      lens = malloc(file->linesCnt * sizeof(*lens));
+  for (uint64_t i = 0; i < file->linesCnt; i++) {
+    keys[i] = MapV_FileLine(file, i, &lens[i]);
+  }
+  const MapV_TuneCfg_st cfg = {
+    .keys    = keys,
+    .keyLens = lens,
+    .keysCnt = file->linesCnt,
+  };
+
+  //---------------------------
+  printf("No target...");
+  fflush(stdout);
+  MapV_TuneResult_st* res = tune(cfg, 0, 0);
+  check_sorted(res);
+  for (uint64_t i = 0; i < res->pointsCnt; i++) {
+    if (res->points[i].p99Ns < res->points[res->best].p99Ns) {
+      printf("point %"PRIu64" has a lower p99 than the best\n", i);
+      exit(1);
+    }
+  }
+  const uint64_t tblBytesMin = res->points[0].tblBytes;
+  const uint64_t tblBytesMax = res->points[res->pointsCnt - 1].tblBytes;
+  printf("ok: %"PRIu64" points, %"PRIu64" to %"PRIu64" bytes\n",
+         res->pointsCnt, tblBytesMin, tblBytesMax);
+  MapV_TuneFree(res);
+
+  //---------------------------
+  // between the smallest and the biggest table, so some points don't fit
+  printf("Memory target...");
+  fflush(stdout);
+  const uint64_t memBytesMax = tblBytesMin + (tblBytesMax - tblBytesMin) / 4;
+  res = tune(cfg, memBytesMax, 0);
+  check_sorted(res);
+  const MapV_TunePoint_st* best = &res->points[res->best];
+  if (best->tblBytes > memBytesMax) {
+    printf("best uses %"PRIu64" bytes\n", best->tblBytes);
+    exit(1);
+  }
+  for (uint64_t i = 0; i < res->pointsCnt; i++) {
+    if (res->points[i].tblBytes <= memBytesMax
+        && res->points[i].p99Ns < best->p99Ns) {
+      printf("point %"PRIu64" fits and has a lower p99 than the best\n", i);
+      exit(1);
+    }
+  }
+
+  // the recommended cfg, built the way a user would
+  MapV_Cfg_st mcfg = best->cfg;
+  MapV_st*    map  = MapV_Create(&mcfg);
+  for (uint64_t i = 0; i < file->linesCnt; i++) {
+    MapV_Insert(map, keys[i], lens[i], (MapV_Val_ut){ .u64 = i }, true);
+  }
+  if (map->meta.tblBytes != best->tblBytes) {
+    printf("the best cfg builds %"PRIu64" bytes, not %"PRIu64"\n",
+           map->meta.tblBytes, best->tblBytes);
+    exit(1);
+  }
+  MapV_Destroy(map);
+  printf("ok\n");
+  MapV_TunePrint(res, stdout);
+  MapV_TuneFree(res);
+
+  //---------------------------
+  printf("Latency target...");
+  fflush(stdout);
+  res = tune(cfg, 0, 1e9);
+  check_sorted(res);
+  if (res->points[res->best].tblBytes != tblBytesMin) {
+    printf("best isn't the smallest table\n");
+    exit(1);
+  }
+  MapV_TuneFree(res);
+
+  res = tune(cfg, 1, 0);
+  if (-1 != res->best) {
+    printf("a 1 byte target was met\n");
+    exit(1);
+  }
+  MapV_TuneFree(res);
+  printf("ok\n");
+
+  free(keys);
+  free(lens);
+  MapV_FileClose(file);
+
+  printf("done\n");
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+static MapV_TuneResult_st*
+tune(MapV_TuneCfg_st cfg, uint64_t memBytesMax, double p99NsMax)
+{
+  cfg.memBytesMax = memBytesMax;
+  cfg.p99NsMax    = p99NsMax;
+
+  MapV_TuneResult_st* res = MapV_Tune(&cfg);
+  if (NULL == res || 0 == res->pointsCnt) {
+    printf("MapV_Tune failed\n");
+    exit(1);
+  }
+  return res;
+}
+
+//------------------------------------------------------------------------------
+static void
+check_sorted(const MapV_TuneResult_st* res)
+{
+  if (-1 == res->best) {
+    printf("no best point\n");
+    exit(1);
+  }
+  for (uint64_t i = 1; i < res->pointsCnt; i++)
+  {
+    const MapV_TunePoint_st* a = &res->points[i - 1];
+    const MapV_TunePoint_st* b = &res->points[i];
+    if (a->tblBytes > b->tblBytes
+        || (a->tblBytes == b->tblBytes && a->p99Ns > b->p99Ns)) {
+      printf("points %"PRIu64" and %"PRIu64" are out of order\n", i - 1, i);
+      exit(1);
+    }
+    if (0 == b->findsPerSec || b->p50Ns > b->p99Ns) {
+      printf("point %"PRIu64" wasn't measured\n", i);
+      exit(1);
+    }
+  }
+}
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV.c"
+#include "MapV_File.h"
+#include "MapV_testUtil.h"
+
+/*
+make clean && make && make test
+*/
+
+//------------------------------------------------------------------------------
+// word counts over a stream of keys, two ways:
+//   - MapV_Find(), then MapV_Insert(..., true) : two hashes, two probes
+//   - MapV_UpsertAdd()                          : one hash, one probe
+// both maps must end up with the same count for every key.
+// the stream is each word repeated (line % 7 + 1) times, in passes, so the
+// counts differ per key and keys keep arriving while the maps grow.
+// the whole stream is then repeated, so most operations hit existing keys.
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char* fileKeys = (argc > 1) ? argv[1] : "./input.english_words.10k.txt";
+  const int   passes   = 7;
+  const int   rounds   = 50;
+
+  MapV_File_st* file = MapV_FileOpen(fileKeys);
+  if (NULL == file) {
+    exit(1);
+  }
+
+  //---------------------------
+  MapV_st* mapOld = test_map(10);
+  double   tBeg   = now_sec();
+  for (int pass = 0; pass < passes * rounds; pass++) {
+    for (uint64_t i = 0; i < file->linesCnt; i++) {
+      if ((int)(i % 7) < pass % passes) {
+        continue;
+      }
+      size_t      keyLen;
+      const char* key = MapV_FileLine(file, i, &keyLen);
+      MapV_Val_ut val = {0};
+      MapV_Find(mapOld, key, keyLen, &val);
+      val.u64++;
+      MapV_Insert(mapOld, key, keyLen, val, true);
+    }
+  }
+  const double tOld = now_sec() - tBeg;
+
+  //---------------------------
+  MapV_st* mapNew = test_map(10);
+  uint64_t ops    = 0;
+  tBeg = now_sec();
+  for (int pass = 0; pass < passes * rounds; pass++) {
+    for (uint64_t i = 0; i < file->linesCnt; i++) {
+      if ((int)(i % 7) < pass % passes) {
+        continue;
+      }
+      size_t      keyLen;
+      const char* key = MapV_FileLine(file, i, &keyLen);
+      MapV_Err_et err;
+      if (MAPV_ERR__OK != (err = MapV_UpsertAdd(mapNew, key, keyLen, 1, NULL))) {
+        printf("MapV_UpsertAdd failed: %s\n", MapV_PrintErr(err));
+        exit(1);
+      }
+      ops++;
+    }
+  }
+  const double tNew = now_sec() - tBeg;
+
+  //---------------------------
+  printf("Checking counts...");
+  fflush(stdout);
+  if (mapOld->meta.slotsUsed != mapNew->meta.slotsUsed) {
+    printf("entry counts differ: %"PRIu64" vs %"PRIu64"\n",
+           mapOld->meta.slotsUsed, mapNew->meta.slotsUsed);
+    exit(1);
+  }
+  for (uint64_t i = 0; i < file->linesCnt; i++) {
+    size_t      keyLen;
+    const char* key = MapV_FileLine(file, i, &keyLen);
+    MapV_Val_ut valOld = {0};
+    MapV_Val_ut valNew = {0};
+    if (   !MapV_Find(mapOld, key, keyLen, &valOld)
+        || !MapV_Find(mapNew, key, keyLen, &valNew)
+        || valOld.u64 != valNew.u64) {
+      printf("count mismatch on %.*s: %"PRIu64" vs %"PRIu64"\n",
+             (int)keyLen, key, valOld.u64, valNew.u64);
+      exit(1);
+    }
+  }
+  printf("ok\n");
+
+  // the returned pointer is live; update through it and read it back
+  MapV_Val_ut* valPtr;
+  bool         inserted;
+  MapV_Upsert(mapNew, "no such word!", 13, &valPtr, &inserted);
+  if (!inserted || 0 != valPtr->u64) {
+    printf("new key should be inserted with value 0\n");
+    exit(1);
+  }
+  valPtr->u64 = 42;
+  MapV_Upsert(mapNew, "no such word!", 13, &valPtr, &inserted);
+  if (inserted || 42 != valPtr->u64) {
+    printf("existing key should not be re-inserted\n");
+    exit(1);
+  }
+
+  printf("Find+Insert ops per second : %.0f\n", ops / tOld);
+  printf("UpsertAdd   ops per second : %.0f\n", ops / tNew);
+
+  MapV_Destroy(mapOld);
+  MapV_Destroy(mapNew);
+  MapV_FileClose(file);
+
+  printf("done\n");
+  return 0;
+}
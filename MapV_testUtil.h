@@ -0,0 +1,177 @@
+#ifndef _MapV_MapV_testUtil_h_
+#define _MapV_MapV_testUtil_h_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "MapV.h"
+#include "MapV_File.h"
+
+
+
+
+//==============================================================================
+//
+// helpers shared by the MapV_test*.c programs (and MapV_testCpp.cpp). each
+// test keeps only its own feature's checks and benches. every helper that
+// can fail prints why and exits.
+//
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+static inline double
+now_sec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------------------------------
+// xorshift64; *s must start non-zero
+static inline uint64_t
+rand_u64(uint64_t* s)
+{
+  *s ^= *s << 13;
+  *s ^= *s >> 7;
+  *s ^= *s << 17;
+  return *s;
+}
+
+//------------------------------------------------------------------------------
+// the cfg the tests start from; they change what their feature needs
+static inline MapV_Cfg_st
+test_cfg(const uint64_t initialSlotCount)
+{
+  MapV_Cfg_st cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.initialSlotCount = initialSlotCount;
+  cfg.distSlotMax      = 32;
+  cfg.distBktMax       = 8;
+  cfg.capPctMax        = 90;
+  cfg.memAlign         = 4096;
+  return cfg;
+}
+
+//------------------------------------------------------------------------------
+static inline MapV_st*
+test_create(const MapV_Cfg_st* cfg)
+{
+  MapV_st* map;
+  if (NULL == (map = MapV_Create(cfg))) {
+    printf("MapV_Create failed\n");
+    exit(1);
+  }
+  return map;
+}
+
+//------------------------------------------------------------------------------
+static inline MapV_st*
+test_map(const uint64_t initialSlotCount)
+{
+  const MapV_Cfg_st cfg = test_cfg(initialSlotCount);
+  return test_create(&cfg);
+}
+
+//------------------------------------------------------------------------------
+// MapV_Add() in a set, else MapV_Insert() of val without overwriting
+static inline void
+test_put(      MapV_st*  map,
+         const void*     key,
+         const size_t    keyLen,
+         const uint64_t  val)
+{
+  MapV_Val_ut v;
+  v.u64 = val;
+  const MapV_Err_et err = map->cfg.set ? MapV_Add(map, key, keyLen)
+                                       : MapV_Insert(map, key, keyLen, v, false);
+  if (MAPV_ERR__OK != err) {
+    printf("insert %" PRIu64 " failed: %s\n", val, MapV_PrintErr(err));
+    exit(1);
+  }
+}
+
+//------------------------------------------------------------------------------
+// MapV_Contains() in a set (*val is left alone), else MapV_Find()
+static inline bool
+test_has(      MapV_st*     map,
+         const void*        key,
+         const size_t       keyLen,
+               MapV_Val_ut* val)
+{
+  return map->cfg.set ? MapV_Contains(map, key, keyLen)
+                      : MapV_Find(map, key, keyLen, val);
+}
+
+//------------------------------------------------------------------------------
+// key with a byte added, into miss (missCap bytes): a key that isn't in a
+// map of the word files. returns its length; exits if it doesn't fit.
+static inline size_t
+test_miss(const void*  key,
+          const size_t keyLen,
+                char*  miss,
+          const size_t missCap)
+{
+  if (keyLen >= missCap) {
+    printf("key of %zu bytes is too long for a miss\n", keyLen);
+    exit(1);
+  }
+  memcpy(miss, key, keyLen);
+  miss[keyLen] = '\x01';
+  return keyLen + 1;
+}
+
+
+//------------------------------------------------------------------------------
+// delete file's line i from map for every third i (i % 3 == 0)
+static inline void
+test_words_del(MapV_st*            map,
+               const MapV_File_st* file)
+{
+  for (uint64_t i = 0; i < file->linesCnt; i += 3) {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    if (MAPV_ERR__OK != (map->cfg.set ? MapV_Remove(map, key, len)
+                                      : MapV_Delete(map, key, len))) {
+      printf("delete %" PRIu64 " failed\n", i);
+      exit(1);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// file's line i is found with value i, for every i but the test_words_del()
+// ones when thirdsGone; no line with a byte added (test_miss()) is found
+static inline void
+test_words_check(      MapV_st*      map,
+                 const MapV_File_st* file,
+                 const bool          thirdsGone)
+{
+  for (uint64_t i = 0; i < file->linesCnt; i++)
+  {
+    size_t      len;
+    const char* key = MapV_FileLine(file, i, &len);
+    char        miss[256];
+    const bool  want = !thirdsGone || (0 != i % 3);
+    MapV_Val_ut val;
+    val.u64 = UINT64_MAX;
+    const bool  got  = test_has(map, key, len, &val);
+    if (got != want || (got && !map->cfg.set && val.u64 != i)) {
+      printf("key %" PRIu64 " found %d\n", i, got);
+      exit(1);
+    }
+    if (test_has(map, miss, test_miss(key, len, miss, sizeof(miss)), &val)) {
+      printf("miss %" PRIu64 " found\n", i);
+      exit(1);
+    }
+  }
+}
+
+
+
+#endif // _MapV_MapV_testUtil_h_
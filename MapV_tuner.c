@@ -0,0 +1,112 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <getopt.h>
+
+#include "MapV.h"
+#include "MapV_File.h"
+#include "MapV_Tune.h"
+
+/*
+mapv-tune -k ./input.english_words.10k.txt
+mapv-tune -k ./input.alexa_domains.1M.txt -m 64000000
+mapv-tune -k ./input.alexa_domains.1M.txt -l 60 -n 100000
+*/
+
+//------------------------------------------------------------------------------
+static void
+usage(void);
+
+
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  const char*     fileKeys  = NULL;
+  uint64_t        sampleCnt = 0;
+  MapV_TuneCfg_st cfg       = {0};
+
+  int opt;
+  while (-1 != (opt = getopt(argc, argv, "k:m:l:f:n:Sh"))) {
+    switch (opt) {
+      case 'k': fileKeys        = optarg;                  break;
+      case 'm': cfg.memBytesMax = strtoull(optarg, 0, 0);  break;
+      case 'l': cfg.p99NsMax    = atof(optarg);            break;
+      case 'f': cfg.fpBits      = strtoul(optarg, 0, 0);   break;
+      case 'n': sampleCnt       = strtoull(optarg, 0, 0);  break;
+      case 'S': cfg.set         = true;                    break;
+      default : usage(); return 1;
+    }
+  }
+
+  if (NULL == fileKeys) {
+    printf("FATAL: a key file is required (-k)\n\n");
+    usage();
+    return 1;
+  }
+
+  MapV_File_st* keys = MapV_FileOpen(fileKeys);
+  if (NULL == keys) {
+    return 1;
+  }
+
+  // an even spread over the file, rather than its first lines
+  cfg.keysCnt = (sampleCnt && sampleCnt < keys->linesCnt)
+              ? sampleCnt : keys->linesCnt;
+  const void** keyPtrs = malloc(cfg.keysCnt * sizeof(*keyPtrs));
+  size_t*      keyLens = malloc(cfg.keysCnt * sizeof(*keyLens));
+  if (NULL == keyPtrs || NULL == keyLens) {
+    printf("FATAL: out of memory\n");
+    return 1;
+  }
+  for (uint64_t i = 0; i < cfg.keysCnt; i++) {
+    keyPtrs[i] = MapV_FileLine(keys, i * keys->linesCnt / cfg.keysCnt,
+                               &keyLens[i]);
+  }
+  cfg.keys    = keyPtrs;
+  cfg.keyLens = keyLens;
+
+  fprintf(stderr, "keys file          : %s\n", fileKeys);
+  fprintf(stderr, "keys sampled       : %"PRIu64" of %"PRIu64"\n",
+          cfg.keysCnt, keys->linesCnt);
+
+  MapV_TuneResult_st* res = MapV_Tune(&cfg);
+  if (NULL == res) {
+    printf("FATAL: MapV_Tune failed\n");
+    return 1;
+  }
+  MapV_TunePrint(res, stdout);
+
+  const int ret = (-1 == res->best) ? 2 : 0;
+  MapV_TuneFree(res);
+  free(keyPtrs);
+  free(keyLens);
+  MapV_FileClose(keys);
+
+  return ret;
+}
+
+
+//------------------------------------------------------------------------------
+static void
+usage(void)
+{
+  printf(
+    "usage: mapv-tune -k <keys file> [options]\n"
+    "\n"
+    "builds the keys into a grid of distSlotMax / distBktMax / capPctMax\n"
+    "configs, times lookups (hits and misses) on each, and prints the\n"
+    "memory/throughput/latency curve and the best config for the target.\n"
+    "exits 2 if no config met it.\n"
+    "\n"
+    "options:\n"
+    "  -k <file>   keys, one per line\n"
+    "  -m <bytes>  memory target: the fastest table no bigger than this\n"
+    "  -l <ns>     latency target: the smallest table with p99 within this\n"
+    "  -f <bits>   cfg.fpBits: 64, 96 or 128 (default 128). not tuned\n"
+    "  -S          tune a set (cfg.set)\n"
+    "  -n <n>      tune on n keys spread over the file (default: all).\n"
+    "              table sizes, and -m, are then for n keys\n"
+  );
+}